@@ -5,30 +5,76 @@
 //
 #include "P256.h"
 #include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config_platform.h"
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <pthread.h>
+#endif
+#ifdef P256_NATIVE
+#include "p256_native.h"
+#endif
+#include "vrf_metrics.h"
 
 const int use_toy_curve = 0;
 const int kill_randomness = 0;
 
 #ifdef DEBUG
-// temporary utilitary functions for simple allocation/deallocation check
-static int num_bn_allocated = 0;
-static int num_bn_freed = 0;
-static int num_point_allocated = 0;
-static int num_point_freed = 0;
+#include <stdatomic.h>
+// temporary utilitary functions for simple allocation/deallocation check (atomic, counted from several threads)
+static atomic_int num_bn_allocated = 0;
+static atomic_int num_bn_freed = 0;
+static atomic_int num_point_allocated = 0;
+static atomic_int num_point_freed = 0;
 // print utilitary information about bn_new/bn_free and point_new/point_free
 void print_allocation_status(void) {
-    printf("BIGNUM allocation: %d new, %d free (%d unfreed)\n", num_bn_allocated, num_bn_freed, num_bn_allocated-num_bn_freed);
-    printf("EC_POINT allocation: %d new, %d free (%d unfreed)\n", num_point_allocated, num_point_freed, num_point_allocated-num_point_freed);
+    int bn_allocated = atomic_load(&num_bn_allocated);
+    int bn_freed = atomic_load(&num_bn_freed);
+    int point_allocated = atomic_load(&num_point_allocated);
+    int point_freed = atomic_load(&num_point_freed);
+    printf("BIGNUM allocation: %d new, %d free (%d unfreed)\n", bn_allocated, bn_freed, bn_allocated-bn_freed);
+    printf("EC_POINT allocation: %d new, %d free (%d unfreed)\n", point_allocated, point_freed, point_allocated-point_freed);
+}
+
+int allocation_count(void) {
+    return atomic_load(&num_bn_allocated) + atomic_load(&num_point_allocated);
 }
 #endif
 
 static EC_GROUP *group = NULL;
+static BIGNUM *field_prime = NULL;
+static BN_MONT_CTX *field_mont = NULL;
+
+static void group_init(void);
+
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+static INIT_ONCE group_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK group_init_once(PINIT_ONCE once, PVOID param, PVOID *context) {
+    group_init();
+    return TRUE;
+}
 
 const EC_GROUP *get0_group(void) {
-    if (group) {
-        return group;
-    }
+    InitOnceExecuteOnce(&group_once, group_init_once, NULL, NULL);
+    return group;
+}
+#else
+static pthread_once_t group_once = PTHREAD_ONCE_INIT;
+
+// thread-safe, the group is instantiated once by whichever thread comes first
+const EC_GROUP *get0_group(void) {
+    int ret = pthread_once(&group_once, group_init);
+    assert(ret == 0 && "get0Group: pthread_once failed");
+    return group;
+}
+#endif
 
+static void group_init(void) {
     // instantiate group
     if (use_toy_curve) { // use toy curve
         // ----------- Custom group (toy curve EC29 for debugging) ---------
@@ -58,12 +104,30 @@ const EC_GROUP *get0_group(void) {
 //        exit(1);
     }
     assert(group && "get0Group: group not instantiated");
-    return group;
+
+    // field prime and its Montgomery context, live as long as the group (raw BN_new, not an allocation to track)
+    BN_CTX *ctx = BN_CTX_new();
+    field_prime = BN_new();
+    field_mont = BN_MONT_CTX_new();
+    assert(ctx && field_prime && field_mont && "get0Group: allocation failed");
+    int ret = EC_GROUP_get_curve_GFp(group, field_prime, NULL, NULL, ctx) && BN_MONT_CTX_set(field_mont, field_prime, ctx);
+    assert(ret == 1 && "get0Group: field Montgomery context not set");
+    BN_CTX_free(ctx);
+
+#if P256_GENERATOR_TABLE
+    // the P-256 implementations of libcrypto (ecp_nistz256, ecp_nistp256) come with a static
+    // generator table built together with the library, other builds get a table computed once here
+    if (!EC_GROUP_have_precompute_mult(group)) {
+        int ret = EC_GROUP_precompute_mult(group, NULL);
+        assert(ret == 1 && "get0Group: generator precomputation failed");
+    }
+#endif
 }
 
 BIGNUM *bn_new(void) {
     BIGNUM *bn = BN_new();
     assert(bn && "bn_new: allocation failed");
+    VRF_METRICS_COUNT(VRF_METRICS_BN_ALLOC, 1);
 #ifdef DEBUG
     num_bn_allocated++;
 #endif
@@ -77,6 +141,14 @@ void bn_free(BIGNUM *bn) {
 #endif
 }
 
+const BIGNUM *get0_field_prime(const EC_GROUP *g) {
+    return g == get0_group() ? field_prime : NULL;
+}
+
+BN_MONT_CTX *get0_field_mont(const EC_GROUP *g) {
+    return g == get0_group() ? field_mont : NULL;
+}
+
 const BIGNUM* get0_order(const EC_GROUP *group) {
     // using get0 means ownership is reteined by parent object
     const BIGNUM *order = EC_GROUP_get0_order(group);
@@ -91,6 +163,14 @@ const EC_POINT* get0_generator(const EC_GROUP *group) {
     return generator;
 }
 
+int point_is_generator(const EC_GROUP *group, const EC_POINT *point) {
+#if P256_GENERATOR_TABLE
+    return point == EC_GROUP_get0_generator(group);
+#else
+    return 0;
+#endif
+}
+
 void bn_print(const BIGNUM *x) {
     char *num = BN_bn2dec(x);
     printf("%s", num);
@@ -100,6 +180,7 @@ void bn_print(const BIGNUM *x) {
 EC_POINT *point_new(const EC_GROUP *group) {
     EC_POINT *p = EC_POINT_new(group);
     assert(p && "point_new: allocation failed");
+    VRF_METRICS_COUNT(VRF_METRICS_POINT_ALLOC, 1);
 #ifdef DEBUG
     num_point_allocated++;
 #endif
@@ -156,15 +237,40 @@ void point_print(const EC_GROUP *group, const EC_POINT *p, BN_CTX *ctx){
     bn_free(y);
 }
 
+int point_to_bytes(const EC_GROUP *group, const EC_POINT *point, unsigned char *buf, BN_CTX *ctx) {
+    if (EC_POINT_is_at_infinity(group, point)) {
+        return 1; // no fixed-size encoding
+    }
+    VRF_METRICS_COUNT(VRF_METRICS_POINT_ENCODE, 1);
+    size_t len = EC_POINT_point2oct(group, point, POINT_CONVERSION_COMPRESSED, buf, P256_POINT_BYTES, ctx);
+    return len != P256_POINT_BYTES;
+}
+
+int point_from_bytes(const EC_GROUP *group, EC_POINT *point, const unsigned char *buf, BN_CTX *ctx) {
+    if (buf[0] != POINT_CONVERSION_COMPRESSED && buf[0] != (POINT_CONVERSION_COMPRESSED | 1)) {
+        return 1; // not a compressed point
+    }
+    // EC_POINT_oct2point rejects x >= p and x not on the curve
+    return EC_POINT_oct2point(group, point, buf, P256_POINT_BYTES, ctx) != 1;
+}
+
+int bn_to_bytes(const BIGNUM *bn, unsigned char *buf) {
+    return BN_bn2binpad(bn, buf, P256_SCALAR_BYTES) != P256_SCALAR_BYTES;
+}
+
 // random bignum (modulo group order)
 BIGNUM* bn_random(const BIGNUM *modulus, BN_CTX *ctx) {
     BIGNUM *r = bn_new();
     assert(r && "random_bignum: no r generated");
+    bn_random_r(r, modulus, ctx);
+    return r;
+}
 
+void bn_random_r(BIGNUM *r, const BIGNUM *modulus, BN_CTX *ctx) {
     if (kill_randomness) { // eliminate randomness, all rands are five
         int ret = BN_set_word(r, 5);
         assert(ret == 1 && "random_bignum: BN_set_word error");
-        return r;
+        return;
     }
 
     // set to uniformly random value
@@ -172,18 +278,50 @@ BIGNUM* bn_random(const BIGNUM *modulus, BN_CTX *ctx) {
     assert(ret == 1 && "random_bignum: BN_rand error");
     ret = BN_mod(r, r, modulus, ctx);
     assert(ret == 1 && "random_bignum: BN_mod error");
-    return r;
 }
 
 BIGNUM *bn_from_binary_data(int len, const unsigned char *buf) {
     BIGNUM *bn = BN_bin2bn(buf, len, NULL);
     assert(bn && "bn_from_binary_data: allocation failure");
+    VRF_METRICS_COUNT(VRF_METRICS_BN_ALLOC, 1);
 #ifdef DEBUG
     num_bn_allocated++;
 #endif
     return bn;
 }
 
+void bn_mod_inverse_batch(BIGNUM **r, int num, const BIGNUM **a, const BIGNUM *modulus, BN_CTX *ctx) {
+    if (num <= 0) {
+        return;
+    }
+    // prefix[k] = a[0] * ... * a[k]
+    BN_CTX_start(ctx);
+    BIGNUM **prefix = malloc(num * sizeof(BIGNUM*));
+    assert(prefix && "bn_mod_inverse_batch: allocation error");
+    for (int k=0; k<num; k++) {
+        prefix[k] = BN_CTX_get(ctx);
+    }
+    BIGNUM *inv = BN_CTX_get(ctx);
+    BIGNUM *ak = BN_CTX_get(ctx);
+    assert(ak && "bn_mod_inverse_batch: BN_CTX_get failed");
+    int ret = BN_copy(prefix[0], a[0]) != NULL;
+    for (int k=1; k<num; k++) {
+        ret &= BN_mod_mul(prefix[k], prefix[k-1], a[k], modulus, ctx);
+    }
+    ret &= BN_mod_inverse(inv, prefix[num-1], modulus, ctx) != NULL;
+    assert(ret == 1 && "bn_mod_inverse_batch: usage error, a zero or non invertible element");
+    // inv = 1/prefix[k] going down, 1/a[k] = inv * prefix[k-1]
+    for (int k=num-1; k>0; k--) {
+        ret &= BN_copy(ak, a[k]) != NULL;
+        ret &= BN_mod_mul(r[k], inv, prefix[k-1], modulus, ctx);
+        ret &= BN_mod_mul(inv, inv, ak, modulus, ctx);
+    }
+    ret &= BN_copy(r[0], inv) != NULL;
+    assert(ret == 1 && "bn_mod_inverse_batch: computation failed");
+    free(prefix);
+    BN_CTX_end(ctx);
+}
+
 // check for point equality
 int point_cmp(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *b, BN_CTX *ctx) {
     int ret = EC_POINT_cmp(group, a, b, ctx);
@@ -201,49 +339,949 @@ EC_POINT *point_random(const EC_GROUP *group, BN_CTX *ctx) {
     return point;
 }
 
+#ifdef P256_NATIVE
+// r = bn * point (point NULL for the generator) with the native backend, returns 1 (nothing done) for the toy curve
+// and for scalars outside of [0, 2^256)
+static int point_mul_native(const EC_GROUP *group, EC_POINT *r, const BIGNUM *bn, const EC_POINT *point, BN_CTX *ctx) {
+    unsigned char scalar[P256_SCALAR_BYTES];
+    if (use_toy_curve || BN_is_negative(bn) || bn_to_bytes(bn, scalar)) {
+        return 1;
+    }
+    p256_point a;
+    if (point) {
+        int ret = p256_native_from_ec_point(&a, group, point, ctx);
+        assert(ret == 0 && "point_mul_native: conversion from EC_POINT failed");
+        p256_native_point_mul(&a, scalar, &a);
+    } else {
+        p256_native_base_mul(&a, scalar);
+    }
+    int ret = p256_native_to_ec_point(group, r, &a, ctx);
+    assert(ret == 0 && "point_mul_native: conversion to EC_POINT failed");
+    return 0;
+}
+#endif
+
 void point_mul(const EC_GROUP *group, EC_POINT *r, const BIGNUM *bn, const EC_POINT *point, BN_CTX *ctx) {
-    int ret = EC_POINT_mul(group, r, NULL, point, bn, ctx);
+    VRF_METRICS_COUNT(point_is_generator(group, point) ? VRF_METRICS_BASE_MUL : VRF_METRICS_SCALAR_MUL, 1);
+#ifdef P256_NATIVE
+    if (point_mul_native(group, r, bn, point_is_generator(group, point) ? NULL : point, ctx) == 0) {
+        return;
+    }
+#endif
+    int ret;
+    if (point_is_generator(group, point)) { // use the fixed-base table
+        ret = EC_POINT_mul(group, r, bn, NULL, NULL, ctx);
+    } else {
+        ret = EC_POINT_mul(group, r, NULL, point, bn, ctx);
+    }
     assert(ret == 1 && "point_mul: EC_POINT_mul failed");
 }
 
+// Straus, i.e. the interleaved wNAF multiplication of EC_POINTs_mul, generator terms use the fixed-base table
+static void point_weighted_sum_straus(const EC_GROUP *group, EC_POINT *r, int num_terms, const BIGNUM **w, const EC_POINT **p, BN_CTX *ctx) {
+    const EC_POINT **points = malloc(num_terms * sizeof(EC_POINT*));
+    const BIGNUM **scalars = malloc(num_terms * sizeof(BIGNUM*));
+    assert(points && scalars && "point_weighted_sum_straus: allocation error");
+    BIGNUM *g_scalar = NULL;
+    int num_points = 0;
+    for (int i=0; i<num_terms; i++) {
+        if (point_is_generator(group, p[i])) {
+            if (!g_scalar) {
+                g_scalar = bn_new();
+                BN_zero(g_scalar);
+            }
+            int ret = BN_mod_add(g_scalar, g_scalar, w[i], get0_order(group), ctx);
+            assert(ret == 1 && "point_weighted_sum_straus: BN_mod_add failed");
+        } else {
+            points[num_points] = p[i];
+            scalars[num_points++] = w[i];
+        }
+    }
+    int ret = EC_POINTs_mul(group, r, g_scalar, num_points, points, scalars, ctx);
+    assert(ret == 1 && "point_weighted_sum_straus: EC_POINTs_mul failed");
+
+    // cleanup
+    if (g_scalar) {
+        bn_free(g_scalar);
+    }
+    free(points);
+    free(scalars);
+}
+
+// window size minimizing (number of windows) * (additions into buckets + 2 additions per bucket)
+static int point_weighted_sum_pippenger_window(int num_terms) {
+    int best_c = 2;
+    double best_cost = 0;
+    for (int c=2; c<=16; c++) {
+        double cost = (double)(256 / c + 1) * ((double)num_terms + (double)(1 << c));
+        if (c == 2 || cost < best_cost) {
+            best_c = c;
+            best_cost = cost;
+        }
+    }
+    return best_c;
+}
+
+// bits [bit, bit+c) of the big-endian scalar s (P256_SCALAR_BYTES)
+static int point_weighted_sum_pippenger_bits(const unsigned char *s, int bit, int c) {
+    int v = 0;
+    for (int i=0; i<c && bit+i < 8*P256_SCALAR_BYTES; i++) {
+        int b = bit + i;
+        v |= ((s[P256_SCALAR_BYTES - 1 - b/8] >> (b%8)) & 1) << i;
+    }
+    return v;
+}
+
+/*
+ * Pippenger bucket method with c-bit windows (2 <= c <= 16) and signed digits in [-2^(c-1), 2^(c-1)): per window
+ * every point is added (or its negation subtracted) into one of 2^(c-1) buckets, and the buckets are summed with a
+ * running sum. The scalars come as P256_SCALAR_BYTES each, points[0..num_terms-1] are affine so that bucket
+ * additions are mixed additions and points[num_terms + i] is the negation of points[i].
+ */
+static void point_weighted_sum_pippenger_buckets(const EC_GROUP *group, EC_POINT *r, int num_terms, const unsigned char *scalars, EC_POINT **points, int c, BN_CTX *ctx) {
+    assert(c >= 2 && c <= 16 && "point_weighted_sum_pippenger: usage error, unexpected window size");
+    int num_windows = 256 / c + 1; // num_windows * c > 256, the top digit absorbs the last carry
+    int num_buckets = 1 << (c - 1);
+
+    // scalars to signed digits
+    int16_t *digits = malloc((size_t)num_terms * num_windows * sizeof(int16_t));
+    assert(digits && "point_weighted_sum_pippenger: allocation error (digits)");
+    for (int i=0; i<num_terms; i++) {
+        const unsigned char *s = scalars + (size_t)i * P256_SCALAR_BYTES;
+        int carry = 0;
+        for (int k=0; k<num_windows; k++) {
+            int d = point_weighted_sum_pippenger_bits(s, k*c, c) + carry;
+            carry = d >= num_buckets;
+            digits[(size_t)i*num_windows + k] = (int16_t)(carry ? d - (1 << c) : d);
+        }
+    }
+
+    EC_POINT **buckets = malloc(num_buckets * sizeof(EC_POINT*));
+    assert(buckets && "point_weighted_sum_pippenger: allocation error (buckets)");
+    for (int j=0; j<num_buckets; j++) {
+        buckets[j] = point_new(group);
+    }
+    EC_POINT *running = point_new(group);
+    EC_POINT *window_sum = point_new(group);
+
+    EC_POINT_set_to_infinity(group, r);
+    for (int k=num_windows-1; k>=0; k--) {
+        for (int i=0; i<c && k<num_windows-1; i++) {
+            EC_POINT_dbl(group, r, r, ctx);
+        }
+        for (int j=0; j<num_buckets; j++) {
+            EC_POINT_set_to_infinity(group, buckets[j]);
+        }
+        for (int i=0; i<num_terms; i++) {
+            int d = digits[(size_t)i*num_windows + k];
+            if (d > 0) {
+                point_add(group, buckets[d-1], buckets[d-1], points[i], ctx);
+            } else if (d < 0) {
+                point_add(group, buckets[-d-1], buckets[-d-1], points[num_terms + i], ctx);
+            }
+        }
+        // window_sum = sum_j (j+1) * buckets[j]
+        EC_POINT_set_to_infinity(group, running);
+        EC_POINT_set_to_infinity(group, window_sum);
+        for (int j=num_buckets-1; j>=0; j--) {
+            point_add(group, running, running, buckets[j], ctx);
+            point_add(group, window_sum, window_sum, running, ctx);
+        }
+        point_add(group, r, r, window_sum, ctx);
+    }
+
+    // cleanup
+    point_free(window_sum);
+    point_free(running);
+    for (int j=0; j<num_buckets; j++) {
+        point_free(buckets[j]);
+    }
+    free(buckets);
+    free(digits);
+}
+
+// negations of points[0..num_terms-1] to points[num_terms..2*num_terms-1]
+static void point_weighted_sum_pippenger_negate(const EC_GROUP *group, int num_terms, EC_POINT **points, BN_CTX *ctx) {
+    for (int i=0; i<num_terms; i++) {
+        points[num_terms + i] = point_new(group);
+        EC_POINT_copy(points[num_terms + i], points[i]);
+        EC_POINT_invert(group, points[num_terms + i], ctx);
+    }
+}
+
+static void point_weighted_sum_pippenger(const EC_GROUP *group, EC_POINT *r, int num_terms, const BIGNUM **w, const EC_POINT **p, BN_CTX *ctx) {
+    const BIGNUM *order = get0_order(group);
+
+    // scalars reduced and encoded one after the other
+    unsigned char *scalars = malloc((size_t)num_terms * P256_SCALAR_BYTES);
+    assert(scalars && "point_weighted_sum_pippenger: allocation error (scalars)");
+    BIGNUM *reduced = bn_new();
+    for (int i=0; i<num_terms; i++) {
+        const BIGNUM *wi = w[i];
+        if (BN_is_negative(wi) || BN_cmp(wi, order) >= 0) {
+            int ret = BN_nnmod(reduced, wi, order, ctx);
+            assert(ret == 1 && "point_weighted_sum_pippenger: BN_nnmod failed");
+            wi = reduced;
+        }
+        int ret = BN_bn2binpad(wi, scalars + (size_t)i * P256_SCALAR_BYTES, P256_SCALAR_BYTES);
+        assert(ret == P256_SCALAR_BYTES && "point_weighted_sum_pippenger: BN_bn2binpad failed");
+    }
+    bn_free(reduced);
+
+    // affine copies of the points and their negations
+    EC_POINT **points = malloc(2 * (size_t)num_terms * sizeof(EC_POINT*));
+    assert(points && "point_weighted_sum_pippenger: allocation error (points)");
+    for (int i=0; i<num_terms; i++) {
+        points[i] = point_new(group);
+        EC_POINT_copy(points[i], p[i]);
+    }
+    int ret = EC_POINTs_make_affine(group, num_terms, points, ctx);
+    assert(ret == 1 && "point_weighted_sum_pippenger: EC_POINTs_make_affine failed");
+    point_weighted_sum_pippenger_negate(group, num_terms, points, ctx);
+
+    point_weighted_sum_pippenger_buckets(group, r, num_terms, scalars, points, point_weighted_sum_pippenger_window(num_terms), ctx);
+
+    // cleanup
+    for (int i=0; i<2*num_terms; i++) {
+        point_free(points[i]);
+    }
+    free(points);
+    free(scalars);
+}
+
 // r = sum_{0..n-1}(w_i * p[i])
 void point_weighted_sum(const EC_GROUP *group, EC_POINT *r, int num_terms, const BIGNUM **w, const EC_POINT **p, BN_CTX *ctx) {
     assert(num_terms > 0 && "point_weighted_sum: usage error, unexpected parameter");
-    point_mul(group, r, w[0], p[0], ctx);
-    EC_POINT *t = point_new(group); // temp
-    assert(t && "point_weighted_sum: usage error, unexpected parameter");
-    for (int i=1; i<num_terms; i++) {
-        point_mul(group, t, w[i], p[i], ctx);
-        point_add(group, r, r, t, ctx);
+    VRF_METRICS_COUNT(VRF_METRICS_MSM, 1);
+    VRF_METRICS_COUNT(VRF_METRICS_MSM_TERMS, num_terms);
+    if (num_terms < P256_MSM_PIPPENGER_THRESHOLD) {
+        point_weighted_sum_straus(group, r, num_terms, w, p, ctx);
+    } else {
+        point_weighted_sum_pippenger(group, r, num_terms, w, p, ctx);
     }
-
-    // cleanup
-    point_free(t);
 }
 
 void point_add(const EC_GROUP *group, EC_POINT *r, const EC_POINT *a, const EC_POINT *b, BN_CTX *ctx) {
+    VRF_METRICS_COUNT(VRF_METRICS_POINT_ADD, 1);
     int ret = EC_POINT_add(group, r, a, b, ctx);
     assert(ret == 1 && "point_add: EC_POINT_add failed");
 }
 
 void point_sub(const EC_GROUP *group, EC_POINT *r, const EC_POINT *a, const EC_POINT *b, BN_CTX *ctx) {
-    EC_POINT *b_copy = EC_POINT_dup(b, group);
-#ifdef DEBUG
-    num_point_allocated++;
-#endif
-    assert(b_copy && "point_sub: point duplication failed");
-    int ret = EC_POINT_invert(group, b_copy, ctx); // invert b_copy instead of b to avoid side effects on input parameter
-    assert(ret == 1 && "point_sub: EC_POINT_invert failed");
-    ret = EC_POINT_add(group, r, a, b_copy, ctx);
-    assert(ret == 1 && "point_sub: EC_POINT_add failed");
-    point_free(b_copy);
+    VRF_METRICS_COUNT(VRF_METRICS_POINT_ADD, 1);
+    // work in r instead of a copy of b to avoid side effects on the input parameters without allocating
+    int ret;
+    if (r != a) { // r = a + (-b)
+        ret = EC_POINT_copy(r, b);
+        assert(ret == 1 && "point_sub: EC_POINT_copy failed");
+        ret = EC_POINT_invert(group, r, ctx);
+        assert(ret == 1 && "point_sub: EC_POINT_invert failed");
+        ret = EC_POINT_add(group, r, a, r, ctx);
+        assert(ret == 1 && "point_sub: EC_POINT_add failed");
+    } else { // r = -((-a) + b)
+        ret = EC_POINT_invert(group, r, ctx);
+        assert(ret == 1 && "point_sub: EC_POINT_invert failed");
+        ret = EC_POINT_add(group, r, r, b, ctx);
+        assert(ret == 1 && "point_sub: EC_POINT_add failed");
+        ret = EC_POINT_invert(group, r, ctx);
+        assert(ret == 1 && "point_sub: EC_POINT_invert failed");
+    }
 }
 
 // convert bignum to point
 EC_POINT *bn2point(const EC_GROUP *group, const BIGNUM *bn, BN_CTX *ctx) {
     EC_POINT *point = point_new(group);
     assert(point && "bn2point: no point allocated");
-    int ret = EC_POINT_mul(group, point, bn, NULL, NULL, ctx);
-    assert(ret == 1 && "bn2point: EC_POINT_mul failed");
+    bn2point_r(group, point, bn, ctx);
     return point;
 }
+
+void bn2point_r(const EC_GROUP *group, EC_POINT *r, const BIGNUM *bn, BN_CTX *ctx) {
+    VRF_METRICS_COUNT(VRF_METRICS_BASE_MUL, 1);
+#ifdef P256_NATIVE
+    if (point_mul_native(group, r, bn, P256_GENERATOR_TABLE ? NULL : get0_generator(group), ctx) == 0) {
+        return;
+    }
+#endif
+#if P256_GENERATOR_TABLE
+    int ret = EC_POINT_mul(group, r, bn, NULL, NULL, ctx);
+#else
+    int ret = EC_POINT_mul(group, r, NULL, get0_generator(group), bn, ctx);
+#endif
+    assert(ret == 1 && "bn2point: EC_POINT_mul failed");
+}
+
+/*
+ *
+ *  scratch arena
+ *
+ */
+#define P256_ARENA_MAX_FRAMES 16
+
+struct p256_arena {
+    const EC_GROUP *group;
+    BN_CTX *bn_ctx;
+    BIGNUM **bns;
+    int num_bns; // allocated
+    int bn_top; // next free
+    EC_POINT **points;
+    int num_points;
+    int point_top;
+    int bn_frames[P256_ARENA_MAX_FRAMES];
+    int point_frames[P256_ARENA_MAX_FRAMES];
+    int num_frames;
+};
+
+// make room for at least num_bns BIGNUMs and num_points EC_POINTs
+static void p256_arena_reserve(p256_arena *arena, int num_bns, int num_points) {
+    if (num_bns > arena->num_bns) {
+        arena->bns = realloc(arena->bns, num_bns * sizeof(BIGNUM*));
+        assert(arena->bns && "p256_arena_reserve: allocation error (bns)");
+        for (int i=arena->num_bns; i<num_bns; i++) {
+            arena->bns[i] = bn_new();
+        }
+        arena->num_bns = num_bns;
+    }
+    if (num_points > arena->num_points) {
+        arena->points = realloc(arena->points, num_points * sizeof(EC_POINT*));
+        assert(arena->points && "p256_arena_reserve: allocation error (points)");
+        for (int i=arena->num_points; i<num_points; i++) {
+            arena->points[i] = point_new(arena->group);
+        }
+        arena->num_points = num_points;
+    }
+}
+
+p256_arena *p256_arena_new(const EC_GROUP *group, int num_bns, int num_points) {
+    p256_arena *arena = calloc(1, sizeof(p256_arena));
+    assert(arena && "p256_arena_new: allocation error");
+    arena->group = group;
+    arena->bn_ctx = BN_CTX_new();
+    assert(arena->bn_ctx && "p256_arena_new: BN_CTX_new failed");
+    p256_arena_reserve(arena, num_bns, num_points);
+    return arena;
+}
+
+void p256_arena_free(p256_arena *arena) {
+    assert(arena->num_frames == 0 && "p256_arena_free: usage error, unbalanced p256_arena_start");
+    for (int i=0; i<arena->num_bns; i++) {
+        bn_free(arena->bns[i]);
+    }
+    for (int i=0; i<arena->num_points; i++) {
+        point_free(arena->points[i]);
+    }
+    free(arena->bns);
+    free(arena->points);
+    BN_CTX_free(arena->bn_ctx);
+    free(arena);
+}
+
+void p256_arena_start(p256_arena *arena) {
+    assert(arena->num_frames < P256_ARENA_MAX_FRAMES && "p256_arena_start: too many nested frames");
+    arena->bn_frames[arena->num_frames] = arena->bn_top;
+    arena->point_frames[arena->num_frames] = arena->point_top;
+    arena->num_frames++;
+}
+
+void p256_arena_end(p256_arena *arena) {
+    assert(arena->num_frames > 0 && "p256_arena_end: usage error, no matching p256_arena_start");
+    arena->num_frames--;
+    arena->bn_top = arena->bn_frames[arena->num_frames];
+    arena->point_top = arena->point_frames[arena->num_frames];
+}
+
+BIGNUM *p256_arena_bn(p256_arena *arena) {
+    assert(arena->num_frames > 0 && "p256_arena_bn: usage error, no frame started");
+    if (arena->bn_top == arena->num_bns) {
+        p256_arena_reserve(arena, 2 * arena->num_bns + 1, 0);
+    }
+    BIGNUM *bn = arena->bns[arena->bn_top++];
+    BN_zero(bn);
+    return bn;
+}
+
+EC_POINT *p256_arena_point(p256_arena *arena) {
+    assert(arena->num_frames > 0 && "p256_arena_point: usage error, no frame started");
+    if (arena->point_top == arena->num_points) {
+        p256_arena_reserve(arena, 0, 2 * arena->num_points + 1);
+    }
+    return arena->points[arena->point_top++];
+}
+
+BN_CTX *p256_arena_get0_bn_ctx(p256_arena *arena) {
+    return arena->bn_ctx;
+}
+
+/*
+ *
+ *  contiguous vectors
+ *
+ */
+
+// block of size bytes aligned to P256_VEC_ALIGN
+static void *p256_vec_alloc(size_t size) {
+    void *p;
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+    p = _aligned_malloc(size, P256_VEC_ALIGN);
+#else
+    if (posix_memalign(&p, P256_VEC_ALIGN, size)) {
+        p = NULL;
+    }
+#endif
+    assert(p && "p256_vec_alloc: allocation error");
+    return p;
+}
+
+static void p256_vec_free(void *p) {
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+// size rounded up to a multiple of P256_VEC_ALIGN, the arrays of a vector each start on a cache line
+static size_t p256_vec_round(size_t size) {
+    return (size + P256_VEC_ALIGN - 1) / P256_VEC_ALIGN * P256_VEC_ALIGN;
+}
+
+scalar_vec *scalar_vec_new(int num) {
+    assert(num >= 0 && "scalar_vec_new: usage error, negative length");
+    scalar_vec *v = malloc(sizeof(scalar_vec));
+    assert(v && "scalar_vec_new: allocation error");
+    size_t size = p256_vec_round((size_t)num * P256_SCALAR_BYTES + 1);
+    v->num = num;
+    v->data = p256_vec_alloc(size);
+    memset(v->data, 0, size);
+    return v;
+}
+
+void scalar_vec_free(scalar_vec *v) {
+    p256_vec_free(v->data);
+    free(v);
+}
+
+void scalar_vec_from_bns(const EC_GROUP *group, scalar_vec *v, const BIGNUM **bns, BN_CTX *ctx) {
+    const BIGNUM *order = get0_order(group);
+    BN_CTX_start(ctx);
+    BIGNUM *reduced = BN_CTX_get(ctx);
+    assert(reduced && "scalar_vec_from_bns: BN_CTX_get failed");
+    for (int i=0; i<v->num; i++) {
+        const BIGNUM *bn = bns[i];
+        if (BN_is_negative(bn) || BN_cmp(bn, order) >= 0) {
+            int ret = BN_nnmod(reduced, bn, order, ctx);
+            assert(ret == 1 && "scalar_vec_from_bns: BN_nnmod failed");
+            bn = reduced;
+        }
+        int ret = BN_bn2binpad(bn, v->data + (size_t)i * P256_SCALAR_BYTES, P256_SCALAR_BYTES);
+        assert(ret == P256_SCALAR_BYTES && "scalar_vec_from_bns: BN_bn2binpad failed");
+    }
+    BN_CTX_end(ctx);
+}
+
+void scalar_vec_to_bns(const scalar_vec *v, BIGNUM **bns) {
+    for (int i=0; i<v->num; i++) {
+        BIGNUM *ret = BN_bin2bn(v->data + (size_t)i * P256_SCALAR_BYTES, P256_SCALAR_BYTES, bns[i]);
+        assert(ret && "scalar_vec_to_bns: BN_bin2bn failed");
+    }
+}
+
+int scalar_vec_from_bytes(const EC_GROUP *group, scalar_vec *v, const unsigned char *buf) {
+    unsigned char order[P256_SCALAR_BYTES];
+    int ret = bn_to_bytes(get0_order(group), order);
+    assert(ret == 0 && "scalar_vec_from_bytes: order does not fit");
+    memcpy(v->data, buf, (size_t)v->num * P256_SCALAR_BYTES);
+    for (int i=0; i<v->num; i++) {
+        // big endian, byte order is numeric order
+        if (memcmp(v->data + (size_t)i * P256_SCALAR_BYTES, order, P256_SCALAR_BYTES) >= 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+point_vec *point_vec_new(int num) {
+    assert(num >= 0 && "point_vec_new: usage error, negative length");
+    point_vec *v = malloc(sizeof(point_vec));
+    assert(v && "point_vec_new: allocation error");
+    // one block: x, y, infinity
+    size_t coord_size = p256_vec_round((size_t)num * P256_FIELD_BYTES + 1);
+    size_t size = 2 * coord_size + p256_vec_round(num + 1);
+    v->num = num;
+    v->x = p256_vec_alloc(size);
+    v->y = v->x + coord_size;
+    v->infinity = v->y + coord_size;
+    memset(v->x, 0, 2 * coord_size);
+    memset(v->infinity, 1, num);
+    return v;
+}
+
+void point_vec_free(point_vec *v) {
+    p256_vec_free(v->x);
+    free(v);
+}
+
+void point_vec_from_points(const EC_GROUP *group, point_vec *v, const EC_POINT **points, BN_CTX *ctx) {
+    const BIGNUM *prime = get0_field_prime(group);
+    assert(prime && BN_num_bytes(prime) == P256_FIELD_BYTES && "point_vec_from_points: usage error, P-256 only");
+    BN_CTX_start(ctx);
+    // Jacobian coordinates of the points with Z != 1, all 1/Z from one inversion
+    BIGNUM **X = malloc(3 * (size_t)v->num * sizeof(BIGNUM*) + 1);
+    int *index = malloc((size_t)v->num * sizeof(int) + 1);
+    assert(X && index && "point_vec_from_points: allocation error");
+    BIGNUM **Y = X + v->num;
+    BIGNUM **Z = Y + v->num;
+    BIGNUM *z2 = BN_CTX_get(ctx);
+    BIGNUM *coord = BN_CTX_get(ctx);
+    assert(coord && "point_vec_from_points: BN_CTX_get failed");
+    int num_jacobian = 0;
+    int num_allocated = 0;
+    int ret = 1;
+    for (int i=0; i<v->num; i++) {
+        v->infinity[i] = (unsigned char)EC_POINT_is_at_infinity(group, points[i]);
+        if (v->infinity[i]) {
+            memset(v->x + (size_t)i * P256_FIELD_BYTES, 0, P256_FIELD_BYTES);
+            memset(v->y + (size_t)i * P256_FIELD_BYTES, 0, P256_FIELD_BYTES);
+            continue;
+        }
+        int j = num_jacobian;
+        if (j == num_allocated) { // affine points reuse the coordinates of the last one
+            X[j] = BN_CTX_get(ctx);
+            Y[j] = BN_CTX_get(ctx);
+            Z[j] = BN_CTX_get(ctx);
+            assert(Z[j] && "point_vec_from_points: BN_CTX_get failed");
+            num_allocated++;
+        }
+        ret &= EC_POINT_get_Jprojective_coordinates_GFp(group, points[i], X[j], Y[j], Z[j], ctx);
+        if (BN_is_one(Z[j])) {
+            ret &= BN_bn2binpad(X[j], v->x + (size_t)i * P256_FIELD_BYTES, P256_FIELD_BYTES) == P256_FIELD_BYTES;
+            ret &= BN_bn2binpad(Y[j], v->y + (size_t)i * P256_FIELD_BYTES, P256_FIELD_BYTES) == P256_FIELD_BYTES;
+            continue;
+        }
+        index[num_jacobian++] = i;
+    }
+    bn_mod_inverse_batch(Z, num_jacobian, (const BIGNUM**)Z, prime, ctx);
+    for (int j=0; j<num_jacobian; j++) {
+        // x = X / Z^2, y = Y / Z^3
+        int i = index[j];
+        ret &= BN_mod_sqr(z2, Z[j], prime, ctx);
+        ret &= BN_mod_mul(coord, X[j], z2, prime, ctx);
+        ret &= BN_bn2binpad(coord, v->x + (size_t)i * P256_FIELD_BYTES, P256_FIELD_BYTES) == P256_FIELD_BYTES;
+        ret &= BN_mod_mul(z2, z2, Z[j], prime, ctx);
+        ret &= BN_mod_mul(coord, Y[j], z2, prime, ctx);
+        ret &= BN_bn2binpad(coord, v->y + (size_t)i * P256_FIELD_BYTES, P256_FIELD_BYTES) == P256_FIELD_BYTES;
+    }
+    assert(ret == 1 && "point_vec_from_points: conversion failed");
+    free(index);
+    free(X);
+    BN_CTX_end(ctx);
+}
+
+void point_vec_to_points(const EC_GROUP *group, const point_vec *v, EC_POINT **points, BN_CTX *ctx) {
+    BN_CTX_start(ctx);
+    BIGNUM *x = BN_CTX_get(ctx);
+    BIGNUM *y = BN_CTX_get(ctx);
+    assert(y && "point_vec_to_points: BN_CTX_get failed");
+    int ret = 1;
+    for (int i=0; i<v->num; i++) {
+        if (v->infinity[i]) {
+            ret &= EC_POINT_set_to_infinity(group, points[i]);
+            continue;
+        }
+        ret &= BN_bin2bn(v->x + (size_t)i * P256_FIELD_BYTES, P256_FIELD_BYTES, x) != NULL;
+        ret &= BN_bin2bn(v->y + (size_t)i * P256_FIELD_BYTES, P256_FIELD_BYTES, y) != NULL;
+        ret &= EC_POINT_set_affine_coordinates_GFp(group, points[i], x, y, ctx);
+    }
+    assert(ret == 1 && "point_vec_to_points: conversion failed");
+    BN_CTX_end(ctx);
+}
+
+int point_vec_to_bytes(const point_vec *v, unsigned char *buf) {
+    for (int i=0; i<v->num; i++) {
+        if (v->infinity[i]) {
+            return 1;
+        }
+        unsigned char *p = buf + (size_t)i * P256_POINT_BYTES;
+        p[0] = 0x02 | (v->y[(size_t)i * P256_FIELD_BYTES + P256_FIELD_BYTES - 1] & 1);
+        memcpy(p + 1, v->x + (size_t)i * P256_FIELD_BYTES, P256_FIELD_BYTES);
+    }
+    return 0;
+}
+
+int point_vec_from_bytes(const EC_GROUP *group, point_vec *v, const unsigned char *buf, BN_CTX *ctx) {
+    BN_CTX_start(ctx);
+    BIGNUM *x = BN_CTX_get(ctx);
+    BIGNUM *y = BN_CTX_get(ctx);
+    assert(y && "point_vec_from_bytes: BN_CTX_get failed");
+    EC_POINT *point = point_new(group);
+    int ret = 0;
+    for (int i=0; i<v->num && ret == 0; i++) {
+        // decompressed points are affine
+        ret = point_from_bytes(group, point, buf + (size_t)i * P256_POINT_BYTES, ctx);
+        if (ret == 0) {
+            int ok = EC_POINT_get_affine_coordinates_GFp(group, point, x, y, ctx);
+            ok &= BN_bn2binpad(x, v->x + (size_t)i * P256_FIELD_BYTES, P256_FIELD_BYTES) == P256_FIELD_BYTES;
+            ok &= BN_bn2binpad(y, v->y + (size_t)i * P256_FIELD_BYTES, P256_FIELD_BYTES) == P256_FIELD_BYTES;
+            assert(ok == 1 && "point_vec_from_bytes: conversion failed");
+            v->infinity[i] = 0;
+        }
+    }
+    point_free(point);
+    BN_CTX_end(ctx);
+    return ret;
+}
+
+// Straus on the terms converted to BIGNUMs and EC_POINTs
+static void point_weighted_sum_vec_straus(const EC_GROUP *group, EC_POINT *r, const scalar_vec *w, const point_vec *p, BN_CTX *ctx) {
+    int num_terms = w->num;
+    BIGNUM **bns = bn_new_array(num_terms);
+    EC_POINT **points = malloc(num_terms * sizeof(EC_POINT*));
+    assert(points && "point_weighted_sum_vec_straus: allocation error");
+    for (int i=0; i<num_terms; i++) {
+        points[i] = point_new(group);
+    }
+    scalar_vec_to_bns(w, bns);
+    point_vec_to_points(group, p, points, ctx);
+    point_weighted_sum_straus(group, r, num_terms, (const BIGNUM**)bns, (const EC_POINT**)points, ctx);
+
+    // cleanup
+    for (int i=0; i<num_terms; i++) {
+        point_free(points[i]);
+    }
+    free(points);
+    bn_free_array(num_terms, bns);
+}
+
+// Pippenger on the scalars as they are and the points already affine
+static void point_weighted_sum_vec_pippenger(const EC_GROUP *group, EC_POINT *r, const scalar_vec *w, const point_vec *p, BN_CTX *ctx) {
+    int num_terms = w->num;
+    EC_POINT **points = malloc(2 * (size_t)num_terms * sizeof(EC_POINT*));
+    assert(points && "point_weighted_sum_vec_pippenger: allocation error");
+    for (int i=0; i<num_terms; i++) {
+        points[i] = point_new(group);
+    }
+    point_vec_to_points(group, p, points, ctx);
+    point_weighted_sum_pippenger_negate(group, num_terms, points, ctx);
+    point_weighted_sum_pippenger_buckets(group, r, num_terms, w->data, points, point_weighted_sum_pippenger_window(num_terms), ctx);
+
+    // cleanup
+    for (int i=0; i<2*num_terms; i++) {
+        point_free(points[i]);
+    }
+    free(points);
+}
+
+void point_weighted_sum_vec(const EC_GROUP *group, EC_POINT *r, const scalar_vec *w, const point_vec *p, BN_CTX *ctx) {
+    assert(w->num == p->num && w->num > 0 && "point_weighted_sum_vec: usage error, unexpected parameter");
+    VRF_METRICS_COUNT(VRF_METRICS_MSM, 1);
+    VRF_METRICS_COUNT(VRF_METRICS_MSM_TERMS, w->num);
+    if (w->num < P256_MSM_PIPPENGER_THRESHOLD) {
+        point_weighted_sum_vec_straus(group, r, w, p, ctx);
+    } else {
+        point_weighted_sum_vec_pippenger(group, r, w, p, ctx);
+    }
+}
+
+/*
+ *
+ *  P256 tests
+ *
+ */
+static int p256_test_1(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    const int num_terms = 50;
+    const BIGNUM *order = get0_order(group);
+
+    // random terms, including the generator, a zero weight and a weight larger than the order
+    BIGNUM **w = bn_new_array(num_terms);
+    const EC_POINT *p[num_terms];
+    EC_POINT *points[num_terms];
+    for (int i=0; i<num_terms; i++) {
+        BIGNUM *bn = bn_random(order, ctx);
+        BN_copy(w[i], bn);
+        bn_free(bn);
+        points[i] = point_random(group, ctx);
+        p[i] = points[i];
+    }
+    p[7] = get0_generator(group);
+    BN_zero(w[11]);
+    BN_add(w[13], w[13], order);
+
+    // plain sum of products
+    EC_POINT *expected = point_new(group);
+    EC_POINT *t = point_new(group);
+    EC_POINT_set_to_infinity(group, expected);
+    for (int i=0; i<num_terms; i++) {
+        point_mul(group, t, w[i], p[i], ctx);
+        point_add(group, expected, expected, t, ctx);
+    }
+
+    EC_POINT *r = point_new(group);
+    point_weighted_sum_straus(group, r, num_terms, (const BIGNUM**)w, p, ctx);
+    int ret1 = point_cmp(group, r, expected, ctx);
+    if (print) {
+        printf("%6s Test 1 - 1: Straus weighted sum %s correct\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+    point_weighted_sum_pippenger(group, r, num_terms, (const BIGNUM**)w, p, ctx);
+    int ret2 = point_cmp(group, r, expected, ctx);
+    if (print) {
+        printf("%6s Test 1 - 2: Pippenger weighted sum %s correct\n", ret2 ? "NOT OK" : "OK", ret2 ? "NOT" : "indeed");
+    }
+
+    // cleanup
+    for (int i=0; i<num_terms; i++) {
+        point_free(points[i]);
+    }
+    bn_free_array(num_terms, w);
+    point_free(expected);
+    point_free(t);
+    point_free(r);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0);
+}
+
+static int p256_test_2(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    EC_POINT *a = point_random(group, ctx);
+    EC_POINT *b = point_random(group, ctx);
+    EC_POINT *diff = point_new(group);
+    EC_POINT *r = point_new(group);
+
+    // point_sub with r aliasing neither, a or b
+    point_sub(group, diff, a, b, ctx);
+    point_add(group, r, diff, b, ctx);
+    int ret1 = point_cmp(group, r, a, ctx);
+    EC_POINT_copy(r, a);
+    point_sub(group, r, r, b, ctx);
+    ret1 |= point_cmp(group, r, diff, ctx);
+    EC_POINT_copy(r, b);
+    point_sub(group, r, a, r, ctx);
+    ret1 |= point_cmp(group, r, diff, ctx);
+    if (print) {
+        printf("%6s Test 2 - 1: Point subtraction %s correct\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // arena frames hand out the same objects again once ended
+    p256_arena *arena = p256_arena_new(group, 1, 1);
+    p256_arena_start(arena);
+    BIGNUM *bn1 = p256_arena_bn(arena);
+    EC_POINT *point1 = p256_arena_point(arena);
+    p256_arena_start(arena);
+    BIGNUM *bn2 = p256_arena_bn(arena); // grows the arena
+    p256_arena_end(arena);
+    p256_arena_end(arena);
+    p256_arena_start(arena);
+    int ret2 = bn1 == bn2 || p256_arena_bn(arena) != bn1 || p256_arena_bn(arena) != bn2 || p256_arena_point(arena) != point1;
+    p256_arena_end(arena);
+    p256_arena_free(arena);
+    if (print) {
+        printf("%6s Test 2 - 2: Arena frames %s correct\n", ret2 ? "NOT OK" : "OK", ret2 ? "NOT" : "indeed");
+    }
+
+    // cleanup
+    point_free(a);
+    point_free(b);
+    point_free(diff);
+    point_free(r);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0);
+}
+
+static int p256_test_3(int print) {
+    const EC_GROUP *group = get0_group();
+    const BIGNUM *order = get0_order(group);
+    BN_CTX *ctx = BN_CTX_new();
+    const int num = 20;
+
+    // affine, Jacobian and infinity points, weights including zero and one larger than the order
+    BIGNUM **w = bn_new_array(num);
+    BIGNUM **w_back = bn_new_array(num);
+    EC_POINT *points[num];
+    EC_POINT *points_back[num];
+    for (int i=0; i<num; i++) {
+        bn_random_r(w[i], order, ctx);
+        points[i] = point_random(group, ctx);
+        if (i % 3 == 0) {
+            point_add(group, points[i], points[i], points[i], ctx); // not affine
+        }
+        points_back[i] = point_new(group);
+    }
+    EC_POINT_set_to_infinity(group, points[4]);
+    BN_zero(w[5]);
+    BN_add(w[6], w[6], order);
+    scalar_vec *sv = scalar_vec_new(num);
+    point_vec *pv = point_vec_new(num);
+    scalar_vec_from_bns(group, sv, (const BIGNUM**)w, ctx);
+    point_vec_from_points(group, pv, (const EC_POINT**)points, ctx);
+
+    // conversions back, the weight larger than the order comes back reduced
+    scalar_vec_to_bns(sv, w_back);
+    point_vec_to_points(group, pv, points_back, ctx);
+    BN_sub(w[6], w[6], order);
+    int ret1 = 0;
+    for (int i=0; i<num; i++) {
+        ret1 |= BN_cmp(w[i], w_back[i]) != 0;
+        ret1 |= point_cmp(group, points[i], points_back[i], ctx) != 0;
+    }
+    if (print) {
+        printf("%6s Test 3 - 1: Scalars and points %s their vectors unchanged\n", ret1 ? "NOT OK" : "OK", ret1 ? "do NOT come back from" : "come back from");
+    }
+
+    // encodings as point_to_bytes and bn_to_bytes, decoded again
+    unsigned char buf[num * P256_POINT_BYTES];
+    unsigned char expected[P256_POINT_BYTES];
+    int ret2 = point_vec_to_bytes(pv, buf) == 0; // point at infinity
+    EC_POINT_copy(points[4], points[3]);
+    point_vec_from_points(group, pv, (const EC_POINT**)points, ctx);
+    ret2 |= point_vec_to_bytes(pv, buf);
+    for (int i=0; i<num; i++) {
+        point_to_bytes(group, points[i], expected, ctx);
+        ret2 |= memcmp(buf + i * P256_POINT_BYTES, expected, P256_POINT_BYTES) != 0;
+        bn_to_bytes(w[i], expected);
+        ret2 |= memcmp(sv->data + i * P256_SCALAR_BYTES, expected, P256_SCALAR_BYTES) != 0;
+    }
+    point_vec *pv_decoded = point_vec_new(num);
+    scalar_vec *sv_decoded = scalar_vec_new(num);
+    ret2 |= point_vec_from_bytes(group, pv_decoded, buf, ctx);
+    ret2 |= memcmp(pv_decoded->x, pv->x, num * P256_FIELD_BYTES) || memcmp(pv_decoded->y, pv->y, num * P256_FIELD_BYTES);
+    ret2 |= scalar_vec_from_bytes(group, sv_decoded, sv->data);
+    ret2 |= memcmp(sv_decoded->data, sv->data, num * P256_SCALAR_BYTES) != 0;
+    // negative tests, a point off the curve and a scalar not below the order
+    buf[7 * P256_POINT_BYTES] = 0x04;
+    ret2 |= point_vec_from_bytes(group, pv_decoded, buf, ctx) == 0;
+    bn_to_bytes(order, sv->data + 9 * P256_SCALAR_BYTES);
+    ret2 |= scalar_vec_from_bytes(group, sv_decoded, sv->data) == 0;
+    if (print) {
+        printf("%6s Test 3 - 2: Vector encodings %s\n", ret2 ? "NOT OK" : "OK", ret2 ? "NOT correct" : "indeed correct, invalid ones not accepted");
+    }
+
+    // weighted sums of the vectors, both methods
+    scalar_vec_from_bns(group, sv, (const BIGNUM**)w, ctx);
+    EC_POINT *r = point_new(group);
+    EC_POINT *r_vec = point_new(group);
+    point_weighted_sum(group, r, num, (const BIGNUM**)w, (const EC_POINT**)points, ctx);
+    point_weighted_sum_vec_straus(group, r_vec, sv, pv, ctx);
+    int ret3 = point_cmp(group, r, r_vec, ctx) != 0;
+    point_weighted_sum_vec_pippenger(group, r_vec, sv, pv, ctx);
+    ret3 |= point_cmp(group, r, r_vec, ctx) != 0;
+    if (print) {
+        printf("%6s Test 3 - 3: Weighted sums of vectors %s correct\n", ret3 ? "NOT OK" : "OK", ret3 ? "NOT" : "indeed");
+    }
+
+    // cleanup
+    point_free(r_vec);
+    point_free(r);
+    scalar_vec_free(sv_decoded);
+    point_vec_free(pv_decoded);
+    point_vec_free(pv);
+    scalar_vec_free(sv);
+    for (int i=0; i<num; i++) {
+        point_free(points[i]);
+        point_free(points_back[i]);
+    }
+    bn_free_array(num, w_back);
+    bn_free_array(num, w);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0 && ret3 == 0);
+}
+
+// Pippenger at every window size against Straus, with digits at the edges of the signed digit range
+static int p256_test_4(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    const int num_terms = 4;
+    const int window_sizes[] = { 3, 8, 15, 16 };
+    const int num_window_sizes = sizeof(window_sizes) / sizeof(int);
+
+    EC_POINT *points[2 * num_terms];
+    for (int i=0; i<num_terms; i++) {
+        points[i] = point_random(group, ctx);
+    }
+    int ret = EC_POINTs_make_affine(group, num_terms, points, ctx);
+    assert(ret == 1 && "p256_test_4: EC_POINTs_make_affine failed");
+    point_weighted_sum_pippenger_negate(group, num_terms, points, ctx);
+
+    BIGNUM **w = bn_new_array(num_terms);
+    EC_POINT *expected = point_new(group);
+    EC_POINT *r = point_new(group);
+    unsigned char scalars[num_terms * P256_SCALAR_BYTES];
+    int ret1 = 0;
+    for (int j=0; j<num_window_sizes; j++) {
+        // 2^(c-1) in the lowest window only, in every window, 2^(c-1) - 1 in every window, order - 1
+        int c = window_sizes[j];
+        memset(scalars, 0, sizeof(scalars));
+        unsigned char *s = scalars;
+        s[P256_SCALAR_BYTES - 1 - (c-1)/8] |= 1 << ((c-1)%8);
+        for (int bit=0; bit<8*P256_SCALAR_BYTES; bit++) {
+            int b = bit % c;
+            if (b == c-1) {
+                s[P256_SCALAR_BYTES + P256_SCALAR_BYTES - 1 - bit/8] |= 1 << (bit%8);
+            } else {
+                s[2*P256_SCALAR_BYTES + P256_SCALAR_BYTES - 1 - bit/8] |= 1 << (bit%8);
+            }
+        }
+        BN_copy(w[3], get0_order(group));
+        BN_sub_word(w[3], 1);
+        BN_bn2binpad(w[3], s + 3*P256_SCALAR_BYTES, P256_SCALAR_BYTES);
+        for (int i=0; i<num_terms; i++) {
+            BN_bin2bn(s + i*P256_SCALAR_BYTES, P256_SCALAR_BYTES, w[i]);
+        }
+
+        point_weighted_sum_straus(group, expected, num_terms, (const BIGNUM**)w, (const EC_POINT**)points, ctx);
+        point_weighted_sum_pippenger_buckets(group, r, num_terms, scalars, points, c, ctx);
+        ret1 |= point_cmp(group, r, expected, ctx) != 0;
+    }
+    if (print) {
+        printf("%6s Test 4 - 1: Pippenger weighted sums for windows of up to 16 bits %s correct\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // cleanup
+    point_free(r);
+    point_free(expected);
+    bn_free_array(num_terms, w);
+    for (int i=0; i<2*num_terms; i++) {
+        point_free(points[i]);
+    }
+    BN_CTX_free(ctx);
+
+    // return test results
+    return ret1;
+}
+
+typedef int (*test_function)(int);
+
+static test_function test_suite[] = {
+    &p256_test_1,
+    &p256_test_2,
+    &p256_test_3,
+    &p256_test_4
+};
+
+int p256_test_suite(int print) {
+    if (print) {
+        printf("P256 test suite BEGIN -------------------------------\n");
+    }
+    int num_tests = sizeof(test_suite)/sizeof(test_function);
+    int ret = 0;
+    for (int i=0; i<num_tests; i++) {
+        if (test_suite[i](print)) {
+            ret = 1;
+        }
+    }
+    if (print) {
+        printf("P256 test suite END ---------------------------------\n");
+#ifdef DEBUG
+        print_allocation_status();
+#endif
+        fflush(stdout);
+    }
+    return ret;
+}
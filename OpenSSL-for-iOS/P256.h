@@ -10,15 +10,33 @@
 #include <openssl/ec.h>
 #include <openssl/evp.h>
 
+// multiply the generator through the fixed-base table held by the group (set to 0 to treat the generator as any other point)
+#ifndef P256_GENERATOR_TABLE
+#define P256_GENERATOR_TABLE 1
+#endif
+
+// number of terms from which point_weighted_sum switches from Straus to Pippenger
+#ifndef P256_MSM_PIPPENGER_THRESHOLD
+#define P256_MSM_PIPPENGER_THRESHOLD 32768
+#endif
+
 // get curve group
 const EC_GROUP* get0_group(void);
 
 // get curve group order
 const BIGNUM* get0_order(const EC_GROUP *group);
 
+// prime and Montgomery context of the field of the group returned by get0_group (NULL for any other group), for
+// arithmetic on coordinates (the context is only read, BN_mod_mul_montgomery takes it non-const)
+const BIGNUM *get0_field_prime(const EC_GROUP *group);
+BN_MONT_CTX *get0_field_mont(const EC_GROUP *group);
+
 // get curve group generator
 const EC_POINT* get0_generator(const EC_GROUP *group);
 
+// check if point is the generator returned by get0_generator (and thus multiplied using the fixed-base table)
+int point_is_generator(const EC_GROUP *group, const EC_POINT *point);
+
 /* BIGNUM functions, wrappers for OPENSSL BN_xxx functionality */
 
 // get new bignum
@@ -39,12 +57,22 @@ void bn_free_array(int len, BIGNUM **bn_array);
 // get random element in Zp
 BIGNUM *bn_random(const BIGNUM *modulus, BN_CTX *ctx);
 
+// set r to a random element in Zp
+void bn_random_r(BIGNUM *r, const BIGNUM *modulus, BN_CTX *ctx);
+
 // interpret binary data as bignum
 BIGNUM *bn_from_binary_data(int len, const unsigned char *buf);
 
+// r[i] = 1/a[i] mod modulus for i < num (a[i] nonzero, r[i] may be a[i]), one inversion and 3 (num - 1)
+// multiplications (Montgomery's trick)
+void bn_mod_inverse_batch(BIGNUM **r, int num, const BIGNUM **a, const BIGNUM *modulus, BN_CTX *ctx);
+
 // return bignum as point on curve (generator^bignum)
 EC_POINT* bn2point(const EC_GROUP *group, const BIGNUM *bn, BN_CTX *ctx);
 
+// r = generator^bn
+void bn2point_r(const EC_GROUP *group, EC_POINT *r, const BIGNUM *bn, BN_CTX *ctx);
+
 // helper to print bignum to terminal
 void bn_print(const BIGNUM *x);
 
@@ -64,7 +92,7 @@ EC_POINT *point_random(const EC_GROUP *group, BN_CTX *ctx);
 // r = bn * point
 void point_mul(const EC_GROUP *group, EC_POINT *r, const BIGNUM *bn, const EC_POINT *point, BN_CTX *ctx);
 
-// r = sum_{0..n-1}(w_i * p[i])
+// r = sum_{0..n-1}(w_i * p[i]), Straus for fewer than P256_MSM_PIPPENGER_THRESHOLD terms, Pippenger otherwise
 void point_weighted_sum(const EC_GROUP *group, EC_POINT *r, int num_terms, const BIGNUM **w, const EC_POINT **p, BN_CTX *ctx);
 
 // r = a + b
@@ -76,9 +104,104 @@ void point_sub(const EC_GROUP *group, EC_POINT *r, const EC_POINT *a, const EC_P
 // helper to print point to terminal
 void point_print(const EC_GROUP *group, const EC_POINT *p, BN_CTX *ctx);
 
+/* fixed-size encodings */
+
+// compressed point (SEC1) and scalar modulo the group order (big endian)
+#define P256_POINT_BYTES 33
+#define P256_SCALAR_BYTES 32
+
+// write point compressed to buf (P256_POINT_BYTES), returns 0 on success (fails for the point at infinity)
+int point_to_bytes(const EC_GROUP *group, const EC_POINT *point, unsigned char *buf, BN_CTX *ctx);
+
+// read compressed point from buf (P256_POINT_BYTES), returns 0 on success (fails if not canonical or not on the curve)
+int point_from_bytes(const EC_GROUP *group, EC_POINT *point, const unsigned char *buf, BN_CTX *ctx);
+
+// write bn to buf (P256_SCALAR_BYTES, zero padded), returns 0 on success (fails if bn does not fit)
+int bn_to_bytes(const BIGNUM *bn, unsigned char *buf);
+
+/* scratch arena, BIGNUMs and EC_POINTs allocated once and handed out in nested frames (as BN_CTX_start/BN_CTX_end) */
+
+typedef struct p256_arena p256_arena;
+
+// arena with num_bns BIGNUMs and num_points EC_POINTs preallocated, grows when a frame needs more
+p256_arena *p256_arena_new(const EC_GROUP *group, int num_bns, int num_points);
+
+void p256_arena_free(p256_arena *arena);
+
+// open a frame, p256_arena_end returns everything taken from the arena since the matching start
+void p256_arena_start(p256_arena *arena);
+void p256_arena_end(p256_arena *arena);
+
+// scratch bignum (set to zero) and point (value unspecified), valid until the frame ends
+BIGNUM *p256_arena_bn(p256_arena *arena);
+EC_POINT *p256_arena_point(p256_arena *arena);
+
+// BN_CTX owned by the arena, for the calls that take one
+BN_CTX *p256_arena_get0_bn_ctx(p256_arena *arena);
+
+/* contiguous vectors, structure of arrays in P256_VEC_ALIGN aligned blocks (P-256 only) */
+
+#define P256_VEC_ALIGN 64
+#define P256_FIELD_BYTES 32
+
+// num scalars modulo the group order, scalar i at data + i * P256_SCALAR_BYTES (big endian, as bn_to_bytes)
+typedef struct {
+    int num;
+    unsigned char *data;
+} scalar_vec;
+
+// num affine points, x and y of point i at x + i * P256_FIELD_BYTES and y + i * P256_FIELD_BYTES (big endian),
+// infinity[i] = 1 for the point at infinity (coordinates zero)
+typedef struct {
+    int num;
+    unsigned char *x;
+    unsigned char *y;
+    unsigned char *infinity;
+} point_vec;
+
+// new vector of num zero scalars
+scalar_vec *scalar_vec_new(int num);
+
+void scalar_vec_free(scalar_vec *v);
+
+// v[i] = bns[i] mod order for i < v->num
+void scalar_vec_from_bns(const EC_GROUP *group, scalar_vec *v, const BIGNUM **bns, BN_CTX *ctx);
+
+// bns[i] = v[i] for i < v->num (bns initialized)
+void scalar_vec_to_bns(const scalar_vec *v, BIGNUM **bns);
+
+// read v->num scalars (P256_SCALAR_BYTES each) from buf, returns 0 on success, 1 if one is not below the order
+// (written as they are, v->data is the encoding)
+int scalar_vec_from_bytes(const EC_GROUP *group, scalar_vec *v, const unsigned char *buf);
+
+// new vector of num points at infinity
+point_vec *point_vec_new(int num);
+
+void point_vec_free(point_vec *v);
+
+// v[i] = points[i] for i < v->num, converted to affine together with one field inversion
+void point_vec_from_points(const EC_GROUP *group, point_vec *v, const EC_POINT **points, BN_CTX *ctx);
+
+// points[i] = v[i] for i < v->num (points initialized)
+void point_vec_to_points(const EC_GROUP *group, const point_vec *v, EC_POINT **points, BN_CTX *ctx);
+
+// compressed encodings (as point_to_bytes) of the v->num points at buf + i * P256_POINT_BYTES, no field arithmetic,
+// returns 0 on success (fails for the point at infinity)
+int point_vec_to_bytes(const point_vec *v, unsigned char *buf);
+
+// read v->num compressed points (P256_POINT_BYTES each) from buf, returns 0 on success (as point_from_bytes)
+int point_vec_from_bytes(const EC_GROUP *group, point_vec *v, const unsigned char *buf, BN_CTX *ctx);
+
+// r = sum_{0..n-1}(w_i * p_i) for n = w->num = p->num terms, as point_weighted_sum
+void point_weighted_sum_vec(const EC_GROUP *group, EC_POINT *r, const scalar_vec *w, const point_vec *p, BN_CTX *ctx);
+
+int p256_test_suite(int print);
+
 // print utilitary information about bn_new/bn_free and point_new/point_free
 #ifdef DEBUG
 void print_allocation_status(void);
+// number of bn_new and point_new calls so far
+int allocation_count(void);
 #endif
 
 #endif /* P256_H */
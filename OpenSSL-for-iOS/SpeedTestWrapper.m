@@ -6,6 +6,7 @@
 #import <Foundation/Foundation.h>
 #import "SpeedTestWrapper.h"
 #import "speed_test.h"
+#import "praos_vrf.h"
 
 @implementation SpeedTestWrapper
 
@@ -13,6 +14,64 @@
 + (void) performanceTest{
     NSLog(@"Sig ECDSA speed: %f", ecdsa_speed(10000));
     NSLog(@"VRF speed: %f", praos_vrf_speed(10000));
+    NSLog(@"Sig ECDSA speed (registered key): %f", ecdsa_registry_speed(10000));
+    NSLog(@"VRF speed (registered key): %f", praos_vrf_registry_speed(10000));
+    double ecdsa_per_sig = ecdsa_speed(4096) / 4096;
+    for (int batch_size = 1; batch_size <= 4096; batch_size *= 4) {
+        NSLog(@"Sig Schnorr batch speed (batch size %d): %f per signature (one by one: %f, ECDSA: %f)", batch_size, schnorr_speed(batch_size, 4096 / batch_size, 1), schnorr_speed(batch_size, 4096 / batch_size, 0), ecdsa_per_sig);
+    }
+    NSLog(@"VRF speed (encoded output): %f", praos_vrf_bytes_speed(10000));
+    NSLog(@"VRF speed (arena): %f", praos_vrf_arena_speed(10000));
+    NSLog(@"VRF speed (hash to curve suite): %f", praos_vrf_suite_speed(10000, PRAOS_VRF_SUITE_P256_SSWU));
+    for (int win_permille = 10; win_permille <= 200; win_permille *= 2) {
+        NSLog(@"VRF epoch speed (%.1f%% of the slots won): %f per slot (prove_vrf for all slots: %f per slot)", win_permille / 10.0, vrf_epoch_speed(2000, win_permille / 1000.0, 1), vrf_epoch_speed(2000, win_permille / 1000.0, 0));
+    }
+    for (int proofs_per_seed = 1; proofs_per_seed <= 100; proofs_per_seed *= 10) {
+        NSLog(@"VRF speed (%d per seed): %f per output (seed cache: %f per output)", proofs_per_seed, praos_vrf_seed_cache_speed(100, proofs_per_seed, 100, 0), praos_vrf_seed_cache_speed(100, proofs_per_seed, 100, 1));
+    }
+    for (int copies = 1; copies <= 8; copies *= 2) {
+        NSLog(@"VRF speed (each output received %d times): %f per output (verify cache: %f per output)", copies, praos_vrf_verify_cache_speed(100, copies, 0), praos_vrf_verify_cache_speed(100, copies, 1));
+    }
+    NSLog(@"VRF seed hash speed: %f (hash to curve suite: %f)", vrf_hash_seed_speed(10000, PRAOS_VRF_SUITE_LEGACY), vrf_hash_seed_speed(10000, PRAOS_VRF_SUITE_P256_SSWU));
+    NSLog(@"bn2point speed (generator table): %f", bn2point_speed(10000, 1));
+    NSLog(@"bn2point speed (no generator table): %f", bn2point_speed(10000, 0));
+    NSLog(@"P-256 generator mul speed: %f (native: %f)", p256_backend_mul_speed(10000, 1, 0), p256_backend_mul_speed(10000, 1, 1));
+    NSLog(@"P-256 point mul speed: %f (native: %f)", p256_backend_mul_speed(10000, 0, 0), p256_backend_mul_speed(10000, 0, 1));
+    for (int list_len = 1; list_len <= 64; list_len *= 2) {
+        NSLog(@"Transcript hash speed (%d points): %f (one by one: %f)", list_len, hash_points_speed(list_len, 1000, 1), hash_points_speed(list_len, 1000, 0));
+    }
+    for (int num_points = 16; num_points <= 4096; num_points *= 4) {
+        NSLog(@"Point list hash speed (%d points): %f per point (point vector: %f per point)", num_points, point_vec_hash_speed(num_points, 20000 / num_points + 1, 0), point_vec_hash_speed(num_points, 20000 / num_points + 1, 1));
+    }
+    for (int lanes = 1; lanes <= 16; lanes *= 2) {
+        NSLog(@"SHA-256 speed (%d lanes): %f per 6-point transcript, %f per randval", lanes, sha256_mb_speed(1024, 198, 100, lanes), sha256_mb_speed(1024, 66, 100, lanes));
+    }
+    NSLog(@"NIZK DL EQ speed: %f", nizk_dl_eq_speed(10000));
+    for (int num_terms = 2; num_terms <= (1 << 16); num_terms *= 2) {
+        NSLog(@"Weighted sum speed (%d terms): %f per term (loop: %f per term)", num_terms, point_weighted_sum_speed(num_terms, 0), point_weighted_sum_speed(num_terms, 1));
+    }
+    for (int n = 64; n <= 4096; n *= 2) {
+        double ldt_speed = scrape_ldt_speed(n, 8192 / n);
+        NSLog(@"SCRAPE low-degree test speed (%d parties, degree %d): %f (%f per party)", n, n / 2 - 1, ldt_speed, ldt_speed / n);
+    }
+    for (int t = 1; t <= 1000; t *= 10) {
+        NSLog(@"Threshold combination speed (%d shares): %f (cached coefficients: %f, inversion per coefficient: %f)", t, threshold_combine_speed(t, 1000 / t, 1), threshold_combine_speed(t, 1000 / t, 2), threshold_combine_speed(t, 1000 / t, 0));
+    }
+    for (int num_terms = 16; num_terms <= (1 << 16); num_terms *= 4) {
+        NSLog(@"Weighted sum speed (%d terms): %f per term (vectors: %f per term)", num_terms, point_weighted_sum_vec_speed(num_terms, 0), point_weighted_sum_vec_speed(num_terms, 1));
+    }
+    for (int batch_size = 1; batch_size <= 10000; batch_size *= 10) {
+        NSLog(@"NIZK DL EQ batch speed (batch size %d): %f per proof", batch_size, nizk_dl_eq_batch_speed(batch_size, 10000 / batch_size));
+    }
+    for (int batch_size = 1; batch_size <= 10000; batch_size *= 10) {
+        NSLog(@"VRF batch speed (batch size %d, 10 per seed): %f per output", batch_size, praos_vrf_batch_speed(batch_size, 10, 10000 / batch_size));
+    }
+    for (int num_threads = 1; num_threads <= [[NSProcessInfo processInfo] activeProcessorCount]; num_threads++) {
+        NSLog(@"VRF engine throughput (%d threads): %f outputs per second", num_threads, vrf_engine_speed(num_threads, 10000, 1));
+    }
+    for (int num_threads = 1; num_threads <= [[NSProcessInfo processInfo] activeProcessorCount]; num_threads++) {
+        NSLog(@"Leader schedule throughput (%d threads): %f slots per second", num_threads, leader_schedule_speed(21600, num_threads));
+    }
 }
 
 @end
@@ -22,7 +22,10 @@
 #define PLATFORM_TYPE_WINDOWS 2
 
 // set PLATFORM_TYPE to precisely one of the above
+// (command line builds outside Xcode, see tools/Makefile, pass it as -DPLATFORM_TYPE=...)
+#ifndef PLATFORM_TYPE
 #define PLATFORM_TYPE PLATFORM_TYPE_MAC
+#endif
 
 #ifndef PLATFORM_TYPE
 #error "PLATFORM_TYPE undefined, see config_platform.h"
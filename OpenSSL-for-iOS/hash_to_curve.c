@@ -0,0 +1,491 @@
+//
+//  hash_to_curve.c
+//  OpenSSL-for-iOS
+//
+#include "hash_to_curve.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <openssl/sha.h>
+#include "config_platform.h"
+#include "openssl_hashing_tools.h"
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+// bytes per field element in hash_to_field, L = ceil((ceil(log2(p)) + k) / 8) with k = 128
+#define HASH_TO_CURVE_L 48
+
+// curve and map constants, computed once, all but p in Montgomery form
+static struct {
+    BIGNUM *p;
+    BIGNUM *A;
+    BIGNUM *B;
+    BIGNUM *Z; // -10
+    BIGNUM *c2; // sqrt(-Z)
+    BIGNUM *one;
+    BN_MONT_CTX *mont;
+} k;
+
+// the constants live as long as the process, allocated outside bn_new so the DEBUG counters stay balanced
+static void hash_to_curve_init(void) {
+    BN_CTX *ctx = BN_CTX_new();
+    const EC_GROUP *group = get0_group();
+    k.p = BN_new();
+    k.A = BN_new();
+    k.B = BN_new();
+    k.Z = BN_new();
+    k.c2 = BN_new();
+    k.one = BN_new();
+    k.mont = BN_MONT_CTX_new();
+    int ret = k.p && k.A && k.B && k.Z && k.c2 && k.one && k.mont;
+    ret &= EC_GROUP_get_curve_GFp(group, k.p, k.A, k.B, ctx);
+    ret &= BN_MONT_CTX_set(k.mont, k.p, ctx);
+    ret &= BN_set_word(k.c2, 10);
+    ret &= BN_mod_sqrt(k.c2, k.c2, k.p, ctx) != NULL;
+    ret &= BN_set_word(k.Z, 10);
+    ret &= BN_sub(k.Z, k.p, k.Z);
+    BIGNUM *consts[] = { k.A, k.B, k.Z, k.c2, k.one };
+    ret &= BN_one(k.one);
+    for (int i=0; i<5; i++) {
+        ret &= BN_to_montgomery(consts[i], consts[i], k.mont, ctx);
+    }
+    assert(ret == 1 && "hash_to_curve_init: computing constants failed");
+    BN_CTX_free(ctx);
+}
+
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+static INIT_ONCE constants_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK hash_to_curve_init_once(PINIT_ONCE once, PVOID param, PVOID *context) {
+    hash_to_curve_init();
+    return TRUE;
+}
+
+static void hash_to_curve_constants(void) {
+    InitOnceExecuteOnce(&constants_once, hash_to_curve_init_once, NULL, NULL);
+}
+#else
+static pthread_once_t constants_once = PTHREAD_ONCE_INIT;
+
+static void hash_to_curve_constants(void) {
+    int ret = pthread_once(&constants_once, hash_to_curve_init);
+    assert(ret == 0 && "hash_to_curve_constants: pthread_once failed");
+}
+#endif
+
+int expand_message_xmd_sha256(unsigned char *out, size_t out_len, const unsigned char *msg, size_t msg_len, const unsigned char *dst, size_t dst_len) {
+    size_t ell = (out_len + SHA256_DIGEST_LENGTH - 1) / SHA256_DIGEST_LENGTH;
+    if (ell > 255 || out_len > 65535 || dst_len > 255) {
+        return 1;
+    }
+    const unsigned char z_pad[SHA256_CBLOCK] = { 0 };
+    const unsigned char l_i_b_str[] = { (unsigned char)(out_len >> 8), (unsigned char)out_len, 0 };
+    const unsigned char dst_len_byte = (unsigned char)dst_len;
+
+    // b_0 = H(Z_pad || msg || l_i_b_str || I2OSP(0, 1) || DST_prime)
+    SHA256_CTX sha_ctx;
+    unsigned char b_0[SHA256_DIGEST_LENGTH];
+    openssl_hash_init(&sha_ctx);
+    openssl_hash_update(&sha_ctx, z_pad, sizeof(z_pad));
+    openssl_hash_update(&sha_ctx, msg, msg_len);
+    openssl_hash_update(&sha_ctx, l_i_b_str, sizeof(l_i_b_str));
+    openssl_hash_update(&sha_ctx, dst, dst_len);
+    openssl_hash_update(&sha_ctx, &dst_len_byte, 1);
+    openssl_hash_final(b_0, &sha_ctx);
+
+    // b_i = H(strxor(b_0, b_(i - 1)) || I2OSP(i, 1) || DST_prime), b_1 = H(b_0 || I2OSP(1, 1) || DST_prime)
+    unsigned char b_i[SHA256_DIGEST_LENGTH] = { 0 };
+    for (size_t i=1; i<=ell; i++) {
+        for (int j=0; j<SHA256_DIGEST_LENGTH; j++) {
+            b_i[j] ^= b_0[j];
+        }
+        const unsigned char i_byte = (unsigned char)i;
+        openssl_hash_init(&sha_ctx);
+        openssl_hash_update(&sha_ctx, b_i, SHA256_DIGEST_LENGTH);
+        openssl_hash_update(&sha_ctx, &i_byte, 1);
+        openssl_hash_update(&sha_ctx, dst, dst_len);
+        openssl_hash_update(&sha_ctx, &dst_len_byte, 1);
+        openssl_hash_final(b_i, &sha_ctx);
+        size_t len = out_len - (i - 1) * SHA256_DIGEST_LENGTH;
+        memcpy(out + (i - 1) * SHA256_DIGEST_LENGTH, b_i, len < SHA256_DIGEST_LENGTH ? len : SHA256_DIGEST_LENGTH);
+    }
+    return 0;
+}
+
+/* field arithmetic modulo p, multiplications in Montgomery form (BN_mod_mul is about ten times slower) */
+
+static void fe_mul(BIGNUM *r, const BIGNUM *a, const BIGNUM *b, BN_CTX *ctx) {
+    int ret = BN_mod_mul_montgomery(r, a, b, k.mont, ctx);
+    assert(ret == 1 && "fe_mul: BN_mod_mul_montgomery failed");
+}
+
+static void fe_sqr(BIGNUM *r, const BIGNUM *a, BN_CTX *ctx) {
+    fe_mul(r, a, a, ctx);
+}
+
+static void fe_add(BIGNUM *r, const BIGNUM *a, const BIGNUM *b) {
+    int ret = BN_mod_add_quick(r, a, b, k.p);
+    assert(ret == 1 && "fe_add: BN_mod_add_quick failed");
+}
+
+static void fe_sub(BIGNUM *r, const BIGNUM *a, const BIGNUM *b) {
+    int ret = BN_mod_sub_quick(r, a, b, k.p);
+    assert(ret == 1 && "fe_sub: BN_mod_sub_quick failed");
+}
+
+static void fe_from_mont(BIGNUM *r, const BIGNUM *a, BN_CTX *ctx) {
+    int ret = BN_from_montgomery(r, a, k.mont, ctx);
+    assert(ret == 1 && "fe_from_mont: BN_from_montgomery failed");
+}
+
+// r = a^(2^n) * b
+static void fe_sqr_n_mul(BIGNUM *r, const BIGNUM *a, int n, const BIGNUM *b, BN_CTX *ctx) {
+    if (r != a) {
+        BN_copy(r, a);
+    }
+    for (int i=0; i<n; i++) {
+        fe_sqr(r, r, ctx);
+    }
+    fe_mul(r, r, b, ctx);
+}
+
+/*
+ * r = a^c1 with c1 = (p - 3) / 4 = 2^254 - 2^222 + 2^190 + 2^94 - 1 by an addition chain
+ * (x_n below stands for a^(2^n - 1))
+ */
+static void fe_exp_c1(BIGNUM *r, const BIGNUM *a, BN_CTX *ctx) {
+    BN_CTX_start(ctx);
+    BIGNUM *x2 = BN_CTX_get(ctx);
+    BIGNUM *x3 = BN_CTX_get(ctx);
+    BIGNUM *x15 = BN_CTX_get(ctx);
+    BIGNUM *x30 = BN_CTX_get(ctx);
+    BIGNUM *t = BN_CTX_get(ctx);
+    assert(t && "fe_exp_c1: BN_CTX_get failed");
+
+    fe_sqr_n_mul(x2, a, 1, a, ctx);
+    fe_sqr_n_mul(x3, x2, 1, a, ctx);
+    fe_sqr_n_mul(t, x3, 3, x3, ctx);        // x6
+    fe_sqr_n_mul(x15, t, 6, t, ctx);        // x12
+    fe_sqr_n_mul(x15, x15, 3, x3, ctx);
+    fe_sqr_n_mul(x30, x15, 15, x15, ctx);
+    fe_sqr_n_mul(t, x30, 2, x2, ctx);       // x32
+    fe_sqr_n_mul(x2, t, 32, a, ctx);        // a^(2^64 - 2^32 + 1), the top 64 bits of c1
+    fe_sqr_n_mul(x3, t, 32, t, ctx);        // x64
+    fe_sqr_n_mul(x3, x3, 30, x30, ctx);     // x94
+    fe_sqr_n_mul(r, x2, 190, x3, ctx);
+
+    BN_CTX_end(ctx);
+}
+
+/*
+ * simplified SWU map, straight-line version of RFC 9380 appendix F.2 with sqrt_ratio for p = 3 mod 4,
+ * result in Jacobian coordinates (X, Y, Zj) in Montgomery form with Zj the denominator of x (saves the inversion)
+ */
+static void map_to_curve_sswu(BIGNUM *X, BIGNUM *Y, BIGNUM *Zj, const BIGNUM *u_in, BN_CTX *ctx) {
+    BN_CTX_start(ctx);
+    BIGNUM *u = BN_CTX_get(ctx);
+    BIGNUM *tv1 = BN_CTX_get(ctx);
+    BIGNUM *tv2 = BN_CTX_get(ctx);
+    BIGNUM *tv3 = BN_CTX_get(ctx);
+    BIGNUM *tv4 = BN_CTX_get(ctx);
+    BIGNUM *tv5 = BN_CTX_get(ctx);
+    BIGNUM *tv6 = BN_CTX_get(ctx);
+    BIGNUM *x = BN_CTX_get(ctx);
+    BIGNUM *y = BN_CTX_get(ctx);
+    BIGNUM *y1 = BN_CTX_get(ctx);
+    BIGNUM *s = BN_CTX_get(ctx);
+    BIGNUM *t = BN_CTX_get(ctx);
+    assert(t && "map_to_curve_sswu: BN_CTX_get failed");
+
+    int ret = BN_to_montgomery(u, u_in, k.mont, ctx);
+    assert(ret == 1 && "map_to_curve_sswu: BN_to_montgomery failed");
+    fe_sqr(tv1, u, ctx);                    // tv1 = u^2
+    fe_mul(tv1, k.Z, tv1, ctx);             // tv1 = Z * tv1
+    fe_sqr(tv2, tv1, ctx);                  // tv2 = tv1^2
+    fe_add(tv2, tv2, tv1);                  // tv2 = tv2 + tv1
+    fe_add(tv3, tv2, k.one);               // tv3 = tv2 + 1
+    fe_mul(tv3, k.B, tv3, ctx);             // tv3 = B * tv3
+    if (BN_is_zero(tv2)) {                  // tv4 = CMOV(Z, -tv2, tv2 != 0)
+        BN_copy(tv4, k.Z);
+    } else {
+        fe_sub(tv4, k.p, tv2);
+    }
+    fe_mul(tv4, k.A, tv4, ctx);             // tv4 = A * tv4
+    fe_sqr(tv2, tv3, ctx);                  // tv2 = tv3^2
+    fe_sqr(tv6, tv4, ctx);                  // tv6 = tv4^2
+    fe_mul(tv5, k.A, tv6, ctx);             // tv5 = A * tv6
+    fe_add(tv2, tv2, tv5);                  // tv2 = tv2 + tv5
+    fe_mul(tv2, tv2, tv3, ctx);             // tv2 = tv2 * tv3
+    fe_mul(tv6, tv6, tv4, ctx);             // tv6 = tv6 * tv4
+    fe_mul(tv5, k.B, tv6, ctx);             // tv5 = B * tv6
+    fe_add(tv2, tv2, tv5);                  // tv2 = tv2 + tv5
+    fe_mul(x, tv1, tv3, ctx);               // x = tv1 * tv3
+
+    // (is_gx1_square, y1) = sqrt_ratio(tv2, tv6)
+    fe_sqr(s, tv6, ctx);                    // s = v^2
+    fe_mul(t, tv2, tv6, ctx);               // t = u * v
+    fe_mul(s, s, t, ctx);                   // s = s * t
+    fe_exp_c1(y1, s, ctx);                  // y1 = s^c1
+    fe_mul(y1, y1, t, ctx);                 // y1 = y1 * t
+    fe_sqr(s, y1, ctx);
+    fe_mul(s, s, tv6, ctx);
+    int is_gx1_square = BN_cmp(s, tv2) == 0; // y1^2 * v == u
+    if (!is_gx1_square) {
+        fe_mul(y1, y1, k.c2, ctx);          // y1 = y1 * c2
+    }
+
+    fe_mul(y, tv1, u, ctx);                 // y = tv1 * u
+    fe_mul(y, y, y1, ctx);                  // y = y * y1
+    if (is_gx1_square) {
+        BN_copy(x, tv3);                    // x = CMOV(x, tv3, is_gx1_square)
+        BN_copy(y, y1);                     // y = CMOV(y, y1, is_gx1_square)
+    }
+    fe_from_mont(s, y, ctx);
+    if (BN_is_odd(u_in) != BN_is_odd(s)) {  // y = CMOV(-y, y, sgn0(u) == sgn0(y))
+        fe_sub(y, k.p, y);
+    }
+
+    // (x / tv4, y) = (x * tv4 / tv4^2, y * tv4^3 / tv4^3)
+    fe_mul(X, x, tv4, ctx);
+    fe_sqr(s, tv4, ctx);
+    fe_mul(s, s, tv4, ctx);
+    fe_mul(Y, y, s, ctx);
+    BN_copy(Zj, tv4);
+
+    BN_CTX_end(ctx);
+}
+
+/*
+ * (X3, Y3, Z3) = (X1, Y1, Z1) + (X2, Y2, Z2) in Jacobian coordinates (add-2007-bl), returns 0 on success, 1 if
+ * the points are equal and 2 if they are inverse (both not handled by the formula)
+ */
+static int add_jacobian(BIGNUM *X3, BIGNUM *Y3, BIGNUM *Z3, const BIGNUM *X1, const BIGNUM *Y1, const BIGNUM *Z1, const BIGNUM *X2, const BIGNUM *Y2, const BIGNUM *Z2, BN_CTX *ctx) {
+    BN_CTX_start(ctx);
+    BIGNUM *Z1Z1 = BN_CTX_get(ctx);
+    BIGNUM *Z2Z2 = BN_CTX_get(ctx);
+    BIGNUM *U1 = BN_CTX_get(ctx);
+    BIGNUM *U2 = BN_CTX_get(ctx);
+    BIGNUM *S1 = BN_CTX_get(ctx);
+    BIGNUM *S2 = BN_CTX_get(ctx);
+    BIGNUM *H = BN_CTX_get(ctx);
+    BIGNUM *I = BN_CTX_get(ctx);
+    BIGNUM *J = BN_CTX_get(ctx);
+    BIGNUM *rr = BN_CTX_get(ctx);
+    BIGNUM *V = BN_CTX_get(ctx);
+    assert(V && "add_jacobian: BN_CTX_get failed");
+
+    fe_sqr(Z1Z1, Z1, ctx);              // Z1Z1 = Z1^2
+    fe_sqr(Z2Z2, Z2, ctx);              // Z2Z2 = Z2^2
+    fe_mul(U1, X1, Z2Z2, ctx);          // U1 = X1 * Z2Z2
+    fe_mul(U2, X2, Z1Z1, ctx);          // U2 = X2 * Z1Z1
+    fe_mul(S1, Y1, Z2, ctx);
+    fe_mul(S1, S1, Z2Z2, ctx);          // S1 = Y1 * Z2 * Z2Z2
+    fe_mul(S2, Y2, Z1, ctx);
+    fe_mul(S2, S2, Z1Z1, ctx);          // S2 = Y2 * Z1 * Z1Z1
+    fe_sub(H, U2, U1);                  // H = U2 - U1
+    if (BN_is_zero(H)) {
+        int equal = BN_cmp(S1, S2) == 0;
+        BN_CTX_end(ctx);
+        return equal ? 1 : 2;
+    }
+    fe_add(I, H, H);
+    fe_sqr(I, I, ctx);                  // I = (2 * H)^2
+    fe_mul(J, H, I, ctx);               // J = H * I
+    fe_sub(rr, S2, S1);
+    fe_add(rr, rr, rr);                 // r = 2 * (S2 - S1)
+    fe_mul(V, U1, I, ctx);              // V = U1 * I
+    fe_sqr(X3, rr, ctx);
+    fe_sub(X3, X3, J);
+    fe_sub(X3, X3, V);
+    fe_sub(X3, X3, V);                  // X3 = r^2 - J - 2 * V
+    fe_sub(V, V, X3);
+    fe_mul(V, rr, V, ctx);
+    fe_mul(S1, S1, J, ctx);
+    fe_add(S1, S1, S1);
+    fe_sub(Y3, V, S1);                  // Y3 = r * (V - X3) - 2 * S1 * J
+    fe_add(Z3, Z1, Z2);
+    fe_sqr(Z3, Z3, ctx);
+    fe_sub(Z3, Z3, Z1Z1);
+    fe_sub(Z3, Z3, Z2Z2);
+    fe_mul(Z3, Z3, H, ctx);             // Z3 = ((Z1 + Z2)^2 - Z1Z1 - Z2Z2) * H
+
+    BN_CTX_end(ctx);
+    return 0;
+}
+
+void hash_to_curve_p256_sswu(const EC_GROUP *group, EC_POINT *r, const unsigned char *msg, size_t msg_len, const unsigned char *dst, size_t dst_len, BN_CTX *ctx) {
+    hash_to_curve_constants();
+
+    // u = hash_to_field(msg, 2)
+    unsigned char uniform_bytes[2 * HASH_TO_CURVE_L];
+    int ret = expand_message_xmd_sha256(uniform_bytes, sizeof(uniform_bytes), msg, msg_len, dst, dst_len);
+    assert(ret == 0 && "hash_to_curve_p256_sswu: usage error, DST too long");
+
+    BN_CTX_start(ctx);
+    BIGNUM *u = BN_CTX_get(ctx);
+    BIGNUM *X0 = BN_CTX_get(ctx);
+    BIGNUM *Y0 = BN_CTX_get(ctx);
+    BIGNUM *Z0 = BN_CTX_get(ctx);
+    BIGNUM *X1 = BN_CTX_get(ctx);
+    BIGNUM *Y1 = BN_CTX_get(ctx);
+    BIGNUM *Z1 = BN_CTX_get(ctx);
+    BIGNUM *X = BN_CTX_get(ctx);
+    BIGNUM *Y = BN_CTX_get(ctx);
+    BIGNUM *Z = BN_CTX_get(ctx);
+    assert(Z && "hash_to_curve_p256_sswu: BN_CTX_get failed");
+
+    // Q0 = map_to_curve(u[0]), Q1 = map_to_curve(u[1])
+    ret = BN_bin2bn(uniform_bytes, HASH_TO_CURVE_L, u) != NULL;
+    ret &= BN_nnmod(u, u, k.p, ctx);
+    map_to_curve_sswu(X0, Y0, Z0, u, ctx);
+    ret &= BN_bin2bn(uniform_bytes + HASH_TO_CURVE_L, HASH_TO_CURVE_L, u) != NULL;
+    ret &= BN_nnmod(u, u, k.p, ctx);
+    map_to_curve_sswu(X1, Y1, Z1, u, ctx);
+    assert(ret == 1 && "hash_to_curve_p256_sswu: reducing u failed");
+
+    // r = Q0 + Q1 (the cofactor is 1)
+    switch (add_jacobian(X, Y, Z, X0, Y0, Z0, X1, Y1, Z1, ctx)) {
+        case 0:
+            fe_from_mont(X, X, ctx);
+            fe_from_mont(Y, Y, ctx);
+            fe_from_mont(Z, Z, ctx);
+            ret = EC_POINT_set_Jprojective_coordinates_GFp(group, r, X, Y, Z, ctx);
+            break;
+        case 1: // Q0 = Q1 and Q0 = -Q1 have negligible probability
+            fe_from_mont(X0, X0, ctx);
+            fe_from_mont(Y0, Y0, ctx);
+            fe_from_mont(Z0, Z0, ctx);
+            ret = EC_POINT_set_Jprojective_coordinates_GFp(group, r, X0, Y0, Z0, ctx);
+            ret &= EC_POINT_dbl(group, r, r, ctx);
+            break;
+        default:
+            ret = EC_POINT_set_to_infinity(group, r);
+            break;
+    }
+    assert(ret == 1 && "hash_to_curve_p256_sswu: setting the result failed");
+
+    BN_CTX_end(ctx);
+}
+
+/* test vectors of RFC 9380 appendix J.1.1 */
+
+static const char *test_dst = "QUUX-V01-CS02-with-P256_XMD:SHA-256_SSWU_RO_";
+static const struct {
+    const char *msg;
+    const char *x;
+    const char *y;
+} test_vectors[] = {
+    { "", "2c15230b26dbc6fc9a37051158c95b79656e17a1a920b11394ca91c44247d3e4", "8a7a74985cc5c776cdfe4b1f19884970453912e9d31528c060be9ab5c43e8415" },
+    { "abc", "0bb8b87485551aa43ed54f009230450b492fead5f1cc91658775dac4a3388a0f", "5c41b3d0731a27a7b14bc0bf0ccded2d8751f83493404c84a88e71ffd424212e" },
+    { "abcdef0123456789", "65038ac8f2b1def042a5df0b33b1f4eca6bff7cb0f9c6c1526811864e544ed80", "cad44d40a656e7aff4002a8de287abc8ae0482b5ae825822bb870d6df9b56ca3" },
+    {
+      "q128_qqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqq"
+      "qqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqqq",
+      "4be61ee205094282ba8a2042bcb48d88dfbb609301c49aa8b078533dc65a0b5d", "98f8df449a072c4721d241a3b1236d3caccba603f916ca680f4539d2bfb3c29e" },
+    {
+      "a512_aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+      "457ae2981f70ca85d8e24c308b14db22f3e3862c5ea0f652ca38b5e49cd64bc5", "ecb9f0eadc9aeed232dabc53235368c1394c78de05dd96893eefa62b0f4757dc" },
+};
+
+static int hash_to_curve_test_1(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    EC_POINT *r = point_new(group);
+    BIGNUM *x = bn_new();
+    BIGNUM *y = bn_new();
+    BIGNUM *expected = bn_new();
+
+    // hash_to_curve matches the RFC 9380 vectors
+    int num_vectors = sizeof(test_vectors)/sizeof(test_vectors[0]);
+    int ret1 = 0;
+    for (int i=0; i<num_vectors; i++) {
+        hash_to_curve_p256_sswu(group, r, (const unsigned char *)test_vectors[i].msg, strlen(test_vectors[i].msg), (const unsigned char *)test_dst, strlen(test_dst), ctx);
+        ret1 |= EC_POINT_get_affine_coordinates_GFp(group, r, x, y, ctx) != 1;
+        ret1 |= !BN_hex2bn(&expected, test_vectors[i].x) || BN_cmp(x, expected) != 0;
+        ret1 |= !BN_hex2bn(&expected, test_vectors[i].y) || BN_cmp(y, expected) != 0;
+    }
+    if (print) {
+        printf("%6s Test 1 - 1: hash_to_curve %s the RFC 9380 test vectors\n", ret1 ? "NOT OK" : "OK", ret1 ? "does NOT match" : "matches");
+    }
+
+    // cleanup
+    bn_free(expected);
+    bn_free(y);
+    bn_free(x);
+    point_free(r);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0);
+}
+
+static int hash_to_curve_test_2(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    EC_POINT *r1 = point_new(group);
+    EC_POINT *r2 = point_new(group);
+    const unsigned char msg[] = "seed";
+    const unsigned char dst1[] = "DST-1";
+    const unsigned char dst2[] = "DST-2";
+
+    // the same input maps to the same point on the curve
+    hash_to_curve_p256_sswu(group, r1, msg, sizeof(msg) - 1, dst1, sizeof(dst1) - 1, ctx);
+    hash_to_curve_p256_sswu(group, r2, msg, sizeof(msg) - 1, dst1, sizeof(dst1) - 1, ctx);
+    int ret1 = EC_POINT_is_on_curve(group, r1, ctx) != 1 || EC_POINT_cmp(group, r1, r2, ctx) != 0;
+    if (print) {
+        printf("%6s Test 2 - 1: hash_to_curve %s deterministic and on the curve\n", ret1 ? "NOT OK" : "OK", ret1 ? "is NOT" : "is");
+    }
+
+    // another message or another domain separation tag maps elsewhere
+    hash_to_curve_p256_sswu(group, r2, msg, sizeof(msg) - 2, dst1, sizeof(dst1) - 1, ctx);
+    int ret2 = EC_POINT_cmp(group, r1, r2, ctx) == 0;
+    hash_to_curve_p256_sswu(group, r2, msg, sizeof(msg) - 1, dst2, sizeof(dst2) - 1, ctx);
+    ret2 |= EC_POINT_cmp(group, r1, r2, ctx) == 0;
+    if (print) {
+        printf("%6s Test 2 - 2: Different messages and domains %s different points\n", ret2 ? "NOT OK" : "OK", ret2 ? "do NOT give" : "give");
+    }
+
+    // cleanup
+    point_free(r2);
+    point_free(r1);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0);
+}
+
+typedef int (*test_function)(int);
+
+static test_function test_suite[] = {
+    &hash_to_curve_test_1,
+    &hash_to_curve_test_2
+};
+
+int hash_to_curve_test_suite(int print) {
+    if (print) {
+        printf("Hash to curve test suite BEGIN ----------------------\n");
+    }
+    int num_tests = sizeof(test_suite)/sizeof(test_function);
+    int ret = 0;
+    for (int i=0; i<num_tests; i++) {
+        if (test_suite[i](print)) {
+            ret = 1;
+        }
+    }
+    if (print) {
+        printf("Hash to curve test suite END ------------------------\n");
+#ifdef DEBUG
+        print_allocation_status();
+#endif
+        fflush(stdout);
+    }
+    return ret;
+}
@@ -0,0 +1,23 @@
+//
+//  hash_to_curve.h
+//  OpenSSL-for-iOS
+//
+//  Hashing to P-256 following RFC 9380, suite P256_XMD:SHA-256_SSWU_RO_ (random oracle encoding,
+//  simplified SWU map). Not constant time, meant for public inputs such as VRF seeds.
+//
+
+#ifndef HASH_TO_CURVE_H
+#define HASH_TO_CURVE_H
+#include <stddef.h>
+#include "P256.h"
+
+// expand_message_xmd with SHA-256 (RFC 9380 section 5.3.1), returns 0 on success
+// (fails for out_len > 8160 or dst_len > 255)
+int expand_message_xmd_sha256(unsigned char *out, size_t out_len, const unsigned char *msg, size_t msg_len, const unsigned char *dst, size_t dst_len);
+
+// r = hash_to_curve(msg) with domain separation tag dst (dst_len at most 255)
+void hash_to_curve_p256_sswu(const EC_GROUP *group, EC_POINT *r, const unsigned char *msg, size_t msg_len, const unsigned char *dst, size_t dst_len, BN_CTX *ctx);
+
+int hash_to_curve_test_suite(int print);
+
+#endif /* HASH_TO_CURVE_H */
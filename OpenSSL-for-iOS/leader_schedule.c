@@ -0,0 +1,430 @@
+//
+//  leader_schedule.c
+//  OpenSSL-for-iOS
+//
+#include "leader_schedule.h"
+#include <assert.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config_platform.h"
+#include "openssl_hashing_tools.h"
+#include "platform_measurement_utils.h"
+#include "sha256_mb.h"
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+#error "leader_schedule: unsupported platform type (not implemented for this platform)"
+#endif
+#include <pthread.h>
+
+// slots evaluated together (the transcripts of a chunk are encoded and hashed together)
+#define LEADER_SCHEDULE_CHUNK 64
+
+typedef struct {
+    const EC_GROUP *group;
+    key_pair *kp;
+    const unsigned char *nonce;
+    size_t nonce_len;
+    uint64_t first_slot;
+    uint64_t num_slots;
+    const unsigned char *threshold;
+    praos_vrf_suite suite;
+    transcript prefix; // proof transcript with the generator and kp->pub absorbed, cloned for each leader slot
+    atomic_uint_fast64_t next; // first slot offset of the next chunk to evaluate
+} schedule_job;
+
+// per thread, scratch values for one chunk and the leader slots found so far
+typedef struct {
+    schedule_job *job;
+    pthread_t thread;
+    BN_CTX *ctx;
+    BIGNUM **seed;
+    BIGNUM **h;
+    BIGNUM **randval;
+    BIGNUM *e;
+    EC_POINT **seed_point;
+    EC_POINT **u;
+    EC_POINT **hash_seed_point;
+    unsigned char *msg_buf;
+    leader_slot *slots;
+    int num_slots;
+    int max_slots;
+} schedule_worker;
+
+void leader_schedule_slot_seed(BIGNUM *seed, const unsigned char *epoch_nonce, size_t nonce_len, uint64_t slot) {
+    unsigned char slot_bytes[8];
+    for (int i=0; i<8; i++) {
+        slot_bytes[i] = (unsigned char)(slot >> (56 - 8 * i));
+    }
+    SHA256_CTX sha_ctx;
+    unsigned char md[SHA256_DIGEST_LENGTH];
+    openssl_hash_init(&sha_ctx);
+    openssl_hash_update(&sha_ctx, epoch_nonce, nonce_len);
+    openssl_hash_update(&sha_ctx, slot_bytes, sizeof(slot_bytes));
+    openssl_hash_final(md, &sha_ctx);
+    BIGNUM *ret = BN_bin2bn(md, SHA256_DIGEST_LENGTH, seed);
+    assert(ret && "leader_schedule_slot_seed: BN_bin2bn failed");
+}
+
+void leader_schedule_threshold(unsigned char *threshold, double relative_stake, double active_slot_coeff) {
+    assert(relative_stake >= 0 && active_slot_coeff >= 0 && active_slot_coeff <= 1 && "leader_schedule_threshold: usage error, unexpected parameter");
+    // phi = 1 - (1 - f)^stake, written as base 256 fraction
+    double phi = active_slot_coeff == 1 ? (relative_stake > 0) : -expm1(relative_stake * log1p(-active_slot_coeff));
+    if (phi >= 1) {
+        memset(threshold, 0xff, LEADER_SCHEDULE_THRESHOLD_BYTES);
+        return;
+    }
+    for (int i=0; i<LEADER_SCHEDULE_THRESHOLD_BYTES; i++) {
+        phi *= 256;
+        double digit = floor(phi);
+        threshold[i] = (unsigned char)digit;
+        phi -= digit;
+    }
+}
+
+static void worker_init(schedule_worker *worker, schedule_job *job) {
+    const EC_GROUP *group = job->group;
+    worker->job = job;
+    worker->ctx = BN_CTX_new();
+    worker->seed = bn_new_array(LEADER_SCHEDULE_CHUNK);
+    worker->h = bn_new_array(LEADER_SCHEDULE_CHUNK);
+    worker->randval = bn_new_array(LEADER_SCHEDULE_CHUNK);
+    worker->e = bn_new();
+    worker->seed_point = malloc(LEADER_SCHEDULE_CHUNK * sizeof(EC_POINT*));
+    worker->u = malloc(LEADER_SCHEDULE_CHUNK * sizeof(EC_POINT*));
+    worker->hash_seed_point = malloc(LEADER_SCHEDULE_CHUNK * sizeof(EC_POINT*));
+    worker->msg_buf = malloc(LEADER_SCHEDULE_CHUNK * (job->nonce_len + 8));
+    assert(worker->ctx && worker->seed_point && worker->u && worker->hash_seed_point && worker->msg_buf && "leader_schedule: allocation error");
+    for (int i=0; i<LEADER_SCHEDULE_CHUNK; i++) {
+        worker->seed_point[i] = point_new(group);
+        worker->u[i] = point_new(group);
+        worker->hash_seed_point[i] = point_new(group);
+    }
+    worker->slots = NULL;
+    worker->num_slots = 0;
+    worker->max_slots = 0;
+}
+
+// frees the scratch values, not the leader slots
+static void worker_free(schedule_worker *worker) {
+    for (int i=0; i<LEADER_SCHEDULE_CHUNK; i++) {
+        point_free(worker->seed_point[i]);
+        point_free(worker->u[i]);
+        point_free(worker->hash_seed_point[i]);
+    }
+    free(worker->msg_buf);
+    free(worker->hash_seed_point);
+    free(worker->u);
+    free(worker->seed_point);
+    bn_free(worker->e);
+    bn_free_array(LEADER_SCHEDULE_CHUNK, worker->randval);
+    bn_free_array(LEADER_SCHEDULE_CHUNK, worker->h);
+    bn_free_array(LEADER_SCHEDULE_CHUNK, worker->seed);
+    BN_CTX_free(worker->ctx);
+}
+
+// prove slot i of the chunk (u and hash_seed_point set) and add it to the leader slots of the worker
+static void worker_add_leader_slot(schedule_worker *worker, uint64_t slot, int i) {
+    schedule_job *job = worker->job;
+    const EC_GROUP *group = job->group;
+    if (worker->num_slots == worker->max_slots) {
+        worker->max_slots = worker->max_slots ? 2 * worker->max_slots : 16;
+        worker->slots = realloc(worker->slots, worker->max_slots * sizeof(leader_slot));
+        assert(worker->slots && "leader_schedule: allocation error");
+    }
+    leader_slot *leader = &worker->slots[worker->num_slots++];
+    leader->slot = slot;
+    nizk_dl_eq_proof pi;
+    nizk_dl_eq_prove_prefix(group, job->kp->priv, worker->hash_seed_point[i], worker->u[i], get0_generator(group), &job->prefix, &pi, worker->ctx);
+    int ret = vrf_output_to_bytes(group, worker->u[i], &pi, worker->randval[i], job->suite, leader->output, worker->ctx);
+    assert(ret == 0 && "leader_schedule: vrf_output_to_bytes failed");
+    nizk_dl_eq_proof_free(&pi);
+}
+
+// evaluate the VRF for the n slots from slot on, u = H'(seed)^k and randval = H([seed]G, u) as in prove_vrf
+static void worker_eval_chunk(schedule_worker *worker, uint64_t slot, int n) {
+    schedule_job *job = worker->job;
+    const EC_GROUP *group = job->group;
+    BN_CTX *ctx = worker->ctx;
+    const unsigned char *msg[LEADER_SCHEDULE_CHUNK] = { NULL };
+    size_t len[LEADER_SCHEDULE_CHUNK] = { 0 };
+    unsigned char md[LEADER_SCHEDULE_CHUNK * SHA256_DIGEST_LENGTH];
+
+    // seeds H(nonce || slot), all hashed together
+    size_t msg_len = job->nonce_len + 8;
+    for (int i=0; i<n; i++) {
+        unsigned char *m = worker->msg_buf + i * msg_len;
+        memcpy(m, job->nonce, job->nonce_len);
+        for (int b=0; b<8; b++) {
+            m[job->nonce_len + b] = (unsigned char)((slot + i) >> (56 - 8 * b));
+        }
+        msg[i] = m;
+        len[i] = msg_len;
+    }
+    sha256_mb(n, msg, len, md);
+    for (int i=0; i<n; i++) {
+        BIGNUM *ret = BN_bin2bn(md + i * SHA256_DIGEST_LENGTH, SHA256_DIGEST_LENGTH, worker->seed[i]);
+        assert(ret && "leader_schedule: BN_bin2bn failed");
+        bn2point_r(group, worker->seed_point[i], worker->seed[i], ctx);
+    }
+
+    if (job->suite == PRAOS_VRF_SUITE_LEGACY) {
+        // H'(seed) = G^H(seed) (H of the minimal big endian seed bytes, as openssl_hash_bn2bn), so that
+        // u = G^(k * H(seed)) comes from the generator table, H'(seed) is only needed for the leader slots
+        unsigned char seed_bytes[LEADER_SCHEDULE_CHUNK][SHA256_DIGEST_LENGTH];
+        for (int i=0; i<n; i++) {
+            len[i] = BN_bn2bin(worker->seed[i], seed_bytes[i]);
+            assert(len[i] > 0 && "leader_schedule: zero seed");
+            msg[i] = seed_bytes[i];
+        }
+        sha256_mb(n, msg, len, md);
+        for (int i=0; i<n; i++) {
+            BIGNUM *ret = BN_bin2bn(md + i * SHA256_DIGEST_LENGTH, SHA256_DIGEST_LENGTH, worker->h[i]);
+            assert(ret && "leader_schedule: BN_bin2bn failed");
+            int ok = BN_mod_mul(worker->e, job->kp->priv, worker->h[i], get0_order(group), ctx);
+            assert(ok == 1 && "leader_schedule: BN_mod_mul failed");
+            bn2point_r(group, worker->u[i], worker->e, ctx);
+        }
+    } else {
+        for (int i=0; i<n; i++) {
+            vrf_hash_seed_r(group, worker->hash_seed_point[i], worker->seed[i], job->suite, ctx);
+            point_mul(group, worker->u[i], job->kp->priv, worker->hash_seed_point[i], ctx);
+        }
+    }
+
+    // randvals and the leader check
+    const EC_POINT **transcript[2] = { (const EC_POINT**)worker->seed_point, (const EC_POINT**)worker->u };
+    openssl_hash_point_columns2bn_r(worker->randval, group, ctx, n, 2, transcript);
+    for (int i=0; i<n; i++) {
+        unsigned char randval[SHA256_DIGEST_LENGTH];
+        int ret = BN_bn2binpad(worker->randval[i], randval, SHA256_DIGEST_LENGTH);
+        assert(ret == SHA256_DIGEST_LENGTH && "leader_schedule: BN_bn2binpad failed");
+        if (memcmp(randval, job->threshold, LEADER_SCHEDULE_THRESHOLD_BYTES) < 0) {
+            if (job->suite == PRAOS_VRF_SUITE_LEGACY) {
+                bn2point_r(group, worker->hash_seed_point[i], worker->h[i], ctx);
+            }
+            worker_add_leader_slot(worker, slot + i, i);
+        }
+    }
+}
+
+static void *worker_run(void *arg) {
+    schedule_worker *worker = arg;
+    schedule_job *job = worker->job;
+    for (;;) {
+        uint64_t offset = atomic_fetch_add(&job->next, LEADER_SCHEDULE_CHUNK);
+        if (offset >= job->num_slots) {
+            break;
+        }
+        uint64_t rest = job->num_slots - offset;
+        worker_eval_chunk(worker, job->first_slot + offset, rest < LEADER_SCHEDULE_CHUNK ? (int)rest : LEADER_SCHEDULE_CHUNK);
+    }
+    return NULL;
+}
+
+static int leader_slot_cmp(const void *a, const void *b) {
+    uint64_t sa = ((const leader_slot*)a)->slot;
+    uint64_t sb = ((const leader_slot*)b)->slot;
+    return (sa > sb) - (sa < sb);
+}
+
+leader_schedule *leader_schedule_compute(const EC_GROUP *group, key_pair *kp, const unsigned char *epoch_nonce, size_t nonce_len, uint64_t first_slot, uint64_t num_slots, const unsigned char *threshold, int num_threads, const praos_vrf_params *params) {
+    assert(num_threads > 0 && "leader_schedule_compute: usage error, no threads");
+    platform_time_type start = platform_utils_get_wall_time();
+    schedule_job job;
+    job.group = group;
+    job.kp = kp;
+    job.nonce = epoch_nonce;
+    job.nonce_len = nonce_len;
+    job.first_slot = first_slot;
+    job.num_slots = num_slots;
+    job.threshold = threshold;
+    job.suite = params ? params->suite : PRAOS_VRF_SUITE_LEGACY;
+    atomic_init(&job.next, 0);
+
+    schedule_worker *workers = malloc(num_threads * sizeof(schedule_worker));
+    assert(workers && "leader_schedule_compute: allocation error");
+    for (int t=0; t<num_threads; t++) {
+        worker_init(&workers[t], &job);
+    }
+    nizk_dl_eq_transcript_prefix(group, &job.prefix, get0_generator(group), kp->pub, NULL, workers[0].ctx);
+    // the calling thread is worker 0
+    for (int t=1; t<num_threads; t++) {
+        int ret = pthread_create(&workers[t].thread, NULL, worker_run, &workers[t]);
+        assert(ret == 0 && "leader_schedule_compute: pthread_create failed");
+    }
+    worker_run(&workers[0]);
+    for (int t=1; t<num_threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+    }
+
+    // merge the leader slots of all workers
+    leader_schedule *schedule = malloc(sizeof(leader_schedule));
+    assert(schedule && "leader_schedule_compute: allocation error");
+    schedule->first_slot = first_slot;
+    schedule->num_slots = num_slots;
+    schedule->num_leader_slots = 0;
+    for (int t=0; t<num_threads; t++) {
+        schedule->num_leader_slots += workers[t].num_slots;
+    }
+    schedule->leader_slots = malloc(schedule->num_leader_slots * sizeof(leader_slot) + 1);
+    assert(schedule->leader_slots && "leader_schedule_compute: allocation error");
+    for (int t=0, k=0; t<num_threads; t++) {
+        memcpy(schedule->leader_slots + k, workers[t].slots, workers[t].num_slots * sizeof(leader_slot));
+        k += workers[t].num_slots;
+        free(workers[t].slots);
+        worker_free(&workers[t]);
+    }
+    free(workers);
+    qsort(schedule->leader_slots, schedule->num_leader_slots, sizeof(leader_slot), leader_slot_cmp);
+
+    platform_time_type end = platform_utils_get_wall_time();
+    schedule->seconds = platform_utils_get_wall_time_diff(start, end);
+    schedule->slots_per_second = schedule->seconds > 0 ? num_slots / schedule->seconds : 0;
+    return schedule;
+}
+
+void leader_schedule_free(leader_schedule *schedule) {
+    free(schedule->leader_slots);
+    free(schedule);
+}
+
+/*
+ *
+ * test functions
+ *
+ */
+
+// leader slots on one and on several threads as found slot by slot with prove_vrf, each output verifies
+static int leader_schedule_check(int print, int test, praos_vrf_suite suite, uint64_t num_slots) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    praos_vrf_params params = { suite, NULL, NULL };
+    key_pair kp;
+    key_pair_generate(group, &kp, ctx);
+    const unsigned char nonce[] = "leader schedule test nonce";
+    const uint64_t first_slot = 1000;
+    unsigned char threshold[LEADER_SCHEDULE_THRESHOLD_BYTES];
+    leader_schedule_threshold(threshold, 0.5, 0.5); // about 29% of the slots
+
+    leader_schedule *schedule1 = leader_schedule_compute(group, &kp, nonce, sizeof(nonce), first_slot, num_slots, threshold, 1, &params);
+    leader_schedule *schedule3 = leader_schedule_compute(group, &kp, nonce, sizeof(nonce), first_slot, num_slots, threshold, 3, &params);
+
+    // proofs are randomized, slots, u and randval are not
+    int ret1 = schedule1->num_leader_slots != schedule3->num_leader_slots;
+    for (int i=0; i<schedule1->num_leader_slots && !ret1; i++) {
+        const leader_slot *l1 = &schedule1->leader_slots[i];
+        const leader_slot *l3 = &schedule3->leader_slots[i];
+        ret1 = l1->slot != l3->slot || memcmp(l1->output, l3->output, P256_POINT_BYTES) != 0 ||
+               memcmp(l1->output + VRF_OUTPUT_RANDVAL_OFFSET, l3->output + VRF_OUTPUT_RANDVAL_OFFSET, SHA256_DIGEST_LENGTH) != 0;
+    }
+
+    int ret2 = schedule1->num_leader_slots == 0 || schedule1->num_leader_slots == (int)num_slots;
+    BIGNUM *seed = bn_new();
+    EC_POINT *u = point_new(group);
+    int k = 0;
+    for (uint64_t slot=first_slot; slot<first_slot+num_slots && !ret2; slot++) {
+        leader_schedule_slot_seed(seed, nonce, sizeof(nonce), slot);
+        BIGNUM *randval;
+        nizk_dl_eq_proof pi;
+        prove_vrf(group, seed, &randval, u, &pi, &kp, &params, ctx);
+        unsigned char randval_bytes[SHA256_DIGEST_LENGTH];
+        BN_bn2binpad(randval, randval_bytes, SHA256_DIGEST_LENGTH);
+        int leader = memcmp(randval_bytes, threshold, LEADER_SCHEDULE_THRESHOLD_BYTES) < 0;
+        if (leader) {
+            const leader_slot *l = &schedule1->leader_slots[k++];
+            ret2 = l->slot != slot || memcmp(l->output + VRF_OUTPUT_RANDVAL_OFFSET, randval_bytes, SHA256_DIGEST_LENGTH) != 0 ||
+                   verify_vrf_bytes(group, seed, l->output, kp.pub, &params, ctx) != 0;
+        } else {
+            ret2 = k < schedule1->num_leader_slots && schedule1->leader_slots[k].slot == slot;
+        }
+        nizk_dl_eq_proof_free(&pi);
+        bn_free(randval);
+    }
+    ret2 |= k != schedule1->num_leader_slots;
+
+    if (print) {
+        const char *suite_name = suite == PRAOS_VRF_SUITE_LEGACY ? "legacy" : "hash to curve";
+        printf("%6s Test %d - 1: Leader slots (%s suite) on 1 and 3 threads %s\n", ret1 ? "NOT OK" : "OK", test, suite_name, ret1 ? "do NOT match" : "match");
+        printf("%6s Test %d - 2: %d of %d leader slots %s prove_vrf slot by slot, outputs %s\n", ret2 ? "NOT OK" : "OK", test, schedule1->num_leader_slots,
+               (int)num_slots, ret2 ? "do NOT match" : "match", ret2 ? "NOT all verified" : "verified");
+    }
+
+    // cleanup
+    point_free(u);
+    bn_free(seed);
+    leader_schedule_free(schedule3);
+    leader_schedule_free(schedule1);
+    key_pair_free(&kp);
+    BN_CTX_free(ctx);
+    return ret1 || ret2;
+}
+
+static int leader_schedule_test_1(int print) {
+    return leader_schedule_check(print, 1, PRAOS_VRF_SUITE_LEGACY, 3 * LEADER_SCHEDULE_CHUNK + 5);
+}
+
+static int leader_schedule_test_2(int print) {
+    return leader_schedule_check(print, 2, PRAOS_VRF_SUITE_P256_SSWU, LEADER_SCHEDULE_CHUNK + 5);
+}
+
+// threshold bytes as fraction of 2^256 (first 8 bytes)
+static double threshold_value(const unsigned char *threshold) {
+    double value = 0;
+    for (int i=7; i>=0; i--) {
+        value = (value + threshold[i]) / 256;
+    }
+    return value;
+}
+
+// thresholds: none for no stake, all for f = 1, 2^256 * phi otherwise
+static int leader_schedule_test_3(int print) {
+    unsigned char threshold[LEADER_SCHEDULE_THRESHOLD_BYTES];
+    unsigned char expected[LEADER_SCHEDULE_THRESHOLD_BYTES];
+    leader_schedule_threshold(threshold, 0, 0.05);
+    memset(expected, 0, sizeof(expected));
+    int ret1 = memcmp(threshold, expected, sizeof(expected)) != 0;
+    leader_schedule_threshold(threshold, 0.3, 1);
+    memset(expected, 0xff, sizeof(expected));
+    ret1 |= memcmp(threshold, expected, sizeof(expected)) != 0;
+    leader_schedule_threshold(threshold, 1, 0.25); // phi = 1/4
+    ret1 |= fabs(threshold_value(threshold) - 0.25) > 1e-12;
+    leader_schedule_threshold(threshold, 2, 0.5); // phi = 3/4
+    ret1 |= fabs(threshold_value(threshold) - 0.75) > 1e-12;
+    leader_schedule_threshold(threshold, 0.01, 0.05); // phi = 1 - 0.95^0.01
+    ret1 |= fabs(threshold_value(threshold) - 5.128014e-4) > 1e-9;
+    if (print) {
+        printf("%6s Test 3 - 1: Leader thresholds %s\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT correct" : "correct");
+    }
+    return ret1;
+}
+
+typedef int (*test_function)(int);
+
+static test_function test_suite[] = {
+    &leader_schedule_test_1,
+    &leader_schedule_test_2,
+    &leader_schedule_test_3
+};
+
+int leader_schedule_test_suite(int print) {
+    if (print) {
+        printf("Leader schedule test suite BEGIN --------------------\n");
+    }
+    int num_tests = sizeof(test_suite)/sizeof(test_function);
+    int ret = 0;
+    for (int i=0; i<num_tests; i++) {
+        if (test_suite[i](print)) {
+            ret = 1;
+        }
+    }
+    if (print) {
+        printf("Leader schedule test suite END ----------------------\n");
+#ifdef DEBUG
+        print_allocation_status();
+        nizk_dl_eq_print_allocation_status();
+#endif
+        fflush(stdout);
+    }
+    return ret;
+}
@@ -0,0 +1,46 @@
+//
+//  leader_schedule.h
+//  OpenSSL-for-iOS
+//
+//  Leader schedule of one key for a range of slots: the VRF is evaluated for every slot seed of the epoch on
+//  several threads, chunk by chunk (seed hashes, transcript encodings and digests batched per chunk), and only
+//  the slots the key leads get a proof. The VRF outputs are the ones of prove_vrf for the slot seed.
+//
+
+#ifndef LEADER_SCHEDULE_H
+#define LEADER_SCHEDULE_H
+#include <stdint.h>
+#include "praos_vrf.h"
+
+#define LEADER_SCHEDULE_THRESHOLD_BYTES 32
+
+typedef struct {
+    uint64_t slot;
+    unsigned char output[VRF_OUTPUT_BYTES]; // u || proof || randval || suite (vrf_output_to_bytes), checked by verify_vrf_bytes
+} leader_slot;
+
+typedef struct {
+    uint64_t first_slot;
+    uint64_t num_slots;
+    int num_leader_slots;
+    leader_slot *leader_slots; // ascending slots
+    double seconds;            // wall time of the evaluation
+    double slots_per_second;
+} leader_schedule;
+
+// seed of a slot, SHA-256(epoch_nonce || slot as 8 bytes big endian)
+void leader_schedule_slot_seed(BIGNUM *seed, const unsigned char *epoch_nonce, size_t nonce_len, uint64_t slot);
+
+// threshold for relative_stake of the total stake and the active slot coefficient f: a slot is led if its randval,
+// as 256-bit big endian number, is below 2^256 * (1 - (1 - f)^relative_stake)
+void leader_schedule_threshold(unsigned char *threshold, double relative_stake, double active_slot_coeff);
+
+// the slots of [first_slot, first_slot + num_slots) led by kp with the VRF outputs for them, evaluated on
+// num_threads threads (1: the calling thread only), under the suite of params (NULL: legacy)
+leader_schedule *leader_schedule_compute(const EC_GROUP *group, key_pair *kp, const unsigned char *epoch_nonce, size_t nonce_len, uint64_t first_slot, uint64_t num_slots, const unsigned char *threshold, int num_threads, const praos_vrf_params *params);
+
+void leader_schedule_free(leader_schedule *schedule);
+
+int leader_schedule_test_suite(int print);
+
+#endif /* LEADER_SCHEDULE_H */
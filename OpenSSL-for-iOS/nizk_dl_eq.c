@@ -4,14 +4,19 @@
 //
 #include "nizk_dl_eq.h"
 #include <assert.h>
-#include "openssl_hashing_tools.h"
+#include <stdlib.h>
+#include <string.h>
+#include "vrf_metrics.h"
 
 #ifdef DEBUG
-static int num_initialized = 0;
-static int num_freed = 0;
+#include <stdatomic.h>
+static atomic_int num_initialized = 0;
+static atomic_int num_freed = 0;
 
 void nizk_dl_eq_print_allocation_status(void) {
-    printf("nizk_dl_eq: initalized %d, freed %d (%d diff)\n", num_initialized, num_freed, num_initialized - num_freed);
+    int initialized = atomic_load(&num_initialized);
+    int freed = atomic_load(&num_freed);
+    printf("nizk_dl_eq: initalized %d, freed %d (%d diff)\n", initialized, freed, initialized - freed);
 }
 #endif
 
@@ -31,70 +36,427 @@ void nizk_dl_eq_proof_free(nizk_dl_eq_proof *pi) {
 #endif
 }
 
-void nizk_dl_eq_prove(const EC_GROUP *group, const BIGNUM *exp, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const EC_POINT *B, nizk_dl_eq_proof *pi, BN_CTX *ctx) {
+void nizk_dl_eq_proof_init(const EC_GROUP *group, nizk_dl_eq_proof *pi) {
+    pi->Ra = point_new(group);
+    pi->Rb = point_new(group);
+    pi->z = bn_new();
+#ifdef DEBUG
+    num_initialized++;
+#endif
+}
+
+// transcript of a proof: protocol, b, B, a, A, Ra, Rb, then the challenge c (b and B first, so that a prefix
+// with them absorbed serves all proofs for one key)
+#define NIZK_DL_EQ_PROTOCOL "nizk_dl_eq"
+#define NIZK_DL_EQ_CHALLENGE_LABEL "c"
+static const char *const nizk_dl_eq_labels[] = { "b", "B", "a", "A", "Ra", "Rb" };
+
+void nizk_dl_eq_transcript_prefix(const EC_GROUP *group, transcript *t, const EC_POINT *b, const EC_POINT *B, const unsigned char *B_bytes, BN_CTX *ctx) {
+    transcript_init(t, NIZK_DL_EQ_PROTOCOL);
+    if (B_bytes) {
+        transcript_absorb_points(t, group, 1, nizk_dl_eq_labels, &b, ctx);
+        transcript_absorb(t, nizk_dl_eq_labels[1], B_bytes, P256_POINT_BYTES);
+    } else {
+        const EC_POINT *points[] = { b, B };
+        transcript_absorb_points(t, group, 2, nizk_dl_eq_labels, points, ctx);
+    }
+}
+
+// c = challenge of prefix followed by a, A, Ra, Rb, without prefix (NULL) of the transcript of all six points
+// (encoded together)
+static void nizk_dl_eq_challenge(const EC_GROUP *group, BIGNUM *c, const transcript *prefix, const EC_POINT *b, const EC_POINT *B, const EC_POINT *a, const EC_POINT *A, const EC_POINT *Ra, const EC_POINT *Rb, BN_CTX *ctx) {
+    transcript t;
+    const EC_POINT *points[] = { b, B, a, A, Ra, Rb };
+    if (prefix) {
+        transcript_clone(&t, prefix);
+        transcript_absorb_points(&t, group, 4, nizk_dl_eq_labels + 2, points + 2, ctx);
+    } else {
+        transcript_init(&t, NIZK_DL_EQ_PROTOCOL);
+        transcript_absorb_points(&t, group, 6, nizk_dl_eq_labels, points, ctx);
+    }
+    transcript_challenge(&t, NIZK_DL_EQ_CHALLENGE_LABEL, c, get0_order(group), ctx);
+}
+
+// fill the initialized proof pi, r and c are scratch (prefix as in nizk_dl_eq_challenge)
+static void nizk_dl_eq_prove_r(const EC_GROUP *group, const BIGNUM *exp, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const EC_POINT *B, const transcript *prefix, nizk_dl_eq_proof *pi, BIGNUM *r, BIGNUM *c, BN_CTX *ctx) {
     const BIGNUM *order = get0_order(group);
 
-    // compute Ra
-    BIGNUM *r = bn_random(order, ctx); // draw r uniformly at random
-    pi->Ra = point_new(group);
+    // compute Ra and Rb
+    bn_random_r(r, order, ctx); // draw r uniformly at random
     point_mul(group, pi->Ra, r, a, ctx);
-
-    // compute Rb
-    pi->Rb = point_new(group);
     point_mul(group, pi->Rb, r, b, ctx);
 
     // compute c
-    BIGNUM *c = openssl_hash_points2bn(group, ctx, 6, a, A, b, B, pi->Ra, pi->Rb);
+    nizk_dl_eq_challenge(group, c, prefix, b, B, a, A, pi->Ra, pi->Rb, ctx);
 
     // compute z
-    pi->z = bn_new();
     int ret = BN_mod_mul(pi->z, c, exp, order, ctx);
     assert(ret == 1 && "nizk_dl_eq_prove: BN_mod_mul computation failed");
     ret = BN_mod_sub(pi->z, r, pi->z, order, ctx);
     assert(ret == 1 && "nizk_dl_eq_prove: BN_mod_sub computation failed");
+}
+
+// pi = proof with the transcript prefix (NULL for the whole transcript at once)
+static void nizk_dl_eq_prove_transcript(const EC_GROUP *group, const BIGNUM *exp, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const EC_POINT *B, const transcript *prefix, nizk_dl_eq_proof *pi, BN_CTX *ctx) {
+    int metrics = vrf_metrics_op_begin(VRF_METRICS_OP_NIZK_PROVE);
+    nizk_dl_eq_proof_init(group, pi);
+    BIGNUM *r = bn_new();
+    BIGNUM *c = bn_new();
+    nizk_dl_eq_prove_r(group, exp, a, A, b, B, prefix, pi, r, c, ctx);
 
     // cleanup
     bn_free(c);
     bn_free(r);
-    
-#ifdef DEBUG
-    num_initialized++;
-#endif
+    vrf_metrics_op_end(metrics);
+
     /* implicitly return pi = (Ra, Rb, z) */
 }
 
-int nizk_dl_eq_verify(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const EC_POINT *B, const nizk_dl_eq_proof *pi, BN_CTX *ctx) {
+void nizk_dl_eq_prove(const EC_GROUP *group, const BIGNUM *exp, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const EC_POINT *B, nizk_dl_eq_proof *pi, BN_CTX *ctx) {
+    nizk_dl_eq_prove_transcript(group, exp, a, A, b, B, NULL, pi, ctx);
+}
+
+void nizk_dl_eq_prove_prefix(const EC_GROUP *group, const BIGNUM *exp, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const transcript *prefix, nizk_dl_eq_proof *pi, BN_CTX *ctx) {
+    assert(prefix && "nizk_dl_eq_prove_prefix: usage error, no prefix passed");
+    nizk_dl_eq_prove_transcript(group, exp, a, A, b, NULL, prefix, pi, ctx);
+}
+
+void nizk_dl_eq_prove_arena(const EC_GROUP *group, const BIGNUM *exp, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const EC_POINT *B, nizk_dl_eq_proof *pi, p256_arena *arena) {
+    int metrics = vrf_metrics_op_begin(VRF_METRICS_OP_NIZK_PROVE);
+    p256_arena_start(arena);
+    BIGNUM *r = p256_arena_bn(arena);
+    BIGNUM *c = p256_arena_bn(arena);
+    nizk_dl_eq_prove_r(group, exp, a, A, b, B, NULL, pi, r, c, p256_arena_get0_bn_ctx(arena));
+    p256_arena_end(arena);
+    vrf_metrics_op_end(metrics);
+}
+
+// r = [z]x + [c]X, x goes through the fixed-base table if it is the generator
+static void nizk_dl_eq_lincomb(const EC_GROUP *group, EC_POINT *r, const BIGNUM *z, const EC_POINT *x, const BIGNUM *c, const EC_POINT *X, BN_CTX *ctx) {
+    VRF_METRICS_COUNT(VRF_METRICS_MSM, 1);
+    VRF_METRICS_COUNT(VRF_METRICS_MSM_TERMS, 2);
+    int ret;
+    if (point_is_generator(group, x)) {
+        ret = EC_POINTs_mul(group, r, z, 1, &X, &c, ctx); // no wrapper for EC_POINTs_mul
+    } else {
+        const EC_POINT *points[] = { x, X };
+        const BIGNUM *bns[] = { z, c };
+        ret = EC_POINTs_mul(group, r, NULL, 2, points, bns, ctx); // no wrapper for EC_POINTs_mul
+    }
+    assert(ret == 1 && "nizk_dl_eq_lincomb: EC_POINTs_mul failed");
+}
+
+// R_prime and c are scratch (prefix as in nizk_dl_eq_challenge)
+static int nizk_dl_eq_verify_r(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const EC_POINT *B, const transcript *prefix, const nizk_dl_eq_proof *pi, EC_POINT *R_prime, BIGNUM *c, BN_CTX *ctx) {
     // compute c
-    BIGNUM *c = openssl_hash_points2bn(group, ctx, 6, a, A, b, B, pi->Ra, pi->Rb);
+    nizk_dl_eq_challenge(group, c, prefix, b, B, a, A, pi->Ra, pi->Rb, ctx);
 
     /* check if pi->Ra = [pi->z]a + [c]A */
-    EC_POINT *Ra_prime = point_new(group);
-    const EC_POINT *a_points[] = { a, A };
-    const BIGNUM *bns[] = { pi->z, c };
-    EC_POINTs_mul(group, Ra_prime, NULL, 2, a_points, bns, ctx); // no wrapper for EC_POINTs_mul
-    int ret = point_cmp(group, Ra_prime, pi->Ra, ctx);
-    point_free(Ra_prime);
-    
-    if (ret == 1) { // not equal
-        bn_free(c);
+    nizk_dl_eq_lincomb(group, R_prime, pi->z, a, c, A, ctx);
+    if (point_cmp(group, R_prime, pi->Ra, ctx) == 1) { // not equal
         return 1; // verification failed
     }
-    
+
     /* check if pi->Rb = [pi->z]b + [c]B */
-    EC_POINT *Rb_prime = point_new(group);
-    const EC_POINT *b_points[] = { b, B };
-    EC_POINTs_mul(group, Rb_prime, NULL, 2, b_points, bns, ctx); // no wrapper for EC_POINTs_mul
-    ret = point_cmp(group, Rb_prime, pi->Rb, ctx);
-    point_free(Rb_prime);
-    if (ret == 1) { // not equal
-        bn_free(c);
-        return 1; // verification failed
+    nizk_dl_eq_lincomb(group, R_prime, pi->z, b, c, B, ctx);
+    return point_cmp(group, R_prime, pi->Rb, ctx); // 0 if verification successful
+}
+
+static int nizk_dl_eq_verify_transcript(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const EC_POINT *B, const transcript *prefix, const nizk_dl_eq_proof *pi, BN_CTX *ctx) {
+    int metrics = vrf_metrics_op_begin(VRF_METRICS_OP_NIZK_VERIFY);
+    EC_POINT *R_prime = point_new(group);
+    BIGNUM *c = bn_new();
+    int ret = nizk_dl_eq_verify_r(group, a, A, b, B, prefix, pi, R_prime, c, ctx);
+
+    // cleanup
+    bn_free(c);
+    point_free(R_prime);
+    vrf_metrics_op_end(metrics);
+
+    return ret;
+}
+
+int nizk_dl_eq_verify(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const EC_POINT *B, const nizk_dl_eq_proof *pi, BN_CTX *ctx) {
+    return nizk_dl_eq_verify_transcript(group, a, A, b, B, NULL, pi, ctx);
+}
+
+int nizk_dl_eq_verify_prefix(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const EC_POINT *B, const transcript *prefix, const nizk_dl_eq_proof *pi, BN_CTX *ctx) {
+    assert(prefix && "nizk_dl_eq_verify_prefix: usage error, no prefix passed");
+    return nizk_dl_eq_verify_transcript(group, a, A, b, B, prefix, pi, ctx);
+}
+
+int nizk_dl_eq_verify_arena(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const EC_POINT *B, const nizk_dl_eq_proof *pi, p256_arena *arena) {
+    int metrics = vrf_metrics_op_begin(VRF_METRICS_OP_NIZK_VERIFY);
+    p256_arena_start(arena);
+    EC_POINT *R_prime = p256_arena_point(arena);
+    BIGNUM *c = p256_arena_bn(arena);
+    int ret = nizk_dl_eq_verify_r(group, a, A, b, B, NULL, pi, R_prime, c, p256_arena_get0_bn_ctx(arena));
+    p256_arena_end(arena);
+    vrf_metrics_op_end(metrics);
+    return ret;
+}
+
+int nizk_dl_eq_verify_registered(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *A, pubkey_registry *reg, int key_index, const nizk_dl_eq_proof *pi, BN_CTX *ctx) {
+    const EC_POINT *B = pubkey_registry_get0_pub(reg, key_index);
+    int metrics = vrf_metrics_op_begin(VRF_METRICS_OP_NIZK_VERIFY);
+
+    // compute c, B absorbed as stored in the registry
+    unsigned char B_bytes[P256_POINT_BYTES];
+    pubkey_registry_get_pub_bytes(reg, key_index, B_bytes);
+    transcript prefix;
+    nizk_dl_eq_transcript_prefix(group, &prefix, get0_generator(group), B, B_bytes, ctx);
+    BIGNUM *c = bn_new();
+    nizk_dl_eq_challenge(group, c, &prefix, NULL, NULL, a, A, pi->Ra, pi->Rb, ctx);
+
+    /* check if pi->Ra = [pi->z]a + [c]A */
+    EC_POINT *R_prime = point_new(group);
+    nizk_dl_eq_lincomb(group, R_prime, pi->z, a, c, A, ctx);
+    int ret = point_cmp(group, R_prime, pi->Ra, ctx);
+
+    /* check if pi->Rb = [pi->z]G + [c]B, both from fixed-base tables */
+    if (ret == 0) {
+        pubkey_registry_mul(reg, R_prime, pi->z, key_index, c, ctx);
+        ret = point_cmp(group, R_prime, pi->Rb, ctx);
     }
 
     // cleanup
+    point_free(R_prime);
     bn_free(c);
+    vrf_metrics_op_end(metrics);
+
+    return ret; // 0 if verification successful
+}
+
+/*
+ *
+ *  nizk_dl_eq proof encoding
+ *
+ */
+int nizk_dl_eq_proof_to_bytes(const EC_GROUP *group, const nizk_dl_eq_proof *pi, unsigned char *buf, BN_CTX *ctx) {
+    if (point_to_bytes(group, pi->Ra, buf, ctx) || point_to_bytes(group, pi->Rb, buf + P256_POINT_BYTES, ctx)) {
+        return 1;
+    }
+    return bn_to_bytes(pi->z, buf + 2 * P256_POINT_BYTES);
+}
+
+int nizk_dl_eq_proof_from_bytes(const EC_GROUP *group, nizk_dl_eq_proof *pi, const unsigned char *buf, BN_CTX *ctx) {
+    EC_POINT *Ra = point_new(group);
+    EC_POINT *Rb = point_new(group);
+    BIGNUM *z = bn_from_binary_data(P256_SCALAR_BYTES, buf + 2 * P256_POINT_BYTES);
+    if (point_from_bytes(group, Ra, buf, ctx) || point_from_bytes(group, Rb, buf + P256_POINT_BYTES, ctx) || BN_cmp(z, get0_order(group)) >= 0) {
+        point_free(Ra);
+        point_free(Rb);
+        bn_free(z);
+        return 1;
+    }
+    pi->Ra = Ra;
+    pi->Rb = Rb;
+    pi->z = z;
+#ifdef DEBUG
+    num_initialized++;
+#endif
+    return 0;
+}
+
+// as nizk_dl_eq_verify_bytes_prefix, without prefix (NULL) b, B, a and A are encoded together
+static int nizk_dl_eq_verify_bytes_transcript(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *A, const unsigned char *A_bytes, const EC_POINT *b, const EC_POINT *B, const transcript *prefix, const unsigned char *proof, BN_CTX *ctx) {
+    const unsigned char *Ra = proof;
+    const unsigned char *Rb = proof + P256_POINT_BYTES;
+
+    BN_CTX_start(ctx);
+    BIGNUM *z = BN_CTX_get(ctx);
+    BIGNUM *c = BN_CTX_get(ctx);
+    assert(c && "nizk_dl_eq_verify_bytes: BN_CTX_get failed");
+    BN_bin2bn(proof + 2 * P256_POINT_BYTES, P256_SCALAR_BYTES, z);
+    if (BN_cmp(z, get0_order(group)) >= 0) {
+        BN_CTX_end(ctx);
+        return 1; // z not canonical
+    }
+
+    int metrics = vrf_metrics_op_begin(VRF_METRICS_OP_NIZK_VERIFY);
+
+    // compute c, A (if given) and Ra, Rb are absorbed as received
+    transcript t;
+    if (prefix) {
+        transcript_clone(&t, prefix);
+        if (A_bytes) {
+            transcript_absorb_points(&t, group, 1, nizk_dl_eq_labels + 2, &a, ctx);
+            transcript_absorb(&t, nizk_dl_eq_labels[3], A_bytes, P256_POINT_BYTES);
+        } else {
+            const EC_POINT *points[] = { a, A };
+            transcript_absorb_points(&t, group, 2, nizk_dl_eq_labels + 2, points, ctx);
+        }
+    } else {
+        const EC_POINT *points[] = { b, B, a, A };
+        transcript_init(&t, NIZK_DL_EQ_PROTOCOL);
+        transcript_absorb_points(&t, group, 4, nizk_dl_eq_labels, points, ctx);
+    }
+    transcript_absorb(&t, nizk_dl_eq_labels[4], Ra, P256_POINT_BYTES);
+    transcript_absorb(&t, nizk_dl_eq_labels[5], Rb, P256_POINT_BYTES);
+    transcript_challenge(&t, NIZK_DL_EQ_CHALLENGE_LABEL, c, get0_order(group), ctx);
+
+    /* check if Ra = [z]a + [c]A and Rb = [z]b + [c]B, comparing canonical encodings */
+    EC_POINT *R_prime = point_new(group);
+    unsigned char R_prime_bytes[P256_POINT_BYTES];
+    nizk_dl_eq_lincomb(group, R_prime, z, a, c, A, ctx);
+    int ret = point_to_bytes(group, R_prime, R_prime_bytes, ctx) || memcmp(R_prime_bytes, Ra, P256_POINT_BYTES);
+    if (ret == 0) {
+        nizk_dl_eq_lincomb(group, R_prime, z, b, c, B, ctx);
+        ret = point_to_bytes(group, R_prime, R_prime_bytes, ctx) || memcmp(R_prime_bytes, Rb, P256_POINT_BYTES);
+    }
+
+    // cleanup
+    point_free(R_prime);
+    BN_CTX_end(ctx);
+    vrf_metrics_op_end(metrics);
+
+    return ret; // 0 if verification successful
+}
+
+int nizk_dl_eq_verify_bytes(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const EC_POINT *B, const unsigned char *proof, BN_CTX *ctx) {
+    return nizk_dl_eq_verify_bytes_transcript(group, a, A, NULL, b, B, NULL, proof, ctx);
+}
+
+int nizk_dl_eq_verify_bytes_prefix(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *A, const unsigned char *A_bytes, const EC_POINT *b, const EC_POINT *B, const transcript *prefix, const unsigned char *proof, BN_CTX *ctx) {
+    assert(prefix && "nizk_dl_eq_verify_bytes_prefix: usage error, no prefix passed");
+    return nizk_dl_eq_verify_bytes_transcript(group, a, A, A_bytes, b, B, prefix, proof, ctx);
+}
+
+/*
+ *
+ *  nizk_dl_eq batch verification
+ *
+ */
+
+// number of bits of the random batch weights (soundness error 2^-128 per batch)
+#define NIZK_DL_EQ_BATCH_WEIGHT_BITS 128
+
+// draw a nonzero random batch weight
+static void nizk_dl_eq_batch_weight(BIGNUM *w) {
+    do {
+        int ret = BN_rand(w, NIZK_DL_EQ_BATCH_WEIGHT_BITS, -1, 0);
+        assert(ret == 1 && "nizk_dl_eq_batch_weight: BN_rand error");
+    } while (BN_is_zero(w));
+}
+
+// add w to the generator coefficient if p is the group generator, returns 1 if merged
+static int nizk_dl_eq_batch_merge_generator(const EC_GROUP *group, BIGNUM *g_scalar, const EC_POINT *p, const BIGNUM *w, BN_CTX *ctx) {
+    if (!point_is_generator(group, p)) {
+        return 0;
+    }
+    int ret = BN_mod_add(g_scalar, g_scalar, w, get0_order(group), ctx);
+    assert(ret == 1 && "nizk_dl_eq_batch_merge_generator: BN_mod_add failed");
+    return 1;
+}
+
+/*
+ * check the proofs first..first+num-1 at once using random weights rho_i, sigma_i:
+ *   sum_i rho_i*([z_i]a_i + [c_i]A_i - Ra_i) + sigma_i*([z_i]b_i + [c_i]B_i - Rb_i) = O
+ * terms whose base is the generator are collected into a single generator term
+ */
+static int nizk_dl_eq_verify_batch_range(const EC_GROUP *group, int first, int num, const EC_POINT **a, const EC_POINT **A, const EC_POINT **b, const EC_POINT **B, const nizk_dl_eq_proof *pi, BIGNUM **c, BN_CTX *ctx) {
+    const BIGNUM *order = get0_order(group);
+    int max_terms = 6 * num + 1;
+    const EC_POINT **points = malloc(max_terms * sizeof(EC_POINT*));
+    assert(points && "nizk_dl_eq_verify_batch_range: allocation error (points)");
+    BIGNUM **scalars = bn_new_array(max_terms);
+    BIGNUM *g_scalar = bn_new();
+    BN_zero(g_scalar);
+    BIGNUM *rho = bn_new();
+    BIGNUM *sigma = bn_new();
+    BIGNUM *t = bn_new();
+
+    int num_terms = 0;
+    int ret;
+    for (int i=first; i<first+num; i++) {
+        nizk_dl_eq_batch_weight(rho);
+        nizk_dl_eq_batch_weight(sigma);
+        const BIGNUM *weights[] = { rho, sigma };
+        const EC_POINT *bases[][3] = { { a[i], A[i], pi[i].Ra }, { b[i], B[i], pi[i].Rb } };
+        for (int j=0; j<2; j++) {
+            // [w*z]base, [w*c]Base, [-w]R
+            ret = BN_mod_mul(t, weights[j], pi[i].z, order, ctx);
+            assert(ret == 1 && "nizk_dl_eq_verify_batch_range: BN_mod_mul failed");
+            if (!nizk_dl_eq_batch_merge_generator(group, g_scalar, bases[j][0], t, ctx)) {
+                BN_copy(scalars[num_terms], t);
+                points[num_terms++] = bases[j][0];
+            }
+            ret = BN_mod_mul(t, weights[j], c[i], order, ctx);
+            assert(ret == 1 && "nizk_dl_eq_verify_batch_range: BN_mod_mul failed");
+            if (!nizk_dl_eq_batch_merge_generator(group, g_scalar, bases[j][1], t, ctx)) {
+                BN_copy(scalars[num_terms], t);
+                points[num_terms++] = bases[j][1];
+            }
+            ret = BN_sub(scalars[num_terms], order, weights[j]);
+            assert(ret == 1 && "nizk_dl_eq_verify_batch_range: BN_sub failed");
+            points[num_terms++] = bases[j][2];
+        }
+    }
+
+    if (!BN_is_zero(g_scalar)) {
+        BN_copy(scalars[num_terms], g_scalar);
+        points[num_terms++] = get0_generator(group);
+    }
+
+    EC_POINT *sum = point_new(group);
+    point_weighted_sum(group, sum, num_terms, (const BIGNUM**)scalars, points, ctx);
+    ret = EC_POINT_is_at_infinity(group, sum) ? 0 : 1;
+
+    // cleanup
+    point_free(sum);
+    bn_free(t);
+    bn_free(sigma);
+    bn_free(rho);
+    bn_free(g_scalar);
+    bn_free_array(max_terms, scalars);
+    free(points);
 
-    return 0; // verification successful
+    return ret; // 0 if all proofs in the range verify
+}
+
+// bisect a failing range to find its first bad proof
+static int nizk_dl_eq_find_bad_proof(const EC_GROUP *group, int first, int num, const EC_POINT **a, const EC_POINT **A, const EC_POINT **b, const EC_POINT **B, const nizk_dl_eq_proof *pi, BIGNUM **c, BN_CTX *ctx) {
+    while (num > 1) {
+        int half = num / 2;
+        if (nizk_dl_eq_verify_batch_range(group, first, half, a, A, b, B, pi, c, ctx)) {
+            num = half; // bad proof in the lower half
+        } else {
+            first += half; // lower half fine, bad proof in the upper half
+            num -= half;
+        }
+    }
+    return first;
+}
+
+int nizk_dl_eq_verify_batch(const EC_GROUP *group, int num_proofs, const EC_POINT **a, const EC_POINT **A, const EC_POINT **b, const EC_POINT **B, const nizk_dl_eq_proof *pi, int *bad_index, BN_CTX *ctx) {
+    assert(num_proofs > 0 && "nizk_dl_eq_verify_batch: usage error, no proofs passed");
+    int metrics = vrf_metrics_op_begin(VRF_METRICS_OP_NIZK_VERIFY_BATCH);
+
+    // compute challenges once, they are reused while searching for a bad proof
+    // (the independent transcripts are hashed several at a time)
+    BIGNUM **c = bn_new_array(num_proofs);
+    const EC_POINT **Ra = malloc(num_proofs * sizeof(EC_POINT*));
+    const EC_POINT **Rb = malloc(num_proofs * sizeof(EC_POINT*));
+    assert(Ra && Rb && "nizk_dl_eq_verify_batch: allocation error");
+    for (int i=0; i<num_proofs; i++) {
+        Ra[i] = pi[i].Ra;
+        Rb[i] = pi[i].Rb;
+    }
+    const EC_POINT **columns[6] = { b, B, a, A, Ra, Rb };
+    transcript_challenge_columns(c, group, NIZK_DL_EQ_PROTOCOL, 6, nizk_dl_eq_labels, columns, NIZK_DL_EQ_CHALLENGE_LABEL, num_proofs, ctx);
+    free(Ra);
+    free(Rb);
+
+    int ret = nizk_dl_eq_verify_batch_range(group, 0, num_proofs, a, A, b, B, pi, c, ctx);
+    if (ret && bad_index) {
+        *bad_index = nizk_dl_eq_find_bad_proof(group, 0, num_proofs, a, A, b, B, pi, c, ctx);
+    }
+
+    // cleanup
+    bn_free_array(num_proofs, c);
+    vrf_metrics_op_end(metrics);
+
+    return ret; // 0 if all proofs verify
 }
 
 /*
@@ -208,11 +570,186 @@ static int nizk_dl_eq_test_2(int print) {
     return !(ret1 == 0 && ret2 != 0);
 }
 
+static int nizk_dl_eq_test_3(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    const int num_proofs = 9;
+    const int bad = 5;
+
+    // VRF-like statements, b is the generator
+    BIGNUM *exp[num_proofs];
+    EC_POINT *a[num_proofs], *A[num_proofs], *B[num_proofs];
+    const EC_POINT *b[num_proofs];
+    nizk_dl_eq_proof pi[num_proofs];
+    for (int i=0; i<num_proofs; i++) {
+        exp[i] = bn_random(get0_order(group), ctx);
+        a[i] = point_random(group, ctx);
+        A[i] = point_new(group);
+        point_mul(group, A[i], exp[i], a[i], ctx);
+        b[i] = get0_generator(group);
+        B[i] = bn2point(group, exp[i], ctx);
+        nizk_dl_eq_prove(group, exp[i], a[i], A[i], b[i], B[i], &pi[i], ctx);
+    }
+
+    // all proofs correct
+    int bad_index = -1;
+    int ret1 = nizk_dl_eq_verify_batch(group, num_proofs, (const EC_POINT**)a, (const EC_POINT**)A, b, (const EC_POINT**)B, pi, &bad_index, ctx);
+    if (print) {
+        printf("%6s Test 3 - 1: Correct NIZK DL EQ Proof batch %s accepted\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // negative test, one proof with a bad B-value
+    point_add(group, B[bad], B[bad], b[bad], ctx);
+    int ret2 = nizk_dl_eq_verify_batch(group, num_proofs, (const EC_POINT**)a, (const EC_POINT**)A, b, (const EC_POINT**)B, pi, &bad_index, ctx);
+    if (print) {
+        if (ret2 && bad_index == bad) {
+            printf("    OK Test 3 - 2: Incorrect NIZK DL EQ Proof batch not accepted, bad proof %d found (which is CORRECT)\n", bad_index);
+        } else {
+            printf("NOT OK Test 3 - 2: Incorrect NIZK DL EQ Proof batch IS accepted or bad proof not found (which is an ERROR)\n");
+        }
+    }
+
+    // cleanup
+    for (int i=0; i<num_proofs; i++) {
+        nizk_dl_eq_proof_free(&pi[i]);
+        point_free(a[i]);
+        point_free(A[i]);
+        point_free(B[i]);
+        bn_free(exp[i]);
+    }
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 != 0 && bad_index == bad);
+}
+
+static int nizk_dl_eq_test_4(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    BIGNUM *exp = bn_random(get0_order(group), ctx);
+    EC_POINT *a = point_random(group, ctx);
+    EC_POINT *A = point_new(group);
+    point_mul(group, A, exp, a, ctx);
+    const EC_POINT *b = get0_generator(group);
+    EC_POINT *B = bn2point(group, exp, ctx);
+    nizk_dl_eq_proof pi;
+    nizk_dl_eq_prove(group, exp, a, A, b, B, &pi, ctx);
+
+    // encoded proof verifies in place and decodes to a proof that verifies
+    unsigned char buf[NIZK_DL_EQ_PROOF_BYTES];
+    nizk_dl_eq_proof pi_decoded;
+    int ret1 = nizk_dl_eq_proof_to_bytes(group, &pi, buf, ctx) || nizk_dl_eq_verify_bytes(group, a, A, b, B, buf, ctx);
+    if (!ret1) {
+        ret1 = nizk_dl_eq_proof_from_bytes(group, &pi_decoded, buf, ctx);
+        if (!ret1) {
+            ret1 = nizk_dl_eq_verify(group, a, A, b, B, &pi_decoded, ctx);
+            nizk_dl_eq_proof_free(&pi_decoded);
+        }
+    }
+    if (print) {
+        printf("%6s Test 4 - 1: Correct encoded NIZK DL EQ Proof %s accepted\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // negative tests, a modified byte in Ra, Rb or z and a z that is not reduced
+    int ret2 = 0;
+    const int offsets[] = { 1, P256_POINT_BYTES + 7, NIZK_DL_EQ_PROOF_BYTES - 1 };
+    for (int i=0; i<3; i++) {
+        buf[offsets[i]] ^= 0x01;
+        ret2 |= !nizk_dl_eq_verify_bytes(group, a, A, b, B, buf, ctx);
+        buf[offsets[i]] ^= 0x01;
+    }
+    memset(buf + 2 * P256_POINT_BYTES, 0xff, P256_SCALAR_BYTES);
+    ret2 |= !nizk_dl_eq_verify_bytes(group, a, A, b, B, buf, ctx);
+    ret2 |= !nizk_dl_eq_proof_from_bytes(group, &pi_decoded, buf, ctx);
+    if (print) {
+        if (!ret2) {
+            printf("    OK Test 4 - 2: Incorrect encoded NIZK DL EQ Proofs not accepted (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 4 - 2: Incorrect encoded NIZK DL EQ Proof IS accepted (which is an ERROR)\n");
+        }
+    }
+
+    // cleanup
+    nizk_dl_eq_proof_free(&pi);
+    point_free(a);
+    point_free(A);
+    point_free(B);
+    bn_free(exp);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0);
+}
+
+static int nizk_dl_eq_test_5(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    BIGNUM *exp = bn_random(get0_order(group), ctx);
+    EC_POINT *a = point_random(group, ctx);
+    EC_POINT *A = point_new(group);
+    point_mul(group, A, exp, a, ctx);
+    const EC_POINT *b = get0_generator(group);
+    EC_POINT *B = bn2point(group, exp, ctx);
+    pubkey_registry *reg = pubkey_registry_new(group);
+    int key_index = pubkey_registry_add(reg, B, ctx);
+
+    // proof from a prefix with B absorbed as stored in the registry verifies against the prefix of the points,
+    // in place with A absorbed as encoded and against the registered key
+    unsigned char B_bytes[P256_POINT_BYTES];
+    unsigned char A_bytes[P256_POINT_BYTES];
+    pubkey_registry_get_pub_bytes(reg, key_index, B_bytes);
+    int ret1 = point_to_bytes(group, A, A_bytes, ctx);
+    transcript prefix, prefix_points;
+    nizk_dl_eq_transcript_prefix(group, &prefix, b, B, B_bytes, ctx);
+    nizk_dl_eq_transcript_prefix(group, &prefix_points, b, B, NULL, ctx);
+    nizk_dl_eq_proof pi;
+    nizk_dl_eq_prove_prefix(group, exp, a, A, b, &prefix, &pi, ctx);
+    unsigned char buf[NIZK_DL_EQ_PROOF_BYTES];
+    ret1 |= nizk_dl_eq_verify(group, a, A, b, B, &pi, ctx);
+    ret1 |= nizk_dl_eq_verify_prefix(group, a, A, b, B, &prefix_points, &pi, ctx);
+    ret1 |= nizk_dl_eq_verify_registered(group, a, A, reg, key_index, &pi, ctx);
+    ret1 |= nizk_dl_eq_proof_to_bytes(group, &pi, buf, ctx) || nizk_dl_eq_verify_bytes_prefix(group, a, A, A_bytes, b, B, &prefix, buf, ctx);
+    if (print) {
+        printf("%6s Test 5 - 1: Correct NIZK DL EQ Proof %s accepted from a transcript prefix\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // negative tests, prefix of another key and A encoded differently from the A of the statement
+    EC_POINT *B_bad = point_random(group, ctx);
+    transcript prefix_bad;
+    nizk_dl_eq_transcript_prefix(group, &prefix_bad, b, B_bad, NULL, ctx);
+    int ret2 = !nizk_dl_eq_verify_prefix(group, a, A, b, B, &prefix_bad, &pi, ctx);
+    A_bytes[1] ^= 0x01;
+    ret2 |= !nizk_dl_eq_verify_bytes_prefix(group, a, A, A_bytes, b, B, &prefix, buf, ctx);
+    if (print) {
+        if (!ret2) {
+            printf("    OK Test 5 - 2: NIZK DL EQ Proof not accepted under another transcript (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 5 - 2: NIZK DL EQ Proof IS accepted under another transcript (which is an ERROR)\n");
+        }
+    }
+
+    // cleanup
+    nizk_dl_eq_proof_free(&pi);
+    pubkey_registry_free(reg);
+    point_free(B_bad);
+    point_free(a);
+    point_free(A);
+    point_free(B);
+    bn_free(exp);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0);
+}
+
 typedef int (*test_function)(int);
 
 static test_function test_suite[] = {
     &nizk_dl_eq_test_1,
-    &nizk_dl_eq_test_2
+    &nizk_dl_eq_test_2,
+    &nizk_dl_eq_test_3,
+    &nizk_dl_eq_test_4,
+    &nizk_dl_eq_test_5
 };
 
 int nizk_dl_eq_test_suite(int print) {
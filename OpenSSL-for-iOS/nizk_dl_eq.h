@@ -7,6 +7,8 @@
 #ifndef NIZK_DL_EQ_H
 #define NIZK_DL_EQ_H
 #include "P256.h"
+#include "pubkey_registry.h"
+#include "transcript.h"
 
 typedef struct {
     EC_POINT *Ra;
@@ -16,8 +18,37 @@ typedef struct {
 
 void nizk_dl_eq_prove(const EC_GROUP *group, const BIGNUM *exp, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const EC_POINT *B, nizk_dl_eq_proof *pi, BN_CTX *ctx);
 int nizk_dl_eq_verify(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const EC_POINT *B, const nizk_dl_eq_proof *pi, BN_CTX *ctx);
+// Fiat-Shamir transcript prefix of the proofs with statement part b, B (b, B absorbed), to be cloned by the _prefix
+// variants when many proofs share b and B (e.g. b the generator and B a public key); B_bytes (P256_POINT_BYTES)
+// is the encoding of B as received, absorbed as it is (NULL to encode B)
+void nizk_dl_eq_transcript_prefix(const EC_GROUP *group, transcript *t, const EC_POINT *b, const EC_POINT *B, const unsigned char *B_bytes, BN_CTX *ctx);
+// as nizk_dl_eq_prove and nizk_dl_eq_verify with the transcript prefix of b and B
+void nizk_dl_eq_prove_prefix(const EC_GROUP *group, const BIGNUM *exp, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const transcript *prefix, nizk_dl_eq_proof *pi, BN_CTX *ctx);
+int nizk_dl_eq_verify_prefix(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const EC_POINT *B, const transcript *prefix, const nizk_dl_eq_proof *pi, BN_CTX *ctx);
+// allocate the fields of pi, to be filled by nizk_dl_eq_prove_arena (and freed by nizk_dl_eq_proof_free)
+void nizk_dl_eq_proof_init(const EC_GROUP *group, nizk_dl_eq_proof *pi);
+// as nizk_dl_eq_prove and nizk_dl_eq_verify, with all scratch values taken from arena (pi initialized)
+void nizk_dl_eq_prove_arena(const EC_GROUP *group, const BIGNUM *exp, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const EC_POINT *B, nizk_dl_eq_proof *pi, p256_arena *arena);
+int nizk_dl_eq_verify_arena(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const EC_POINT *B, const nizk_dl_eq_proof *pi, p256_arena *arena);
+// verify with b the generator and B the registered key key_index (VRF statements)
+int nizk_dl_eq_verify_registered(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *A, pubkey_registry *reg, int key_index, const nizk_dl_eq_proof *pi, BN_CTX *ctx);
+// verify num_proofs proofs (a[i], A[i], b[i], B[i], pi[i]) with a single random linear combination check,
+// returns 0 if all proofs verify, otherwise 1 and (if bad_index is non-NULL) the index of the first bad proof
+int nizk_dl_eq_verify_batch(const EC_GROUP *group, int num_proofs, const EC_POINT **a, const EC_POINT **A, const EC_POINT **b, const EC_POINT **B, const nizk_dl_eq_proof *pi, int *bad_index, BN_CTX *ctx);
 void nizk_dl_eq_proof_free(nizk_dl_eq_proof *pi);
 
+// fixed-size proof encoding Ra || Rb || z
+#define NIZK_DL_EQ_PROOF_BYTES (2 * P256_POINT_BYTES + P256_SCALAR_BYTES)
+// write pi to buf (NIZK_DL_EQ_PROOF_BYTES), returns 0 on success
+int nizk_dl_eq_proof_to_bytes(const EC_GROUP *group, const nizk_dl_eq_proof *pi, unsigned char *buf, BN_CTX *ctx);
+// read pi from buf, returns 0 on success (pi is only allocated on success)
+int nizk_dl_eq_proof_from_bytes(const EC_GROUP *group, nizk_dl_eq_proof *pi, const unsigned char *buf, BN_CTX *ctx);
+// verify an encoded proof in place, Ra and Rb are hashed and compared in their encoded form and never decoded
+int nizk_dl_eq_verify_bytes(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *A, const EC_POINT *b, const EC_POINT *B, const unsigned char *proof, BN_CTX *ctx);
+// as nizk_dl_eq_verify_bytes with the transcript prefix of b and B, A_bytes (if non-NULL) is the encoding of A as
+// received and absorbed as it is
+int nizk_dl_eq_verify_bytes_prefix(const EC_GROUP *group, const EC_POINT *a, const EC_POINT *A, const unsigned char *A_bytes, const EC_POINT *b, const EC_POINT *B, const transcript *prefix, const unsigned char *proof, BN_CTX *ctx);
+
 int nizk_dl_eq_test_suite(int print);
 #ifdef DEBUG
 void nizk_dl_eq_print_allocation_status(void);
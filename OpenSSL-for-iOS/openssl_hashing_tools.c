@@ -4,8 +4,12 @@
 //
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include "openssl_hashing_tools.h"
+#include "sha256_mb.h"
+#include "vrf_metrics.h"
 
 void openssl_hash_init(SHA256_CTX *ctx) {
     SHA256_Init(ctx);
@@ -30,25 +34,169 @@ void openssl_hash_update_bignum(SHA256_CTX *sha_ctx, const BIGNUM *bn) {
     SHA256_Update(sha_ctx, buf, len); // excluding sentinel
 }
 
-void openssl_hash_update_point(SHA256_CTX *sha_ctx, const EC_GROUP *group, const EC_POINT *point, BN_CTX *bn_ctx) {
-    size_t len = EC_POINT_point2oct(group, point, POINT_CONVERSION_COMPRESSED, NULL, 0, NULL);
-    assert(len > 0 && "openssl_hash_update_point: unexpected length");
-    size_t buf_size = len + 1;
-    unsigned char buf[buf_size];
-    const unsigned char sentinel = 0xac;
-    buf[len] = sentinel;
-    EC_POINT_point2oct(group, point, POINT_CONVERSION_COMPRESSED, buf, len, bn_ctx);
-    if (buf[len] != sentinel) {
-        assert(0 && "ec_points_hash: sentinel overwritten");
+// non-affine points are encoded one by one below this count (an inversion each), from this count on they are
+// brought to affine coordinates together (one inversion and a few multiplications per point)
+#define HASH_AFFINE_BATCH_MIN 4
+
+// Jacobian coordinates of a point that is not affine
+typedef struct {
+    int index;
+    BIGNUM *X, *Y, *Z;
+} jacobian_point;
+
+// compressed encoding of x and the parity of y
+static void encode_affine(unsigned char *p, const BIGNUM *x, const BIGNUM *y, size_t field_len) {
+    p[0] = 0x02 | BN_is_odd(y);
+    int ret = BN_bn2binpad(x, p + 1, (int)field_len);
+    assert(ret == (int)field_len && "encode_points: BN_bn2binpad failed");
+}
+
+// encode the Jacobian points with x = X/Z^2, y = Y/Z^3 and all 1/Z from one inversion (Montgomery's trick) in the
+// Montgomery domain mod p (mont(a, b) = a*b/R): prefix[k] = Z_0 * ... * Z_k / R^k, inv = 1/prefix[n-1] is
+// R^(n-1) / (Z_0 * ... * Z_(n-1)), walking down mont(inv, prefix[k-1]) = 1/Z_k and mont(inv, Z_k) is the inverse of
+// the next prefix
+static void encode_jacobian_batch(int num, jacobian_point *points, const BIGNUM *prime, BN_MONT_CTX *mont, unsigned char *buf, size_t *len, size_t field_len, BN_CTX *bn_ctx) {
+    BN_CTX_start(bn_ctx);
+    BIGNUM **prefix = malloc(num * sizeof(BIGNUM*));
+    assert(prefix && "encode_points: allocation error");
+    for (int k=0; k<num; k++) {
+        prefix[k] = BN_CTX_get(bn_ctx);
     }
-    SHA256_Update(sha_ctx, buf, len); // excluding sentinel
+    BIGNUM *inv = BN_CTX_get(bn_ctx);
+    BIGNUM *zi = BN_CTX_get(bn_ctx);
+    BIGNUM *zi2 = BN_CTX_get(bn_ctx);
+    BIGNUM *zi3 = BN_CTX_get(bn_ctx);
+    assert(zi3 && "encode_points: BN_CTX_get failed");
+    int ret = BN_copy(prefix[0], points[0].Z) != NULL;
+    for (int k=1; k<num; k++) {
+        ret &= BN_mod_mul_montgomery(prefix[k], prefix[k-1], points[k].Z, mont, bn_ctx);
+    }
+    ret &= BN_mod_inverse(inv, prefix[num-1], prime, bn_ctx) != NULL;
+    for (int k=num-1; k>=0; k--) {
+        if (k > 0) {
+            ret &= BN_mod_mul_montgomery(zi, inv, prefix[k-1], mont, bn_ctx);
+            ret &= BN_mod_mul_montgomery(inv, inv, points[k].Z, mont, bn_ctx);
+        } else {
+            ret &= BN_copy(zi, inv) != NULL;
+        }
+        // zi*R, zi^2*R and zi^3*R, the products with X and Y are then out of the Montgomery domain
+        ret &= BN_to_montgomery(zi, zi, mont, bn_ctx);
+        ret &= BN_mod_mul_montgomery(zi2, zi, zi, mont, bn_ctx);
+        ret &= BN_mod_mul_montgomery(zi3, zi2, zi, mont, bn_ctx);
+        ret &= BN_mod_mul_montgomery(points[k].X, points[k].X, zi2, mont, bn_ctx);
+        ret &= BN_mod_mul_montgomery(points[k].Y, points[k].Y, zi3, mont, bn_ctx);
+        int i = points[k].index;
+        encode_affine(buf + i * P256_POINT_BYTES, points[k].X, points[k].Y, field_len);
+        len[i] = field_len + 1;
+    }
+    assert(ret == 1 && "encode_points: field arithmetic failed");
+    free(prefix);
+    BN_CTX_end(bn_ctx);
+}
+
+// write the compressed encoding of num points to buf, point i at buf + i * P256_POINT_BYTES with its length in
+// len[i] (1 for the point at infinity, shorter on the toy curve); points already in affine coordinates are
+// encoded from their coordinates directly, without the inversion EC_POINT_point2oct may still do for them
+static void encode_points(const EC_GROUP *group, int num, const EC_POINT **points, unsigned char *buf, size_t *len, BN_CTX *bn_ctx) {
+    size_t field_len = (EC_GROUP_get_degree(group) + 7) / 8;
+    assert(field_len + 1 <= P256_POINT_BYTES && "encode_points: field too large");
+    VRF_METRICS_COUNT(VRF_METRICS_POINT_ENCODE, num);
+    BN_CTX_start(bn_ctx);
+    int num_jacobian = 0;
+    jacobian_point *jacobian = malloc(num * sizeof(jacobian_point) + 1);
+    assert(jacobian && "encode_points: allocation error");
+    for (int i=0; i<num; i++) {
+        unsigned char *p = buf + i * P256_POINT_BYTES;
+        if (EC_POINT_is_at_infinity(group, points[i])) {
+            p[0] = 0;
+            len[i] = 1;
+            continue;
+        }
+        jacobian_point *j = &jacobian[num_jacobian];
+        j->index = i;
+        j->X = BN_CTX_get(bn_ctx);
+        j->Y = BN_CTX_get(bn_ctx);
+        j->Z = BN_CTX_get(bn_ctx);
+        assert(j->Z && "encode_points: BN_CTX_get failed");
+        int ret = EC_POINT_get_Jprojective_coordinates_GFp(group, points[i], j->X, j->Y, j->Z, bn_ctx);
+        assert(ret == 1 && "encode_points: EC_POINT_get_Jprojective_coordinates_GFp failed");
+        if (!BN_is_one(j->Z)) {
+            num_jacobian++; // keep the coordinates
+            continue;
+        }
+        encode_affine(p, j->X, j->Y, field_len);
+        len[i] = field_len + 1;
+    }
+
+    BN_MONT_CTX *mont = get0_field_mont(group);
+    if (num_jacobian >= HASH_AFFINE_BATCH_MIN && mont) {
+        encode_jacobian_batch(num_jacobian, jacobian, get0_field_prime(group), mont, buf, len, field_len, bn_ctx);
+    } else {
+        for (int j=0; j<num_jacobian; j++) {
+            int i = jacobian[j].index;
+            len[i] = EC_POINT_point2oct(group, points[i], POINT_CONVERSION_COMPRESSED, buf + i * P256_POINT_BYTES, P256_POINT_BYTES, bn_ctx);
+            assert(len[i] > 0 && "encode_points: EC_POINT_point2oct failed");
+        }
+    }
+    free(jacobian);
+    BN_CTX_end(bn_ctx);
+}
+
+void points_encode(const EC_GROUP *group, int num, const EC_POINT **points, unsigned char *buf, size_t *len, BN_CTX *bn_ctx) {
+    encode_points(group, num, points, buf, len, bn_ctx);
+}
+
+int points_to_bytes(const EC_GROUP *group, int num, const EC_POINT **points, unsigned char *buf, BN_CTX *bn_ctx) {
+    size_t len[num];
+    encode_points(group, num, points, buf, len, bn_ctx);
+    for (int i=0; i<num; i++) {
+        if (len[i] != P256_POINT_BYTES) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// the encodings of encode_points one after the other, returns the total length
+static size_t pack_encoded_points(int num, unsigned char *buf, const size_t *len) {
+    size_t off = 0;
+    for (int i=0; i<num; i++) {
+        memmove(buf + off, buf + i * P256_POINT_BYTES, len[i]);
+        off += len[i];
+    }
+    return off;
+}
+
+void openssl_hash_update_point(SHA256_CTX *sha_ctx, const EC_GROUP *group, const EC_POINT *point, BN_CTX *bn_ctx) {
+    unsigned char buf[P256_POINT_BYTES];
+    size_t len;
+    encode_points(group, 1, &point, buf, &len, bn_ctx);
+    SHA256_Update(sha_ctx, buf, len);
+}
+
+// md = hash of the points one after the other, all of them encoded together
+static void hash_points(unsigned char *md, const EC_GROUP *group, BN_CTX *bn_ctx, int num_points, const EC_POINT **points) {
+    unsigned char *buf = malloc(num_points * P256_POINT_BYTES + 1);
+    size_t *len = malloc(num_points * sizeof(size_t) + 1);
+    assert(buf && len && "hash_points: allocation error");
+    encode_points(group, num_points, points, buf, len, bn_ctx);
+    size_t total = pack_encoded_points(num_points, buf, len);
+    SHA256_CTX sha_ctx;
+    openssl_hash_init(&sha_ctx);
+    openssl_hash_update(&sha_ctx, buf, total);
+    openssl_hash_final(md, &sha_ctx);
+    free(len);
+    free(buf);
 }
 
 void openssl_hash_final(unsigned char *md, SHA256_CTX *ctx) {
+    // compressions of the whole message including padding (Nl/Nh: message length in bits)
+    VRF_METRICS_COUNT(VRF_METRICS_SHA256_BLOCKS, ((((uint64_t)ctx->Nh << 32) | ctx->Nl) / 8 + 9 + SHA256_CBLOCK - 1) / SHA256_CBLOCK);
     SHA256_Final(md, ctx);
 }
 
 void openssl_hash(const unsigned char *buf, size_t buf_len, unsigned char *md) {
+    VRF_METRICS_COUNT(VRF_METRICS_SHA256_BLOCKS, (buf_len + 9 + SHA256_CBLOCK - 1) / SHA256_CBLOCK);
     SHA256(buf, buf_len, md);
 }
 
@@ -89,6 +237,16 @@ BIGNUM *openssl_hash_bn_list2bn(int num_bns, const BIGNUM *bn_list[]) {
     return bn;
 }
 
+void openssl_hash_bn2bn_r(BIGNUM *r, const BIGNUM *bn) {
+    SHA256_CTX sha_ctx;
+    openssl_hash_init(&sha_ctx);
+    openssl_hash_update_bignum(&sha_ctx, bn);
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    openssl_hash_final(hash, &sha_ctx);
+    BIGNUM *ret = BN_bin2bn(hash, SHA256_DIGEST_LENGTH, r);
+    assert(ret && "openssl_hash_bn2bn_r: BN_bin2bn failed");
+}
+
 BIGNUM *openssl_hash_point2bn(const EC_GROUP *group, BN_CTX *bn_ctx, const EC_POINT *point) {
     return openssl_hash_points2bn(group, bn_ctx, 1, point);
 }
@@ -96,51 +254,90 @@ BIGNUM *openssl_hash_point2bn(const EC_GROUP *group, BN_CTX *bn_ctx, const EC_PO
 BIGNUM *openssl_hash_points2bn(const EC_GROUP *group, BN_CTX *bn_ctx, int num_points,...) {
     va_list vl;
     va_start(vl, num_points);
-
-    SHA256_CTX sha_ctx;
-    openssl_hash_init(&sha_ctx);
+    const EC_POINT **points = malloc(num_points * sizeof(EC_POINT*) + 1);
+    assert(points && "openssl_hash_points2bn: allocation error");
     for (int i=0; i<num_points; i++) {
-        const EC_POINT *point = va_arg(vl, const EC_POINT*);
-        openssl_hash_update_point(&sha_ctx, group, point, bn_ctx);
+        points[i] = va_arg(vl, const EC_POINT*);
     }
     va_end(vl);
-    unsigned char hash[SHA256_DIGEST_LENGTH];
-    openssl_hash_final(hash, &sha_ctx);
-    BIGNUM *bn = openssl_hash2bignum(hash);
+    BIGNUM *bn = openssl_hash_point_list2bn(group, bn_ctx, num_points, points);
+    free(points);
     return bn;
 }
 
 BIGNUM *openssl_hash_point_list2bn(const EC_GROUP *group, BN_CTX *bn_ctx, int list_len, const EC_POINT *point_list[]) {
-    return openssl_hash_point_lists2bn(group, bn_ctx, 1, &list_len, &point_list);
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    hash_points(hash, group, bn_ctx, list_len, point_list);
+    return openssl_hash2bignum(hash);
 }
 
 BIGNUM *openssl_hash_point_lists2bn(const EC_GROUP *group, BN_CTX *bn_ctx, int num_lists, int *list_len, const EC_POINT **point_list[]) {
-    SHA256_CTX sha_ctx;
-    openssl_hash_init(&sha_ctx);
+    // the lists hash as their concatenation
+    int num_points = 0;
+    for (int i=0; i<num_lists; i++) {
+        num_points += list_len[i];
+    }
+    const EC_POINT **points = malloc(num_points * sizeof(EC_POINT*) + 1);
+    assert(points && "openssl_hash_point_lists2bn: allocation error");
+    num_points = 0;
     for (int i=0; i<num_lists; i++) {
-        const EC_POINT **pl = point_list[i];
         for (int j=0; j<list_len[i]; j++) {
-            const EC_POINT *point = pl[j];
-            openssl_hash_update_point(&sha_ctx, group, point, bn_ctx);
+            points[num_points++] = point_list[i][j];
         }
     }
     unsigned char hash[SHA256_DIGEST_LENGTH];
-    openssl_hash_final(hash, &sha_ctx);
-    BIGNUM *bn = openssl_hash2bignum(hash);
-    return bn;
+    hash_points(hash, group, bn_ctx, num_points, points);
+    free(points);
+    return openssl_hash2bignum(hash);
 }
 
-void openssl_hash_points2poly(const EC_GROUP *group, BN_CTX *ctx, int num_coeffs, BIGNUM *poly_coeff[], int num_point_lists, int *num_points, const EC_POINT ***point_list) {
-    const BIGNUM *order = get0_order(group);
+void openssl_hash_point_list2bn_r(BIGNUM *r, const EC_GROUP *group, BN_CTX *bn_ctx, int list_len, const EC_POINT *point_list[]) {
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    hash_points(hash, group, bn_ctx, list_len, point_list);
+    BIGNUM *ret = BN_bin2bn(hash, SHA256_DIGEST_LENGTH, r);
+    assert(ret && "openssl_hash_point_list2bn_r: BN_bin2bn failed");
+}
 
-    assert(num_point_lists > 0 && "openssl_hash_points2poly: usage error, no point lists passed");
-    BIGNUM *list_digest[num_point_lists];
-    for (int i=0; i<num_point_lists; i++) {
-        list_digest[i] = openssl_hash_point_list2bn(group, ctx, num_points[i], point_list[i]);
+void openssl_hash_point_columns2bn_r(BIGNUM **r, const EC_GROUP *group, BN_CTX *bn_ctx, int num_msgs, int list_len, const EC_POINT **points[]) {
+    // encode a chunk of lists together, then hash the chunk
+    enum { chunk = 4 * SHA256_MB_MAX_LANES };
+    size_t max_len = list_len * P256_POINT_BYTES;
+    unsigned char *buf = malloc(chunk * max_len + 1);
+    size_t *point_len = malloc(chunk * list_len * sizeof(size_t) + 1);
+    const EC_POINT **chunk_points = malloc(chunk * list_len * sizeof(EC_POINT*) + 1);
+    unsigned char md[chunk * SHA256_DIGEST_LENGTH];
+    const unsigned char *msg[chunk];
+    size_t len[chunk];
+    assert(buf && point_len && chunk_points && "openssl_hash_point_columns2bn_r: allocation error");
+    for (int first=0; first<num_msgs; first+=chunk) {
+        int n = num_msgs - first < chunk ? num_msgs - first : chunk;
+        for (int i=0; i<n; i++) {
+            for (int k=0; k<list_len; k++) {
+                chunk_points[i * list_len + k] = points[k][first + i];
+            }
+        }
+        encode_points(group, n * list_len, chunk_points, buf, point_len, bn_ctx);
+        for (int i=0; i<n; i++) {
+            msg[i] = buf + i * max_len;
+            len[i] = pack_encoded_points(list_len, buf + i * max_len, point_len + i * list_len);
+        }
+        sha256_mb(n, msg, len, md);
+        for (int i=0; i<n; i++) {
+            BIGNUM *ret = BN_bin2bn(md + SHA256_DIGEST_LENGTH * i, SHA256_DIGEST_LENGTH, r[first + i]);
+            assert(ret && "openssl_hash_point_columns2bn_r: BN_bin2bn failed");
+        }
     }
+    free(chunk_points);
+    free(point_len);
+    free(buf);
+}
+
+// coefficients of openssl_hash_points2poly from the digests of the lists (freed here)
+static void hash_digests2poly(const EC_GROUP *group, BN_CTX *ctx, int num_coeffs, BIGNUM *poly_coeff[], int num_lists, BIGNUM **list_digest) {
+    const BIGNUM *order = get0_order(group);
 
     // hash chain coefficients
-    poly_coeff[0] = openssl_hash_bn_list2bn(num_point_lists, (const BIGNUM**)list_digest);
+    poly_coeff[0] = openssl_hash_bn_list2bn(num_lists, (const BIGNUM**)list_digest);
     for (int i=1; i<num_coeffs; i++) {
         poly_coeff[i] = openssl_hash_bn2bn(poly_coeff[i-1]);
     }
@@ -151,7 +348,200 @@ void openssl_hash_points2poly(const EC_GROUP *group, BN_CTX *ctx, int num_coeffs
     }
 
     // cleanup
-    for (int i=0; i<num_point_lists; i++) {
+    for (int i=0; i<num_lists; i++) {
         bn_free(list_digest[i]);
     }
 }
+
+void openssl_hash_points2poly(const EC_GROUP *group, BN_CTX *ctx, int num_coeffs, BIGNUM *poly_coeff[], int num_point_lists, int *num_points, const EC_POINT ***point_list) {
+
+    assert(num_point_lists > 0 && "openssl_hash_points2poly: usage error, no point lists passed");
+    // all lists encoded together, then one digest per list
+    int total_points = 0;
+    for (int i=0; i<num_point_lists; i++) {
+        total_points += num_points[i];
+    }
+    const EC_POINT **points = malloc(total_points * sizeof(EC_POINT*) + 1);
+    unsigned char *buf = malloc(total_points * P256_POINT_BYTES + 1);
+    size_t *len = malloc(total_points * sizeof(size_t) + 1);
+    assert(points && buf && len && "openssl_hash_points2poly: allocation error");
+    for (int i=0, k=0; i<num_point_lists; i++) {
+        for (int j=0; j<num_points[i]; j++) {
+            points[k++] = point_list[i][j];
+        }
+    }
+    encode_points(group, total_points, points, buf, len, ctx);
+    BIGNUM *list_digest[num_point_lists];
+    for (int i=0, k=0; i<num_point_lists; i++) {
+        unsigned char *list_buf = buf + k * P256_POINT_BYTES;
+        size_t list_bytes = pack_encoded_points(num_points[i], list_buf, len + k);
+        SHA256_CTX sha_ctx;
+        unsigned char hash[SHA256_DIGEST_LENGTH];
+        openssl_hash_init(&sha_ctx);
+        openssl_hash_update(&sha_ctx, list_buf, list_bytes);
+        openssl_hash_final(hash, &sha_ctx);
+        list_digest[i] = openssl_hash2bignum(hash);
+        k += num_points[i];
+    }
+    free(len);
+    free(buf);
+    free(points);
+    hash_digests2poly(group, ctx, num_coeffs, poly_coeff, num_point_lists, list_digest);
+}
+
+// compressed encodings of the points of v (1 byte for the point at infinity) one after the other, returns the total
+// length (at most v->num * P256_POINT_BYTES)
+static size_t encode_point_vec(const point_vec *v, unsigned char *buf) {
+    size_t off = 0;
+    for (int i=0; i<v->num; i++) {
+        if (v->infinity[i]) {
+            buf[off++] = 0;
+            continue;
+        }
+        buf[off] = 0x02 | (v->y[(size_t)i * P256_FIELD_BYTES + P256_FIELD_BYTES - 1] & 1);
+        memcpy(buf + off + 1, v->x + (size_t)i * P256_FIELD_BYTES, P256_FIELD_BYTES);
+        off += P256_POINT_BYTES;
+    }
+    return off;
+}
+
+// SHA-256 of the encodings of the points of v
+static void hash_point_vec(unsigned char *md, const point_vec *v) {
+    VRF_METRICS_COUNT(VRF_METRICS_POINT_ENCODE, v->num);
+    unsigned char *buf = malloc((size_t)v->num * P256_POINT_BYTES + 1);
+    assert(buf && "hash_point_vec: allocation error");
+    size_t total = encode_point_vec(v, buf);
+    openssl_hash(buf, total, md);
+    free(buf);
+}
+
+void openssl_hash_point_vec2bn_r(BIGNUM *r, const point_vec *points) {
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    hash_point_vec(hash, points);
+    BIGNUM *ret = BN_bin2bn(hash, SHA256_DIGEST_LENGTH, r);
+    assert(ret && "openssl_hash_point_vec2bn_r: BN_bin2bn failed");
+}
+
+void openssl_hash_point_vecs2poly(const EC_GROUP *group, BN_CTX *ctx, int num_coeffs, BIGNUM *poly_coeff[], int num_vecs, const point_vec **vecs) {
+    assert(num_vecs > 0 && "openssl_hash_point_vecs2poly: usage error, no point vectors passed");
+    BIGNUM *vec_digest[num_vecs];
+    for (int i=0; i<num_vecs; i++) {
+        unsigned char hash[SHA256_DIGEST_LENGTH];
+        hash_point_vec(hash, vecs[i]);
+        vec_digest[i] = openssl_hash2bignum(hash);
+    }
+    hash_digests2poly(group, ctx, num_coeffs, poly_coeff, num_vecs, vec_digest);
+}
+
+/*
+ *
+ *  openssl_hashing_tools tests
+ *
+ */
+static int openssl_hashing_tools_test_1(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    int max_len = 2 * HASH_AFFINE_BATCH_MIN + 1;
+    const EC_POINT **points = malloc(max_len * sizeof(EC_POINT*));
+    EC_POINT **p = malloc(max_len * sizeof(EC_POINT*));
+    assert(points && p && "openssl_hashing_tools_test_1: allocation error");
+    // affine (generator), Jacobian (sums) and the point at infinity
+    for (int i=0; i<max_len; i++) {
+        p[i] = point_random(group, ctx);
+        if (i % 3 != 0) {
+            point_add(group, p[i], p[i], p[i-1], ctx);
+        }
+        points[i] = p[i];
+    }
+    EC_POINT_set_to_infinity(group, p[max_len-1]);
+    points[0] = get0_generator(group);
+
+    // every list length, below and above the batch normalization threshold, against point2oct one by one
+    int ret1 = 0;
+    for (int list_len=1; list_len<=max_len; list_len++) {
+        SHA256_CTX sha_ctx;
+        openssl_hash_init(&sha_ctx);
+        for (int i=0; i<list_len; i++) {
+            unsigned char buf[P256_POINT_BYTES];
+            size_t len = EC_POINT_point2oct(group, points[max_len-list_len+i], POINT_CONVERSION_COMPRESSED, buf, sizeof(buf), ctx);
+            openssl_hash_update(&sha_ctx, buf, len);
+        }
+        unsigned char hash[SHA256_DIGEST_LENGTH];
+        openssl_hash_final(hash, &sha_ctx);
+        BIGNUM *expected = openssl_hash2bignum(hash);
+        BIGNUM *c = openssl_hash_point_list2bn(group, ctx, list_len, points + max_len - list_len);
+        ret1 |= BN_cmp(c, expected) != 0;
+        bn_free(c);
+        bn_free(expected);
+    }
+    if (print) {
+        printf("%6s Test 1 - 1: Batch encoded point lists %s the point2oct encodings\n", ret1 ? "NOT OK" : "OK", ret1 ? "do NOT hash as" : "hash as");
+    }
+
+    // point vectors hash as the lists of their points, also to polynomials
+    point_vec *v = point_vec_new(max_len);
+    point_vec *w = point_vec_new(max_len - 1);
+    point_vec_from_points(group, v, points, ctx);
+    point_vec_from_points(group, w, points + 1, ctx);
+    BIGNUM *expected = openssl_hash_point_list2bn(group, ctx, max_len, points);
+    BIGNUM *c = bn_new();
+    openssl_hash_point_vec2bn_r(c, v);
+    int ret2 = BN_cmp(c, expected) != 0;
+    BIGNUM *coeff[3];
+    BIGNUM *coeff_vec[3];
+    const EC_POINT **lists[] = { points, points + 1 };
+    int list_len[] = { max_len, max_len - 1 };
+    const point_vec *vecs[] = { v, w };
+    openssl_hash_points2poly(group, ctx, 3, coeff, 2, list_len, lists);
+    openssl_hash_point_vecs2poly(group, ctx, 3, coeff_vec, 2, vecs);
+    for (int i=0; i<3; i++) {
+        ret2 |= BN_cmp(coeff[i], coeff_vec[i]) != 0;
+        bn_free(coeff[i]);
+        bn_free(coeff_vec[i]);
+    }
+    if (print) {
+        printf("%6s Test 1 - 2: Point vectors %s the lists of their points\n", ret2 ? "NOT OK" : "OK", ret2 ? "do NOT hash as" : "hash as");
+    }
+
+    // cleanup
+    bn_free(c);
+    bn_free(expected);
+    point_vec_free(w);
+    point_vec_free(v);
+    for (int i=0; i<max_len; i++) {
+        point_free(p[i]);
+    }
+    free(p);
+    free(points);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0);
+}
+
+typedef int (*test_function)(int);
+
+static test_function test_suite[] = {
+    &openssl_hashing_tools_test_1
+};
+
+int openssl_hashing_tools_test_suite(int print) {
+    if (print) {
+        printf("Hashing tools test suite BEGIN ----------------------\n");
+    }
+    int num_tests = sizeof(test_suite)/sizeof(test_function);
+    int ret = 0;
+    for (int i=0; i<num_tests; i++) {
+        if (test_suite[i](print)) {
+            ret = 1;
+        }
+    }
+    if (print) {
+        printf("Hashing tools test suite END ------------------------\n");
+#ifdef DEBUG
+        print_allocation_status();
+#endif
+        fflush(stdout);
+    }
+    return ret;
+}
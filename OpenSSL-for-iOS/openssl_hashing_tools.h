@@ -20,14 +20,35 @@ BIGNUM *openssl_hash2bignum(const unsigned char *md);
 BIGNUM *openssl_hash_bn2bn(const BIGNUM *bn);
 BIGNUM *openssl_hash_bns2bn(int num_bns,...);
 BIGNUM *openssl_hash_bn_list2bn(int num_bns, const BIGNUM *bn_list[]);
+void openssl_hash_bn2bn_r(BIGNUM *r, const BIGNUM *bn); // as openssl_hash_bn2bn, result written to r
 
 // hashing points
 BIGNUM *openssl_hash_point2bn(const EC_GROUP *group, BN_CTX *bn_ctx, const EC_POINT *point);
 BIGNUM *openssl_hash_points2bn(const EC_GROUP *group, BN_CTX *bn_ctx, int num_points,...);
 BIGNUM *openssl_hash_point_list2bn(const EC_GROUP *group, BN_CTX *bn_ctx, int list_len, const EC_POINT *point_list[]);
 BIGNUM *openssl_hash_point_lists2bn(const EC_GROUP *group, BN_CTX *bn_ctx, int num_lists, int *list_len, const EC_POINT **point_list[]);
+void openssl_hash_point_list2bn_r(BIGNUM *r, const EC_GROUP *group, BN_CTX *bn_ctx, int list_len, const EC_POINT *point_list[]); // result written to r
+// r[i] = hash of the list points[0][i], ..., points[list_len-1][i] for i < num_msgs (as openssl_hash_point_list2bn on
+// each list), the lists hashed several at a time (sha256_mb.h)
+void openssl_hash_point_columns2bn_r(BIGNUM **r, const EC_GROUP *group, BN_CTX *bn_ctx, int num_msgs, int list_len, const EC_POINT **points[]);
+
+// compressed encodings of num points as hashed by openssl_hash_update_point, point i at buf + i * P256_POINT_BYTES
+// with its length in len[i] (1 for the point at infinity), the points in Jacobian coordinates converted to affine
+// together with one field inversion
+void points_encode(const EC_GROUP *group, int num, const EC_POINT **points, unsigned char *buf, size_t *len, BN_CTX *bn_ctx);
+
+// compressed encodings of num points as point_to_bytes, point i at buf + i * P256_POINT_BYTES, converted to affine
+// together (see encode_points), returns 0 on success (fails for the point at infinity and off P-256)
+int points_to_bytes(const EC_GROUP *group, int num, const EC_POINT **points, unsigned char *buf, BN_CTX *bn_ctx);
 
 // hash points to polynomial
 void openssl_hash_points2poly(const EC_GROUP *group, BN_CTX *ctx, int num_coeffs, BIGNUM *poly_coeff[], int num_point_lists, int *num_points, const EC_POINT ***point_list);
 
+// as openssl_hash_point_list2bn_r and openssl_hash_points2poly on the points of contiguous vectors, encoded from
+// their affine coordinates without field arithmetic
+void openssl_hash_point_vec2bn_r(BIGNUM *r, const point_vec *points);
+void openssl_hash_point_vecs2poly(const EC_GROUP *group, BN_CTX *ctx, int num_coeffs, BIGNUM *poly_coeff[], int num_vecs, const point_vec **vecs);
+
+int openssl_hashing_tools_test_suite(int print);
+
 #endif
@@ -0,0 +1,854 @@
+//
+//  p256_native.c
+//  OpenSSL-for-iOS
+//
+#include "p256_native.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "config_platform.h"
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#ifdef P256_NATIVE_SUPPORTED
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define P256_NATIVE_X86_64 1
+#endif
+
+typedef unsigned __int128 u128;
+
+// affine point (x, y) in Montgomery form, (0, 0) stands for "nothing to add" in the table lookups
+typedef struct {
+    p256_fe x;
+    p256_fe y;
+} p256_affine;
+
+// p = 2^256 - 2^224 + 2^192 + 2^96 - 1, -p^-1 = 1 modulo 2^64
+static const uint64_t P[4] = { 0xffffffffffffffffULL, 0x00000000ffffffffULL, 0x0000000000000000ULL, 0xffffffff00000001ULL };
+// R = 2^256 modulo p (one in Montgomery form) and R^2 modulo p
+static const p256_fe fe_one = {{ 0x0000000000000001ULL, 0xffffffff00000000ULL, 0xffffffffffffffffULL, 0x00000000fffffffeULL }};
+static const p256_fe fe_r2 = {{ 0x0000000000000003ULL, 0xfffffffbffffffffULL, 0xfffffffffffffffeULL, 0x00000004fffffffdULL }};
+static const p256_fe fe_zero = {{ 0, 0, 0, 0 }};
+
+// scalars are recoded into 52 signed 5-bit windows (Booth), digits in [-16, 16]
+#define P256_NATIVE_WINDOWS 52
+
+// generator table, base_table[i][j] = (j + 1) * 32^i * G, about 53 kB
+static p256_affine base_table[P256_NATIVE_WINDOWS][16];
+static int use_mulx = 0;
+static int mulx_available = 0;
+
+/* field arithmetic */
+
+// add with carry and subtract with borrow, carry and borrow in {0, 1}
+static inline uint64_t addc(uint64_t a, uint64_t b, uint64_t *carry) {
+#if P256_NATIVE_X86_64
+    unsigned long long r;
+    *carry = _addcarry_u64((unsigned char)*carry, a, b, &r);
+    return r;
+#else
+    u128 t = (u128)a + b + *carry;
+    *carry = (uint64_t)(t >> 64);
+    return (uint64_t)t;
+#endif
+}
+
+static inline uint64_t subb(uint64_t a, uint64_t b, uint64_t *borrow) {
+#if P256_NATIVE_X86_64
+    unsigned long long r;
+    *borrow = _subborrow_u64((unsigned char)*borrow, a, b, &r);
+    return r;
+#else
+    u128 t = (u128)a - b - *borrow;
+    *borrow = (uint64_t)(t >> 64) & 1;
+    return (uint64_t)t;
+#endif
+}
+
+// r = t - p if t >= p (t given as 5 limbs, t < 2p)
+static inline void fe_reduce_once(p256_fe *r, uint64_t t0, uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4) {
+    uint64_t borrow = 0;
+    uint64_t s0 = subb(t0, P[0], &borrow);
+    uint64_t s1 = subb(t1, P[1], &borrow);
+    uint64_t s2 = subb(t2, P[2], &borrow);
+    uint64_t s3 = subb(t3, P[3], &borrow);
+    subb(t4, 0, &borrow);
+    uint64_t keep = (uint64_t)0 - borrow; // all ones if t < p
+    r->v[0] = (t0 & keep) | (s0 & ~keep);
+    r->v[1] = (t1 & keep) | (s1 & ~keep);
+    r->v[2] = (t2 & keep) | (s2 & ~keep);
+    r->v[3] = (t3 & keep) | (s3 & ~keep);
+}
+
+// a * b + c + carry, high word returned in carry
+static inline uint64_t mac(uint64_t a, uint64_t b, uint64_t c, uint64_t *carry) {
+    u128 t = (u128)a * b + c + *carry;
+    *carry = (uint64_t)(t >> 64);
+    return (uint64_t)t;
+}
+
+// one Montgomery reduction step, t = (t + m * p) / 2^64 with m = t0 (-p^-1 = 1 modulo 2^64); with
+// t0 - m = 0 that is t / 2^64 + m * 2^32 + m * 2^128 * P[3], a shift and a single multiplication
+#define FE_REDUCE_STEP(mac, t0, t1, t2, t3, t4) do { \
+        uint64_t m_ = t0, c_ = 0, hi_ = 0; \
+        t1 = addc(t1, m_ << 32, &c_); \
+        t2 = addc(t2, m_ >> 32, &c_); \
+        t3 = addc(t3, 0, &c_); \
+        t4 = addc(t4, 0, &c_); \
+        uint64_t t5_ = c_; \
+        uint64_t lo_ = mac(m_, P[3], 0, &hi_); \
+        c_ = 0; \
+        t3 = addc(t3, lo_, &c_); \
+        t4 = addc(t4, hi_, &c_); \
+        t0 = t1; t1 = t2; t2 = t3; t3 = t4; t4 = t5_ + c_; \
+    } while (0)
+
+// Montgomery multiplication, schoolbook product then four reduction steps on the low half (result below 2p
+// before the final subtraction since the high half is below p)
+#define FE_MUL_BODY(mac, r, a, b) do { \
+        uint64_t t_[8], c_ = 0; \
+        t_[0] = mac(a->v[0], b->v[0], 0, &c_); \
+        t_[1] = mac(a->v[0], b->v[1], 0, &c_); \
+        t_[2] = mac(a->v[0], b->v[2], 0, &c_); \
+        t_[3] = mac(a->v[0], b->v[3], 0, &c_); \
+        t_[4] = c_; \
+        for (int i_=1; i_<4; i_++) { \
+            c_ = 0; \
+            t_[i_] = mac(a->v[i_], b->v[0], t_[i_], &c_); \
+            t_[i_+1] = mac(a->v[i_], b->v[1], t_[i_+1], &c_); \
+            t_[i_+2] = mac(a->v[i_], b->v[2], t_[i_+2], &c_); \
+            t_[i_+3] = mac(a->v[i_], b->v[3], t_[i_+3], &c_); \
+            t_[i_+4] = c_; \
+        } \
+        uint64_t r0_ = t_[0], r1_ = t_[1], r2_ = t_[2], r3_ = t_[3], r4_ = 0; \
+        FE_REDUCE_STEP(mac, r0_, r1_, r2_, r3_, r4_); \
+        FE_REDUCE_STEP(mac, r0_, r1_, r2_, r3_, r4_); \
+        FE_REDUCE_STEP(mac, r0_, r1_, r2_, r3_, r4_); \
+        FE_REDUCE_STEP(mac, r0_, r1_, r2_, r3_, r4_); \
+        c_ = 0; \
+        r0_ = addc(r0_, t_[4], &c_); \
+        r1_ = addc(r1_, t_[5], &c_); \
+        r2_ = addc(r2_, t_[6], &c_); \
+        r3_ = addc(r3_, t_[7], &c_); \
+        fe_reduce_once(r, r0_, r1_, r2_, r3_, r4_ + c_); \
+    } while (0)
+
+static void fe_mul_generic(p256_fe *r, const p256_fe *a, const p256_fe *b) {
+    FE_MUL_BODY(mac, r, a, b);
+}
+
+#if P256_NATIVE_X86_64
+__attribute__((target("bmi2,adx")))
+static inline uint64_t mac_mulx(uint64_t a, uint64_t b, uint64_t c, uint64_t *carry) {
+    unsigned long long hi;
+    unsigned long long lo = _mulx_u64(a, b, &hi);
+    uint64_t k = 0;
+    lo = addc(lo, c, &k);
+    hi += k;
+    k = 0;
+    lo = addc(lo, *carry, &k);
+    *carry = hi + k;
+    return lo;
+}
+
+// the same with mulx (the compiler schedules the adcx/adox carry chains)
+__attribute__((target("bmi2,adx")))
+static void fe_mul_mulx(p256_fe *r, const p256_fe *a, const p256_fe *b) {
+    FE_MUL_BODY(mac_mulx, r, a, b);
+}
+#endif
+
+static inline void fe_mul(p256_fe *r, const p256_fe *a, const p256_fe *b) {
+#if P256_NATIVE_X86_64
+    if (use_mulx) {
+        fe_mul_mulx(r, a, b);
+        return;
+    }
+#endif
+    fe_mul_generic(r, a, b);
+}
+
+static inline void fe_sqr(p256_fe *r, const p256_fe *a) {
+    fe_mul(r, a, a);
+}
+
+static void fe_add(p256_fe *r, const p256_fe *a, const p256_fe *b) {
+    uint64_t carry = 0;
+    uint64_t t0 = addc(a->v[0], b->v[0], &carry);
+    uint64_t t1 = addc(a->v[1], b->v[1], &carry);
+    uint64_t t2 = addc(a->v[2], b->v[2], &carry);
+    uint64_t t3 = addc(a->v[3], b->v[3], &carry);
+    fe_reduce_once(r, t0, t1, t2, t3, carry);
+}
+
+static void fe_sub(p256_fe *r, const p256_fe *a, const p256_fe *b) {
+    uint64_t borrow = 0;
+    uint64_t t0 = subb(a->v[0], b->v[0], &borrow);
+    uint64_t t1 = subb(a->v[1], b->v[1], &borrow);
+    uint64_t t2 = subb(a->v[2], b->v[2], &borrow);
+    uint64_t t3 = subb(a->v[3], b->v[3], &borrow);
+    uint64_t mask = (uint64_t)0 - borrow; // add p back on borrow
+    uint64_t carry = 0;
+    r->v[0] = addc(t0, P[0] & mask, &carry);
+    r->v[1] = addc(t1, P[1] & mask, &carry);
+    r->v[2] = addc(t2, P[2] & mask, &carry);
+    r->v[3] = addc(t3, P[3] & mask, &carry);
+}
+
+// all ones if a is zero, zero otherwise
+static uint64_t fe_is_zero(const p256_fe *a) {
+    uint64_t x = a->v[0] | a->v[1] | a->v[2] | a->v[3];
+    return ((x | ((uint64_t)0 - x)) >> 63) - 1;
+}
+
+static void fe_cmov(p256_fe *r, const p256_fe *a, uint64_t mask) {
+    for (int i=0; i<4; i++) {
+        r->v[i] = (r->v[i] & ~mask) | (a->v[i] & mask);
+    }
+}
+
+// r = a^(2^n) * b
+static void fe_sqr_n_mul(p256_fe *r, const p256_fe *a, int n, const p256_fe *b) {
+    p256_fe t = *a;
+    for (int i=0; i<n; i++) {
+        fe_sqr(&t, &t);
+    }
+    fe_mul(r, &t, b);
+}
+
+// r = a^(p - 2) = a^-1, p - 2 = 2^256 - 2^224 + 2^192 + 2^96 - 3 (x_n stands for a^(2^n - 1))
+static void fe_inv(p256_fe *r, const p256_fe *a) {
+    p256_fe x2, x3, x6, x12, x15, x30, x32, x64, x94, t;
+    fe_sqr_n_mul(&x2, a, 1, a);
+    fe_sqr_n_mul(&x3, &x2, 1, a);
+    fe_sqr_n_mul(&x6, &x3, 3, &x3);
+    fe_sqr_n_mul(&x12, &x6, 6, &x6);
+    fe_sqr_n_mul(&x15, &x12, 3, &x3);
+    fe_sqr_n_mul(&x30, &x15, 15, &x15);
+    fe_sqr_n_mul(&x32, &x30, 2, &x2);
+    fe_sqr_n_mul(&t, &x32, 32, a);
+    fe_sqr_n_mul(&x64, &x32, 32, &x32);
+    fe_sqr_n_mul(&x94, &x64, 30, &x30);
+    fe_sqr_n_mul(&t, &t, 190, &x94);
+    fe_sqr_n_mul(r, &t, 2, a);
+}
+
+static void fe_from_bytes_le(p256_fe *r, const unsigned char *buf) {
+    for (int i=0; i<4; i++) {
+        uint64_t w = 0;
+        for (int j=7; j>=0; j--) {
+            w = (w << 8) | buf[8 * i + j];
+        }
+        r->v[i] = w;
+    }
+}
+
+static void fe_to_bytes_le(unsigned char *buf, const p256_fe *a) {
+    for (int i=0; i<4; i++) {
+        for (int j=0; j<8; j++) {
+            buf[8 * i + j] = (unsigned char)(a->v[i] >> (8 * j));
+        }
+    }
+}
+
+// BIGNUM (below p) to Montgomery form
+static int fe_from_bn(p256_fe *r, const BIGNUM *bn) {
+    unsigned char buf[32];
+    if (BN_is_negative(bn) || BN_bn2lebinpad(bn, buf, 32) != 32) {
+        return 1;
+    }
+    p256_fe a;
+    fe_from_bytes_le(&a, buf);
+    fe_mul(r, &a, &fe_r2);
+    return 0;
+}
+
+static int fe_to_bn(BIGNUM *r, const p256_fe *a) {
+    static const p256_fe plain_one = {{ 1, 0, 0, 0 }};
+    p256_fe t;
+    fe_mul(&t, a, &plain_one);
+    unsigned char buf[32];
+    fe_to_bytes_le(buf, &t);
+    return BN_lebin2bn(buf, 32, r) == NULL;
+}
+
+/* point arithmetic, a = -3 */
+
+static void point_set_infinity(p256_point *r) {
+    r->X = fe_zero;
+    r->Y = fe_zero;
+    r->Z = fe_zero;
+}
+
+static void point_cmov(p256_point *r, const p256_point *a, uint64_t mask) {
+    fe_cmov(&r->X, &a->X, mask);
+    fe_cmov(&r->Y, &a->Y, mask);
+    fe_cmov(&r->Z, &a->Z, mask);
+}
+
+// dbl-2001-b, the point at infinity stays at Z = 0
+void p256_native_point_dbl(p256_point *r, const p256_point *a) {
+    p256_fe delta, gamma, beta, alpha, t1, t2;
+    fe_sqr(&delta, &a->Z);
+    fe_sqr(&gamma, &a->Y);
+    fe_mul(&beta, &a->X, &gamma);
+    fe_sub(&t1, &a->X, &delta);
+    fe_add(&t2, &a->X, &delta);
+    fe_mul(&alpha, &t1, &t2);
+    fe_add(&t1, &alpha, &alpha);
+    fe_add(&alpha, &alpha, &t1);                // alpha = 3 * (X1 - delta) * (X1 + delta)
+    fe_add(&t1, &a->Y, &a->Z);
+    fe_sqr(&t1, &t1);
+    fe_sub(&t1, &t1, &gamma);
+    fe_sub(&r->Z, &t1, &delta);                 // Z3 = (Y1 + Z1)^2 - gamma - delta
+    fe_add(&beta, &beta, &beta);
+    fe_add(&beta, &beta, &beta);                // 4 * beta
+    fe_sqr(&t1, &alpha);
+    fe_add(&t2, &beta, &beta);
+    fe_sub(&r->X, &t1, &t2);                    // X3 = alpha^2 - 8 * beta
+    fe_sub(&t1, &beta, &r->X);
+    fe_mul(&t1, &alpha, &t1);
+    fe_sqr(&gamma, &gamma);
+    fe_add(&gamma, &gamma, &gamma);
+    fe_add(&gamma, &gamma, &gamma);
+    fe_add(&gamma, &gamma, &gamma);
+    fe_sub(&r->Y, &t1, &gamma);                 // Y3 = alpha * (4 * beta - X3) - 8 * gamma^2
+}
+
+// add-2007-bl, infinity inputs are handled without branching, a = b and a = -b by a branch
+void p256_native_point_add(p256_point *r, const p256_point *a, const p256_point *b) {
+    p256_fe z1z1, z2z2, u1, u2, s1, s2, h, i, j, rr, v, t;
+    p256_point res;
+    fe_sqr(&z1z1, &a->Z);
+    fe_sqr(&z2z2, &b->Z);
+    fe_mul(&u1, &a->X, &z2z2);
+    fe_mul(&u2, &b->X, &z1z1);
+    fe_mul(&s1, &a->Y, &b->Z);
+    fe_mul(&s1, &s1, &z2z2);
+    fe_mul(&s2, &b->Y, &a->Z);
+    fe_mul(&s2, &s2, &z1z1);
+    fe_sub(&h, &u2, &u1);
+    fe_sub(&rr, &s2, &s1);
+    uint64_t a_inf = fe_is_zero(&a->Z);
+    uint64_t b_inf = fe_is_zero(&b->Z);
+    if (fe_is_zero(&h) & ~a_inf & ~b_inf) { // exceptional, a = b or a = -b
+        if (fe_is_zero(&rr)) {
+            p256_native_point_dbl(r, a);
+        } else {
+            point_set_infinity(r);
+        }
+        return;
+    }
+    fe_add(&rr, &rr, &rr);
+    fe_add(&i, &h, &h);
+    fe_sqr(&i, &i);                             // I = (2 * H)^2
+    fe_mul(&j, &h, &i);                         // J = H * I
+    fe_mul(&v, &u1, &i);                        // V = U1 * I
+    fe_sqr(&res.X, &rr);
+    fe_sub(&res.X, &res.X, &j);
+    fe_sub(&res.X, &res.X, &v);
+    fe_sub(&res.X, &res.X, &v);                 // X3 = r^2 - J - 2 * V
+    fe_sub(&t, &v, &res.X);
+    fe_mul(&t, &rr, &t);
+    fe_mul(&s1, &s1, &j);
+    fe_add(&s1, &s1, &s1);
+    fe_sub(&res.Y, &t, &s1);                    // Y3 = r * (V - X3) - 2 * S1 * J
+    fe_add(&t, &a->Z, &b->Z);
+    fe_sqr(&t, &t);
+    fe_sub(&t, &t, &z1z1);
+    fe_sub(&t, &t, &z2z2);
+    fe_mul(&res.Z, &t, &h);                     // Z3 = ((Z1 + Z2)^2 - Z1Z1 - Z2Z2) * H
+    point_cmov(&res, b, a_inf);
+    point_cmov(&res, a, b_inf);
+    *r = res;
+}
+
+// madd-2007-bl, r = a + b with b affine, b_none (all ones) if nothing is to be added
+static void point_add_affine(p256_point *r, const p256_point *a, const p256_affine *b, uint64_t b_none) {
+    p256_fe z1z1, u2, s2, h, hh, i, j, rr, v, t;
+    p256_point res;
+    fe_sqr(&z1z1, &a->Z);
+    fe_mul(&u2, &b->x, &z1z1);
+    fe_mul(&s2, &b->y, &a->Z);
+    fe_mul(&s2, &s2, &z1z1);
+    fe_sub(&h, &u2, &a->X);
+    fe_sub(&rr, &s2, &a->Y);
+    uint64_t a_inf = fe_is_zero(&a->Z);
+    if (fe_is_zero(&h) & ~a_inf & ~b_none) { // exceptional, a = b or a = -b
+        if (fe_is_zero(&rr)) {
+            p256_native_point_dbl(r, a);
+        } else {
+            point_set_infinity(r);
+        }
+        return;
+    }
+    fe_add(&rr, &rr, &rr);
+    fe_sqr(&hh, &h);
+    fe_add(&i, &hh, &hh);
+    fe_add(&i, &i, &i);                         // I = 4 * HH
+    fe_mul(&j, &h, &i);                         // J = H * I
+    fe_mul(&v, &a->X, &i);                      // V = X1 * I
+    fe_sqr(&res.X, &rr);
+    fe_sub(&res.X, &res.X, &j);
+    fe_sub(&res.X, &res.X, &v);
+    fe_sub(&res.X, &res.X, &v);                 // X3 = r^2 - J - 2 * V
+    fe_sub(&t, &v, &res.X);
+    fe_mul(&t, &rr, &t);
+    fe_mul(&j, &a->Y, &j);
+    fe_add(&j, &j, &j);
+    fe_sub(&res.Y, &t, &j);                     // Y3 = r * (V - X3) - 2 * Y1 * J
+    fe_add(&t, &a->Z, &h);
+    fe_sqr(&t, &t);
+    fe_sub(&t, &t, &z1z1);
+    fe_sub(&res.Z, &t, &hh);                    // Z3 = (Z1 + H)^2 - Z1Z1 - HH
+    p256_point b_jacobian = { b->x, b->y, fe_one };
+    point_cmov(&res, &b_jacobian, a_inf);
+    point_cmov(&res, a, b_none);
+    *r = res;
+}
+
+void p256_native_point_neg(p256_point *r, const p256_point *a) {
+    r->X = a->X;
+    fe_sub(&r->Y, &fe_zero, &a->Y);
+    r->Z = a->Z;
+}
+
+int p256_native_point_cmp(const p256_point *a, const p256_point *b) {
+    uint64_t a_inf = fe_is_zero(&a->Z);
+    uint64_t b_inf = fe_is_zero(&b->Z);
+    if (a_inf | b_inf) {
+        return !(a_inf & b_inf);
+    }
+    // X1 * Z2^2 = X2 * Z1^2 and Y1 * Z2^3 = Y2 * Z1^3
+    p256_fe z1z1, z2z2, t1, t2;
+    fe_sqr(&z1z1, &a->Z);
+    fe_sqr(&z2z2, &b->Z);
+    fe_mul(&t1, &a->X, &z2z2);
+    fe_mul(&t2, &b->X, &z1z1);
+    if (memcmp(&t1, &t2, sizeof(p256_fe)) != 0) {
+        return 1;
+    }
+    fe_mul(&z1z1, &z1z1, &a->Z);
+    fe_mul(&z2z2, &z2z2, &b->Z);
+    fe_mul(&t1, &a->Y, &z2z2);
+    fe_mul(&t2, &b->Y, &z1z1);
+    return memcmp(&t1, &t2, sizeof(p256_fe)) != 0;
+}
+
+/* scalar multiplication */
+
+// 32 bytes big endian to little endian limbs, with a zero limb on top for the window reads
+static void scalar_from_bytes(uint64_t k[5], const unsigned char *scalar) {
+    for (int i=0; i<4; i++) {
+        uint64_t w = 0;
+        for (int j=0; j<8; j++) {
+            w = (w << 8) | scalar[32 - 8 * (i + 1) + j];
+        }
+        k[i] = w;
+    }
+    k[4] = 0;
+}
+
+// the 6 bits k[bit .. bit + 5] (bit -1 reads as zero), the window position is public
+static uint64_t scalar_window(const uint64_t k[5], int bit) {
+    if (bit < 0) {
+        return (k[0] << 1) & 0x3f;
+    }
+    int limb = bit / 64;
+    int shift = bit % 64;
+    uint64_t w = k[limb] >> shift;
+    if (shift > 58) {
+        w |= k[limb + 1] << (64 - shift);
+    }
+    return w & 0x3f;
+}
+
+// signed digit of a 6-bit window (Booth recoding), |digit| <= 16
+static void booth_recode(uint64_t *sign, uint64_t *digit, uint64_t window) {
+    uint64_t s = ~((window >> 5) - 1);
+    uint64_t d = (1 << 6) - window - 1;
+    d = (d & s) | (window & ~s);
+    d = (d >> 1) + (d & 1);
+    *sign = s & 1;
+    *digit = d;
+}
+
+// all ones if a == b
+static uint64_t mask_eq(uint64_t a, uint64_t b) {
+    uint64_t x = a ^ b;
+    return ((x | ((uint64_t)0 - x)) >> 63) - 1;
+}
+
+// r = table[digit - 1] (the point at infinity for digit 0), reading every entry
+static void select_point(p256_point *r, const p256_point table[16], uint64_t digit) {
+    point_set_infinity(r);
+    for (uint64_t j=0; j<16; j++) {
+        point_cmov(r, &table[j], mask_eq(j + 1, digit));
+    }
+}
+
+static void select_affine(p256_affine *r, const p256_affine table[16], uint64_t digit) {
+    r->x = fe_zero;
+    r->y = fe_zero;
+    for (uint64_t j=0; j<16; j++) {
+        uint64_t mask = mask_eq(j + 1, digit);
+        fe_cmov(&r->x, &table[j].x, mask);
+        fe_cmov(&r->y, &table[j].y, mask);
+    }
+}
+
+static void fe_cond_neg(p256_fe *a, uint64_t sign) {
+    p256_fe n;
+    fe_sub(&n, &fe_zero, a);
+    fe_cmov(a, &n, (uint64_t)0 - sign);
+}
+
+void p256_native_point_mul(p256_point *r, const unsigned char *scalar, const p256_point *point) {
+    uint64_t k[5];
+    scalar_from_bytes(k, scalar);
+
+    // table[j] = (j + 1) * point
+    p256_point table[16];
+    table[0] = *point;
+    p256_native_point_dbl(&table[1], point);
+    for (int j=2; j<16; j++) {
+        p256_native_point_add(&table[j], &table[j-1], point);
+    }
+
+    uint64_t sign, digit;
+    p256_point acc, t;
+    booth_recode(&sign, &digit, scalar_window(k, 5 * (P256_NATIVE_WINDOWS - 1) - 1));
+    select_point(&acc, table, digit);
+    fe_cond_neg(&acc.Y, sign);
+    for (int i=P256_NATIVE_WINDOWS-2; i>=0; i--) {
+        for (int j=0; j<5; j++) {
+            p256_native_point_dbl(&acc, &acc);
+        }
+        booth_recode(&sign, &digit, scalar_window(k, 5 * i - 1));
+        select_point(&t, table, digit);
+        fe_cond_neg(&t.Y, sign);
+        p256_native_point_add(&acc, &acc, &t);
+    }
+    *r = acc;
+}
+
+/* initialization, kernel selection and generator table */
+
+static void native_init(void) {
+#if P256_NATIVE_X86_64
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        mulx_available = (ebx & (1u << 8)) && (ebx & (1u << 19)); // BMI2 and ADX
+    }
+    use_mulx = mulx_available;
+#endif
+
+    // G from the group, then 16 multiples per window
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    p256_point base;
+    int ret = ctx && p256_native_from_ec_point(&base, group, get0_generator(group), ctx) == 0;
+    assert(ret && "p256_native_init: reading the generator failed");
+    BN_CTX_free(ctx);
+    static p256_point multiples[P256_NATIVE_WINDOWS * 16];
+    for (int i=0; i<P256_NATIVE_WINDOWS; i++) {
+        p256_point *row = &multiples[16 * i];
+        row[0] = base;
+        p256_native_point_dbl(&row[1], &base);
+        for (int j=2; j<16; j++) {
+            p256_native_point_add(&row[j], &row[j-1], &base);
+        }
+        p256_native_point_dbl(&base, &row[15]); // 32^(i + 1) * G
+    }
+
+    // to affine with a single inversion (Montgomery's trick), none of the multiples is the point at infinity
+    static p256_fe prefix[P256_NATIVE_WINDOWS * 16];
+    int num = P256_NATIVE_WINDOWS * 16;
+    prefix[0] = multiples[0].Z;
+    for (int i=1; i<num; i++) {
+        fe_mul(&prefix[i], &prefix[i-1], &multiples[i].Z);
+    }
+    p256_fe inv, z_inv, z_inv2;
+    fe_inv(&inv, &prefix[num-1]);
+    for (int i=num-1; i>=0; i--) {
+        if (i > 0) {
+            fe_mul(&z_inv, &inv, &prefix[i-1]);
+            fe_mul(&inv, &inv, &multiples[i].Z);
+        } else {
+            z_inv = inv;
+        }
+        p256_affine *e = &base_table[i / 16][i % 16];
+        fe_sqr(&z_inv2, &z_inv);
+        fe_mul(&e->x, &multiples[i].X, &z_inv2);
+        fe_mul(&z_inv2, &z_inv2, &z_inv);
+        fe_mul(&e->y, &multiples[i].Y, &z_inv2);
+    }
+}
+
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+static INIT_ONCE native_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK native_init_once(PINIT_ONCE once, PVOID param, PVOID *context) {
+    native_init();
+    return TRUE;
+}
+
+static void p256_native_init(void) {
+    InitOnceExecuteOnce(&native_once, native_init_once, NULL, NULL);
+}
+#else
+static pthread_once_t native_once = PTHREAD_ONCE_INIT;
+
+static void p256_native_init(void) {
+    int ret = pthread_once(&native_once, native_init);
+    assert(ret == 0 && "p256_native_init: pthread_once failed");
+}
+#endif
+
+void p256_native_base_mul(p256_point *r, const unsigned char *scalar) {
+    p256_native_init();
+    uint64_t k[5];
+    scalar_from_bytes(k, scalar);
+    p256_point acc;
+    point_set_infinity(&acc);
+    p256_affine t;
+    for (int i=0; i<P256_NATIVE_WINDOWS; i++) {
+        uint64_t sign, digit;
+        booth_recode(&sign, &digit, scalar_window(k, 5 * i - 1));
+        select_affine(&t, base_table[i], digit);
+        fe_cond_neg(&t.y, sign);
+        point_add_affine(&acc, &acc, &t, mask_eq(digit, 0));
+    }
+    *r = acc;
+}
+
+const char *p256_native_kernel(void) {
+    p256_native_init();
+    return use_mulx ? "mulx/adx" : "generic";
+}
+
+void p256_native_set_generic(int generic) {
+    p256_native_init();
+    use_mulx = mulx_available && !generic;
+}
+
+int p256_native_from_ec_point(p256_point *r, const EC_GROUP *group, const EC_POINT *point, BN_CTX *ctx) {
+    if (EC_POINT_is_at_infinity(group, point)) {
+        point_set_infinity(r);
+        return 0;
+    }
+    BN_CTX_start(ctx);
+    BIGNUM *X = BN_CTX_get(ctx);
+    BIGNUM *Y = BN_CTX_get(ctx);
+    BIGNUM *Z = BN_CTX_get(ctx);
+    int ret = !Z || EC_POINT_get_Jprojective_coordinates_GFp(group, point, X, Y, Z, ctx) != 1;
+    ret = ret || fe_from_bn(&r->X, X) || fe_from_bn(&r->Y, Y) || fe_from_bn(&r->Z, Z);
+    BN_CTX_end(ctx);
+    return ret;
+}
+
+int p256_native_to_ec_point(const EC_GROUP *group, EC_POINT *r, const p256_point *point, BN_CTX *ctx) {
+    if (fe_is_zero(&point->Z)) {
+        return EC_POINT_set_to_infinity(group, r) != 1;
+    }
+    BN_CTX_start(ctx);
+    BIGNUM *X = BN_CTX_get(ctx);
+    BIGNUM *Y = BN_CTX_get(ctx);
+    BIGNUM *Z = BN_CTX_get(ctx);
+    int ret = !Z || fe_to_bn(X, &point->X) || fe_to_bn(Y, &point->Y) || fe_to_bn(Z, &point->Z);
+    ret = ret || EC_POINT_set_Jprojective_coordinates_GFp(group, r, X, Y, Z, ctx) != 1;
+    BN_CTX_end(ctx);
+    return ret;
+}
+
+#endif /* P256_NATIVE_SUPPORTED */
+
+/*
+ *
+ *  tests, differential against the libcrypto implementation
+ *
+ */
+
+#ifdef P256_NATIVE_SUPPORTED
+// 0 if the native point equals the EC_POINT
+static int native_differs(const EC_GROUP *group, const p256_point *a, const EC_POINT *expected, BN_CTX *ctx) {
+    EC_POINT *t = point_new(group);
+    int ret = p256_native_to_ec_point(group, t, a, ctx) || EC_POINT_cmp(group, t, expected, ctx) != 0;
+    point_free(t);
+    return ret;
+}
+
+static int p256_native_test_1(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    EC_POINT *a = point_random(group, ctx);
+    EC_POINT *b = point_random(group, ctx);
+    EC_POINT *expected = point_new(group);
+    EC_POINT *infinity = point_new(group);
+    EC_POINT_set_to_infinity(group, infinity);
+    p256_point na, nb, ninf, nr;
+    int ret1 = 0;
+    int ret2 = 0;
+
+    // both kernels (the same one twice where mulx/adx is not available)
+    for (int generic=0; generic<2; generic++) {
+        p256_native_set_generic(generic);
+        ret1 |= p256_native_from_ec_point(&na, group, a, ctx) || p256_native_from_ec_point(&nb, group, b, ctx);
+        ret1 |= p256_native_from_ec_point(&ninf, group, infinity, ctx);
+        ret1 |= native_differs(group, &na, a, ctx) || native_differs(group, &ninf, infinity, ctx);
+
+        // a + b, 2a, -a, a - b
+        p256_native_point_add(&nr, &na, &nb);
+        point_add(group, expected, a, b, ctx);
+        ret1 |= native_differs(group, &nr, expected, ctx);
+        p256_native_point_dbl(&nr, &na);
+        point_add(group, expected, a, a, ctx);
+        ret1 |= native_differs(group, &nr, expected, ctx);
+        p256_native_point_neg(&nr, &nb);
+        p256_native_point_add(&nr, &na, &nr);
+        point_sub(group, expected, a, b, ctx);
+        ret1 |= native_differs(group, &nr, expected, ctx);
+
+        // exceptional cases, a + a, a + (-a), a + O, O + a, 2O
+        p256_native_point_dbl(&nr, &na);
+        p256_native_point_add(&nr, &nr, &na); // Jacobian input with Z != 1
+        p256_native_point_add(&nr, &nr, &nr);
+        point_add(group, expected, a, a, ctx);
+        point_add(group, expected, expected, a, ctx);
+        point_add(group, expected, expected, expected, ctx);
+        ret2 |= native_differs(group, &nr, expected, ctx);
+        p256_native_point_neg(&nr, &na);
+        p256_native_point_add(&nr, &na, &nr);
+        ret2 |= native_differs(group, &nr, infinity, ctx);
+        p256_native_point_add(&nr, &na, &ninf);
+        ret2 |= native_differs(group, &nr, a, ctx);
+        p256_native_point_add(&nr, &ninf, &na);
+        ret2 |= native_differs(group, &nr, a, ctx);
+        p256_native_point_dbl(&nr, &ninf);
+        ret2 |= native_differs(group, &nr, infinity, ctx);
+
+        // comparison across representations
+        p256_point nb2;
+        p256_native_point_dbl(&nr, &nb);
+        p256_native_point_neg(&nb2, &nb);
+        p256_native_point_add(&nb2, &nr, &nb2); // b with Z != 1
+        ret2 |= p256_native_point_cmp(&nb2, &nb) != 0 || p256_native_point_cmp(&na, &nb) == 0;
+        ret2 |= p256_native_point_cmp(&ninf, &ninf) != 0 || p256_native_point_cmp(&ninf, &na) == 0;
+    }
+    p256_native_set_generic(0);
+    if (print) {
+        printf("%6s Test 1 - 1: Native addition, doubling and negation %s libcrypto\n", ret1 ? "NOT OK" : "OK", ret1 ? "do NOT match" : "match");
+        printf("%6s Test 1 - 2: Exceptional cases and comparison %s\n", ret2 ? "NOT OK" : "OK", ret2 ? "NOT handled" : "handled");
+    }
+
+    // cleanup
+    point_free(infinity);
+    point_free(expected);
+    point_free(b);
+    point_free(a);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0);
+}
+
+static int p256_native_test_2(int print) {
+    const EC_GROUP *group = get0_group();
+    const BIGNUM *order = get0_order(group);
+    BN_CTX *ctx = BN_CTX_new();
+    EC_POINT *point = point_random(group, ctx);
+    EC_POINT *expected = point_new(group);
+    BIGNUM *k = bn_new();
+    p256_point np, nr;
+    unsigned char buf[32];
+    int ret1 = 0;
+    int ret2 = 0;
+
+    // random scalars, then 0, 1, 2, n - 1, n, n + 1 and 2^256 - 1
+    int num_random = 16;
+    for (int generic=0; generic<2; generic++) {
+        p256_native_set_generic(generic);
+        ret1 |= p256_native_from_ec_point(&np, group, point, ctx);
+        for (int i=0; i<num_random+7; i++) {
+            if (i < num_random) {
+                bn_random_r(k, order, ctx);
+            } else if (i < num_random + 3) {
+                BN_set_word(k, i - num_random);
+            } else if (i < num_random + 6) {
+                BN_copy(k, order);
+                BN_add_word(k, i - num_random - 3);
+                BN_sub_word(k, 1);
+            } else {
+                BN_zero(k);
+                BN_set_bit(k, 256);
+                BN_sub_word(k, 1);
+            }
+            int ret = BN_bn2binpad(k, buf, 32) != 32;
+            int *r = i < num_random ? &ret1 : &ret2;
+            p256_native_point_mul(&nr, buf, &np);
+            EC_POINT_mul(group, expected, NULL, point, k, ctx);
+            *r |= ret || native_differs(group, &nr, expected, ctx);
+            p256_native_base_mul(&nr, buf);
+            EC_POINT_mul(group, expected, k, NULL, NULL, ctx);
+            *r |= native_differs(group, &nr, expected, ctx);
+        }
+    }
+    p256_native_set_generic(0);
+    if (print) {
+        printf("%6s Test 2 - 1: Native scalar multiplications %s libcrypto\n", ret1 ? "NOT OK" : "OK", ret1 ? "do NOT match" : "match");
+        printf("%6s Test 2 - 2: Edge case scalars %s\n", ret2 ? "NOT OK" : "OK", ret2 ? "NOT handled" : "handled");
+    }
+
+    // cleanup
+    bn_free(k);
+    point_free(expected);
+    point_free(point);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0);
+}
+
+typedef int (*test_function)(int);
+
+static test_function test_suite[] = {
+    &p256_native_test_1,
+    &p256_native_test_2
+};
+#endif /* P256_NATIVE_SUPPORTED */
+
+int p256_native_test_suite(int print) {
+    if (print) {
+        printf("P256 native test suite BEGIN ------------------------\n");
+    }
+    int ret = 0;
+#ifdef P256_NATIVE_SUPPORTED
+    if (print) {
+        printf("Kernel: %s\n", p256_native_kernel());
+    }
+    int num_tests = sizeof(test_suite)/sizeof(test_function);
+    for (int i=0; i<num_tests; i++) {
+        if (test_suite[i](print)) {
+            ret = 1;
+        }
+    }
+#else
+    if (print) {
+        printf("Not supported by this compiler\n");
+    }
+#endif
+    if (print) {
+        printf("P256 native test suite END --------------------------\n");
+#ifdef DEBUG
+        print_allocation_status();
+#endif
+        fflush(stdout);
+    }
+    return ret;
+}
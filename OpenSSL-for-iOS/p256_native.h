@@ -0,0 +1,68 @@
+//
+//  p256_native.h
+//  OpenSSL-for-iOS
+//
+//  Native P-256 arithmetic: field elements as 4x64-bit limbs in Montgomery form, Jacobian points held by value,
+//  no heap or BN_CTX use. The field multiplication uses mulx/adx when the CPU has them (x86-64, detected at run
+//  time) and portable 128-bit arithmetic otherwise. Scalar multiplications run in constant time apart from the
+//  exceptional cases of the addition formulas, which do not occur for scalars below the group order.
+//
+//  Built with -DP256_NATIVE, P256.c routes point_mul and bn2point through this backend (P-256 only, not the toy
+//  curve). Single additions and comparisons stay with libcrypto, converting from and to EC_POINT costs more than
+//  the operation saves. Needs a compiler with unsigned __int128 (GCC, Clang).
+//
+
+#ifndef P256_NATIVE_H
+#define P256_NATIVE_H
+#include <stdint.h>
+#include "P256.h"
+
+#if defined(__SIZEOF_INT128__)
+#define P256_NATIVE_SUPPORTED 1
+#endif
+
+#if defined(P256_NATIVE) && !defined(P256_NATIVE_SUPPORTED)
+#error "P256_NATIVE needs a compiler with unsigned __int128, see p256_native.h"
+#endif
+
+// field element modulo p in Montgomery form (little endian limbs, fully reduced)
+typedef struct {
+    uint64_t v[4];
+} p256_fe;
+
+// Jacobian point (X / Z^2, Y / Z^3), Z = 0 for the point at infinity
+typedef struct {
+    p256_fe X;
+    p256_fe Y;
+    p256_fe Z;
+} p256_point;
+
+#ifdef P256_NATIVE_SUPPORTED
+
+// field multiplication kernel in use, "mulx/adx" or "generic"
+const char *p256_native_kernel(void);
+
+// force the portable kernel (1) or go back to the detected one (0), for tests and benchmarks
+void p256_native_set_generic(int generic);
+
+// conversion from and to EC_POINT (in the group of get0_group), returns 0 on success
+int p256_native_from_ec_point(p256_point *r, const EC_GROUP *group, const EC_POINT *point, BN_CTX *ctx);
+int p256_native_to_ec_point(const EC_GROUP *group, EC_POINT *r, const p256_point *point, BN_CTX *ctx);
+
+// r = a + b, r = 2a and r = -a (r may alias the inputs)
+void p256_native_point_add(p256_point *r, const p256_point *a, const p256_point *b);
+void p256_native_point_dbl(p256_point *r, const p256_point *a);
+void p256_native_point_neg(p256_point *r, const p256_point *a);
+
+// 0 if a and b are the same point, 1 otherwise
+int p256_native_point_cmp(const p256_point *a, const p256_point *b);
+
+// r = scalar * point and r = scalar * G, scalar is 32 bytes big endian (as written by bn_to_bytes)
+void p256_native_point_mul(p256_point *r, const unsigned char *scalar, const p256_point *point);
+void p256_native_base_mul(p256_point *r, const unsigned char *scalar);
+
+#endif /* P256_NATIVE_SUPPORTED */
+
+int p256_native_test_suite(int print);
+
+#endif /* P256_NATIVE_H */
@@ -17,19 +17,35 @@ int proc_pid_rusage(int pid, int flavor, rusage_info_t *buffer)
 #endif
 
 #if PLATFORM_TYPE == PLATFORM_TYPE_UNIX
+#include <stdio.h>
+#include <string.h>
 #include <time.h>
-#include <sys/time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+#ifndef CLOCK_MONOTONIC_RAW
+#define CLOCK_MONOTONIC_RAW CLOCK_MONOTONIC
+#endif
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <x86intrin.h>
+#define PLATFORM_HAS_RDTSCP
 #endif
 
 platform_time_type platform_utils_get_wall_time(void) {
 #if PLATFORM_TYPE == PLATFORM_TYPE_MAC
     return mach_absolute_time();
 #elif PLATFORM_TYPE == PLATFORM_TYPE_UNIX
-    struct timeval t;
-    if (gettimeofday(&t, NULL)) {
-        return -1; // error, could not get time
+    struct timespec t;
+    if (clock_gettime(CLOCK_MONOTONIC_RAW, &t)) {
+        return 0; // error, could not get time
     }
-    return (double)t.tv_sec + (double)t.tv_usec * .000001;
+    return (uint64_t)t.tv_sec * 1000000000 + (uint64_t)t.tv_nsec;
 #elif PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
   return clock();
 #else
@@ -43,7 +59,7 @@ double platform_utils_get_wall_time_diff(platform_time_type start_time, platform
     mach_timebase_info(&info);
     return (double)(end_time - start_time) * (double)info.numer / (double)info.denom / 1e9;
 #elif PLATFORM_TYPE == PLATFORM_TYPE_UNIX
-    return end_time - start_time;
+    return (double)(int64_t)(end_time - start_time) / 1e9;
 #elif PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
   return (double)(end_time - start_time) / CLOCKS_PER_SEC;
 #else
@@ -73,10 +89,123 @@ uint64_t platform_utils_get_max_memory_usage(void) {
   return (uint64_t)vm_info.ledger_phys_footprint_peak;
 #endif
 #elif PLATFORM_TYPE == PLATFORM_TYPE_UNIX
-  return 0; // not implemented, but pass zero as temporary test of code
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage)) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return (uint64_t)usage.ru_maxrss; // bytes
+#else
+  return (uint64_t)usage.ru_maxrss * 1024; // kilobytes
+#endif
 #elif PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
   return 0; // not implemented, but pass zero as temporary test of code
 #else
 #error "unsupported platform type (not implemented for this platform)"
 #endif
 }
+
+// measure the current RAM memory footprint of the current process
+uint64_t platform_utils_get_current_memory_usage(void) {
+#if PLATFORM_TYPE == PLATFORM_TYPE_MAC
+  rusage_info_current rusage_payload;
+  if (proc_pid_rusage(getpid(), RUSAGE_INFO_CURRENT, (rusage_info_t *)&rusage_payload) != 0) {
+    return 0;
+  }
+  return rusage_payload.ri_phys_footprint;
+#elif PLATFORM_TYPE == PLATFORM_TYPE_UNIX
+  // second field of /proc/self/statm: resident pages
+  FILE *file = fopen("/proc/self/statm", "r");
+  if (!file) {
+    return 0;
+  }
+  unsigned long size, resident;
+  int num = fscanf(file, "%lu %lu", &size, &resident);
+  fclose(file);
+  if (num != 2) {
+    return 0;
+  }
+  return (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE);
+#elif PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+  return 0; // not implemented
+#else
+#error "unsupported platform type (not implemented for this platform)"
+#endif
+}
+
+uint64_t platform_utils_get_cycles(void) {
+#ifdef PLATFORM_HAS_RDTSCP
+  unsigned int aux;
+  return __rdtscp(&aux); // waits for the preceding instructions to complete
+#else
+  return 0;
+#endif
+}
+
+int platform_utils_has_cycle_counter(void) {
+#ifdef PLATFORM_HAS_RDTSCP
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+#if PLATFORM_TYPE == PLATFORM_TYPE_UNIX && defined(__linux__)
+static int perf_event_open_hw(uint64_t config) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0); // this thread, any CPU, no group
+}
+#endif
+
+int platform_utils_perf_start(platform_perf_counters *pc) {
+  int num_events = 0;
+#if PLATFORM_TYPE == PLATFORM_TYPE_UNIX && defined(__linux__)
+  static const uint64_t config[PLATFORM_PERF_NUM_EVENTS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+  };
+  for (int e=0; e<PLATFORM_PERF_NUM_EVENTS; e++) {
+    pc->fd[e] = perf_event_open_hw(config[e]);
+    num_events += pc->fd[e] >= 0;
+  }
+  for (int e=0; e<PLATFORM_PERF_NUM_EVENTS; e++) {
+    if (pc->fd[e] >= 0) {
+      ioctl(pc->fd[e], PERF_EVENT_IOC_RESET, 0);
+      ioctl(pc->fd[e], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#else
+  for (int e=0; e<PLATFORM_PERF_NUM_EVENTS; e++) {
+    pc->fd[e] = -1;
+  }
+#endif
+  return num_events;
+}
+
+void platform_utils_perf_stop(platform_perf_counters *pc, platform_perf_values *values) {
+  values->valid = 0;
+  for (int e=0; e<PLATFORM_PERF_NUM_EVENTS; e++) {
+    values->count[e] = 0;
+#if PLATFORM_TYPE == PLATFORM_TYPE_UNIX && defined(__linux__)
+    if (pc->fd[e] >= 0) {
+      ioctl(pc->fd[e], PERF_EVENT_IOC_DISABLE, 0);
+      uint64_t count;
+      if (read(pc->fd[e], &count, sizeof(count)) == sizeof(count)) {
+        values->count[e] = count;
+        values->valid |= 1u << e;
+      }
+      close(pc->fd[e]);
+      pc->fd[e] = -1;
+    }
+#endif
+  }
+}
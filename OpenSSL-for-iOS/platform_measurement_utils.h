@@ -7,7 +7,7 @@
 typedef uint64_t platform_time_type;
 #elif PLATFORM_TYPE == PLATFORM_TYPE_UNIX
 #include <inttypes.h>
-typedef double platform_time_type;
+typedef uint64_t platform_time_type; // CLOCK_MONOTONIC_RAW in ns
 #elif PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
 #include <inttypes.h>
 #include <time.h>
@@ -19,6 +19,37 @@ typedef clock_t platform_time_type;
 platform_time_type platform_utils_get_wall_time(void);
 double platform_utils_get_wall_time_diff(platform_time_type start_time, platform_time_type end_time);
 
+// peak and current resident memory of the process in bytes (0 if not available on the platform)
 uint64_t platform_utils_get_max_memory_usage(void);
+uint64_t platform_utils_get_current_memory_usage(void);
+
+// time stamp counter (rdtscp, x86-64 only), 0 where there is none, see platform_utils_has_cycle_counter
+uint64_t platform_utils_get_cycles(void);
+int platform_utils_has_cycle_counter(void);
+
+// hardware event counts of a measured region (perf_event_open, Linux only):
+//   platform_perf_counters pc;
+//   platform_utils_perf_start(&pc);
+//   ... measured region ...
+//   platform_utils_perf_stop(&pc, &values);
+// events the kernel refuses (perf_event_paranoid, virtual machines) are left out, their bit in values.valid is 0
+#define PLATFORM_PERF_CYCLES        0
+#define PLATFORM_PERF_INSTRUCTIONS  1
+#define PLATFORM_PERF_CACHE_MISSES  2
+#define PLATFORM_PERF_BRANCH_MISSES 3
+#define PLATFORM_PERF_NUM_EVENTS    4
+
+typedef struct {
+    int fd[PLATFORM_PERF_NUM_EVENTS];
+} platform_perf_counters;
+
+typedef struct {
+    uint64_t count[PLATFORM_PERF_NUM_EVENTS];
+    unsigned valid; // bit e set if count[e] was measured
+} platform_perf_values;
+
+// returns the number of events counted (0 if none, e.g. not on Linux)
+int platform_utils_perf_start(platform_perf_counters *pc);
+void platform_utils_perf_stop(platform_perf_counters *pc, platform_perf_values *values);
 
 #endif
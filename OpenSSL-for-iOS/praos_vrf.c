@@ -6,7 +6,94 @@
 //
 
 #include "praos_vrf.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 #include "openssl_hashing_tools.h"
+#include "hash_to_curve.h"
+#include "seed_cache.h"
+#include "vrf_metrics.h"
+
+// params of a call, params NULL stands for the legacy suite with the process wide seed cache and no verify cache
+// (filled into defaults, the seed cache is only known at run time)
+static const praos_vrf_params *vrf_params_or_default(const praos_vrf_params *params, praos_vrf_params *defaults) {
+    if (params) {
+        return params;
+    }
+    *defaults = (praos_vrf_params){ PRAOS_VRF_SUITE_LEGACY, get0_seed_cache(), NULL };
+    return defaults;
+}
+
+// key of the output in the verify cache, returns 0 on success, 1 if there is no cache or the output cannot be
+// encoded (it is verified as usual then)
+static int vrf_verify_cache_key(const EC_GROUP *group, const BIGNUM *seed, const BIGNUM *randval, const EC_POINT *u, const nizk_dl_eq_proof *pi, const EC_POINT *pub_key, const praos_vrf_params *params, unsigned char *key, BN_CTX *ctx) {
+    if (!params->verify_cache || BN_is_negative(randval) || BN_is_negative(pi->z)) {
+        return 1;
+    }
+    // output as vrf_output_to_bytes followed by the public key, the points encoded together (one inversion, the
+    // cost of a hit, instead of one per point)
+    unsigned char output[VRF_OUTPUT_BYTES + P256_POINT_BYTES];
+    unsigned char *pub_key_bytes = output + VRF_OUTPUT_BYTES;
+    const EC_POINT *points[] = { u, pi->Ra, pi->Rb, pub_key };
+    unsigned char point_bytes[4 * P256_POINT_BYTES];
+    if (points_to_bytes(group, 4, points, point_bytes, ctx) || bn_to_bytes(pi->z, output + 3 * P256_POINT_BYTES) ||
+        BN_bn2binpad(randval, output + VRF_OUTPUT_RANDVAL_OFFSET, SHA256_DIGEST_LENGTH) != SHA256_DIGEST_LENGTH) {
+        return 1;
+    }
+    output[VRF_OUTPUT_SUITE_OFFSET] = (unsigned char)params->suite;
+    memcpy(output, point_bytes, 3 * P256_POINT_BYTES);
+    memcpy(pub_key_bytes, point_bytes + 3 * P256_POINT_BYTES, P256_POINT_BYTES);
+    return verify_cache_key(seed, output, pub_key_bytes, key);
+}
+
+// seed_point = [seed]G and hash_seed_point = H'(seed), shared by all verifiers of the same seed through the seed
+// cache of params if there is one
+static void vrf_seed_points(const EC_GROUP *group, const BIGNUM *seed, const praos_vrf_params *params, EC_POINT *seed_point, EC_POINT *hash_seed_point, BN_CTX *ctx) {
+    if (params->seed_cache) {
+        seed_cache_lookup(params->seed_cache, seed, params->suite, seed_point, hash_seed_point, ctx);
+    } else {
+        bn2point_r(group, seed_point, seed, ctx);
+        vrf_hash_seed_r(group, hash_seed_point, seed, params->suite, ctx);
+    }
+}
+
+// r = H(seed) of the legacy suite, SHA-256 of the minimal big endian seed bytes (none for seed 0, which
+// openssl_hash_bn2bn does not take)
+static void vrf_hash_seed_bn(BIGNUM *r, const BIGNUM *seed) {
+    if (!BN_is_zero(seed)) {
+        openssl_hash_bn2bn_r(r, seed);
+        return;
+    }
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    SHA256(NULL, 0, hash);
+    BIGNUM *ret = BN_bin2bn(hash, SHA256_DIGEST_LENGTH, r);
+    assert(ret && "vrf_hash_seed_bn: BN_bin2bn failed");
+}
+
+void vrf_hash_seed_r(const EC_GROUP *group, EC_POINT *r, const BIGNUM *seed, praos_vrf_suite suite, BN_CTX *ctx) {
+    if (suite == PRAOS_VRF_SUITE_P256_SSWU) {
+        // msg = I2OSP(seed, 32), seeds are scalars, longer ones are hashed with their minimal length
+        unsigned char buf[P256_SCALAR_BYTES];
+        int len = BN_num_bytes(seed);
+        if (len <= P256_SCALAR_BYTES) {
+            bn_to_bytes(seed, buf);
+            hash_to_curve_p256_sswu(group, r, buf, P256_SCALAR_BYTES, (const unsigned char *)PRAOS_VRF_SSWU_DST, sizeof(PRAOS_VRF_SSWU_DST) - 1, ctx);
+        } else {
+            unsigned char *msg = malloc(len);
+            assert(msg && "vrf_hash_seed_r: allocation error");
+            BN_bn2bin(seed, msg);
+            hash_to_curve_p256_sswu(group, r, msg, len, (const unsigned char *)PRAOS_VRF_SSWU_DST, sizeof(PRAOS_VRF_SSWU_DST) - 1, ctx);
+            free(msg);
+        }
+        return;
+    }
+    BN_CTX_start(ctx);
+    BIGNUM *hash_seed = BN_CTX_get(ctx);
+    assert(hash_seed && "vrf_hash_seed_r: BN_CTX_get failed");
+    vrf_hash_seed_bn(hash_seed, seed);
+    bn2point_r(group, r, hash_seed, ctx);
+    BN_CTX_end(ctx);
+}
 
 void key_pair_free(key_pair *kp) {
     bn_free(kp->priv);
@@ -20,11 +107,14 @@ void key_pair_generate(const EC_GROUP *group, key_pair *kp, BN_CTX *ctx) {
 }
 
 //output randval and proof on input a seed and keypair
-void prove_vrf(const EC_GROUP *group, BIGNUM *seed, BIGNUM **randval, EC_POINT *u, nizk_dl_eq_proof *pi,  key_pair *kp, BN_CTX *ctx) {
-    //hash_seed = H'(seed)
-    BIGNUM *hash_seed = openssl_hash_bn2bn(seed);
-    //u = hash_seed^k
-    EC_POINT *hash_seed_point = bn2point(group, hash_seed, ctx);
+void prove_vrf(const EC_GROUP *group, BIGNUM *seed, BIGNUM **randval, EC_POINT *u, nizk_dl_eq_proof *pi,  key_pair *kp, const praos_vrf_params *params, BN_CTX *ctx) {
+    int metrics = vrf_metrics_op_begin(VRF_METRICS_OP_PROVE_VRF);
+    praos_vrf_params defaults;
+    params = vrf_params_or_default(params, &defaults);
+    //hash_seed_point = H'(seed)
+    EC_POINT *hash_seed_point = point_new(group);
+    vrf_hash_seed_r(group, hash_seed_point, seed, params->suite, ctx);
+    //u = hash_seed_point^k
     
     point_mul(group, u, kp->priv, hash_seed_point, ctx);
     //y = H(m,u):
@@ -41,24 +131,786 @@ void prove_vrf(const EC_GROUP *group, BIGNUM *seed, BIGNUM **randval, EC_POINT *
     
     point_free(seed_point);
     point_free(hash_seed_point);
-    bn_free(hash_seed);
+    vrf_metrics_op_end(metrics);
 }
 
-int verify_vrf(const EC_GROUP *group, BIGNUM *seed, BIGNUM *randval, EC_POINT *u, nizk_dl_eq_proof *pi, EC_POINT *pub_key, BN_CTX *ctx) {
-    
-    EC_POINT *seed_point = bn2point(group, seed, ctx); //optimize?
-    BIGNUM *hash_seed = openssl_hash_bn2bn(seed);//optimize?
-    EC_POINT *hash_seed_point = bn2point(group, hash_seed, ctx);//optimize?
+int vrf_randval_below(const BIGNUM *randval, void *threshold) {
+    return BN_cmp(randval, (const BIGNUM *)threshold) < 0;
+}
+
+void vrf_evaluate(const EC_GROUP *group, const BIGNUM *seed, const key_pair *kp, vrf_eval *eval, const praos_vrf_params *params, BN_CTX *ctx) {
+    int metrics = vrf_metrics_op_begin(VRF_METRICS_OP_VRF_EVALUATE);
+    praos_vrf_params defaults;
+    params = vrf_params_or_default(params, &defaults);
+    eval->u = point_new(group);
+    eval->randval = bn_new();
+    eval->hash_seed_point = point_new(group);
+    eval->hash_seed = NULL;
+    eval->suite = params->suite;
+    if (params->suite == PRAOS_VRF_SUITE_LEGACY) {
+        // H'(seed) = G^H(seed) has a known discrete log, so u = G^(k * H(seed)) comes from the generator table
+        // (no variable-base multiplication) and H'(seed) is only needed for the proof
+        eval->hash_seed = bn_new();
+        vrf_hash_seed_bn(eval->hash_seed, seed);
+        BN_CTX_start(ctx);
+        BIGNUM *exp = BN_CTX_get(ctx);
+        assert(exp && "vrf_evaluate: BN_CTX_get failed");
+        int ret = BN_mod_mul(exp, kp->priv, eval->hash_seed, get0_order(group), ctx);
+        assert(ret == 1 && "vrf_evaluate: BN_mod_mul failed");
+        bn2point_r(group, eval->u, exp, ctx);
+        BN_CTX_end(ctx);
+    } else {
+        vrf_hash_seed_r(group, eval->hash_seed_point, seed, params->suite, ctx);
+        point_mul(group, eval->u, kp->priv, eval->hash_seed_point, ctx);
+    }
+    EC_POINT *seed_point = point_new(group);
+    bn2point_r(group, seed_point, seed, ctx);
+    const EC_POINT *randval_points[] = { seed_point, eval->u };
+    openssl_hash_point_list2bn_r(eval->randval, group, ctx, 2, randval_points);
+    point_free(seed_point);
+    vrf_metrics_op_end(metrics);
+}
+
+int vrf_prove_from_eval(const EC_GROUP *group, vrf_eval *eval, const key_pair *kp, vrf_eligibility eligible, void *arg, nizk_dl_eq_proof *pi, BN_CTX *ctx) {
+    if (eligible && !eligible(eval->randval, arg)) {
+        return 0;
+    }
+    if (eval->hash_seed) {
+        bn2point_r(group, eval->hash_seed_point, eval->hash_seed, ctx);
+        bn_free(eval->hash_seed);
+        eval->hash_seed = NULL;
+    }
+    nizk_dl_eq_prove(group, kp->priv, eval->hash_seed_point, eval->u, get0_generator(group), kp->pub, pi, ctx);
+    return 1;
+}
+
+void vrf_eval_free(vrf_eval *eval) {
+    if (eval->hash_seed) {
+        bn_free(eval->hash_seed);
+    }
+    point_free(eval->hash_seed_point);
+    bn_free(eval->randval);
+    point_free(eval->u);
+}
+
+int verify_vrf(const EC_GROUP *group, BIGNUM *seed, BIGNUM *randval, EC_POINT *u, nizk_dl_eq_proof *pi, EC_POINT *pub_key, const praos_vrf_params *params, BN_CTX *ctx) {
+    int metrics = vrf_metrics_op_begin(VRF_METRICS_OP_VERIFY_VRF);
+    praos_vrf_params defaults;
+    params = vrf_params_or_default(params, &defaults);
+    unsigned char key[VERIFY_CACHE_KEY_BYTES];
+    int cacheable = vrf_verify_cache_key(group, seed, randval, u, pi, pub_key, params, key, ctx) == 0;
+    if (cacheable && verify_cache_lookup(params->verify_cache, key)) {
+        vrf_metrics_op_end(metrics);
+        return 0;
+    }
+    EC_POINT *seed_point = point_new(group);
+    EC_POINT *hash_seed_point = point_new(group);
+    vrf_seed_points(group, seed, params, seed_point, hash_seed_point, ctx);
     BIGNUM *rand_val_calc = openssl_hash_points2bn(group, ctx, 2, seed_point, u);
     
-    if (0 != BN_cmp(randval, rand_val_calc)) {//cmp outputs 0 if equal
-        return 1;//return false
+    int val_proof = 1;
+    if (0 == BN_cmp(randval, rand_val_calc)) {//cmp outputs 0 if equal
+        val_proof = nizk_dl_eq_verify(group, hash_seed_point, u, get0_generator(group), pub_key, pi, ctx);
     }
     
-    int val_proof = nizk_dl_eq_verify(group, hash_seed_point, u, get0_generator(group), pub_key, pi, ctx);
-    
+    if (cacheable && val_proof == 0) {
+        verify_cache_insert(params->verify_cache, key);
+    }
     point_free(seed_point);
-    bn_free(hash_seed);
     point_free(hash_seed_point);
+    bn_free(rand_val_calc);
+    vrf_metrics_op_end(metrics);
     return val_proof;//returns 0 on successful validation
 }
+
+void prove_vrf_arena(const EC_GROUP *group, BIGNUM *seed, BIGNUM *randval, EC_POINT *u, nizk_dl_eq_proof *pi, key_pair *kp, const praos_vrf_params *params, p256_arena *arena) {
+    int metrics = vrf_metrics_op_begin(VRF_METRICS_OP_PROVE_VRF);
+    praos_vrf_params defaults;
+    params = vrf_params_or_default(params, &defaults);
+    p256_arena_start(arena);
+    BN_CTX *ctx = p256_arena_get0_bn_ctx(arena);
+    EC_POINT *hash_seed_point = p256_arena_point(arena);
+    EC_POINT *seed_point = p256_arena_point(arena);
+
+    // u = H'(seed)^k, randval = H(seed_point, u)
+    vrf_hash_seed_r(group, hash_seed_point, seed, params->suite, ctx);
+    point_mul(group, u, kp->priv, hash_seed_point, ctx);
+    bn2point_r(group, seed_point, seed, ctx);
+    const EC_POINT *randval_points[] = { seed_point, u };
+    openssl_hash_point_list2bn_r(randval, group, ctx, 2, randval_points);
+
+    nizk_dl_eq_prove_arena(group, kp->priv, hash_seed_point, u, get0_generator(group), kp->pub, pi, arena);
+    p256_arena_end(arena);
+    vrf_metrics_op_end(metrics);
+}
+
+int verify_vrf_arena(const EC_GROUP *group, BIGNUM *seed, BIGNUM *randval, EC_POINT *u, nizk_dl_eq_proof *pi, EC_POINT *pub_key, const praos_vrf_params *params, p256_arena *arena) {
+    int metrics = vrf_metrics_op_begin(VRF_METRICS_OP_VERIFY_VRF);
+    praos_vrf_params defaults;
+    params = vrf_params_or_default(params, &defaults);
+    p256_arena_start(arena);
+    BN_CTX *ctx = p256_arena_get0_bn_ctx(arena);
+    unsigned char key[VERIFY_CACHE_KEY_BYTES];
+    int cacheable = vrf_verify_cache_key(group, seed, randval, u, pi, pub_key, params, key, ctx) == 0;
+    if (cacheable && verify_cache_lookup(params->verify_cache, key)) {
+        p256_arena_end(arena);
+        vrf_metrics_op_end(metrics);
+        return 0;
+    }
+    EC_POINT *seed_point = p256_arena_point(arena);
+    EC_POINT *hash_seed_point = p256_arena_point(arena);
+    BIGNUM *rand_val_calc = p256_arena_bn(arena);
+    vrf_seed_points(group, seed, params, seed_point, hash_seed_point, ctx);
+    const EC_POINT *randval_points[] = { seed_point, u };
+    openssl_hash_point_list2bn_r(rand_val_calc, group, ctx, 2, randval_points);
+
+    int val_proof = 1;
+    if (0 == BN_cmp(randval, rand_val_calc)) {
+        val_proof = nizk_dl_eq_verify_arena(group, hash_seed_point, u, get0_generator(group), pub_key, pi, arena);
+    }
+    if (cacheable && val_proof == 0) {
+        verify_cache_insert(params->verify_cache, key);
+    }
+
+    p256_arena_end(arena);
+    vrf_metrics_op_end(metrics);
+    return val_proof; // returns 0 on successful validation
+}
+
+int verify_vrf_registered(const EC_GROUP *group, BIGNUM *seed, BIGNUM *randval, EC_POINT *u, nizk_dl_eq_proof *pi, pubkey_registry *reg, int key_index, const praos_vrf_params *params, BN_CTX *ctx) {
+    int metrics = vrf_metrics_op_begin(VRF_METRICS_OP_VERIFY_VRF);
+    praos_vrf_params defaults;
+    params = vrf_params_or_default(params, &defaults);
+    unsigned char key[VERIFY_CACHE_KEY_BYTES];
+    int cacheable = vrf_verify_cache_key(group, seed, randval, u, pi, pubkey_registry_get0_pub(reg, key_index), params, key, ctx) == 0;
+    if (cacheable && verify_cache_lookup(params->verify_cache, key)) {
+        vrf_metrics_op_end(metrics);
+        return 0;
+    }
+    EC_POINT *seed_point = point_new(group);
+    EC_POINT *hash_seed_point = point_new(group);
+    vrf_seed_points(group, seed, params, seed_point, hash_seed_point, ctx);
+    BIGNUM *rand_val_calc = openssl_hash_points2bn(group, ctx, 2, seed_point, u);
+
+    int val_proof = 1;
+    if (0 == BN_cmp(randval, rand_val_calc)) {
+        val_proof = nizk_dl_eq_verify_registered(group, hash_seed_point, u, reg, key_index, pi, ctx);
+    }
+    if (cacheable && val_proof == 0) {
+        verify_cache_insert(params->verify_cache, key);
+    }
+
+    point_free(seed_point);
+    point_free(hash_seed_point);
+    bn_free(rand_val_calc);
+    vrf_metrics_op_end(metrics);
+    return val_proof; // returns 0 on successful validation
+}
+
+int vrf_output_to_bytes(const EC_GROUP *group, const EC_POINT *u, const nizk_dl_eq_proof *pi, const BIGNUM *randval, praos_vrf_suite suite, unsigned char *buf, BN_CTX *ctx) {
+    if (point_to_bytes(group, u, buf, ctx) || nizk_dl_eq_proof_to_bytes(group, pi, buf + P256_POINT_BYTES, ctx)) {
+        return 1;
+    }
+    buf[VRF_OUTPUT_SUITE_OFFSET] = (unsigned char)suite;
+    return BN_bn2binpad(randval, buf + VRF_OUTPUT_RANDVAL_OFFSET, SHA256_DIGEST_LENGTH) != SHA256_DIGEST_LENGTH;
+}
+
+int vrf_output_from_bytes(const EC_GROUP *group, const unsigned char *buf, EC_POINT *u, nizk_dl_eq_proof *pi, BIGNUM **randval, praos_vrf_suite *suite, BN_CTX *ctx) {
+    if (buf[VRF_OUTPUT_SUITE_OFFSET] >= PRAOS_VRF_NUM_SUITES || point_from_bytes(group, u, buf, ctx) || nizk_dl_eq_proof_from_bytes(group, pi, buf + P256_POINT_BYTES, ctx)) {
+        return 1;
+    }
+    *randval = bn_from_binary_data(SHA256_DIGEST_LENGTH, buf + VRF_OUTPUT_RANDVAL_OFFSET);
+    if (suite) {
+        *suite = (praos_vrf_suite)buf[VRF_OUTPUT_SUITE_OFFSET];
+    }
+    return 0;
+}
+
+int verify_vrf_bytes(const EC_GROUP *group, BIGNUM *seed, const unsigned char *output, EC_POINT *pub_key, const praos_vrf_params *params, BN_CTX *ctx) {
+    const unsigned char *u_bytes = output;
+    const unsigned char *proof = output + P256_POINT_BYTES;
+    const unsigned char *randval = output + VRF_OUTPUT_RANDVAL_OFFSET;
+    praos_vrf_params defaults;
+    params = vrf_params_or_default(params, &defaults);
+    if (output[VRF_OUTPUT_SUITE_OFFSET] != (unsigned char)params->suite) {
+        return 1;
+    }
+
+    // randval = H(seed_point, u), u is hashed as received
+    int metrics = vrf_metrics_op_begin(VRF_METRICS_OP_VERIFY_VRF);
+    unsigned char key[VERIFY_CACHE_KEY_BYTES];
+    unsigned char pub_key_bytes[P256_POINT_BYTES];
+    const EC_POINT *pub_key_point = pub_key;
+    int pub_key_encoded = points_to_bytes(group, 1, &pub_key_point, pub_key_bytes, ctx) == 0;
+    int cacheable = params->verify_cache && pub_key_encoded && verify_cache_key(seed, output, pub_key_bytes, key) == 0;
+    if (cacheable && verify_cache_lookup(params->verify_cache, key)) {
+        vrf_metrics_op_end(metrics);
+        return 0;
+    }
+    EC_POINT *seed_point = point_new(group);
+    EC_POINT *hash_seed_point = point_new(group);
+    vrf_seed_points(group, seed, params, seed_point, hash_seed_point, ctx);
+    SHA256_CTX sha_ctx;
+    openssl_hash_init(&sha_ctx);
+    openssl_hash_update_point(&sha_ctx, group, seed_point, ctx);
+    openssl_hash_update(&sha_ctx, u_bytes, P256_POINT_BYTES);
+    unsigned char md[SHA256_DIGEST_LENGTH];
+    openssl_hash_final(md, &sha_ctx);
+    point_free(seed_point);
+    if (memcmp(md, randval, SHA256_DIGEST_LENGTH) != 0) {
+        point_free(hash_seed_point);
+        vrf_metrics_op_end(metrics);
+        return 1;
+    }
+
+    EC_POINT *u = point_new(group);
+    int val_proof = point_from_bytes(group, u, u_bytes, ctx);
+    if (val_proof == 0) {
+        // u and the public key enter the proof transcript in the encoding already at hand
+        transcript prefix;
+        nizk_dl_eq_transcript_prefix(group, &prefix, get0_generator(group), pub_key, pub_key_encoded ? pub_key_bytes : NULL, ctx);
+        val_proof = nizk_dl_eq_verify_bytes_prefix(group, hash_seed_point, u, u_bytes, get0_generator(group), pub_key, &prefix, proof, ctx);
+    }
+    if (cacheable && val_proof == 0) {
+        verify_cache_insert(params->verify_cache, key);
+    }
+    point_free(u);
+    point_free(hash_seed_point);
+    vrf_metrics_op_end(metrics);
+    return val_proof; // returns 0 on successful validation
+}
+
+typedef struct {
+    const BIGNUM *seed;
+    int index;
+} vrf_seed_ref;
+
+static int vrf_seed_ref_cmp(const void *a, const void *b) {
+    const vrf_seed_ref *ra = a;
+    const vrf_seed_ref *rb = b;
+    int ret = BN_cmp(ra->seed, rb->seed);
+    return ret ? ret : ra->index - rb->index;
+}
+
+static int verify_vrf_batch_uncached(const EC_GROUP *group, int num_proofs, BIGNUM **seed, BIGNUM **randval, EC_POINT **u, nizk_dl_eq_proof *pi, EC_POINT **pub_key, int *bad_index, const praos_vrf_params *params, BN_CTX *ctx) {
+
+    // group equal seeds by sorting references to them
+    vrf_seed_ref *refs = malloc(num_proofs * sizeof(vrf_seed_ref));
+    assert(refs && "verify_vrf_batch: allocation error (refs)");
+    for (int i=0; i<num_proofs; i++) {
+        refs[i].seed = seed[i];
+        refs[i].index = i;
+    }
+    qsort(refs, num_proofs, sizeof(vrf_seed_ref), vrf_seed_ref_cmp);
+
+    // seed_point and hash_seed_point once per distinct seed, shared by all proofs for that seed
+    EC_POINT **seed_points = malloc(num_proofs * sizeof(EC_POINT*));
+    EC_POINT **hash_seed_points = malloc(num_proofs * sizeof(EC_POINT*));
+    const EC_POINT **a = malloc(num_proofs * sizeof(EC_POINT*));
+    const EC_POINT **b = malloc(num_proofs * sizeof(EC_POINT*));
+    const EC_POINT **s = malloc(num_proofs * sizeof(EC_POINT*));
+    assert(seed_points && hash_seed_points && a && b && s && "verify_vrf_batch: allocation error");
+    int num_seeds = 0;
+    int first_bad_randval = num_proofs;
+    const EC_POINT *seed_point = NULL;
+    for (int i=0; i<num_proofs; i++) {
+        int index = refs[i].index;
+        if (i == 0 || BN_cmp(refs[i-1].seed, refs[i].seed) != 0) {
+            seed_points[num_seeds] = point_new(group);
+            hash_seed_points[num_seeds] = point_new(group);
+            vrf_seed_points(group, seed[index], params, seed_points[num_seeds], hash_seed_points[num_seeds], ctx);
+            seed_point = seed_points[num_seeds];
+            num_seeds++;
+        }
+        a[index] = hash_seed_points[num_seeds-1];
+        b[index] = get0_generator(group);
+        s[index] = seed_point;
+    }
+
+    // check all randvals first, they are cheap compared to the proofs (and hashed several at a time)
+    BIGNUM **rand_val_calc = bn_new_array(num_proofs);
+    const EC_POINT **randval_points[2] = { s, (const EC_POINT**)u };
+    openssl_hash_point_columns2bn_r(rand_val_calc, group, ctx, num_proofs, 2, randval_points);
+    for (int i=0; i<num_proofs; i++) {
+        if (0 != BN_cmp(randval[i], rand_val_calc[i])) {
+            first_bad_randval = i;
+            break;
+        }
+    }
+    bn_free_array(num_proofs, rand_val_calc);
+
+    // only proofs before the first bad randval need to go through the DL EQ check
+    int ret = 0;
+    if (first_bad_randval > 0) {
+        ret = nizk_dl_eq_verify_batch(group, first_bad_randval, a, (const EC_POINT**)u, b, (const EC_POINT**)pub_key, pi, bad_index, ctx);
+    }
+    if (!ret && first_bad_randval < num_proofs) {
+        ret = 1;
+        if (bad_index) {
+            *bad_index = first_bad_randval;
+        }
+    }
+
+    // cleanup
+    for (int i=0; i<num_seeds; i++) {
+        point_free(seed_points[i]);
+        point_free(hash_seed_points[i]);
+    }
+    free(seed_points);
+    free(hash_seed_points);
+    free(a);
+    free(b);
+    free(s);
+    free(refs);
+
+    return ret;
+}
+
+int verify_vrf_batch(const EC_GROUP *group, int num_proofs, BIGNUM **seed, BIGNUM **randval, EC_POINT **u, nizk_dl_eq_proof *pi, EC_POINT **pub_key, int *bad_index, const praos_vrf_params *params, BN_CTX *ctx) {
+    assert(num_proofs > 0 && "verify_vrf_batch: usage error, no proofs passed");
+    praos_vrf_params defaults;
+    params = vrf_params_or_default(params, &defaults);
+    int metrics = vrf_metrics_op_begin(VRF_METRICS_OP_VERIFY_VRF_BATCH);
+    if (!params->verify_cache) {
+        int ret = verify_vrf_batch_uncached(group, num_proofs, seed, randval, u, pi, pub_key, bad_index, params, ctx);
+        vrf_metrics_op_end(metrics);
+        return ret;
+    }
+
+    // batch verify the outputs not in the cache
+    unsigned char (*key)[VERIFY_CACHE_KEY_BYTES] = malloc(num_proofs * VERIFY_CACHE_KEY_BYTES);
+    int *cacheable = malloc(num_proofs * sizeof(int));
+    int *todo = malloc(num_proofs * sizeof(int));
+    BIGNUM **todo_seed = malloc(num_proofs * sizeof(BIGNUM*));
+    BIGNUM **todo_randval = malloc(num_proofs * sizeof(BIGNUM*));
+    EC_POINT **todo_u = malloc(num_proofs * sizeof(EC_POINT*));
+    nizk_dl_eq_proof *todo_pi = malloc(num_proofs * sizeof(nizk_dl_eq_proof));
+    EC_POINT **todo_pub_key = malloc(num_proofs * sizeof(EC_POINT*));
+    assert(key && cacheable && todo && todo_seed && todo_randval && todo_u && todo_pi && todo_pub_key && "verify_vrf_batch: allocation error");
+    int num_todo = 0;
+    for (int i=0; i<num_proofs; i++) {
+        cacheable[i] = vrf_verify_cache_key(group, seed[i], randval[i], u[i], &pi[i], pub_key[i], params, key[i], ctx) == 0;
+        if (cacheable[i] && verify_cache_lookup(params->verify_cache, key[i])) {
+            continue;
+        }
+        todo[num_todo] = i;
+        todo_seed[num_todo] = seed[i];
+        todo_randval[num_todo] = randval[i];
+        todo_u[num_todo] = u[i];
+        todo_pi[num_todo] = pi[i];
+        todo_pub_key[num_todo] = pub_key[i];
+        num_todo++;
+    }
+    int ret = 0;
+    if (num_todo > 0) {
+        int todo_bad_index = 0;
+        ret = verify_vrf_batch_uncached(group, num_todo, todo_seed, todo_randval, todo_u, todo_pi, todo_pub_key, &todo_bad_index, params, ctx);
+        if (ret && bad_index) {
+            *bad_index = todo[todo_bad_index];
+        }
+        for (int i=0; i<num_todo && !ret; i++) {
+            if (cacheable[todo[i]]) {
+                verify_cache_insert(params->verify_cache, key[todo[i]]);
+            }
+        }
+    }
+
+    // cleanup
+    free(key);
+    free(cacheable);
+    free(todo);
+    free(todo_seed);
+    free(todo_randval);
+    free(todo_u);
+    free(todo_pi);
+    free(todo_pub_key);
+    vrf_metrics_op_end(metrics);
+
+    return ret;
+}
+
+/*
+ *
+ *  praos_vrf tests
+ *
+ */
+static int praos_vrf_test_1(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    key_pair kp;
+    key_pair_generate(group, &kp, ctx);
+    BIGNUM *seed = bn_random(get0_order(group), ctx);
+    BIGNUM *randval;
+    EC_POINT *u = point_new(group);
+    nizk_dl_eq_proof pi;
+
+    // produce correct VRF output and verify
+    prove_vrf(group, seed, &randval, u, &pi, &kp, NULL, ctx);
+    int ret1 = verify_vrf(group, seed, randval, u, &pi, kp.pub, NULL, ctx);
+    if (print) {
+        printf("%6s Test 1 - 1: Correct VRF output %s accepted\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // negative test, bad randval
+    BN_add_word(randval, 1);
+    int ret2 = verify_vrf(group, seed, randval, u, &pi, kp.pub, NULL, ctx);
+    if (print) {
+        if (ret2) {
+            printf("    OK Test 1 - 2: Incorrect VRF output not accepted (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 1 - 2: Incorrect VRF output IS accepted (which is an ERROR)\n");
+        }
+    }
+
+    // cleanup
+    nizk_dl_eq_proof_free(&pi);
+    point_free(u);
+    bn_free(randval);
+    bn_free(seed);
+    key_pair_free(&kp);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 != 0);
+}
+
+static int praos_vrf_test_2(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    const int num_proofs = 8;
+    const int bad_randval = 6;
+    const int bad_proof = 3;
+
+    // several leaders per seed, seeds interleaved
+    BIGNUM *seeds[3];
+    for (int i=0; i<3; i++) {
+        seeds[i] = bn_random(get0_order(group), ctx);
+    }
+    key_pair kp[num_proofs];
+    BIGNUM *seed[num_proofs], *randval[num_proofs];
+    EC_POINT *u[num_proofs], *pub_key[num_proofs];
+    nizk_dl_eq_proof pi[num_proofs];
+    for (int i=0; i<num_proofs; i++) {
+        key_pair_generate(group, &kp[i], ctx);
+        seed[i] = seeds[i % 3];
+        u[i] = point_new(group);
+        prove_vrf(group, seed[i], &randval[i], u[i], &pi[i], &kp[i], NULL, ctx);
+        pub_key[i] = kp[i].pub;
+    }
+
+    // all VRF outputs correct
+    int bad_index = -1;
+    int ret1 = verify_vrf_batch(group, num_proofs, seed, randval, u, pi, pub_key, &bad_index, NULL, ctx);
+    if (print) {
+        printf("%6s Test 2 - 1: Correct VRF output batch %s accepted\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // negative tests, bad randval is found
+    BN_add_word(randval[bad_randval], 1);
+    int ret2 = verify_vrf_batch(group, num_proofs, seed, randval, u, pi, pub_key, &bad_index, NULL, ctx);
+    int bad_index2 = bad_index;
+    if (print) {
+        if (ret2 && bad_index2 == bad_randval) {
+            printf("    OK Test 2 - 2: VRF output batch with bad randval not accepted, bad output %d found (which is CORRECT)\n", bad_index2);
+        } else {
+            printf("NOT OK Test 2 - 2: VRF output batch with bad randval IS accepted or bad output not found (which is an ERROR)\n");
+        }
+    }
+
+    // an earlier bad proof takes precedence
+    BN_add_word(pi[bad_proof].z, 1);
+    int ret3 = verify_vrf_batch(group, num_proofs, seed, randval, u, pi, pub_key, &bad_index, NULL, ctx);
+    if (print) {
+        if (ret3 && bad_index == bad_proof) {
+            printf("    OK Test 2 - 3: VRF output batch with bad proof not accepted, bad output %d found (which is CORRECT)\n", bad_index);
+        } else {
+            printf("NOT OK Test 2 - 3: VRF output batch with bad proof IS accepted or bad output not found (which is an ERROR)\n");
+        }
+    }
+
+    // cleanup
+    for (int i=0; i<num_proofs; i++) {
+        nizk_dl_eq_proof_free(&pi[i]);
+        point_free(u[i]);
+        bn_free(randval[i]);
+        key_pair_free(&kp[i]);
+    }
+    for (int i=0; i<3; i++) {
+        bn_free(seeds[i]);
+    }
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 != 0 && bad_index2 == bad_randval && ret3 != 0 && bad_index == bad_proof);
+}
+
+static int praos_vrf_test_3(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    key_pair kp;
+    key_pair_generate(group, &kp, ctx);
+    BIGNUM *seed = bn_random(get0_order(group), ctx);
+    BIGNUM *randval;
+    EC_POINT *u = point_new(group);
+    nizk_dl_eq_proof pi;
+    prove_vrf(group, seed, &randval, u, &pi, &kp, NULL, ctx);
+
+    // encoded VRF output verifies in place and decodes to an output that verifies
+    unsigned char buf[VRF_OUTPUT_BYTES];
+    int ret1 = vrf_output_to_bytes(group, u, &pi, randval, PRAOS_VRF_SUITE_LEGACY, buf, ctx) || verify_vrf_bytes(group, seed, buf, kp.pub, NULL, ctx);
+    if (!ret1) {
+        BIGNUM *randval_decoded;
+        EC_POINT *u_decoded = point_new(group);
+        nizk_dl_eq_proof pi_decoded;
+        ret1 = vrf_output_from_bytes(group, buf, u_decoded, &pi_decoded, &randval_decoded, NULL, ctx);
+        if (!ret1) {
+            ret1 = verify_vrf(group, seed, randval_decoded, u_decoded, &pi_decoded, kp.pub, NULL, ctx);
+            nizk_dl_eq_proof_free(&pi_decoded);
+            bn_free(randval_decoded);
+        }
+        point_free(u_decoded);
+    }
+    if (print) {
+        printf("%6s Test 3 - 1: Correct encoded VRF output %s accepted\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // negative tests, a modified byte in each of u, Ra, Rb, z, randval and the suite
+    int ret2 = 0;
+    for (int offset=2; offset<VRF_OUTPUT_BYTES; offset+=P256_POINT_BYTES) {
+        buf[offset] ^= 0x01;
+        ret2 |= !verify_vrf_bytes(group, seed, buf, kp.pub, NULL, ctx);
+        buf[offset] ^= 0x01;
+    }
+    buf[VRF_OUTPUT_SUITE_OFFSET] ^= 0x01;
+    ret2 |= !verify_vrf_bytes(group, seed, buf, kp.pub, NULL, ctx);
+    if (print) {
+        if (!ret2) {
+            printf("    OK Test 3 - 2: Incorrect encoded VRF outputs not accepted (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 3 - 2: Incorrect encoded VRF output IS accepted (which is an ERROR)\n");
+        }
+    }
+
+    // cleanup
+    nizk_dl_eq_proof_free(&pi);
+    point_free(u);
+    bn_free(randval);
+    bn_free(seed);
+    key_pair_free(&kp);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0);
+}
+
+static int praos_vrf_test_4(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    p256_arena *arena = p256_arena_new(group, PRAOS_VRF_ARENA_BNS, PRAOS_VRF_ARENA_POINTS);
+    key_pair kp;
+    key_pair_generate(group, &kp, ctx);
+    BIGNUM *seed = bn_random(get0_order(group), ctx);
+    BIGNUM *randval = bn_new();
+    EC_POINT *u = point_new(group);
+    nizk_dl_eq_proof pi;
+    nizk_dl_eq_proof_init(group, &pi);
+
+    // VRF outputs from the arena verify, with and without arena, without any allocation in the loop
+#ifdef DEBUG
+    int num_allocated = allocation_count();
+#endif
+    int ret1 = 0;
+    for (int i=0; i<4; i++) {
+        prove_vrf_arena(group, seed, randval, u, &pi, &kp, NULL, arena);
+        ret1 |= verify_vrf_arena(group, seed, randval, u, &pi, kp.pub, NULL, arena);
+    }
+#ifdef DEBUG
+    ret1 |= allocation_count() != num_allocated;
+#endif
+    ret1 |= verify_vrf(group, seed, randval, u, &pi, kp.pub, NULL, ctx);
+    if (print) {
+        printf("%6s Test 4 - 1: Correct VRF output (arena) %s accepted\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // negative test, bad randval and bad proof
+    BN_add_word(randval, 1);
+    int ret2 = verify_vrf_arena(group, seed, randval, u, &pi, kp.pub, NULL, arena);
+    BN_sub_word(randval, 1);
+    BN_add_word(pi.z, 1);
+    ret2 = ret2 && verify_vrf_arena(group, seed, randval, u, &pi, kp.pub, NULL, arena);
+    if (print) {
+        if (ret2) {
+            printf("    OK Test 4 - 2: Incorrect VRF outputs (arena) not accepted (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 4 - 2: Incorrect VRF output (arena) IS accepted (which is an ERROR)\n");
+        }
+    }
+
+    // cleanup
+    nizk_dl_eq_proof_free(&pi);
+    point_free(u);
+    bn_free(randval);
+    bn_free(seed);
+    key_pair_free(&kp);
+    p256_arena_free(arena);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 != 0);
+}
+
+static int praos_vrf_test_5(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    p256_arena *arena = p256_arena_new(group, PRAOS_VRF_ARENA_BNS, PRAOS_VRF_ARENA_POINTS);
+    key_pair kp;
+    key_pair_generate(group, &kp, ctx);
+    BIGNUM *seed = bn_random(get0_order(group), ctx);
+    BIGNUM *randval;
+    EC_POINT *u = point_new(group);
+    nizk_dl_eq_proof pi;
+    prove_vrf(group, seed, &randval, u, &pi, &kp, NULL, ctx);
+
+    // VRF output with the hash to curve suite verifies on all paths, the arena one without allocation
+    praos_vrf_params sswu = { PRAOS_VRF_SUITE_P256_SSWU, NULL, NULL };
+    BIGNUM *randval_sswu = bn_new();
+    EC_POINT *u_sswu = point_new(group);
+    nizk_dl_eq_proof pi_sswu;
+    nizk_dl_eq_proof_init(group, &pi_sswu);
+    prove_vrf_arena(group, seed, randval_sswu, u_sswu, &pi_sswu, &kp, &sswu, arena);
+#ifdef DEBUG
+    int num_allocated = allocation_count();
+#endif
+    prove_vrf_arena(group, seed, randval_sswu, u_sswu, &pi_sswu, &kp, &sswu, arena);
+    int ret1 = verify_vrf_arena(group, seed, randval_sswu, u_sswu, &pi_sswu, kp.pub, &sswu, arena);
+#ifdef DEBUG
+    ret1 |= allocation_count() != num_allocated;
+#endif
+    ret1 |= verify_vrf(group, seed, randval_sswu, u_sswu, &pi_sswu, kp.pub, &sswu, ctx);
+    ret1 |= verify_vrf_batch(group, 1, &seed, &randval_sswu, &u_sswu, &pi_sswu, &kp.pub, NULL, &sswu, ctx);
+    unsigned char buf[VRF_OUTPUT_BYTES];
+    ret1 |= vrf_output_to_bytes(group, u_sswu, &pi_sswu, randval_sswu, PRAOS_VRF_SUITE_P256_SSWU, buf, ctx) || verify_vrf_bytes(group, seed, buf, kp.pub, &sswu, ctx);
+    if (print) {
+        printf("%6s Test 5 - 1: Correct VRF output (hash to curve suite) %s accepted\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // outputs do not verify under the other suite, encoded ones neither once the suite byte is changed
+    int ret2 = verify_vrf(group, seed, randval, u, &pi, kp.pub, &sswu, ctx);
+    ret2 = ret2 && verify_vrf(group, seed, randval_sswu, u_sswu, &pi_sswu, kp.pub, NULL, ctx);
+    ret2 = ret2 && verify_vrf_bytes(group, seed, buf, kp.pub, NULL, ctx);
+    buf[VRF_OUTPUT_SUITE_OFFSET] = PRAOS_VRF_SUITE_LEGACY;
+    ret2 = ret2 && verify_vrf_bytes(group, seed, buf, kp.pub, NULL, ctx) && verify_vrf_bytes(group, seed, buf, kp.pub, &sswu, ctx);
+    if (print) {
+        if (ret2) {
+            printf("    OK Test 5 - 2: VRF outputs of the other suite not accepted (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 5 - 2: VRF output of the other suite IS accepted (which is an ERROR)\n");
+        }
+    }
+
+    // cleanup
+    nizk_dl_eq_proof_free(&pi_sswu);
+    point_free(u_sswu);
+    bn_free(randval_sswu);
+    nizk_dl_eq_proof_free(&pi);
+    point_free(u);
+    bn_free(randval);
+    bn_free(seed);
+    key_pair_free(&kp);
+    p256_arena_free(arena);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 != 0);
+}
+
+// two-phase evaluation: same u and randval as prove_vrf under both suites, proofs verify, none for ineligible outputs
+static int praos_vrf_test_6(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    key_pair kp;
+    key_pair_generate(group, &kp, ctx);
+    const praos_vrf_params params[] = { { PRAOS_VRF_SUITE_LEGACY, NULL, NULL }, { PRAOS_VRF_SUITE_P256_SSWU, NULL, NULL } };
+    BIGNUM *threshold = bn_new();
+    BN_set_bit(threshold, 255); // about half of the outputs eligible
+    int ret1 = 0;
+    int ret2 = 0;
+    int num_eligible = 0;
+    for (int s=0; s<2; s++) {
+        for (int i=0; i<8; i++) {
+            BIGNUM *seed = bn_random(get0_order(group), ctx);
+            BIGNUM *randval;
+            EC_POINT *u = point_new(group);
+            nizk_dl_eq_proof pi;
+            prove_vrf(group, seed, &randval, u, &pi, &kp, &params[s], ctx);
+            vrf_eval eval;
+            vrf_evaluate(group, seed, &kp, &eval, &params[s], ctx);
+            ret1 |= BN_cmp(randval, eval.randval) != 0 || point_cmp(group, u, eval.u, ctx) != 0;
+
+            nizk_dl_eq_proof pi_eval;
+            int eligible = BN_cmp(eval.randval, threshold) < 0;
+            int proven = vrf_prove_from_eval(group, &eval, &kp, vrf_randval_below, threshold, &pi_eval, ctx);
+            ret2 |= proven != eligible;
+            if (proven) {
+                num_eligible++;
+                ret2 |= verify_vrf(group, seed, eval.randval, eval.u, &pi_eval, kp.pub, &params[s], ctx);
+                nizk_dl_eq_proof_free(&pi_eval);
+            }
+            // unconditional proof
+            ret2 |= vrf_prove_from_eval(group, &eval, &kp, NULL, NULL, &pi_eval, ctx) != 1 ||
+                    verify_vrf(group, seed, eval.randval, eval.u, &pi_eval, kp.pub, &params[s], ctx);
+            nizk_dl_eq_proof_free(&pi_eval);
+
+            vrf_eval_free(&eval);
+            nizk_dl_eq_proof_free(&pi);
+            point_free(u);
+            bn_free(randval);
+            bn_free(seed);
+        }
+    }
+    if (print) {
+        printf("%6s Test 6 - 1: Evaluated VRF outputs %s the ones of prove_vrf\n", ret1 ? "NOT OK" : "OK", ret1 ? "do NOT match" : "match");
+        printf("%6s Test 6 - 2: Proofs from evaluations (%d of 16 eligible) %s\n", ret2 ? "NOT OK" : "OK", num_eligible, ret2 ? "NOT correct" : "made exactly when eligible, accepted");
+    }
+
+    // cleanup
+    bn_free(threshold);
+    key_pair_free(&kp);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return ret1 || ret2;
+}
+
+typedef int (*test_function)(int);
+
+static test_function test_suite[] = {
+    &praos_vrf_test_1,
+    &praos_vrf_test_2,
+    &praos_vrf_test_3,
+    &praos_vrf_test_4,
+    &praos_vrf_test_5,
+    &praos_vrf_test_6
+};
+
+int praos_vrf_test_suite(int print) {
+    if (print) {
+        printf("Praos VRF test suite BEGIN --------------------------\n");
+    }
+    int num_tests = sizeof(test_suite)/sizeof(test_function);
+    int ret = 0;
+    for (int i=0; i<num_tests; i++) {
+        if (test_suite[i](print)) {
+            ret = 1;
+        }
+    }
+    if (print) {
+        printf("Praos VRF test suite END ----------------------------\n");
+#ifdef DEBUG
+        print_allocation_status();
+        nizk_dl_eq_print_allocation_status();
+#endif
+        fflush(stdout);
+    }
+    return ret;
+}
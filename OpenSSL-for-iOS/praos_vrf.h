@@ -8,14 +8,83 @@
 
 #include "P256.h"
 #include "nizk_dl_eq.h"
+#include "seed_cache.h"
+#include "verify_cache.h"
 
 typedef struct {
     BIGNUM *priv;
     EC_POINT *pub;
 } key_pair;
 
+// how the seed is mapped to the base point of u = H'(seed)^k, both prover and verifier have to use the same suite
+typedef enum {
+    PRAOS_VRF_SUITE_LEGACY = 0,     // G^H'(seed), a point with known discrete log
+    PRAOS_VRF_SUITE_P256_SSWU = 1   // RFC 9380 hash_to_curve (P256_XMD:SHA-256_SSWU_RO_) of the 32-byte seed
+} praos_vrf_suite;
+#define PRAOS_VRF_SSWU_DST "PRAOS-VRF-V01-P256_XMD:SHA-256_SSWU_RO_"
+#define PRAOS_VRF_NUM_SUITES 2
+
+// parameters of a VRF call, params NULL stands for the defaults: legacy suite, the process wide get0_seed_cache()
+// and no verify cache (pass params with a NULL seed_cache to derive the seed points on every call)
+typedef struct {
+    praos_vrf_suite suite;
+    seed_cache *seed_cache;     // seed points of the verifiers, NULL to derive them each time
+    verify_cache *verify_cache; // verified outputs consulted and filled by the verifiers, NULL for none
+} praos_vrf_params;
+
+// r = H'(seed) as a point under suite
+void vrf_hash_seed_r(const EC_GROUP *group, EC_POINT *r, const BIGNUM *seed, praos_vrf_suite suite, BN_CTX *ctx);
+
 void key_pair_free(key_pair *kp);
 void key_pair_generate(const EC_GROUP *group, key_pair *kp, BN_CTX *ctx);
-void prove_vrf(const EC_GROUP *group, BIGNUM *seed, BIGNUM **randval, EC_POINT *u, nizk_dl_eq_proof *pi,  key_pair *kp, BN_CTX *ctx);
-int verify_vrf(const EC_GROUP *group, BIGNUM *seed, BIGNUM *randval, EC_POINT *u, nizk_dl_eq_proof *pi, EC_POINT *pub_key, BN_CTX *ctx);
+void prove_vrf(const EC_GROUP *group, BIGNUM *seed, BIGNUM **randval, EC_POINT *u, nizk_dl_eq_proof *pi,  key_pair *kp, const praos_vrf_params *params, BN_CTX *ctx);
+int verify_vrf(const EC_GROUP *group, BIGNUM *seed, BIGNUM *randval, EC_POINT *u, nizk_dl_eq_proof *pi, EC_POINT *pub_key, const praos_vrf_params *params, BN_CTX *ctx);
+
+// prove_vrf in two phases: vrf_evaluate computes u and randval (as prove_vrf) and keeps what the proof needs,
+// vrf_prove_from_eval adds the proof only if the output is eligible, e.g. wins the slot
+typedef struct {
+    EC_POINT *u;
+    BIGNUM *randval;
+    BIGNUM *hash_seed;         // legacy suite until proven: H'(seed) = G^hash_seed, u = G^(k * hash_seed); else NULL
+    EC_POINT *hash_seed_point; // H'(seed), set under the legacy suite by vrf_prove_from_eval
+    praos_vrf_suite suite;
+} vrf_eval;
+// returns non-zero if a proof is to be made for randval
+typedef int (*vrf_eligibility)(const BIGNUM *randval, void *arg);
+// eligibility for randval < *(const BIGNUM *)threshold
+int vrf_randval_below(const BIGNUM *randval, void *threshold);
+// allocates the fields of eval (freed by vrf_eval_free)
+void vrf_evaluate(const EC_GROUP *group, const BIGNUM *seed, const key_pair *kp, vrf_eval *eval, const praos_vrf_params *params, BN_CTX *ctx);
+// proof for eval if eligible is NULL or eligible(eval->randval, arg), returns 1 if pi was made (free with
+// nizk_dl_eq_proof_free), 0 otherwise (pi untouched); eval and kp have to be the ones of vrf_evaluate
+int vrf_prove_from_eval(const EC_GROUP *group, vrf_eval *eval, const key_pair *kp, vrf_eligibility eligible, void *arg, nizk_dl_eq_proof *pi, BN_CTX *ctx);
+void vrf_eval_free(vrf_eval *eval);
+
+// arena sizes that cover prove_vrf_arena and verify_vrf_arena
+#define PRAOS_VRF_ARENA_BNS 4
+#define PRAOS_VRF_ARENA_POINTS 4
+// as prove_vrf and verify_vrf, with all scratch values taken from arena: no allocation once the arena has
+// grown to size, randval and u are allocated and pi initialized (nizk_dl_eq_proof_init) by the caller
+void prove_vrf_arena(const EC_GROUP *group, BIGNUM *seed, BIGNUM *randval, EC_POINT *u, nizk_dl_eq_proof *pi, key_pair *kp, const praos_vrf_params *params, p256_arena *arena);
+int verify_vrf_arena(const EC_GROUP *group, BIGNUM *seed, BIGNUM *randval, EC_POINT *u, nizk_dl_eq_proof *pi, EC_POINT *pub_key, const praos_vrf_params *params, p256_arena *arena);
+// verify against the registered key key_index instead of an arbitrary public key
+int verify_vrf_registered(const EC_GROUP *group, BIGNUM *seed, BIGNUM *randval, EC_POINT *u, nizk_dl_eq_proof *pi, pubkey_registry *reg, int key_index, const praos_vrf_params *params, BN_CTX *ctx);
+// verify num_proofs VRF outputs at once, seed points are computed once per distinct seed,
+// returns 0 if all verify, otherwise 1 and (if bad_index is non-NULL) the index of the first bad proof
+int verify_vrf_batch(const EC_GROUP *group, int num_proofs, BIGNUM **seed, BIGNUM **randval, EC_POINT **u, nizk_dl_eq_proof *pi, EC_POINT **pub_key, int *bad_index, const praos_vrf_params *params, BN_CTX *ctx);
+
+// fixed-size VRF output encoding u || Ra || Rb || z || randval || suite (randval is a SHA-256 digest, suite one byte)
+#define VRF_OUTPUT_RANDVAL_OFFSET (P256_POINT_BYTES + NIZK_DL_EQ_PROOF_BYTES)
+#define VRF_OUTPUT_SUITE_OFFSET (VRF_OUTPUT_RANDVAL_OFFSET + 32)
+#define VRF_OUTPUT_BYTES (VRF_OUTPUT_SUITE_OFFSET + 1)
+// write (u, pi, randval) made under suite to buf (VRF_OUTPUT_BYTES), returns 0 on success
+int vrf_output_to_bytes(const EC_GROUP *group, const EC_POINT *u, const nizk_dl_eq_proof *pi, const BIGNUM *randval, praos_vrf_suite suite, unsigned char *buf, BN_CTX *ctx);
+// read (u, pi, randval) and the suite (if suite is non-NULL) from buf, returns 0 on success (pi and randval are only
+// allocated on success)
+int vrf_output_from_bytes(const EC_GROUP *group, const unsigned char *buf, EC_POINT *u, nizk_dl_eq_proof *pi, BIGNUM **randval, praos_vrf_suite *suite, BN_CTX *ctx);
+// verify an encoded VRF output in place (as verify_vrf), only u is decoded; outputs of another suite than the one
+// of params do not verify
+int verify_vrf_bytes(const EC_GROUP *group, BIGNUM *seed, const unsigned char *output, EC_POINT *pub_key, const praos_vrf_params *params, BN_CTX *ctx);
+
+int praos_vrf_test_suite(int print);
 #endif /* DH_KEY_PAIR_H */
@@ -0,0 +1,596 @@
+//
+//  pubkey_registry.c
+//  OpenSSL-for-iOS
+//
+#include "pubkey_registry.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <openssl/sha.h>
+#include "config_platform.h"
+#include "vrf_metrics.h"
+#if PLATFORM_TYPE != PLATFORM_TYPE_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * File format (all integers little endian)
+ *   magic "P256PKR1" | uint32 num_keys | uint32 record size | num_keys records
+ * where each record is the uncompressed SEC1 encoding (0x04 || x || y) of a validated key.
+ *
+ * libcrypto does not expose its precomputation tables, so the file holds the validated affine keys
+ * and the per-key tables are rebuilt when the registry is loaded.
+ */
+#define PUBKEY_REGISTRY_MAGIC "P256PKR1"
+#define PUBKEY_REGISTRY_MAGIC_SIZE 8
+#define PUBKEY_REGISTRY_HEADER_SIZE 16
+#define PUBKEY_REGISTRY_RECORD_SIZE 65
+
+struct pubkey_registry {
+    const EC_GROUP *group;
+    int num_keys;
+    int capacity;
+    const unsigned char *records; // mapped file records or records_buf
+    unsigned char *records_buf; // heap records, used once keys are added
+    void *map; // mapped file (NULL if none)
+    size_t map_len;
+    EC_POINT **pub; // decoded keys
+    EC_GROUP **table; // copy of the group with the key as generator and a fixed-base table
+};
+
+static void put_uint32_le(unsigned char *buf, uint32_t v) {
+    for (int i=0; i<4; i++) {
+        buf[i] = (unsigned char)(v >> (8 * i));
+    }
+}
+
+static uint32_t get_uint32_le(const unsigned char *buf) {
+    uint32_t v = 0;
+    for (int i=0; i<4; i++) {
+        v |= (uint32_t)buf[i] << (8 * i);
+    }
+    return v;
+}
+
+pubkey_registry *pubkey_registry_new(const EC_GROUP *group) {
+    pubkey_registry *reg = calloc(1, sizeof(pubkey_registry));
+    assert(reg && "pubkey_registry_new: allocation error");
+    reg->group = group;
+    return reg;
+}
+
+void pubkey_registry_free(pubkey_registry *reg) {
+    for (int i=0; i<reg->num_keys; i++) {
+        if (reg->pub[i]) {
+            point_free(reg->pub[i]);
+        }
+        EC_GROUP_free(reg->table[i]);
+    }
+    free(reg->pub);
+    free(reg->table);
+    free(reg->records_buf);
+#if PLATFORM_TYPE != PLATFORM_TYPE_WINDOWS
+    if (reg->map) {
+        munmap(reg->map, reg->map_len);
+    }
+#endif
+    free(reg);
+}
+
+// make room for num_keys keys, moving records to the heap if they are mapped
+static void pubkey_registry_reserve(pubkey_registry *reg, int num_keys) {
+    if (num_keys <= reg->capacity && reg->records == reg->records_buf) {
+        return;
+    }
+    int capacity = reg->capacity > 0 ? reg->capacity : 16;
+    while (capacity < num_keys) {
+        capacity *= 2;
+    }
+    unsigned char *records_buf = malloc((size_t)capacity * PUBKEY_REGISTRY_RECORD_SIZE);
+    EC_POINT **pub = realloc(reg->pub, capacity * sizeof(EC_POINT*));
+    EC_GROUP **table = realloc(reg->table, capacity * sizeof(EC_GROUP*));
+    assert(records_buf && pub && table && "pubkey_registry_reserve: allocation error");
+    if (reg->num_keys > 0) {
+        memcpy(records_buf, reg->records, (size_t)reg->num_keys * PUBKEY_REGISTRY_RECORD_SIZE);
+    }
+    free(reg->records_buf);
+    reg->records_buf = records_buf;
+    reg->records = records_buf;
+    reg->pub = pub;
+    reg->table = table;
+    reg->capacity = capacity;
+}
+
+int pubkey_registry_num_keys(const pubkey_registry *reg) {
+    return reg->num_keys;
+}
+
+const EC_POINT *pubkey_registry_get0_pub(const pubkey_registry *reg, int key_index) {
+    assert(key_index >= 0 && key_index < reg->num_keys && "pubkey_registry_get0_pub: usage error, no such key");
+    return reg->pub[key_index];
+}
+
+void pubkey_registry_get_pub_bytes(const pubkey_registry *reg, int key_index, unsigned char *buf) {
+    assert(key_index >= 0 && key_index < reg->num_keys && "pubkey_registry_get_pub_bytes: usage error, no such key");
+    // record 0x04 || x || y, compressed 0x02 | parity(y) || x
+    const unsigned char *record = reg->records + (size_t)key_index * PUBKEY_REGISTRY_RECORD_SIZE;
+    buf[0] = 0x02 | (record[PUBKEY_REGISTRY_RECORD_SIZE - 1] & 1);
+    memcpy(buf + 1, record + 1, P256_POINT_BYTES - 1);
+}
+
+// group with the decoded key key_index as generator, so that EC_POINT_mul uses a fixed-base table for the key
+static void pubkey_registry_build_table(pubkey_registry *reg, int key_index, BN_CTX *ctx) {
+    EC_GROUP *table = EC_GROUP_dup(reg->group);
+    assert(table && "pubkey_registry_build_table: EC_GROUP_dup failed");
+    int ret = EC_GROUP_set_generator(table, reg->pub[key_index], get0_order(reg->group), EC_GROUP_get0_cofactor(reg->group));
+    assert(ret == 1 && "pubkey_registry_build_table: EC_GROUP_set_generator failed");
+    ret = EC_GROUP_precompute_mult(table, ctx);
+    assert(ret == 1 && "pubkey_registry_build_table: EC_GROUP_precompute_mult failed");
+    reg->table[key_index] = table;
+}
+
+// returns 0 if pub is on the curve, in the prime order subgroup and not the point at infinity, 1 otherwise
+static int pubkey_registry_check(const EC_GROUP *group, const EC_POINT *pub, BN_CTX *ctx) {
+    if (EC_POINT_is_at_infinity(group, pub) || EC_POINT_is_on_curve(group, pub, ctx) != 1) {
+        return 1;
+    }
+    const BIGNUM *cofactor = EC_GROUP_get0_cofactor(group);
+    if (cofactor && !BN_is_one(cofactor)) { // P-256 has cofactor 1, every point on the curve is in the subgroup
+        EC_POINT *t = point_new(group);
+        point_mul(group, t, get0_order(group), pub, ctx);
+        int in_subgroup = EC_POINT_is_at_infinity(group, t);
+        point_free(t);
+        if (!in_subgroup) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int pubkey_registry_add(pubkey_registry *reg, const EC_POINT *pub, BN_CTX *ctx) {
+    const EC_GROUP *group = reg->group;
+
+    // validate once here instead of on every verification
+    if (pubkey_registry_check(group, pub, ctx)) {
+        return -1;
+    }
+
+    pubkey_registry_reserve(reg, reg->num_keys + 1);
+    int key_index = reg->num_keys;
+    size_t len = EC_POINT_point2oct(group, pub, POINT_CONVERSION_UNCOMPRESSED, reg->records_buf + (size_t)key_index * PUBKEY_REGISTRY_RECORD_SIZE, PUBKEY_REGISTRY_RECORD_SIZE, ctx);
+    assert(len == PUBKEY_REGISTRY_RECORD_SIZE && "pubkey_registry_add: unexpected encoding length");
+    reg->pub[key_index] = point_new(group);
+    int ret = EC_POINT_copy(reg->pub[key_index], pub);
+    assert(ret == 1 && "pubkey_registry_add: EC_POINT_copy failed");
+    // the table is built here, the verifiers only read it
+    pubkey_registry_build_table(reg, key_index, ctx);
+    reg->num_keys++;
+    return key_index;
+}
+
+void pubkey_registry_mul(const pubkey_registry *reg, EC_POINT *r, const BIGNUM *g_scalar, int key_index, const BIGNUM *bn, BN_CTX *ctx) {
+    assert(key_index >= 0 && key_index < reg->num_keys && "pubkey_registry_mul: usage error, no such key");
+    const EC_GROUP *table = reg->table[key_index];
+    VRF_METRICS_COUNT(VRF_METRICS_BASE_MUL, 1);
+    int ret = EC_POINT_mul(table, r, bn, NULL, NULL, ctx);
+    assert(ret == 1 && "pubkey_registry_mul: EC_POINT_mul failed");
+    if (g_scalar) {
+        EC_POINT *t = bn2point(reg->group, g_scalar, ctx);
+        point_add(reg->group, r, r, t, ctx);
+        point_free(t);
+    }
+}
+
+int pubkey_registry_ecdsa_verify(const pubkey_registry *reg, int key_index, const unsigned char *dgst, int dgst_len, const ECDSA_SIG *sig, BN_CTX *ctx) {
+    const EC_GROUP *group = reg->group;
+    const BIGNUM *order = get0_order(group);
+    const BIGNUM *sig_r, *sig_s;
+    ECDSA_SIG_get0(sig, &sig_r, &sig_s);
+    if (BN_is_zero(sig_r) || BN_is_negative(sig_r) || BN_cmp(sig_r, order) >= 0 ||
+        BN_is_zero(sig_s) || BN_is_negative(sig_s) || BN_cmp(sig_s, order) >= 0) {
+        return 1; // verification failed
+    }
+
+    // e = leftmost bits of the digest
+    BIGNUM *e = bn_from_binary_data(dgst_len, dgst);
+    int order_bits = BN_num_bits(order);
+    if (8 * dgst_len > order_bits) {
+        BN_rshift(e, e, 8 * dgst_len - order_bits);
+    }
+
+    // X = [e/s]G + [r/s]pub
+    BIGNUM *w = bn_new();
+    BIGNUM *u1 = bn_new();
+    BIGNUM *u2 = bn_new();
+    int ret = BN_mod_inverse(w, sig_s, order, ctx) != NULL;
+    assert(ret == 1 && "pubkey_registry_ecdsa_verify: BN_mod_inverse failed");
+    ret = BN_mod_mul(u1, e, w, order, ctx);
+    assert(ret == 1 && "pubkey_registry_ecdsa_verify: BN_mod_mul failed");
+    ret = BN_mod_mul(u2, sig_r, w, order, ctx);
+    assert(ret == 1 && "pubkey_registry_ecdsa_verify: BN_mod_mul failed");
+    EC_POINT *X = point_new(group);
+    pubkey_registry_mul(reg, X, u1, key_index, u2, ctx);
+
+    // check r = x(X) mod order
+    ret = 1;
+    if (!EC_POINT_is_at_infinity(group, X)) {
+        BIGNUM *x = bn_new();
+        EC_POINT_get_affine_coordinates_GFp(group, X, x, NULL, ctx);
+        BN_nnmod(x, x, order, ctx);
+        ret = BN_cmp(x, sig_r) != 0;
+        bn_free(x);
+    }
+
+    // cleanup
+    point_free(X);
+    bn_free(u2);
+    bn_free(u1);
+    bn_free(w);
+    bn_free(e);
+
+    return ret; // 0 if the signature is valid
+}
+
+int pubkey_registry_save(const pubkey_registry *reg, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return 1;
+    }
+    unsigned char header[PUBKEY_REGISTRY_HEADER_SIZE];
+    memcpy(header, PUBKEY_REGISTRY_MAGIC, PUBKEY_REGISTRY_MAGIC_SIZE);
+    put_uint32_le(header + 8, (uint32_t)reg->num_keys);
+    put_uint32_le(header + 12, PUBKEY_REGISTRY_RECORD_SIZE);
+    size_t records_len = (size_t)reg->num_keys * PUBKEY_REGISTRY_RECORD_SIZE;
+    int ret = fwrite(header, 1, sizeof(header), f) != sizeof(header);
+    if (!ret && records_len > 0) {
+        ret = fwrite(reg->records, 1, records_len, f) != records_len;
+    }
+    ret |= fclose(f) != 0;
+    return ret;
+}
+
+pubkey_registry *pubkey_registry_load(const EC_GROUP *group, const char *path) {
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+    // no mmap, read the whole file
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long file_len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (file_len < PUBKEY_REGISTRY_HEADER_SIZE) {
+        fclose(f);
+        return NULL;
+    }
+    unsigned char *data = malloc(file_len);
+    assert(data && "pubkey_registry_load: allocation error");
+    size_t len = fread(data, 1, file_len, f);
+    fclose(f);
+    if (len != (size_t)file_len) {
+        free(data);
+        return NULL;
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < PUBKEY_REGISTRY_HEADER_SIZE) {
+        close(fd);
+        return NULL;
+    }
+    size_t len = (size_t)st.st_size;
+    void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+    const unsigned char *data = map;
+#endif
+
+    uint32_t num_keys = get_uint32_le(data + 8);
+    uint32_t record_size = get_uint32_le(data + 12);
+    int valid = memcmp(data, PUBKEY_REGISTRY_MAGIC, PUBKEY_REGISTRY_MAGIC_SIZE) == 0 &&
+                record_size == PUBKEY_REGISTRY_RECORD_SIZE &&
+                num_keys <= (uint32_t)(INT32_MAX / 2) &&
+                len == PUBKEY_REGISTRY_HEADER_SIZE + (size_t)num_keys * PUBKEY_REGISTRY_RECORD_SIZE;
+    if (!valid) {
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+        free(data);
+#else
+        munmap(map, len);
+#endif
+        return NULL;
+    }
+
+    // keys are decoded, validated and get their tables now
+    pubkey_registry *reg = pubkey_registry_new(group);
+    reg->num_keys = (int)num_keys;
+    reg->capacity = (int)num_keys;
+    reg->records = data + PUBKEY_REGISTRY_HEADER_SIZE;
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+    reg->records_buf = data; // header included, moved on the first pubkey_registry_add
+#else
+    reg->map = map;
+    reg->map_len = len;
+#endif
+    reg->pub = calloc(num_keys > 0 ? num_keys : 1, sizeof(EC_POINT*));
+    reg->table = calloc(num_keys > 0 ? num_keys : 1, sizeof(EC_GROUP*));
+    assert(reg->pub && reg->table && "pubkey_registry_load: allocation error");
+    BN_CTX *ctx = BN_CTX_new();
+    for (int i=0; i<reg->num_keys; i++) {
+        const unsigned char *record = reg->records + (size_t)i * PUBKEY_REGISTRY_RECORD_SIZE;
+        reg->pub[i] = point_new(group);
+        if (record[0] != 0x04 || EC_POINT_oct2point(group, reg->pub[i], record, PUBKEY_REGISTRY_RECORD_SIZE, ctx) != 1 ||
+            pubkey_registry_check(group, reg->pub[i], ctx)) {
+            BN_CTX_free(ctx);
+            pubkey_registry_free(reg);
+            return NULL;
+        }
+        pubkey_registry_build_table(reg, i, ctx);
+    }
+    BN_CTX_free(ctx);
+    return reg;
+}
+
+/*
+ *
+ *  pubkey_registry tests
+ *
+ */
+static int pubkey_registry_test_1(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    const int num_keys = 3;
+    pubkey_registry *reg = pubkey_registry_new(group);
+
+    BIGNUM *priv[num_keys];
+    EC_POINT *pub[num_keys];
+    int index_ok = 1;
+    for (int i=0; i<num_keys; i++) {
+        priv[i] = bn_random(get0_order(group), ctx);
+        pub[i] = bn2point(group, priv[i], ctx);
+        index_ok &= pubkey_registry_add(reg, pub[i], ctx) == i;
+    }
+
+    // [k]pub through the registry matches [k]pub
+    BIGNUM *k = bn_random(get0_order(group), ctx);
+    BIGNUM *g_scalar = bn_random(get0_order(group), ctx);
+    EC_POINT *r = point_new(group);
+    EC_POINT *expected = point_new(group);
+    point_mul(group, expected, k, pub[2], ctx);
+    pubkey_registry_mul(reg, r, NULL, 2, k, ctx);
+    int ret1 = !index_ok || point_cmp(group, r, expected, ctx);
+    if (print) {
+        printf("%6s Test 1 - 1: Registered keys multiplied %s correctly\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // the point at infinity is rejected
+    EC_POINT *infinity = point_new(group);
+    EC_POINT_set_to_infinity(group, infinity);
+    int ret2 = pubkey_registry_add(reg, infinity, ctx);
+    if (print) {
+        if (ret2 < 0) {
+            printf("    OK Test 1 - 2: Invalid key not registered (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 1 - 2: Invalid key IS registered (which is an ERROR)\n");
+        }
+    }
+
+    // saved and loaded registry gives the same results
+    const char *tmpdir = getenv("TMPDIR");
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/pubkey_registry_test.bin", tmpdir ? tmpdir : "/tmp");
+    int ret3 = pubkey_registry_save(reg, path);
+    pubkey_registry *loaded = ret3 ? NULL : pubkey_registry_load(group, path);
+    ret3 = !loaded || pubkey_registry_num_keys(loaded) != num_keys;
+    if (!ret3) {
+        bn_free(g_scalar);
+        g_scalar = bn_random(get0_order(group), ctx);
+        point_mul(group, expected, k, pub[1], ctx);
+        EC_POINT *t = bn2point(group, g_scalar, ctx);
+        point_add(group, expected, expected, t, ctx);
+        point_free(t);
+        pubkey_registry_mul(loaded, r, g_scalar, 1, k, ctx);
+        ret3 = point_cmp(group, r, expected, ctx) || point_cmp(group, pubkey_registry_get0_pub(loaded, 0), pub[0], ctx);
+        pubkey_registry_free(loaded);
+    }
+    if (print) {
+        printf("%6s Test 1 - 3: Saved registry %s loaded correctly\n", ret3 ? "NOT OK" : "OK", ret3 ? "NOT" : "indeed");
+    }
+
+    // negative test, a record off the curve fails the load
+    int ret4 = 1;
+    FILE *f = fopen(path, "r+b");
+    if (f) {
+        long offset = PUBKEY_REGISTRY_HEADER_SIZE + 2 * PUBKEY_REGISTRY_RECORD_SIZE - 1; // last byte of y of key 1
+        int c = fseek(f, offset, SEEK_SET) == 0 ? fgetc(f) : EOF;
+        ret4 = c == EOF || fseek(f, offset, SEEK_SET) != 0 || fputc(c ^ 0x01, f) == EOF;
+        ret4 |= fclose(f) != 0;
+    }
+    loaded = ret4 ? NULL : pubkey_registry_load(group, path);
+    ret4 |= loaded != NULL;
+    if (loaded) {
+        pubkey_registry_free(loaded);
+    }
+    remove(path);
+    if (print) {
+        if (!ret4) {
+            printf("    OK Test 1 - 4: Corrupt registry file not loaded (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 1 - 4: Corrupt registry file IS loaded (which is an ERROR)\n");
+        }
+    }
+
+    // cleanup
+    for (int i=0; i<num_keys; i++) {
+        bn_free(priv[i]);
+        point_free(pub[i]);
+    }
+    point_free(infinity);
+    point_free(expected);
+    point_free(r);
+    bn_free(g_scalar);
+    bn_free(k);
+    pubkey_registry_free(reg);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 < 0 && ret3 == 0 && ret4 == 0);
+}
+
+static int pubkey_registry_test_2(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    pubkey_registry *reg = pubkey_registry_new(group);
+
+    EC_KEY *ec_key = EC_KEY_new();
+    EC_KEY_set_group(ec_key, group);
+    EC_KEY_generate_key(ec_key);
+    int key_index = pubkey_registry_add(reg, EC_KEY_get0_public_key(ec_key), ctx);
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    SHA256((const unsigned char *)"Hello, ECDSA!", 13, digest);
+    ECDSA_SIG *sig = ECDSA_do_sign(digest, sizeof(digest), ec_key);
+
+    // correct signature
+    int ret1 = pubkey_registry_ecdsa_verify(reg, key_index, digest, sizeof(digest), sig, ctx);
+    if (print) {
+        printf("%6s Test 2 - 1: Correct ECDSA signature %s accepted\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // negative test, other message
+    digest[0] ^= 1;
+    int ret2 = pubkey_registry_ecdsa_verify(reg, key_index, digest, sizeof(digest), sig, ctx);
+    if (print) {
+        if (ret2) {
+            printf("    OK Test 2 - 2: Incorrect ECDSA signature not accepted (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 2 - 2: Incorrect ECDSA signature IS accepted (which is an ERROR)\n");
+        }
+    }
+
+    // cleanup
+    ECDSA_SIG_free(sig);
+    EC_KEY_free(ec_key);
+    pubkey_registry_free(reg);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 != 0);
+}
+
+#define PUBKEY_REGISTRY_TEST_THREADS 4
+#define PUBKEY_REGISTRY_TEST_KEYS 8
+
+typedef struct {
+    const pubkey_registry *reg;
+    const BIGNUM *k;
+    EC_POINT **expected; // [k]pub of every key
+    int failed;
+} pubkey_registry_test_worker;
+
+static void *pubkey_registry_test_run(void *arg) {
+    pubkey_registry_test_worker *worker = arg;
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    EC_POINT *r = point_new(group);
+    for (int rep=0; rep<4; rep++) {
+        for (int i=0; i<PUBKEY_REGISTRY_TEST_KEYS; i++) {
+            pubkey_registry_mul(worker->reg, r, NULL, i, worker->k, ctx);
+            worker->failed |= point_cmp(group, r, worker->expected[i], ctx) != 0;
+        }
+    }
+    point_free(r);
+    BN_CTX_free(ctx);
+    return NULL;
+}
+
+// a loaded registry used by several threads at once, every key already has its table
+static int pubkey_registry_test_3(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    pubkey_registry *reg = pubkey_registry_new(group);
+    BIGNUM *k = bn_random(get0_order(group), ctx);
+    EC_POINT *expected[PUBKEY_REGISTRY_TEST_KEYS];
+    for (int i=0; i<PUBKEY_REGISTRY_TEST_KEYS; i++) {
+        BIGNUM *priv = bn_random(get0_order(group), ctx);
+        EC_POINT *pub = bn2point(group, priv, ctx);
+        pubkey_registry_add(reg, pub, ctx);
+        expected[i] = point_new(group);
+        point_mul(group, expected[i], k, pub, ctx);
+        point_free(pub);
+        bn_free(priv);
+    }
+    const char *tmpdir = getenv("TMPDIR");
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/pubkey_registry_test.bin", tmpdir ? tmpdir : "/tmp");
+    int ret1 = pubkey_registry_save(reg, path);
+    pubkey_registry *loaded = ret1 ? NULL : pubkey_registry_load(group, path);
+    ret1 = !loaded;
+    if (!ret1) {
+        pthread_t threads[PUBKEY_REGISTRY_TEST_THREADS];
+        pubkey_registry_test_worker workers[PUBKEY_REGISTRY_TEST_THREADS];
+        for (int t=0; t<PUBKEY_REGISTRY_TEST_THREADS; t++) {
+            workers[t] = (pubkey_registry_test_worker){ loaded, k, expected, 0 };
+            int ret = pthread_create(&threads[t], NULL, pubkey_registry_test_run, &workers[t]);
+            assert(ret == 0 && "pubkey_registry_test_3: pthread_create failed");
+        }
+        for (int t=0; t<PUBKEY_REGISTRY_TEST_THREADS; t++) {
+            pthread_join(threads[t], NULL);
+            ret1 |= workers[t].failed;
+        }
+        pubkey_registry_free(loaded);
+    }
+    if (print) {
+        printf("%6s Test 3 - 1: Loaded registry %s on %d threads at once\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT used correctly" : "used correctly", PUBKEY_REGISTRY_TEST_THREADS);
+    }
+
+    // cleanup
+    remove(path);
+    for (int i=0; i<PUBKEY_REGISTRY_TEST_KEYS; i++) {
+        point_free(expected[i]);
+    }
+    bn_free(k);
+    pubkey_registry_free(reg);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return ret1;
+}
+
+typedef int (*test_function)(int);
+
+static test_function test_suite[] = {
+    &pubkey_registry_test_1,
+    &pubkey_registry_test_2,
+    &pubkey_registry_test_3
+};
+
+int pubkey_registry_test_suite(int print) {
+    if (print) {
+        printf("Public key registry test suite BEGIN ----------------\n");
+    }
+    int num_tests = sizeof(test_suite)/sizeof(test_function);
+    int ret = 0;
+    for (int i=0; i<num_tests; i++) {
+        if (test_suite[i](print)) {
+            ret = 1;
+        }
+    }
+    if (print) {
+        printf("Public key registry test suite END ------------------\n");
+#ifdef DEBUG
+        print_allocation_status();
+#endif
+        fflush(stdout);
+    }
+    return ret;
+}
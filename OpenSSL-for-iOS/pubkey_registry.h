@@ -0,0 +1,55 @@
+//
+//  pubkey_registry.h
+//  OpenSSL-for-iOS
+//
+//  Registry of long-lived public keys (e.g. stake pool keys), validated once at registration
+//  and carrying a per-key fixed-base table so that [k]pub costs about as much as [k]G.
+//
+//  Keys are decoded and their tables built when they are added or loaded, the getters, pubkey_registry_mul and
+//  the verifiers only read the registry and may run on any number of threads at once. pubkey_registry_add must
+//  not run concurrently with them.
+//
+//  The file holds the validated keys only (libcrypto cannot export its tables): loading decodes every key and
+//  rebuilds every table, a restart costs O(num_keys) decompressions and table builds rather than a plain mapping.
+//
+
+#ifndef PUBKEY_REGISTRY_H
+#define PUBKEY_REGISTRY_H
+#include <openssl/ecdsa.h>
+#include "P256.h"
+
+typedef struct pubkey_registry pubkey_registry;
+
+// new empty registry
+pubkey_registry *pubkey_registry_new(const EC_GROUP *group);
+
+// load registry from file written by pubkey_registry_save, the file is memory mapped and every key is
+// decoded, validated and gets its table as by pubkey_registry_add (returns NULL on error or if any record is not
+// a valid key)
+pubkey_registry *pubkey_registry_load(const EC_GROUP *group, const char *path);
+
+// write all registered keys to file, returns 0 on success
+int pubkey_registry_save(const pubkey_registry *reg, const char *path);
+
+void pubkey_registry_free(pubkey_registry *reg);
+
+// validate (on curve, in prime order subgroup) and register pub, returns the key index or -1 if pub is rejected
+int pubkey_registry_add(pubkey_registry *reg, const EC_POINT *pub, BN_CTX *ctx);
+
+int pubkey_registry_num_keys(const pubkey_registry *reg);
+
+// registered public key (owned by the registry)
+const EC_POINT *pubkey_registry_get0_pub(const pubkey_registry *reg, int key_index);
+
+// compressed encoding (P256_POINT_BYTES) of the registered key, taken from its stored record without decoding it
+void pubkey_registry_get_pub_bytes(const pubkey_registry *reg, int key_index, unsigned char *buf);
+
+// r = [g_scalar]G + [bn]pub (g_scalar may be NULL), both multiplications use fixed-base tables
+void pubkey_registry_mul(const pubkey_registry *reg, EC_POINT *r, const BIGNUM *g_scalar, int key_index, const BIGNUM *bn, BN_CTX *ctx);
+
+// ECDSA verification against a registered key, returns 0 if the signature is valid
+int pubkey_registry_ecdsa_verify(const pubkey_registry *reg, int key_index, const unsigned char *dgst, int dgst_len, const ECDSA_SIG *sig, BN_CTX *ctx);
+
+int pubkey_registry_test_suite(int print);
+
+#endif /* PUBKEY_REGISTRY_H */
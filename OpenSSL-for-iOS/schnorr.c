@@ -0,0 +1,500 @@
+//
+//  schnorr.c
+//  OpenSSL-for-iOS
+//
+#include "schnorr.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "openssl_hashing_tools.h"
+#include "vrf_metrics.h"
+
+#ifdef DEBUG
+#include <stdatomic.h>
+static atomic_int num_initialized = 0;
+static atomic_int num_freed = 0;
+
+void schnorr_print_allocation_status(void) {
+    int initialized = atomic_load(&num_initialized);
+    int freed = atomic_load(&num_freed);
+    printf("schnorr: initalized %d, freed %d (%d diff)\n", initialized, freed, initialized - freed);
+}
+#endif
+
+void schnorr_sig_free(schnorr_sig *sig) {
+    assert(sig && "schnorr_sig_free: usage error, no signature passed");
+    assert(sig->R && "schnorr_sig_free: usage error, R is NULL");
+    assert(sig->s && "schnorr_sig_free: usage error, s is NULL");
+    point_free(sig->R);
+    sig->R = NULL; // superflous safety
+    bn_free(sig->s);
+    sig->s = NULL; // superflous safety
+#ifdef DEBUG
+    num_freed++;
+#endif
+}
+
+// c = H(R, P, msg) with R || P given encoded (2 * P256_POINT_BYTES)
+static void schnorr_challenge(BIGNUM *c, const unsigned char *R_P, const unsigned char *msg, size_t msg_len) {
+    SHA256_CTX sha_ctx;
+    openssl_hash_init(&sha_ctx);
+    openssl_hash_update(&sha_ctx, R_P, 2 * P256_POINT_BYTES);
+    openssl_hash_update(&sha_ctx, msg, msg_len);
+    unsigned char md[SHA256_DIGEST_LENGTH];
+    openssl_hash_final(md, &sha_ctx);
+    BN_bin2bn(md, SHA256_DIGEST_LENGTH, c);
+}
+
+// c = H(R, P, msg), R and P encoded together, returns 0 on success (fails for R at infinity)
+static int schnorr_challenge_points(const EC_GROUP *group, BIGNUM *c, const EC_POINT *R, const EC_POINT *pub, const unsigned char *msg, size_t msg_len, BN_CTX *ctx) {
+    const EC_POINT *points[] = { R, pub };
+    unsigned char R_P[2 * P256_POINT_BYTES];
+    if (points_to_bytes(group, 2, points, R_P, ctx)) {
+        return 1;
+    }
+    schnorr_challenge(c, R_P, msg, msg_len);
+    return 0;
+}
+
+void schnorr_sign(const EC_GROUP *group, const BIGNUM *priv, const EC_POINT *pub, const unsigned char *msg, size_t msg_len, schnorr_sig *sig, BN_CTX *ctx) {
+    const BIGNUM *order = get0_order(group);
+    sig->R = point_new(group);
+    sig->s = bn_new();
+#ifdef DEBUG
+    num_initialized++;
+#endif
+    BIGNUM *r = bn_new();
+    BIGNUM *c = bn_new();
+
+    // compute R, redrawn in the (negligible) case it is the point at infinity
+    do {
+        bn_random_r(r, order, ctx); // draw r uniformly at random
+        bn2point_r(group, sig->R, r, ctx);
+    } while (schnorr_challenge_points(group, c, sig->R, pub, msg, msg_len, ctx));
+
+    // compute s = r + c*x
+    int ret = BN_mod_mul(sig->s, c, priv, order, ctx);
+    assert(ret == 1 && "schnorr_sign: BN_mod_mul computation failed");
+    ret = BN_mod_add(sig->s, sig->s, r, order, ctx);
+    assert(ret == 1 && "schnorr_sign: BN_mod_add computation failed");
+
+    // cleanup
+    bn_free(c);
+    bn_free(r);
+
+    /* implicitly return sig = (R, s) */
+}
+
+int schnorr_verify(const EC_GROUP *group, const EC_POINT *pub, const unsigned char *msg, size_t msg_len, const schnorr_sig *sig, BN_CTX *ctx) {
+    const BIGNUM *order = get0_order(group);
+    BN_CTX_start(ctx);
+    BIGNUM *c = BN_CTX_get(ctx);
+    assert(c && "schnorr_verify: BN_CTX_get failed");
+
+    // compute c
+    if (BN_cmp(sig->s, order) >= 0 || schnorr_challenge_points(group, c, sig->R, pub, msg, msg_len, ctx)) {
+        BN_CTX_end(ctx);
+        return 1; // s not canonical or R at infinity
+    }
+
+    /* check if R = [s]G + [-c]P, G from the fixed-base table */
+    int ret = BN_nnmod(c, c, order, ctx);
+    assert(ret == 1 && "schnorr_verify: BN_nnmod failed");
+    if (!BN_is_zero(c)) {
+        ret = BN_sub(c, order, c);
+        assert(ret == 1 && "schnorr_verify: BN_sub failed");
+    }
+    VRF_METRICS_COUNT(VRF_METRICS_MSM, 1);
+    VRF_METRICS_COUNT(VRF_METRICS_MSM_TERMS, 2);
+    EC_POINT *R_prime = point_new(group);
+    ret = EC_POINTs_mul(group, R_prime, sig->s, 1, &pub, (const BIGNUM**)&c, ctx); // no wrapper for EC_POINTs_mul
+    assert(ret == 1 && "schnorr_verify: EC_POINTs_mul failed");
+    ret = point_cmp(group, R_prime, sig->R, ctx);
+
+    // cleanup
+    point_free(R_prime);
+    BN_CTX_end(ctx);
+
+    return ret; // 0 if verification successful
+}
+
+/*
+ *
+ *  schnorr batch verification
+ *
+ */
+
+// number of bits of the random batch weights (soundness error 2^-128 per batch)
+#define SCHNORR_BATCH_WEIGHT_BITS 128
+
+// draw a nonzero random batch weight
+static void schnorr_batch_weight(BIGNUM *w) {
+    do {
+        int ret = BN_rand(w, SCHNORR_BATCH_WEIGHT_BITS, -1, 0);
+        assert(ret == 1 && "schnorr_batch_weight: BN_rand error");
+    } while (BN_is_zero(w));
+}
+
+/*
+ * check the signatures first..first+num-1 at once using random weights a_i:
+ *   [sum_i a_i*s_i]G - sum_i [a_i]R_i - sum_i [a_i*c_i]P_i = O
+ * one multi-scalar multiplication of 2*num+1 terms
+ */
+static int schnorr_verify_batch_range(const EC_GROUP *group, int first, int num, const EC_POINT **pub, const schnorr_sig *sig, BIGNUM **c, BN_CTX *ctx) {
+    const BIGNUM *order = get0_order(group);
+    int max_terms = 2 * num + 1;
+    const EC_POINT **points = malloc(max_terms * sizeof(EC_POINT*));
+    assert(points && "schnorr_verify_batch_range: allocation error (points)");
+    BIGNUM **scalars = bn_new_array(max_terms);
+    BIGNUM *g_scalar = bn_new();
+    BN_zero(g_scalar);
+    BIGNUM *w = bn_new();
+    BIGNUM *t = bn_new();
+
+    int num_terms = 0;
+    int ret;
+    for (int i=first; i<first+num; i++) {
+        schnorr_batch_weight(w);
+        // [w*s]G merged into the generator term
+        ret = BN_mod_mul(t, w, sig[i].s, order, ctx);
+        assert(ret == 1 && "schnorr_verify_batch_range: BN_mod_mul failed");
+        ret = BN_mod_add(g_scalar, g_scalar, t, order, ctx);
+        assert(ret == 1 && "schnorr_verify_batch_range: BN_mod_add failed");
+        // [-w]R
+        ret = BN_sub(scalars[num_terms], order, w);
+        assert(ret == 1 && "schnorr_verify_batch_range: BN_sub failed");
+        points[num_terms++] = sig[i].R;
+        // [-w*c]P
+        ret = BN_mod_mul(t, w, c[i], order, ctx);
+        assert(ret == 1 && "schnorr_verify_batch_range: BN_mod_mul failed");
+        ret = BN_mod_sub(scalars[num_terms], order, t, order, ctx);
+        assert(ret == 1 && "schnorr_verify_batch_range: BN_mod_sub failed");
+        points[num_terms++] = pub[i];
+    }
+
+    if (!BN_is_zero(g_scalar)) {
+        BN_copy(scalars[num_terms], g_scalar);
+        points[num_terms++] = get0_generator(group);
+    }
+
+    EC_POINT *sum = point_new(group);
+    point_weighted_sum(group, sum, num_terms, (const BIGNUM**)scalars, points, ctx);
+    ret = EC_POINT_is_at_infinity(group, sum) ? 0 : 1;
+
+    // cleanup
+    point_free(sum);
+    bn_free(t);
+    bn_free(w);
+    bn_free(g_scalar);
+    bn_free_array(max_terms, scalars);
+    free(points);
+
+    return ret; // 0 if all signatures in the range verify
+}
+
+// bisect a failing range to find its first bad signature
+static int schnorr_find_bad_sig(const EC_GROUP *group, int first, int num, const EC_POINT **pub, const schnorr_sig *sig, BIGNUM **c, BN_CTX *ctx) {
+    while (num > 1) {
+        int half = num / 2;
+        if (schnorr_verify_batch_range(group, first, half, pub, sig, c, ctx)) {
+            num = half; // bad signature in the lower half
+        } else {
+            first += half; // lower half fine, bad signature in the upper half
+            num -= half;
+        }
+    }
+    return first;
+}
+
+// index of the first signature that cannot enter a batch (s not canonical or R at infinity), num_sigs if none
+static int schnorr_find_malformed_sig(const EC_GROUP *group, int num_sigs, const EC_POINT **pub, const unsigned char **msg, const size_t *msg_len, const schnorr_sig *sig, BN_CTX *ctx) {
+    BIGNUM *c = bn_new();
+    int i;
+    for (i=0; i<num_sigs; i++) {
+        if (BN_cmp(sig[i].s, get0_order(group)) >= 0 || schnorr_challenge_points(group, c, sig[i].R, pub[i], msg[i], msg_len[i], ctx)) {
+            break;
+        }
+    }
+    bn_free(c);
+    return i;
+}
+
+int schnorr_verify_batch(const EC_GROUP *group, int num_sigs, const EC_POINT **pub, const unsigned char **msg, const size_t *msg_len, const schnorr_sig *sig, int *bad_index, BN_CTX *ctx) {
+    assert(num_sigs > 0 && "schnorr_verify_batch: usage error, no signatures passed");
+    if (num_sigs == 1) {
+        // a random weight only adds work for a single signature
+        int ret = schnorr_verify(group, pub[0], msg[0], msg_len[0], &sig[0], ctx);
+        if (ret && bad_index) {
+            *bad_index = 0;
+        }
+        return ret;
+    }
+
+    // encode all R_i and P_i together (one inversion), R_i || P_i at buf + 2 * i * P256_POINT_BYTES
+    const EC_POINT **points = malloc(2 * num_sigs * sizeof(EC_POINT*));
+    unsigned char *buf = malloc(2 * num_sigs * P256_POINT_BYTES);
+    assert(points && buf && "schnorr_verify_batch: allocation error");
+    int malformed = 0;
+    for (int i=0; i<num_sigs; i++) {
+        points[2 * i] = sig[i].R;
+        points[2 * i + 1] = pub[i];
+        malformed |= BN_cmp(sig[i].s, get0_order(group)) >= 0;
+    }
+    malformed |= points_to_bytes(group, 2 * num_sigs, points, buf, ctx);
+    free(points);
+    if (malformed) {
+        free(buf);
+        if (bad_index) {
+            *bad_index = schnorr_find_malformed_sig(group, num_sigs, pub, msg, msg_len, sig, ctx);
+        }
+        return 1;
+    }
+
+    // compute challenges once, they are reused while searching for a bad signature
+    BIGNUM **c = bn_new_array(num_sigs);
+    for (int i=0; i<num_sigs; i++) {
+        schnorr_challenge(c[i], buf + 2 * i * P256_POINT_BYTES, msg[i], msg_len[i]);
+    }
+    free(buf);
+
+    int ret = schnorr_verify_batch_range(group, 0, num_sigs, pub, sig, c, ctx);
+    if (ret && bad_index) {
+        *bad_index = schnorr_find_bad_sig(group, 0, num_sigs, pub, sig, c, ctx);
+    }
+
+    // cleanup
+    bn_free_array(num_sigs, c);
+
+    return ret; // 0 if all signatures verify
+}
+
+/*
+ *
+ *  schnorr signature encoding
+ *
+ */
+int schnorr_sig_to_bytes(const EC_GROUP *group, const schnorr_sig *sig, unsigned char *buf, BN_CTX *ctx) {
+    if (point_to_bytes(group, sig->R, buf, ctx)) {
+        return 1;
+    }
+    return bn_to_bytes(sig->s, buf + P256_POINT_BYTES);
+}
+
+int schnorr_sig_from_bytes(const EC_GROUP *group, schnorr_sig *sig, const unsigned char *buf, BN_CTX *ctx) {
+    EC_POINT *R = point_new(group);
+    BIGNUM *s = bn_from_binary_data(P256_SCALAR_BYTES, buf + P256_POINT_BYTES);
+    if (point_from_bytes(group, R, buf, ctx) || BN_cmp(s, get0_order(group)) >= 0) {
+        point_free(R);
+        bn_free(s);
+        return 1;
+    }
+    sig->R = R;
+    sig->s = s;
+#ifdef DEBUG
+    num_initialized++;
+#endif
+    return 0;
+}
+
+/*
+ *
+ *  schnorr tests
+ *
+ */
+static int schnorr_test_1(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    BIGNUM *priv = bn_random(get0_order(group), ctx);
+    EC_POINT *pub = bn2point(group, priv, ctx);
+    BIGNUM *priv_bad = bn_random(get0_order(group), ctx);
+    EC_POINT *pub_bad = bn2point(group, priv_bad, ctx);
+    const unsigned char msg[] = "consistency message";
+    const unsigned char msg_bad[] = "consistency massage";
+
+    // produce correct signature and verify
+    schnorr_sig sig;
+    schnorr_sign(group, priv, pub, msg, sizeof(msg), &sig, ctx);
+    int ret1 = schnorr_verify(group, pub, msg, sizeof(msg), &sig, ctx);
+    if (print) {
+        printf("%6s Test 1 - 1: Correct Schnorr signature %s accepted\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // negative tests, other message, other key and a signature with s not reduced
+    int ret2 = !schnorr_verify(group, pub, msg_bad, sizeof(msg_bad), &sig, ctx);
+    ret2 |= !schnorr_verify(group, pub_bad, msg, sizeof(msg), &sig, ctx);
+    schnorr_sig sig_bad;
+    sig_bad.R = sig.R;
+    sig_bad.s = bn_new();
+    BN_add(sig_bad.s, sig.s, get0_order(group));
+    ret2 |= !schnorr_verify(group, pub, msg, sizeof(msg), &sig_bad, ctx);
+    bn_free(sig_bad.s);
+    if (print) {
+        if (!ret2) {
+            printf("    OK Test 1 - 2: Incorrect Schnorr signatures not accepted (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 1 - 2: Incorrect Schnorr signature IS accepted (which is an ERROR)\n");
+        }
+    }
+
+    // cleanup
+    schnorr_sig_free(&sig);
+    point_free(pub);
+    point_free(pub_bad);
+    bn_free(priv);
+    bn_free(priv_bad);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0);
+}
+
+static int schnorr_test_2(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    const int num_sigs = 37;
+    const int num_keys = 5; // signers sign several messages each
+    BIGNUM *priv[num_keys];
+    EC_POINT *keys[num_keys];
+    for (int i=0; i<num_keys; i++) {
+        priv[i] = bn_random(get0_order(group), ctx);
+        keys[i] = bn2point(group, priv[i], ctx);
+    }
+    const EC_POINT *pub[num_sigs];
+    unsigned char msg_buf[num_sigs][16];
+    const unsigned char *msg[num_sigs];
+    size_t msg_len[num_sigs];
+    schnorr_sig sig[num_sigs];
+    for (int i=0; i<num_sigs; i++) {
+        snprintf((char*)msg_buf[i], sizeof(msg_buf[i]), "round %d", i);
+        msg[i] = msg_buf[i];
+        msg_len[i] = strlen((char*)msg_buf[i]);
+        pub[i] = keys[i % num_keys];
+        schnorr_sign(group, priv[i % num_keys], pub[i], msg[i], msg_len[i], &sig[i], ctx);
+    }
+
+    // all signatures verify in one batch, also a batch of one
+    int bad_index = -1;
+    int ret1 = schnorr_verify_batch(group, num_sigs, pub, msg, msg_len, sig, &bad_index, ctx);
+    ret1 |= schnorr_verify_batch(group, 1, pub, msg, msg_len, sig, NULL, ctx);
+    ret1 |= bad_index != -1;
+    if (print) {
+        printf("%6s Test 2 - 1: Batch of correct Schnorr signatures %s accepted\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // one signature under the wrong key, the batch is rejected and the bad signature found
+    const EC_POINT *pub_saved = pub[23];
+    pub[23] = keys[0];
+    int ret2 = !schnorr_verify_batch(group, num_sigs, pub, msg, msg_len, sig, &bad_index, ctx);
+    ret2 |= bad_index != 23;
+    pub[23] = pub_saved;
+    // two signatures with swapped s values pass neither alone nor together
+    BIGNUM *s_saved = sig[5].s;
+    sig[5].s = sig[6].s;
+    sig[6].s = s_saved;
+    ret2 |= !schnorr_verify_batch(group, num_sigs, pub, msg, msg_len, sig, &bad_index, ctx);
+    ret2 |= bad_index != 5;
+    sig[6].s = sig[5].s;
+    sig[5].s = s_saved;
+    if (print) {
+        if (!ret2) {
+            printf("    OK Test 2 - 2: Batch with incorrect Schnorr signature not accepted and bad signature found (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 2 - 2: Batch with incorrect Schnorr signature IS accepted or bad signature not found (which is an ERROR)\n");
+        }
+    }
+
+    // cleanup
+    for (int i=0; i<num_sigs; i++) {
+        schnorr_sig_free(&sig[i]);
+    }
+    for (int i=0; i<num_keys; i++) {
+        point_free(keys[i]);
+        bn_free(priv[i]);
+    }
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0);
+}
+
+static int schnorr_test_3(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    BIGNUM *priv = bn_random(get0_order(group), ctx);
+    EC_POINT *pub = bn2point(group, priv, ctx);
+    const unsigned char msg[] = "consistency message";
+    schnorr_sig sig;
+    schnorr_sign(group, priv, pub, msg, sizeof(msg), &sig, ctx);
+
+    // encoded signature decodes to a signature that verifies
+    unsigned char buf[SCHNORR_SIG_BYTES];
+    schnorr_sig sig_decoded;
+    int ret1 = schnorr_sig_to_bytes(group, &sig, buf, ctx) || schnorr_sig_from_bytes(group, &sig_decoded, buf, ctx);
+    if (!ret1) {
+        ret1 = schnorr_verify(group, pub, msg, sizeof(msg), &sig_decoded, ctx);
+        schnorr_sig_free(&sig_decoded);
+    }
+    if (print) {
+        printf("%6s Test 3 - 1: Correct encoded Schnorr signature %s accepted\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // negative tests, a modified byte in R or s and an s that is not reduced
+    int ret2 = 0;
+    const int offsets[] = { 1, SCHNORR_SIG_BYTES - 1 };
+    for (int i=0; i<2; i++) {
+        buf[offsets[i]] ^= 0x01;
+        if (schnorr_sig_from_bytes(group, &sig_decoded, buf, ctx) == 0) {
+            ret2 |= !schnorr_verify(group, pub, msg, sizeof(msg), &sig_decoded, ctx);
+            schnorr_sig_free(&sig_decoded);
+        }
+        buf[offsets[i]] ^= 0x01;
+    }
+    memset(buf + P256_POINT_BYTES, 0xff, P256_SCALAR_BYTES);
+    ret2 |= !schnorr_sig_from_bytes(group, &sig_decoded, buf, ctx);
+    if (print) {
+        if (!ret2) {
+            printf("    OK Test 3 - 2: Incorrect encoded Schnorr signatures not accepted (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 3 - 2: Incorrect encoded Schnorr signature IS accepted (which is an ERROR)\n");
+        }
+    }
+
+    // cleanup
+    schnorr_sig_free(&sig);
+    point_free(pub);
+    bn_free(priv);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0);
+}
+
+typedef int (*test_function)(int);
+
+static test_function test_suite[] = {
+    &schnorr_test_1,
+    &schnorr_test_2,
+    &schnorr_test_3
+};
+
+int schnorr_test_suite(int print) {
+    if (print) {
+        printf("Schnorr test suite BEGIN ----------------------------\n");
+    }
+    int num_tests = sizeof(test_suite)/sizeof(test_function);
+    int ret = 0;
+    for (int i=0; i<num_tests; i++) {
+        if (test_suite[i](print)) {
+            ret = 1;
+        }
+    }
+    if (print) {
+        printf("Schnorr test suite END ------------------------------\n");
+#ifdef DEBUG
+        print_allocation_status();
+        schnorr_print_allocation_status();
+#endif
+        fflush(stdout);
+    }
+    return ret;
+}
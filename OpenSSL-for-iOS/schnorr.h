@@ -0,0 +1,41 @@
+//
+//  schnorr.h
+//  OpenSSL-for-iOS
+//
+//  EC-Schnorr signatures over P-256: R = [r]G, c = H(R, P, msg), s = r + c*x, valid if [s]G = R + [c]P.
+//  Unlike ECDSA, many signatures (also under different keys) verify together as a single multi-scalar
+//  multiplication over all R_i and P_i with one merged generator term.
+//
+
+#ifndef SCHNORR_H
+#define SCHNORR_H
+#include <stddef.h>
+#include "P256.h"
+
+typedef struct {
+    EC_POINT *R;
+    BIGNUM *s;
+} schnorr_sig;
+
+// sign msg with the private key priv of the public key pub = [priv]G, sig is allocated (free with schnorr_sig_free)
+void schnorr_sign(const EC_GROUP *group, const BIGNUM *priv, const EC_POINT *pub, const unsigned char *msg, size_t msg_len, schnorr_sig *sig, BN_CTX *ctx);
+// returns 0 if sig is a valid signature of msg under pub
+int schnorr_verify(const EC_GROUP *group, const EC_POINT *pub, const unsigned char *msg, size_t msg_len, const schnorr_sig *sig, BN_CTX *ctx);
+// verify num_sigs signatures (pub[i], msg[i], msg_len[i], sig[i]) with a single random linear combination check,
+// returns 0 if all signatures verify, otherwise 1 and (if bad_index is non-NULL) the index of the first bad signature
+int schnorr_verify_batch(const EC_GROUP *group, int num_sigs, const EC_POINT **pub, const unsigned char **msg, const size_t *msg_len, const schnorr_sig *sig, int *bad_index, BN_CTX *ctx);
+void schnorr_sig_free(schnorr_sig *sig);
+
+// fixed-size signature encoding R || s
+#define SCHNORR_SIG_BYTES (P256_POINT_BYTES + P256_SCALAR_BYTES)
+// write sig to buf (SCHNORR_SIG_BYTES), returns 0 on success
+int schnorr_sig_to_bytes(const EC_GROUP *group, const schnorr_sig *sig, unsigned char *buf, BN_CTX *ctx);
+// read sig from buf, returns 0 on success (sig is only allocated on success)
+int schnorr_sig_from_bytes(const EC_GROUP *group, schnorr_sig *sig, const unsigned char *buf, BN_CTX *ctx);
+
+int schnorr_test_suite(int print);
+#ifdef DEBUG
+void schnorr_print_allocation_status(void);
+#endif
+
+#endif /* SCHNORR_H */
@@ -0,0 +1,361 @@
+//
+//  scrape_ldt.c
+//  OpenSSL-for-iOS
+//
+#include "scrape_ldt.h"
+#include <assert.h>
+#include <stdlib.h>
+#include "openssl_hashing_tools.h"
+
+/*
+ * The coefficients of m are the powers r^k of a single hashed r instead of independent hashes: a vector outside
+ * the code passes only if r is a root of the nonzero polynomial sum_k r^k <c_k, C> of degree n - t - 2 (soundness
+ * error (n - t - 2) / q), and m(i) has a closed form, so the dual codeword costs O(n) instead of the O(n (n - t))
+ * multiplications of Horner's rule at every i.
+ */
+struct scrape_ldt {
+    const EC_GROUP *group;
+    int n;
+    int t;
+    BIGNUM **v;         // v[i-1] = prod_{j != i} 1/(i - j) = (-1)^(n-i) / ((i-1)! (n-i)!)
+    BIGNUM **alpha_pow; // alpha_pow[i-1] = i^(n-t-1)
+};
+
+scrape_ldt *scrape_ldt_new(const EC_GROUP *group, int n, int t, BN_CTX *ctx) {
+    assert(t >= 0 && t <= n - 2 && "scrape_ldt_new: usage error, degree must be in 0..n-2");
+    const BIGNUM *order = get0_order(group);
+    scrape_ldt *ldt = malloc(sizeof(scrape_ldt));
+    assert(ldt && "scrape_ldt_new: allocation error");
+    ldt->group = group;
+    ldt->n = n;
+    ldt->t = t;
+    ldt->v = bn_new_array(n);
+    ldt->alpha_pow = bn_new_array(n);
+
+    // inv_fact[k] = 1/k! for k < n from the single inversion of (n-1)! (nonzero, q > n)
+    BIGNUM **inv_fact = bn_new_array(n);
+    int ret = BN_one(inv_fact[n-1]);
+    for (int k=2; k<n; k++) {
+        ret &= BN_mul_word(inv_fact[n-1], k);
+        ret &= BN_nnmod(inv_fact[n-1], inv_fact[n-1], order, ctx);
+    }
+    ret &= BN_mod_inverse(inv_fact[n-1], inv_fact[n-1], order, ctx) != NULL;
+    for (int k=n-1; k>0; k--) {
+        ret &= BN_copy(inv_fact[k-1], inv_fact[k]) != NULL; // 1/(k-1)! = k/k!
+        ret &= BN_mul_word(inv_fact[k-1], k);
+        ret &= BN_nnmod(inv_fact[k-1], inv_fact[k-1], order, ctx);
+    }
+    assert(ret == 1 && "scrape_ldt_new: factorial computation failed");
+
+    BIGNUM *e = bn_new();
+    BN_set_word(e, n - t - 1);
+    for (int i=1; i<=n; i++) {
+        ret &= BN_mod_mul(ldt->v[i-1], inv_fact[i-1], inv_fact[n-i], order, ctx);
+        if ((n - i) % 2 && !BN_is_zero(ldt->v[i-1])) {
+            ret &= BN_sub(ldt->v[i-1], order, ldt->v[i-1]);
+        }
+        ret &= BN_set_word(ldt->alpha_pow[i-1], i);
+        ret &= BN_mod_exp(ldt->alpha_pow[i-1], ldt->alpha_pow[i-1], e, order, ctx);
+    }
+    assert(ret == 1 && "scrape_ldt_new: weight computation failed");
+
+    // cleanup
+    bn_free(e);
+    bn_free_array(n, inv_fact);
+
+    return ldt;
+}
+
+void scrape_ldt_free(scrape_ldt *ldt) {
+    bn_free_array(ldt->n, ldt->v);
+    bn_free_array(ldt->n, ldt->alpha_pow);
+    free(ldt);
+}
+
+void scrape_ldt_dual_codeword(const scrape_ldt *ldt, const BIGNUM *r, BIGNUM **c, BN_CTX *ctx) {
+    const BIGNUM *order = get0_order(ldt->group);
+    int n = ldt->n;
+    BN_CTX_start(ctx);
+    BIGNUM *r_pow = BN_CTX_get(ctx); // r^(n-t-1)
+    BIGNUM *e = BN_CTX_get(ctx);
+    BIGNUM *inv = BN_CTX_get(ctx);
+    BIGNUM *t = BN_CTX_get(ctx);
+    assert(t && "scrape_ldt_dual_codeword: BN_CTX_get failed");
+    BIGNUM **den = bn_new_array(n);    // r*i - 1
+    BIGNUM **prefix = bn_new_array(n); // products of the nonzero den up to i
+    int ret = BN_set_word(e, ldt->n - ldt->t - 1);
+    ret &= BN_mod_exp(r_pow, r, e, order, ctx);
+
+    // denominators and their prefix products (a zero denominator, r*i = 1, is skipped: m(i) = n - t - 1 there)
+    for (int i=0; i<n; i++) {
+        ret &= BN_copy(den[i], r) != NULL;
+        ret &= BN_mul_word(den[i], i + 1);
+        ret &= BN_sub_word(den[i], 1);
+        ret &= BN_nnmod(den[i], den[i], order, ctx);
+        if (i == 0) {
+            ret &= BN_is_zero(den[i]) ? BN_one(prefix[i]) : BN_copy(prefix[i], den[i]) != NULL;
+        } else if (BN_is_zero(den[i])) {
+            ret &= BN_copy(prefix[i], prefix[i-1]) != NULL;
+        } else {
+            ret &= BN_mod_mul(prefix[i], prefix[i-1], den[i], order, ctx);
+        }
+    }
+    ret &= BN_mod_inverse(inv, prefix[n-1], order, ctx) != NULL;
+
+    // walk down: inv = 1/prefix[i], 1/den[i] = inv * prefix[i-1]
+    for (int i=n-1; i>=0; i--) {
+        if (BN_is_zero(den[i])) {
+            ret &= BN_set_word(t, ldt->n - ldt->t - 1);
+            ret &= BN_mod_mul(c[i], ldt->v[i], t, order, ctx);
+            continue;
+        }
+        if (i > 0) {
+            ret &= BN_mod_mul(t, inv, prefix[i-1], order, ctx); // 1/den[i]
+            ret &= BN_mod_mul(inv, inv, den[i], order, ctx);
+        } else {
+            ret &= BN_copy(t, inv) != NULL;
+        }
+        // c_i = v_i * ((r*i)^(n-t-1) - 1) / (r*i - 1)
+        ret &= BN_mod_mul(c[i], r_pow, ldt->alpha_pow[i], order, ctx);
+        ret &= BN_mod_sub(c[i], c[i], BN_value_one(), order, ctx);
+        ret &= BN_mod_mul(c[i], c[i], t, order, ctx);
+        ret &= BN_mod_mul(c[i], c[i], ldt->v[i], order, ctx);
+    }
+    assert(ret == 1 && "scrape_ldt_dual_codeword: computation failed");
+
+    // cleanup
+    bn_free_array(n, prefix);
+    bn_free_array(n, den);
+    BN_CTX_end(ctx);
+}
+
+int scrape_ldt_verify(const scrape_ldt *ldt, const EC_POINT **C, int num_lists, const int *num_points, const EC_POINT ***lists, BN_CTX *ctx) {
+    const EC_GROUP *group = ldt->group;
+    int n = ldt->n;
+
+    // r = hash of the commitments and the other lists of the transcript
+    const EC_POINT **all_lists[num_lists + 1];
+    int all_num_points[num_lists + 1];
+    all_lists[0] = C;
+    all_num_points[0] = n;
+    for (int i=0; i<num_lists; i++) {
+        all_lists[i + 1] = lists[i];
+        all_num_points[i + 1] = num_points[i];
+    }
+    BIGNUM *r[1];
+    openssl_hash_points2poly(group, ctx, 1, r, num_lists + 1, all_num_points, all_lists);
+
+    // sum_i [c_i]C_i = O
+    BIGNUM **c = bn_new_array(n);
+    scrape_ldt_dual_codeword(ldt, r[0], c, ctx);
+    EC_POINT *sum = point_new(group);
+    point_weighted_sum(group, sum, n, (const BIGNUM**)c, C, ctx);
+    int ret = EC_POINT_is_at_infinity(group, sum) ? 0 : 1;
+
+    // cleanup
+    point_free(sum);
+    bn_free_array(n, c);
+    bn_free(r[0]);
+
+    return ret; // 0 if the commitments are of degree at most t
+}
+
+/*
+ *
+ *  scrape_ldt tests
+ *
+ */
+
+// C[i-1] = [p(i)]H for i = 1..n and p with the deg + 1 coefficients coeff
+static void scrape_ldt_test_commit(const EC_GROUP *group, int n, int deg, BIGNUM **coeff, const EC_POINT *H, EC_POINT **C, BN_CTX *ctx) {
+    const BIGNUM *order = get0_order(group);
+    BIGNUM *x = bn_new();
+    BIGNUM *y = bn_new();
+    for (int i=1; i<=n; i++) {
+        // Horner
+        BN_set_word(x, i);
+        BN_copy(y, coeff[deg]);
+        for (int k=deg-1; k>=0; k--) {
+            BN_mod_mul(y, y, x, order, ctx);
+            BN_mod_add(y, y, coeff[k], order, ctx);
+        }
+        point_mul(group, C[i-1], y, H, ctx);
+    }
+    bn_free(y);
+    bn_free(x);
+}
+
+static int scrape_ldt_test_1(int print) {
+    const EC_GROUP *group = get0_group();
+    const BIGNUM *order = get0_order(group);
+    BN_CTX *ctx = BN_CTX_new();
+    const int n = 13;
+    const int t = 4;
+    scrape_ldt *ldt = scrape_ldt_new(group, n, t, ctx);
+
+    // dual codeword against the definitions, v_i as the product and m(i) by Horner's rule
+    BIGNUM *r = bn_random(order, ctx);
+    BIGNUM **c = bn_new_array(n);
+    scrape_ldt_dual_codeword(ldt, r, c, ctx);
+    BIGNUM *v = bn_new();
+    BIGNUM *m = bn_new();
+    BIGNUM *x = bn_new();
+    BIGNUM *d = bn_new();
+    int ret1 = 0;
+    for (int i=1; i<=n; i++) {
+        BN_one(v);
+        for (int j=1; j<=n; j++) {
+            if (j != i) {
+                BN_set_word(d, i > j ? i - j : j - i);
+                if (i < j) {
+                    BN_sub(d, order, d);
+                }
+                BN_mod_mul(v, v, d, order, ctx);
+            }
+        }
+        BN_mod_inverse(v, v, order, ctx);
+        BN_set_word(x, i);
+        BN_zero(m);
+        for (int k=n-t-2; k>=0; k--) {
+            BN_mod_mul(m, m, x, order, ctx);
+            BN_set_word(d, k);
+            BN_mod_exp(d, r, d, order, ctx);
+            BN_mod_add(m, m, d, order, ctx);
+        }
+        BN_mod_mul(m, m, v, order, ctx);
+        ret1 |= BN_cmp(m, c[i-1]) != 0;
+    }
+    // the codeword hitting r*i = 1 (r = 1/3)
+    BN_set_word(r, 3);
+    BN_mod_inverse(r, r, order, ctx);
+    BIGNUM **c_pole = bn_new_array(n);
+    scrape_ldt_dual_codeword(ldt, r, c_pole, ctx);
+    // sum_i c_i p(i) = 0 for p = x^t
+    BN_zero(m);
+    for (int i=1; i<=n; i++) {
+        BN_set_word(x, i);
+        BN_set_word(d, t);
+        BN_mod_exp(d, x, d, order, ctx);
+        BN_mod_mul(d, d, c_pole[i-1], order, ctx);
+        BN_mod_add(m, m, d, order, ctx);
+    }
+    ret1 |= !BN_is_zero(m);
+    if (print) {
+        printf("%6s Test 1 - 1: Dual codeword %s equal to its definition\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // cleanup
+    bn_free_array(n, c_pole);
+    bn_free(d);
+    bn_free(x);
+    bn_free(m);
+    bn_free(v);
+    bn_free_array(n, c);
+    bn_free(r);
+    scrape_ldt_free(ldt);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return ret1;
+}
+
+static int scrape_ldt_test_2(int print) {
+    const EC_GROUP *group = get0_group();
+    const BIGNUM *order = get0_order(group);
+    BN_CTX *ctx = BN_CTX_new();
+    const int n = 33;
+    const int t = 15;
+    scrape_ldt *ldt = scrape_ldt_new(group, n, t, ctx);
+    EC_POINT *H = point_random(group, ctx);
+    BIGNUM **coeff = bn_new_array(t + 2);
+    for (int k=0; k<t+2; k++) {
+        bn_random_r(coeff[k], order, ctx);
+    }
+    EC_POINT *C[n];
+    EC_POINT *E[n]; // further list of the transcript (encrypted shares)
+    for (int i=0; i<n; i++) {
+        C[i] = point_new(group);
+        E[i] = point_random(group, ctx);
+    }
+    const EC_POINT **lists[] = { (const EC_POINT**)E };
+    const int num_points[] = { n };
+
+    // commitments to a polynomial of degree t pass, with and without a further list
+    scrape_ldt_test_commit(group, n, t, coeff, H, C, ctx);
+    int ret1 = scrape_ldt_verify(ldt, (const EC_POINT**)C, 0, NULL, NULL, ctx);
+    ret1 |= scrape_ldt_verify(ldt, (const EC_POINT**)C, 1, num_points, lists, ctx);
+    if (print) {
+        printf("%6s Test 2 - 1: Commitments of degree t %s accepted\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // negative tests, degree t + 1 and one commitment changed
+    scrape_ldt_test_commit(group, n, t + 1, coeff, H, C, ctx);
+    int ret2 = !scrape_ldt_verify(ldt, (const EC_POINT**)C, 1, num_points, lists, ctx);
+    scrape_ldt_test_commit(group, n, t, coeff, H, C, ctx);
+    point_add(group, C[7], C[7], H, ctx);
+    ret2 |= !scrape_ldt_verify(ldt, (const EC_POINT**)C, 0, NULL, NULL, ctx);
+    if (print) {
+        if (!ret2) {
+            printf("    OK Test 2 - 2: Commitments of higher degree not accepted (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 2 - 2: Commitments of higher degree ARE accepted (which is an ERROR)\n");
+        }
+    }
+
+    // the largest degree, t = n - 2 (m constant)
+    scrape_ldt *ldt_max = scrape_ldt_new(group, n, n - 2, ctx);
+    BIGNUM **coeff_max = bn_new_array(n);
+    for (int k=0; k<n; k++) {
+        bn_random_r(coeff_max[k], order, ctx);
+    }
+    scrape_ldt_test_commit(group, n, n - 2, coeff_max, H, C, ctx);
+    int ret3 = scrape_ldt_verify(ldt_max, (const EC_POINT**)C, 0, NULL, NULL, ctx);
+    scrape_ldt_test_commit(group, n, n - 1, coeff_max, H, C, ctx);
+    ret3 |= !scrape_ldt_verify(ldt_max, (const EC_POINT**)C, 0, NULL, NULL, ctx);
+    if (print) {
+        printf("%6s Test 2 - 3: Commitments of degree n - 2 %s tested correctly\n", ret3 ? "NOT OK" : "OK", ret3 ? "NOT" : "indeed");
+    }
+
+    // cleanup
+    bn_free_array(n, coeff_max);
+    scrape_ldt_free(ldt_max);
+    for (int i=0; i<n; i++) {
+        point_free(C[i]);
+        point_free(E[i]);
+    }
+    bn_free_array(t + 2, coeff);
+    point_free(H);
+    scrape_ldt_free(ldt);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0 && ret3 == 0);
+}
+
+typedef int (*test_function)(int);
+
+static test_function test_suite[] = {
+    &scrape_ldt_test_1,
+    &scrape_ldt_test_2
+};
+
+int scrape_ldt_test_suite(int print) {
+    if (print) {
+        printf("SCRAPE low-degree test suite BEGIN ------------------\n");
+    }
+    int num_tests = sizeof(test_suite)/sizeof(test_function);
+    int ret = 0;
+    for (int i=0; i<num_tests; i++) {
+        if (test_suite[i](print)) {
+            ret = 1;
+        }
+    }
+    if (print) {
+        printf("SCRAPE low-degree test suite END --------------------\n");
+#ifdef DEBUG
+        print_allocation_status();
+#endif
+        fflush(stdout);
+    }
+    return ret;
+}
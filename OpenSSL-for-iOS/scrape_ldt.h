@@ -0,0 +1,33 @@
+//
+//  scrape_ldt.h
+//  OpenSSL-for-iOS
+//
+//  SCRAPE low-degree test of publicly verifiable secret sharing transcripts: the commitments C_i = [p(i)]H,
+//  i = 1..n, are to a polynomial p of degree at most t iff they are orthogonal to the dual code, whose codewords
+//  are c_i = v_i * m(i) with v_i = prod_{j != i} 1/(i - j) and m of degree at most n - t - 2. The verifier draws
+//  m by hashing the transcript and checks sum_i [c_i]C_i = O as one multi-scalar multiplication.
+//
+
+#ifndef SCRAPE_LDT_H
+#define SCRAPE_LDT_H
+#include "P256.h"
+
+typedef struct scrape_ldt scrape_ldt;
+
+// test of n commitments to evaluations at 1..n of a polynomial of degree at most t (0 <= t <= n - 2), with the
+// dual code weights v_i and the powers i^(n-t-1) precomputed
+scrape_ldt *scrape_ldt_new(const EC_GROUP *group, int n, int t, BN_CTX *ctx);
+
+void scrape_ldt_free(scrape_ldt *ldt);
+
+// c[i-1] = v_i * m(i) for i = 1..n (c initialized) with m(x) = sum_{k <= n-t-2} r^k x^k, evaluated in closed form
+// as ((r*x)^(n-t-1) - 1) / (r*x - 1) with one inversion for all i
+void scrape_ldt_dual_codeword(const scrape_ldt *ldt, const BIGNUM *r, BIGNUM **c, BN_CTX *ctx);
+
+// returns 0 if C[0..n-1] commit to a polynomial of degree at most t; r is derived by openssl_hash_points2poly
+// from C and the num_lists further point lists of the transcript (e.g. the encrypted shares, num_lists may be 0)
+int scrape_ldt_verify(const scrape_ldt *ldt, const EC_POINT **C, int num_lists, const int *num_points, const EC_POINT ***lists, BN_CTX *ctx);
+
+int scrape_ldt_test_suite(int print);
+
+#endif /* SCRAPE_LDT_H */
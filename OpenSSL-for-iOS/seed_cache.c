@@ -0,0 +1,418 @@
+//
+//  seed_cache.c
+//  OpenSSL-for-iOS
+//
+#include "seed_cache.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config_platform.h"
+#include "praos_vrf.h"
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+// suite byte followed by the 32-byte seed
+#define SEED_CACHE_KEY_BYTES (1 + P256_SCALAR_BYTES)
+
+typedef struct {
+    unsigned char key[SEED_CACHE_KEY_BYTES];
+    EC_POINT *seed_point;
+    EC_POINT *hash_seed_point;
+    int hash_next; // next entry in the same bucket, -1 at the end
+    int lru_prev; // towards the most recently used entry
+    int lru_next; // towards the least recently used entry
+} seed_cache_entry;
+
+struct seed_cache {
+    const EC_GROUP *group;
+    int capacity;
+    int num_entries;
+    seed_cache_entry *entries;
+    int *buckets; // first entry per bucket, -1 if empty
+    int bucket_mask;
+    int lru_first; // most recently used
+    int lru_last; // least recently used, evicted first
+    long hits;
+    long misses;
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+    SRWLOCK lock;
+#else
+    pthread_mutex_t lock;
+#endif
+};
+
+static void seed_cache_lock(seed_cache *cache) {
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+    AcquireSRWLockExclusive(&cache->lock);
+#else
+    int ret = pthread_mutex_lock(&cache->lock);
+    assert(ret == 0 && "seed_cache_lock: pthread_mutex_lock failed");
+#endif
+}
+
+static void seed_cache_unlock(seed_cache *cache) {
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+    ReleaseSRWLockExclusive(&cache->lock);
+#else
+    int ret = pthread_mutex_unlock(&cache->lock);
+    assert(ret == 0 && "seed_cache_unlock: pthread_mutex_unlock failed");
+#endif
+}
+
+seed_cache *seed_cache_new(const EC_GROUP *group, int capacity) {
+    assert(capacity > 0 && "seed_cache_new: usage error, capacity must be positive");
+    seed_cache *cache = calloc(1, sizeof(seed_cache));
+    assert(cache && "seed_cache_new: allocation error (cache)");
+    int num_buckets = 1;
+    while (num_buckets < 2 * capacity) {
+        num_buckets *= 2;
+    }
+    cache->group = group;
+    cache->capacity = capacity;
+    cache->entries = calloc(capacity, sizeof(seed_cache_entry));
+    cache->buckets = malloc(num_buckets * sizeof(int));
+    assert(cache->entries && cache->buckets && "seed_cache_new: allocation error (table)");
+    cache->bucket_mask = num_buckets - 1;
+    // the points are owned by the cache for its whole life, they are not counted by the DEBUG allocation checks
+    // (the process wide cache is never freed)
+    for (int i=0; i<capacity; i++) {
+        cache->entries[i].seed_point = EC_POINT_new(group);
+        cache->entries[i].hash_seed_point = EC_POINT_new(group);
+        assert(cache->entries[i].seed_point && cache->entries[i].hash_seed_point && "seed_cache_new: allocation error (points)");
+    }
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+    InitializeSRWLock(&cache->lock);
+#else
+    int ret = pthread_mutex_init(&cache->lock, NULL);
+    assert(ret == 0 && "seed_cache_new: pthread_mutex_init failed");
+#endif
+    seed_cache_clear(cache);
+    return cache;
+}
+
+void seed_cache_free(seed_cache *cache) {
+    for (int i=0; i<cache->capacity; i++) {
+        EC_POINT_free(cache->entries[i].seed_point);
+        EC_POINT_free(cache->entries[i].hash_seed_point);
+    }
+#if PLATFORM_TYPE != PLATFORM_TYPE_WINDOWS
+    pthread_mutex_destroy(&cache->lock);
+#endif
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache);
+}
+
+static seed_cache *default_cache = NULL;
+
+static void default_cache_init(void) {
+    default_cache = seed_cache_new(get0_group(), SEED_CACHE_DEFAULT_CAPACITY);
+}
+
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+static INIT_ONCE default_cache_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK default_cache_init_once(PINIT_ONCE once, PVOID param, PVOID *context) {
+    default_cache_init();
+    return TRUE;
+}
+
+seed_cache *get0_seed_cache(void) {
+    InitOnceExecuteOnce(&default_cache_once, default_cache_init_once, NULL, NULL);
+    return default_cache;
+}
+#else
+static pthread_once_t default_cache_once = PTHREAD_ONCE_INIT;
+
+seed_cache *get0_seed_cache(void) {
+    int ret = pthread_once(&default_cache_once, default_cache_init);
+    assert(ret == 0 && "get0_seed_cache: pthread_once failed");
+    return default_cache;
+}
+#endif
+
+// FNV-1a, seeds are hash outputs in practice but keys of equal prefix should not collide
+static int seed_cache_bucket(const seed_cache *cache, const unsigned char *key) {
+    uint32_t h = 2166136261u;
+    for (int i=0; i<SEED_CACHE_KEY_BYTES; i++) {
+        h = (h ^ key[i]) * 16777619u;
+    }
+    return (int)(h & (uint32_t)cache->bucket_mask);
+}
+
+static int seed_cache_find(const seed_cache *cache, const unsigned char *key, int bucket) {
+    for (int i=cache->buckets[bucket]; i>=0; i=cache->entries[i].hash_next) {
+        if (memcmp(cache->entries[i].key, key, SEED_CACHE_KEY_BYTES) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void seed_cache_lru_unlink(seed_cache *cache, int i) {
+    seed_cache_entry *e = &cache->entries[i];
+    if (e->lru_prev >= 0) {
+        cache->entries[e->lru_prev].lru_next = e->lru_next;
+    } else {
+        cache->lru_first = e->lru_next;
+    }
+    if (e->lru_next >= 0) {
+        cache->entries[e->lru_next].lru_prev = e->lru_prev;
+    } else {
+        cache->lru_last = e->lru_prev;
+    }
+}
+
+static void seed_cache_lru_push_first(seed_cache *cache, int i) {
+    seed_cache_entry *e = &cache->entries[i];
+    e->lru_prev = -1;
+    e->lru_next = cache->lru_first;
+    if (cache->lru_first >= 0) {
+        cache->entries[cache->lru_first].lru_prev = i;
+    } else {
+        cache->lru_last = i;
+    }
+    cache->lru_first = i;
+}
+
+static void seed_cache_bucket_unlink(seed_cache *cache, int i) {
+    int *link = &cache->buckets[seed_cache_bucket(cache, cache->entries[i].key)];
+    while (*link != i) {
+        link = &cache->entries[*link].hash_next;
+    }
+    *link = cache->entries[i].hash_next;
+}
+
+static void seed_cache_copy_points(const seed_cache_entry *e, EC_POINT *seed_point, EC_POINT *hash_seed_point) {
+    int ret = EC_POINT_copy(seed_point, e->seed_point);
+    ret &= EC_POINT_copy(hash_seed_point, e->hash_seed_point);
+    assert(ret == 1 && "seed_cache_copy_points: EC_POINT_copy failed");
+}
+
+void seed_cache_lookup(seed_cache *cache, const BIGNUM *seed, int suite, EC_POINT *seed_point, EC_POINT *hash_seed_point, BN_CTX *ctx) {
+    unsigned char key[SEED_CACHE_KEY_BYTES];
+    key[0] = (unsigned char)suite;
+    int cacheable = !BN_is_negative(seed) && bn_to_bytes(seed, key + 1) == 0; // larger seeds are not cached
+    int bucket = cacheable ? seed_cache_bucket(cache, key) : 0;
+
+    seed_cache_lock(cache);
+    int i = cacheable ? seed_cache_find(cache, key, bucket) : -1;
+    if (i >= 0) {
+        cache->hits++;
+        seed_cache_lru_unlink(cache, i);
+        seed_cache_lru_push_first(cache, i);
+        seed_cache_copy_points(&cache->entries[i], seed_point, hash_seed_point);
+        seed_cache_unlock(cache);
+        return;
+    }
+    cache->misses++;
+    seed_cache_unlock(cache);
+
+    // derive without holding the lock, affine so that hits also save the conversion for hashing and encoding
+    bn2point_r(cache->group, seed_point, seed, ctx);
+    vrf_hash_seed_r(cache->group, hash_seed_point, seed, (praos_vrf_suite)suite, ctx);
+    EC_POINT *points[] = { seed_point, hash_seed_point };
+    int ret = EC_POINTs_make_affine(cache->group, 2, points, ctx);
+    assert(ret == 1 && "seed_cache_lookup: EC_POINTs_make_affine failed");
+    if (!cacheable) {
+        return;
+    }
+
+    // insert unless another thread did in the meantime
+    seed_cache_lock(cache);
+    if (seed_cache_find(cache, key, bucket) < 0) {
+        if (cache->num_entries < cache->capacity) {
+            i = cache->num_entries++;
+        } else {
+            i = cache->lru_last;
+            seed_cache_lru_unlink(cache, i);
+            seed_cache_bucket_unlink(cache, i);
+        }
+        seed_cache_entry *e = &cache->entries[i];
+        memcpy(e->key, key, SEED_CACHE_KEY_BYTES);
+        ret = EC_POINT_copy(e->seed_point, seed_point);
+        ret &= EC_POINT_copy(e->hash_seed_point, hash_seed_point);
+        assert(ret == 1 && "seed_cache_lookup: EC_POINT_copy failed");
+        e->hash_next = cache->buckets[bucket];
+        cache->buckets[bucket] = i;
+        seed_cache_lru_push_first(cache, i);
+    }
+    seed_cache_unlock(cache);
+}
+
+void seed_cache_get_stats(seed_cache *cache, long *hits, long *misses) {
+    seed_cache_lock(cache);
+    *hits = cache->hits;
+    *misses = cache->misses;
+    seed_cache_unlock(cache);
+}
+
+void seed_cache_clear(seed_cache *cache) {
+    seed_cache_lock(cache);
+    memset(cache->buckets, 0xff, (cache->bucket_mask + 1) * sizeof(int)); // all -1
+    cache->num_entries = 0;
+    cache->lru_first = -1;
+    cache->lru_last = -1;
+    cache->hits = 0;
+    cache->misses = 0;
+    seed_cache_unlock(cache);
+}
+
+/*
+ *
+ *  seed_cache tests
+ *
+ */
+static int seed_cache_test_1(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    seed_cache *cache = seed_cache_new(group, 2);
+    BIGNUM *seed[3];
+    for (int i=0; i<3; i++) {
+        seed[i] = bn_random(get0_order(group), ctx);
+    }
+    EC_POINT *seed_point = point_new(group);
+    EC_POINT *hash_seed_point = point_new(group);
+    EC_POINT *expected = point_new(group);
+
+    // cached points equal the derived ones
+    seed_cache_lookup(cache, seed[0], PRAOS_VRF_SUITE_LEGACY, seed_point, hash_seed_point, ctx);
+    seed_cache_lookup(cache, seed[0], PRAOS_VRF_SUITE_LEGACY, seed_point, hash_seed_point, ctx);
+    bn2point_r(group, expected, seed[0], ctx);
+    int ret1 = EC_POINT_cmp(group, seed_point, expected, ctx) != 0;
+    vrf_hash_seed_r(group, expected, seed[0], PRAOS_VRF_SUITE_LEGACY, ctx);
+    ret1 |= EC_POINT_cmp(group, hash_seed_point, expected, ctx) != 0;
+    long hits, misses;
+    seed_cache_get_stats(cache, &hits, &misses);
+    ret1 |= hits != 1 || misses != 1;
+    if (print) {
+        printf("%6s Test 1 - 1: Cached seed points %s the derived ones\n", ret1 ? "NOT OK" : "OK", ret1 ? "do NOT equal" : "equal");
+    }
+
+    // seed 1 is the least recently used when seed 2 comes in, so it is evicted and seed 0 is kept
+    seed_cache_lookup(cache, seed[1], PRAOS_VRF_SUITE_LEGACY, seed_point, hash_seed_point, ctx);
+    seed_cache_lookup(cache, seed[0], PRAOS_VRF_SUITE_LEGACY, seed_point, hash_seed_point, ctx);
+    seed_cache_lookup(cache, seed[2], PRAOS_VRF_SUITE_LEGACY, seed_point, hash_seed_point, ctx);
+    seed_cache_lookup(cache, seed[0], PRAOS_VRF_SUITE_LEGACY, seed_point, hash_seed_point, ctx);
+    seed_cache_lookup(cache, seed[1], PRAOS_VRF_SUITE_LEGACY, seed_point, hash_seed_point, ctx);
+    seed_cache_get_stats(cache, &hits, &misses);
+    int ret2 = hits != 3 || misses != 4;
+    bn2point_r(group, expected, seed[1], ctx);
+    ret2 |= EC_POINT_cmp(group, seed_point, expected, ctx) != 0;
+    seed_cache_clear(cache);
+    seed_cache_lookup(cache, seed[1], PRAOS_VRF_SUITE_LEGACY, seed_point, hash_seed_point, ctx);
+    seed_cache_get_stats(cache, &hits, &misses);
+    ret2 |= hits != 0 || misses != 1;
+    if (print) {
+        printf("%6s Test 1 - 2: Least recently used seed %s evicted\n", ret2 ? "NOT OK" : "OK", ret2 ? "NOT" : "indeed");
+    }
+
+    // cleanup
+    point_free(expected);
+    point_free(hash_seed_point);
+    point_free(seed_point);
+    for (int i=0; i<3; i++) {
+        bn_free(seed[i]);
+    }
+    seed_cache_free(cache);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0);
+}
+
+static int seed_cache_test_2(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    seed_cache *cache = seed_cache_new(group, 4);
+    BIGNUM *seed = bn_random(get0_order(group), ctx);
+    EC_POINT *seed_point = point_new(group);
+    EC_POINT *hash_seed_point = point_new(group);
+    EC_POINT *expected = point_new(group);
+
+    // the same seed under another suite is another entry
+    seed_cache_lookup(cache, seed, PRAOS_VRF_SUITE_LEGACY, seed_point, hash_seed_point, ctx);
+    seed_cache_lookup(cache, seed, PRAOS_VRF_SUITE_P256_SSWU, seed_point, hash_seed_point, ctx);
+    vrf_hash_seed_r(group, expected, seed, PRAOS_VRF_SUITE_P256_SSWU, ctx);
+    long hits, misses;
+    seed_cache_get_stats(cache, &hits, &misses);
+    int ret1 = hits != 0 || misses != 2 || EC_POINT_cmp(group, hash_seed_point, expected, ctx) != 0;
+    if (print) {
+        printf("%6s Test 2 - 1: Seed points %s per VRF suite\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT cached" : "cached");
+    }
+
+    // verifiers take the seed points from the cache of their params only
+    key_pair kp;
+    key_pair_generate(group, &kp, ctx);
+    BIGNUM *randval;
+    EC_POINT *u = point_new(group);
+    nizk_dl_eq_proof pi;
+    prove_vrf(group, seed, &randval, u, &pi, &kp, NULL, ctx);
+    praos_vrf_params params = { PRAOS_VRF_SUITE_LEGACY, cache, NULL };
+    int ret2 = verify_vrf(group, seed, randval, u, &pi, kp.pub, &params, ctx);
+    ret2 |= verify_vrf(group, seed, randval, u, &pi, kp.pub, NULL, ctx);
+    seed_cache_get_stats(cache, &hits, &misses);
+    ret2 |= hits != 1 || misses != 2;
+    if (print) {
+        printf("%6s Test 2 - 2: Seed cache %s by the verifiers it is passed to\n", ret2 ? "NOT OK" : "OK", ret2 ? "NOT used correctly" : "used");
+    }
+
+    // verifiers without params use the process wide cache
+    long default_hits, default_misses;
+    seed_cache_get_stats(get0_seed_cache(), &default_hits, &default_misses);
+    int ret3 = verify_vrf(group, seed, randval, u, &pi, kp.pub, NULL, ctx);
+    ret3 |= verify_vrf(group, seed, randval, u, &pi, kp.pub, NULL, ctx);
+    seed_cache_get_stats(get0_seed_cache(), &hits, &misses);
+    ret3 |= hits - default_hits < 1 || (hits - default_hits) + (misses - default_misses) != 2;
+    if (print) {
+        printf("%6s Test 2 - 3: Process wide seed cache %s by the default verifiers\n", ret3 ? "NOT OK" : "OK", ret3 ? "NOT used" : "used");
+    }
+
+    // cleanup
+    nizk_dl_eq_proof_free(&pi);
+    point_free(u);
+    bn_free(randval);
+    key_pair_free(&kp);
+    point_free(expected);
+    point_free(hash_seed_point);
+    point_free(seed_point);
+    bn_free(seed);
+    seed_cache_free(cache);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0 && ret3 == 0);
+}
+
+typedef int (*test_function)(int);
+
+static test_function test_suite[] = {
+    &seed_cache_test_1,
+    &seed_cache_test_2
+};
+
+int seed_cache_test_suite(int print) {
+    if (print) {
+        printf("Seed cache test suite BEGIN -------------------------\n");
+    }
+    int num_tests = sizeof(test_suite)/sizeof(test_function);
+    int ret = 0;
+    for (int i=0; i<num_tests; i++) {
+        if (test_suite[i](print)) {
+            ret = 1;
+        }
+    }
+    if (print) {
+        printf("Seed cache test suite END ---------------------------\n");
+#ifdef DEBUG
+        print_allocation_status();
+#endif
+        fflush(stdout);
+    }
+    return ret;
+}
@@ -0,0 +1,38 @@
+//
+//  seed_cache.h
+//  OpenSSL-for-iOS
+//
+//  Bounded LRU cache of the points derived from a VRF seed (seed_point = [seed]G and hash_seed_point = H'(seed)).
+//  All leaders of a slot share the seed, so verifying their headers only has to derive the points once.
+//  Thread-safe, a single lock guards the table; misses are computed outside of it.
+//
+
+#ifndef SEED_CACHE_H
+#define SEED_CACHE_H
+#include "P256.h"
+
+typedef struct seed_cache seed_cache;
+
+#define SEED_CACHE_DEFAULT_CAPACITY 256
+
+// new empty cache holding at most capacity seeds
+seed_cache *seed_cache_new(const EC_GROUP *group, int capacity);
+
+void seed_cache_free(seed_cache *cache);
+
+// process wide cache of SEED_CACHE_DEFAULT_CAPACITY seeds, the seed_cache of the default praos_vrf_params
+seed_cache *get0_seed_cache(void);
+
+// copy the points derived from seed under suite (a praos_vrf_suite) to seed_point and hash_seed_point, derived and
+// inserted in place of the least recently used seed on a miss
+void seed_cache_lookup(seed_cache *cache, const BIGNUM *seed, int suite, EC_POINT *seed_point, EC_POINT *hash_seed_point, BN_CTX *ctx);
+
+// number of lookups answered from the cache and computed since creation or the last seed_cache_clear
+void seed_cache_get_stats(seed_cache *cache, long *hits, long *misses);
+
+// drop all seeds and reset the counters
+void seed_cache_clear(seed_cache *cache);
+
+int seed_cache_test_suite(int print);
+
+#endif /* SEED_CACHE_H */
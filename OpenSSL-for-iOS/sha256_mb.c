@@ -0,0 +1,419 @@
+//
+//  sha256_mb.c
+//  OpenSSL-for-iOS
+//
+#include "sha256_mb.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/sha.h>
+#include "config_platform.h"
+#include "openssl_hashing_tools.h"
+#include "vrf_metrics.h"
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+// the lane kernels are written with the vector extensions of GCC and Clang, other compilers hash one by one
+#if defined(__GNUC__)
+#define SHA256_MB_VECTOR 1
+#if defined(__x86_64__)
+#define SHA256_MB_X86_64 1
+#endif
+#endif
+
+#define SHA256_MB_BLOCK 64
+
+static int lanes_detected = 1;
+static int lanes_in_use = 1;
+static int have_sha_ni = 0;
+static int have_avx2 = 0;
+static int have_avx512 = 0;
+
+// message of one lane, the full blocks are read in place, the last one or two (padded) from tail
+typedef struct {
+    const unsigned char *msg;
+    size_t full_blocks;
+    size_t num_blocks;
+    unsigned char tail[2 * SHA256_MB_BLOCK];
+} sha256_mb_lane;
+
+static void lane_init(sha256_mb_lane *lane, const unsigned char *msg, size_t len) {
+    size_t rest = len % SHA256_MB_BLOCK;
+    size_t tail_len = rest + 9 > SHA256_MB_BLOCK ? 2 * SHA256_MB_BLOCK : SHA256_MB_BLOCK;
+    lane->msg = msg;
+    lane->full_blocks = len / SHA256_MB_BLOCK;
+    lane->num_blocks = lane->full_blocks + tail_len / SHA256_MB_BLOCK;
+    memset(lane->tail, 0, tail_len);
+    if (rest) {
+        memcpy(lane->tail, msg + len - rest, rest);
+    }
+    lane->tail[rest] = 0x80;
+    uint64_t bits = (uint64_t)len * 8;
+    for (int i=0; i<8; i++) {
+        lane->tail[tail_len - 1 - i] = (unsigned char)(bits >> (8 * i));
+    }
+}
+
+static const unsigned char *lane_block(const sha256_mb_lane *lane, size_t block) {
+    if (block < lane->full_blocks) {
+        return lane->msg + SHA256_MB_BLOCK * block;
+    }
+    return lane->tail + SHA256_MB_BLOCK * (block - lane->full_blocks);
+}
+
+// one message at a time through libcrypto (SHA-NI where the CPU has it)
+static void sha256_mb_x1(int num_msgs, const unsigned char *const *msg, const size_t *len, unsigned char *md) {
+    SHA256_CTX sha_ctx;
+    for (int i=0; i<num_msgs; i++) {
+        SHA256_Init(&sha_ctx);
+        SHA256_Update(&sha_ctx, msg[i], len[i]);
+        SHA256_Final(md + SHA256_DIGEST_LENGTH * i, &sha_ctx);
+    }
+}
+
+#if SHA256_MB_VECTOR
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t H0[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+// input for the lanes past the end of their message (their state is not updated)
+static const unsigned char zero_block[SHA256_MB_BLOCK] = { 0 };
+
+typedef uint32_t sha256_v4 __attribute__((vector_size(16)));
+typedef uint32_t sha256_v8 __attribute__((vector_size(32)));
+typedef uint32_t sha256_v16 __attribute__((vector_size(64)));
+
+static inline uint32_t load_be32(const unsigned char *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void store_be32(unsigned char *p, uint32_t x) {
+    p[0] = (unsigned char)(x >> 24);
+    p[1] = (unsigned char)(x >> 16);
+    p[2] = (unsigned char)(x >> 8);
+    p[3] = (unsigned char)x;
+}
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+// SHA-256 of up to L messages, lane j of every vector of type V holds message j; the message words are
+// transposed into the lanes block by block, lanes whose message is done keep their state
+#define SHA256_MB_KERNEL(name, V, L, attr) \
+attr static void name(int num_msgs, const unsigned char *const *msg, const size_t *len, unsigned char *md) { \
+    sha256_mb_lane lanes[L]; \
+    size_t max_blocks = 0; \
+    for (int j=0; j<num_msgs; j++) { \
+        lane_init(&lanes[j], msg[j], len[j]); \
+        max_blocks = lanes[j].num_blocks > max_blocks ? lanes[j].num_blocks : max_blocks; \
+    } \
+    V s[8], w[16], mask; \
+    uint32_t buf[16][L], active[L]; \
+    for (int i=0; i<8; i++) { \
+        s[i] = (V){ 0 } + H0[i]; \
+    } \
+    for (size_t block=0; block<max_blocks; block++) { \
+        for (int j=0; j<L; j++) { \
+            int live = j < num_msgs && block < lanes[j].num_blocks; \
+            const unsigned char *p = live ? lane_block(&lanes[j], block) : zero_block; \
+            active[j] = live ? 0xffffffff : 0; \
+            for (int t=0; t<16; t++) { \
+                buf[t][j] = load_be32(p + 4 * t); \
+            } \
+        } \
+        for (int t=0; t<16; t++) { \
+            memcpy(&w[t], buf[t], sizeof(V)); \
+        } \
+        memcpy(&mask, active, sizeof(V)); \
+        V a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7]; \
+        for (int t=0; t<64; t++) { \
+            if (t >= 16) { \
+                V w15 = w[(t - 15) & 15]; \
+                V w2 = w[(t - 2) & 15]; \
+                w[t & 15] += (ROTR(w15, 7) ^ ROTR(w15, 18) ^ (w15 >> 3)) + w[(t - 7) & 15] + \
+                             (ROTR(w2, 17) ^ ROTR(w2, 19) ^ (w2 >> 10)); \
+            } \
+            V t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + K[t] + w[t & 15]; \
+            V t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c)); \
+            h = g; \
+            g = f; \
+            f = e; \
+            e = d + t1; \
+            d = c; \
+            c = b; \
+            b = a; \
+            a = t1 + t2; \
+        } \
+        V in[8] = { a, b, c, d, e, f, g, h }; \
+        for (int i=0; i<8; i++) { \
+            s[i] = ((s[i] + in[i]) & mask) | (s[i] & ~mask); \
+        } \
+    } \
+    for (int i=0; i<8; i++) { \
+        memcpy(buf[i], &s[i], sizeof(V)); \
+    } \
+    for (int j=0; j<num_msgs; j++) { \
+        for (int i=0; i<8; i++) { \
+            store_be32(md + SHA256_DIGEST_LENGTH * j + 4 * i, buf[i][j]); \
+        } \
+    } \
+}
+
+SHA256_MB_KERNEL(sha256_mb_x4, sha256_v4, 4, )
+#if SHA256_MB_X86_64
+SHA256_MB_KERNEL(sha256_mb_x8, sha256_v8, 8, __attribute__((target("avx2"))))
+SHA256_MB_KERNEL(sha256_mb_x16, sha256_v16, 16, __attribute__((target("avx512f"))))
+#endif
+#endif /* SHA256_MB_VECTOR */
+
+static void sha256_mb_detect(void) {
+#if SHA256_MB_X86_64
+    __builtin_cpu_init();
+    have_sha_ni = __builtin_cpu_supports("sha");
+    have_avx2 = __builtin_cpu_supports("avx2");
+    have_avx512 = __builtin_cpu_supports("avx512f");
+#endif
+#if SHA256_MB_X86_64
+    // 16 lanes beat SHA-NI (slightly), SHA-NI beats 8 lanes; elsewhere libcrypto has the ARMv8 SHA-2
+    // instructions or the like, the 4-lane kernel is only picked for x86-64 without SHA-NI and AVX2
+    lanes_detected = have_avx512 ? 16 : have_sha_ni ? 1 : have_avx2 ? 8 : 4;
+#endif
+    lanes_in_use = lanes_detected;
+}
+
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+static INIT_ONCE detect_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK sha256_mb_detect_once(PINIT_ONCE once, PVOID param, PVOID *context) {
+    sha256_mb_detect();
+    return TRUE;
+}
+
+static void sha256_mb_init(void) {
+    InitOnceExecuteOnce(&detect_once, sha256_mb_detect_once, NULL, NULL);
+}
+#else
+static pthread_once_t detect_once = PTHREAD_ONCE_INIT;
+
+static void sha256_mb_init(void) {
+    int ret = pthread_once(&detect_once, sha256_mb_detect);
+    assert(ret == 0 && "sha256_mb_init: pthread_once failed");
+}
+#endif
+
+void sha256_mb(int num_msgs, const unsigned char *const *msg, const size_t *len, unsigned char *md) {
+    sha256_mb_init();
+    if (vrf_metrics_enabled()) {
+        uint64_t num_blocks = 0;
+        for (int i=0; i<num_msgs; i++) {
+            num_blocks += (len[i] + 9 + SHA256_MB_BLOCK - 1) / SHA256_MB_BLOCK;
+        }
+        vrf_metrics_add(VRF_METRICS_SHA256_BLOCKS, num_blocks);
+    }
+    int lanes = lanes_in_use;
+    for (int i=0; i<num_msgs; i+=lanes) {
+        int n = num_msgs - i < lanes ? num_msgs - i : lanes;
+        unsigned char *out = md + SHA256_DIGEST_LENGTH * i;
+        switch (lanes) {
+#if SHA256_MB_VECTOR
+            case 4:
+                sha256_mb_x4(n, msg + i, len + i, out);
+                break;
+#if SHA256_MB_X86_64
+            case 8:
+                sha256_mb_x8(n, msg + i, len + i, out);
+                break;
+            case 16:
+                sha256_mb_x16(n, msg + i, len + i, out);
+                break;
+#endif
+#endif
+            default:
+                sha256_mb_x1(n, msg + i, len + i, out);
+        }
+    }
+}
+
+const char *sha256_mb_kernel(void) {
+    sha256_mb_init();
+    switch (lanes_in_use) {
+        case 16:
+            return "avx512";
+        case 8:
+            return "avx2";
+        case 4:
+            return "vector";
+        default:
+            return have_sha_ni ? "sha-ni" : "libcrypto";
+    }
+}
+
+int sha256_mb_lanes(void) {
+    sha256_mb_init();
+    return lanes_in_use;
+}
+
+int sha256_mb_set_lanes(int lanes) {
+    sha256_mb_init();
+    int supported = lanes == 0 || lanes == 1;
+#if SHA256_MB_VECTOR
+    supported = supported || lanes == 4 || (lanes == 8 && have_avx2) || (lanes == 16 && have_avx512);
+#endif
+    if (!supported) {
+        return 1;
+    }
+    lanes_in_use = lanes ? lanes : lanes_detected;
+    return 0;
+}
+
+/*
+ *
+ *  sha256_mb tests
+ *
+ */
+static int sha256_mb_test_1(int print) {
+    // lengths around the padding boundaries (55, 56, 64) and the 6-point and 2-point transcripts (198, 66 bytes)
+    static const size_t lengths[] = { 0, 1, 55, 56, 63, 64, 65, 66, 119, 120, 128, 198, 300, 1000 };
+    int num_msgs = 2 * SHA256_MB_MAX_LANES + 3;
+    int num_lengths = sizeof(lengths) / sizeof(size_t);
+    unsigned char *data = malloc(num_msgs * 1000);
+    const unsigned char **msg = malloc(num_msgs * sizeof(unsigned char*));
+    size_t *len = malloc(num_msgs * sizeof(size_t));
+    unsigned char *md = malloc(num_msgs * SHA256_DIGEST_LENGTH);
+    unsigned char expected[SHA256_DIGEST_LENGTH];
+    assert(data && msg && len && md && "sha256_mb_test_1: allocation error");
+    for (int i=0; i<num_msgs*1000; i++) {
+        data[i] = (unsigned char)(i * 131 + 7);
+    }
+    for (int i=0; i<num_msgs; i++) {
+        msg[i] = data + 1000 * i;
+        len[i] = lengths[i % num_lengths];
+    }
+
+    // every kernel the CPU supports, one length per message and all messages the same length
+    static const int kernels[] = { 1, 4, 8, 16 };
+    int ret1 = 0;
+    int ret2 = 0;
+    for (int k=0; k<4; k++) {
+        if (sha256_mb_set_lanes(kernels[k])) {
+            continue;
+        }
+        sha256_mb(num_msgs, msg, len, md);
+        for (int i=0; i<num_msgs; i++) {
+            SHA256(msg[i], len[i], expected);
+            ret1 |= memcmp(md + SHA256_DIGEST_LENGTH * i, expected, SHA256_DIGEST_LENGTH) != 0;
+        }
+        for (int l=0; l<num_lengths; l++) {
+            for (int i=0; i<num_msgs; i++) {
+                len[i] = lengths[l];
+            }
+            sha256_mb(num_msgs, msg, len, md);
+            for (int i=0; i<num_msgs; i++) {
+                SHA256(msg[i], len[i], expected);
+                ret2 |= memcmp(md + SHA256_DIGEST_LENGTH * i, expected, SHA256_DIGEST_LENGTH) != 0;
+            }
+        }
+        for (int i=0; i<num_msgs; i++) {
+            len[i] = lengths[i % num_lengths];
+        }
+    }
+    sha256_mb_set_lanes(0);
+    if (print) {
+        printf("%6s Test 1 - 1: Multi-buffer digests of mixed lengths %s SHA-256\n", ret1 ? "NOT OK" : "OK", ret1 ? "do NOT match" : "match");
+        printf("%6s Test 1 - 2: Multi-buffer digests of equal lengths %s SHA-256\n", ret2 ? "NOT OK" : "OK", ret2 ? "do NOT match" : "match");
+    }
+
+    // cleanup
+    free(md);
+    free(len);
+    free(msg);
+    free(data);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0);
+}
+
+static int sha256_mb_test_2(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    int num_msgs = SHA256_MB_MAX_LANES + 5;
+    int list_len = 6;
+    const EC_POINT **points[6];
+    EC_POINT **p = malloc(list_len * num_msgs * sizeof(EC_POINT*));
+    assert(p && "sha256_mb_test_2: allocation error");
+    for (int k=0; k<list_len; k++) {
+        points[k] = (const EC_POINT**)(p + k * num_msgs);
+        for (int i=0; i<num_msgs; i++) {
+            p[k * num_msgs + i] = point_random(group, ctx);
+        }
+    }
+    EC_POINT_set_to_infinity(group, p[1]); // encoded in a single byte
+
+    // transcripts hashed in lockstep against openssl_hash_points2bn one by one
+    BIGNUM **c = bn_new_array(num_msgs);
+    openssl_hash_point_columns2bn_r(c, group, ctx, num_msgs, list_len, points);
+    int ret1 = 0;
+    for (int i=0; i<num_msgs; i++) {
+        BIGNUM *expected = openssl_hash_points2bn(group, ctx, 6, points[0][i], points[1][i], points[2][i], points[3][i], points[4][i], points[5][i]);
+        ret1 |= BN_cmp(c[i], expected) != 0;
+        bn_free(expected);
+    }
+    if (print) {
+        printf("%6s Test 2 - 1: Point transcripts hashed in lockstep %s the single hashes\n", ret1 ? "NOT OK" : "OK", ret1 ? "do NOT match" : "match");
+    }
+
+    // cleanup
+    bn_free_array(num_msgs, c);
+    for (int i=0; i<list_len*num_msgs; i++) {
+        point_free(p[i]);
+    }
+    free(p);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0);
+}
+
+typedef int (*test_function)(int);
+
+static test_function test_suite[] = {
+    &sha256_mb_test_1,
+    &sha256_mb_test_2
+};
+
+int sha256_mb_test_suite(int print) {
+    if (print) {
+        printf("SHA-256 multi-buffer test suite BEGIN ---------------\n");
+        printf("Kernel: %s\n", sha256_mb_kernel());
+    }
+    int num_tests = sizeof(test_suite)/sizeof(test_function);
+    int ret = 0;
+    for (int i=0; i<num_tests; i++) {
+        if (test_suite[i](print)) {
+            ret = 1;
+        }
+    }
+    if (print) {
+        printf("SHA-256 multi-buffer test suite END -----------------\n");
+#ifdef DEBUG
+        print_allocation_status();
+#endif
+        fflush(stdout);
+    }
+    return ret;
+}
@@ -0,0 +1,31 @@
+//
+//  sha256_mb.h
+//  OpenSSL-for-iOS
+//
+//  Multi-buffer SHA-256: independent messages hashed in lockstep, one message per vector lane (16 lanes with
+//  AVX-512, 8 with AVX2, 4 with SSE2). Without AVX-512 but with the SHA extensions (SHA-NI, ARMv8) the messages
+//  go one by one through libcrypto, whose SHA instruction code is faster than 8 or 4 lanes.
+//
+
+#ifndef SHA256_MB_H
+#define SHA256_MB_H
+#include <stddef.h>
+
+#define SHA256_MB_MAX_LANES 16
+
+// md + 32 * i = SHA-256(msg[i], len[i]) for i < num_msgs (messages of any length, lengths may differ)
+void sha256_mb(int num_msgs, const unsigned char *const *msg, const size_t *len, unsigned char *md);
+
+// kernel in use, "avx512" (16 lanes), "avx2" (8), "vector" (4), "sha-ni" or "libcrypto" (1)
+const char *sha256_mb_kernel(void);
+
+// number of messages hashed in lockstep by the kernel in use
+int sha256_mb_lanes(void);
+
+// force the kernel with the given number of lanes (1, 4, 8 or 16, if supported), 0 for the detected one,
+// returns 0 on success
+int sha256_mb_set_lanes(int lanes);
+
+int sha256_mb_test_suite(int print);
+
+#endif /* SHA256_MB_H */
@@ -12,8 +12,23 @@
 #include <openssl/ecdsa.h>
 #include <openssl/objects.h>
 #include <openssl/rand.h>
+#include "leader_schedule.h"
+#include "openssl_hashing_tools.h"
+#include "p256_native.h"
 #include "platform_measurement_utils.h"
 #include "praos_vrf.h"
+#include "pubkey_registry.h"
+#include "schnorr.h"
+#include "scrape_ldt.h"
+#include "seed_cache.h"
+#include "sha256_mb.h"
+#include "threshold.h"
+#include "verify_cache.h"
+#include "vrf_engine.h"
+
+// seed points derived on every call, the VRF verification benchmarks time the whole verification unless they
+// measure a cache
+static const praos_vrf_params vrf_uncached_params = { PRAOS_VRF_SUITE_LEGACY, NULL, NULL };
 
 void handleErrors(const char *msg) {
     fprintf(stderr, "Error: %s\n", msg);
@@ -48,15 +63,13 @@ double ecdsa_speed(int num_reps) {
     unsigned char digest[32];
     SHA256((const unsigned char *)message, message_len, digest);
     
-    platform_time_type start = platform_utils_get_wall_time();
-    
-
-    // Sign the message
+    // Sign the message (not timed, only the verifications are)
     signature = ECDSA_do_sign(digest, sizeof(digest), ec_key);
     if (!signature) {
         handleErrors("Failed to sign the message");
     }
     
+    platform_time_type start = platform_utils_get_wall_time();
     for(int i = 0; i < num_reps; i++) {
         // Verify the signature
         if (ECDSA_do_verify(digest, sizeof(digest), signature, ec_key) != 1) {
@@ -75,7 +88,8 @@ double ecdsa_speed(int num_reps) {
     return sig_speed;
 }
 
-double praos_vrf_speed(int num_reps) {
+// VRF verification of one output under params
+static double vrf_verify_speed(int num_reps, const praos_vrf_params *params) {
     
     const EC_GROUP *group = get0_group();
     BN_CTX *ctx = BN_CTX_new();
@@ -87,13 +101,13 @@ double praos_vrf_speed(int num_reps) {
     EC_POINT *u = point_new(group);
     nizk_dl_eq_proof pi;
     
-    prove_vrf(group, seed, &rand_val, u, &pi, &kp, ctx);
+    prove_vrf(group, seed, &rand_val, u, &pi, &kp, params, ctx);
     
     int ver;
     
     platform_time_type start = platform_utils_get_wall_time();
     for(int i = 0; i < num_reps; i++) {
-        ver = verify_vrf(group, seed, rand_val, u, &pi, kp.pub, ctx);
+        ver = verify_vrf(group, seed, rand_val, u, &pi, kp.pub, params, ctx);
     }
     
     platform_time_type end = platform_utils_get_wall_time();
@@ -115,3 +129,1077 @@ double praos_vrf_speed(int num_reps) {
     return vrf_speed;
 
 }
+
+double praos_vrf_speed(int num_reps) {
+    return vrf_verify_speed(num_reps, &vrf_uncached_params);
+}
+
+// VRF-shaped proof statements (a random, b the generator) for the NIZK DL EQ benchmarks
+static void nizk_dl_eq_speed_setup(const EC_GROUP *group, int num_proofs, BIGNUM **exp, EC_POINT **a, EC_POINT **A, const EC_POINT **b, EC_POINT **B, nizk_dl_eq_proof *pi, BN_CTX *ctx) {
+    for (int i = 0; i < num_proofs; i++) {
+        exp[i] = bn_random(get0_order(group), ctx);
+        a[i] = point_random(group, ctx);
+        A[i] = point_new(group);
+        point_mul(group, A[i], exp[i], a[i], ctx);
+        b[i] = get0_generator(group);
+        B[i] = bn2point(group, exp[i], ctx);
+        nizk_dl_eq_prove(group, exp[i], a[i], A[i], b[i], B[i], &pi[i], ctx);
+    }
+}
+
+static void nizk_dl_eq_speed_cleanup(int num_proofs, BIGNUM **exp, EC_POINT **a, EC_POINT **A, EC_POINT **B, nizk_dl_eq_proof *pi) {
+    for (int i = 0; i < num_proofs; i++) {
+        nizk_dl_eq_proof_free(&pi[i]);
+        point_free(a[i]);
+        point_free(A[i]);
+        point_free(B[i]);
+        bn_free(exp[i]);
+    }
+}
+
+double nizk_dl_eq_speed(int num_reps) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    BIGNUM *exp;
+    EC_POINT *a, *A, *B;
+    const EC_POINT *b;
+    nizk_dl_eq_proof pi;
+    nizk_dl_eq_speed_setup(group, 1, &exp, &a, &A, &b, &B, &pi, ctx);
+
+    int ver = 0;
+
+    platform_time_type start = platform_utils_get_wall_time();
+    for(int i = 0; i < num_reps; i++) {
+        ver |= nizk_dl_eq_verify(group, a, A, b, B, &pi, ctx);
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double nizk_speed = platform_utils_get_wall_time_diff(start, end);
+
+    if (ver != 0) {
+        printf("NIZK DL EQ FAILED to verify!\n");
+    }
+
+    nizk_dl_eq_speed_cleanup(1, &exp, &a, &A, &B, &pi);
+    BN_CTX_free(ctx);
+
+    return nizk_speed;
+}
+
+// returns the verification time per proof when verifying batches of batch_size proofs
+double nizk_dl_eq_batch_speed(int batch_size, int num_reps) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    BIGNUM **exp = malloc(batch_size * sizeof(BIGNUM*));
+    EC_POINT **a = malloc(batch_size * sizeof(EC_POINT*));
+    EC_POINT **A = malloc(batch_size * sizeof(EC_POINT*));
+    const EC_POINT **b = malloc(batch_size * sizeof(EC_POINT*));
+    EC_POINT **B = malloc(batch_size * sizeof(EC_POINT*));
+    nizk_dl_eq_proof *pi = malloc(batch_size * sizeof(nizk_dl_eq_proof));
+    if (!exp || !a || !A || !b || !B || !pi) {
+        handleErrors("Failed to allocate NIZK DL EQ batch");
+    }
+    nizk_dl_eq_speed_setup(group, batch_size, exp, a, A, b, B, pi, ctx);
+
+    int ver = 0;
+
+    platform_time_type start = platform_utils_get_wall_time();
+    for(int i = 0; i < num_reps; i++) {
+        ver |= nizk_dl_eq_verify_batch(group, batch_size, (const EC_POINT**)a, (const EC_POINT**)A, b, (const EC_POINT**)B, pi, NULL, ctx);
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double batch_speed = platform_utils_get_wall_time_diff(start, end) / ((double)num_reps * batch_size);
+
+    if (ver != 0) {
+        printf("NIZK DL EQ batch FAILED to verify!\n");
+    }
+
+    nizk_dl_eq_speed_cleanup(batch_size, exp, a, A, B, pi);
+    free(exp);
+    free(a);
+    free(A);
+    free(b);
+    free(B);
+    free(pi);
+    BN_CTX_free(ctx);
+
+    return batch_speed;
+}
+
+// returns the verification time per VRF output when verifying batches of batch_size outputs,
+// proofs_per_seed leaders share each seed
+double praos_vrf_batch_speed(int batch_size, int proofs_per_seed, int num_reps) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    key_pair *kp = malloc(batch_size * sizeof(key_pair));
+    BIGNUM **seed = malloc(batch_size * sizeof(BIGNUM*));
+    BIGNUM **rand_val = malloc(batch_size * sizeof(BIGNUM*));
+    EC_POINT **u = malloc(batch_size * sizeof(EC_POINT*));
+    EC_POINT **pub_key = malloc(batch_size * sizeof(EC_POINT*));
+    nizk_dl_eq_proof *pi = malloc(batch_size * sizeof(nizk_dl_eq_proof));
+    if (!kp || !seed || !rand_val || !u || !pub_key || !pi) {
+        handleErrors("Failed to allocate VRF batch");
+    }
+    for (int i = 0; i < batch_size; i++) {
+        key_pair_generate(group, &kp[i], ctx);
+        seed[i] = (i % proofs_per_seed) ? seed[i - 1] : bn_random(get0_order(group), ctx);
+        u[i] = point_new(group);
+        prove_vrf(group, seed[i], &rand_val[i], u[i], &pi[i], &kp[i], NULL, ctx);
+        pub_key[i] = kp[i].pub;
+    }
+
+    int ver = 0;
+
+    platform_time_type start = platform_utils_get_wall_time();
+    for(int i = 0; i < num_reps; i++) {
+        ver |= verify_vrf_batch(group, batch_size, seed, rand_val, u, pi, pub_key, NULL, &vrf_uncached_params, ctx);
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double batch_speed = platform_utils_get_wall_time_diff(start, end) / ((double)num_reps * batch_size);
+
+    if (ver != 0) {
+        printf("VRF batch FAILED to verify!\n");
+    }
+
+    for (int i = 0; i < batch_size; i++) {
+        if (i % proofs_per_seed == 0) {
+            bn_free(seed[i]);
+        }
+        nizk_dl_eq_proof_free(&pi[i]);
+        point_free(u[i]);
+        bn_free(rand_val[i]);
+        key_pair_free(&kp[i]);
+    }
+    free(kp);
+    free(seed);
+    free(rand_val);
+    free(u);
+    free(pub_key);
+    free(pi);
+    BN_CTX_free(ctx);
+
+    return batch_speed;
+}
+
+// single VRF verifications of a slot, proofs_per_seed leaders share each seed, the seed cache starts empty
+// on every repetition (time per proof)
+double praos_vrf_seed_cache_speed(int num_proofs, int proofs_per_seed, int num_reps, int use_cache) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    key_pair *kp = malloc(num_proofs * sizeof(key_pair));
+    BIGNUM **seed = malloc(num_proofs * sizeof(BIGNUM*));
+    BIGNUM **rand_val = malloc(num_proofs * sizeof(BIGNUM*));
+    EC_POINT **u = malloc(num_proofs * sizeof(EC_POINT*));
+    nizk_dl_eq_proof *pi = malloc(num_proofs * sizeof(nizk_dl_eq_proof));
+    if (!kp || !seed || !rand_val || !u || !pi) {
+        handleErrors("Failed to allocate VRF proofs");
+    }
+    for (int i = 0; i < num_proofs; i++) {
+        key_pair_generate(group, &kp[i], ctx);
+        seed[i] = (i % proofs_per_seed) ? seed[i - 1] : bn_random(get0_order(group), ctx);
+        u[i] = point_new(group);
+        prove_vrf(group, seed[i], &rand_val[i], u[i], &pi[i], &kp[i], NULL, ctx);
+    }
+    seed_cache *cache = get0_seed_cache();
+    praos_vrf_params params = { PRAOS_VRF_SUITE_LEGACY, use_cache ? cache : NULL, NULL };
+
+    int ver = 0;
+
+    platform_time_type start = platform_utils_get_wall_time();
+    for(int r = 0; r < num_reps; r++) {
+        seed_cache_clear(cache);
+        for (int i = 0; i < num_proofs; i++) {
+            ver |= verify_vrf(group, seed[i], rand_val[i], u[i], &pi[i], kp[i].pub, &params, ctx);
+        }
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double vrf_speed = platform_utils_get_wall_time_diff(start, end) / ((double)num_reps * num_proofs);
+
+    if (ver != 0) {
+        printf("VRF (seed cache) FAILED to verify!\n");
+    }
+    if (use_cache) {
+        long hits, misses;
+        seed_cache_get_stats(cache, &hits, &misses);
+        printf("Seed cache: %ld hits, %ld misses\n", hits, misses);
+    }
+
+    for (int i = 0; i < num_proofs; i++) {
+        if (i % proofs_per_seed == 0) {
+            bn_free(seed[i]);
+        }
+        nizk_dl_eq_proof_free(&pi[i]);
+        point_free(u[i]);
+        bn_free(rand_val[i]);
+        key_pair_free(&kp[i]);
+    }
+    free(kp);
+    free(seed);
+    free(rand_val);
+    free(u);
+    free(pi);
+    BN_CTX_free(ctx);
+
+    return vrf_speed;
+}
+
+// generator multiplication, through the fixed-base table of the group or with the generator as a variable base
+double bn2point_speed(int num_reps, int use_generator_table) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    BIGNUM *bn = bn_random(get0_order(group), ctx);
+    EC_POINT *point = point_new(group);
+
+    platform_time_type start = platform_utils_get_wall_time();
+    for(int i = 0; i < num_reps; i++) {
+        if (use_generator_table) {
+            EC_POINT_mul(group, point, bn, NULL, NULL, ctx);
+        } else {
+            EC_POINT_mul(group, point, NULL, get0_generator(group), bn, ctx);
+        }
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double mul_speed = platform_utils_get_wall_time_diff(start, end);
+
+    point_free(point);
+    bn_free(bn);
+    BN_CTX_free(ctx);
+
+    return mul_speed;
+}
+
+// ECDSA verification against a key from the public key registry
+double ecdsa_registry_speed(int num_reps) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    EC_KEY *ec_key = EC_KEY_new();
+    if (!ec_key || EC_KEY_set_group(ec_key, group) != 1 || EC_KEY_generate_key(ec_key) != 1) {
+        handleErrors("Failed to generate key pair");
+    }
+    pubkey_registry *reg = pubkey_registry_new(group);
+    int key_index = pubkey_registry_add(reg, EC_KEY_get0_public_key(ec_key), ctx);
+
+    const char *message = "Hello, ECDSA!";
+    unsigned char digest[32];
+    SHA256((const unsigned char *)message, strlen(message), digest);
+    ECDSA_SIG *signature = ECDSA_do_sign(digest, sizeof(digest), ec_key);
+    if (!signature) {
+        handleErrors("Failed to sign the message");
+    }
+
+    platform_time_type start = platform_utils_get_wall_time();
+    for(int i = 0; i < num_reps; i++) {
+        if (pubkey_registry_ecdsa_verify(reg, key_index, digest, sizeof(digest), signature, ctx) != 0) {
+            handleErrors("Failed to verify the signature");
+        }
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double sig_speed = platform_utils_get_wall_time_diff(start, end);
+
+    ECDSA_SIG_free(signature);
+    pubkey_registry_free(reg);
+    EC_KEY_free(ec_key);
+    BN_CTX_free(ctx);
+
+    return sig_speed;
+}
+
+// returns the verification time per Schnorr signature for batch_size signatures under as many keys (keys and
+// signatures decoded, as received), verified with schnorr_verify_batch or (batch = 0) one by one
+double schnorr_speed(int batch_size, int num_reps, int batch) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    const EC_POINT **pub = malloc(batch_size * sizeof(EC_POINT*));
+    const unsigned char **msg = malloc(batch_size * sizeof(unsigned char*));
+    size_t *msg_len = malloc(batch_size * sizeof(size_t));
+    schnorr_sig *sig = malloc(batch_size * sizeof(schnorr_sig));
+    if (!pub || !msg || !msg_len || !sig) {
+        handleErrors("Failed to allocate Schnorr batch");
+    }
+
+    const char *message = "Hello, Schnorr!";
+    for (int i = 0; i < batch_size; i++) {
+        BIGNUM *priv = bn_random(get0_order(group), ctx);
+        EC_POINT *key = bn2point(group, priv, ctx);
+        EC_POINT *pub_decoded = point_new(group);
+        schnorr_sig sig_signed;
+        unsigned char pub_bytes[P256_POINT_BYTES];
+        unsigned char sig_bytes[SCHNORR_SIG_BYTES];
+        schnorr_sign(group, priv, key, (const unsigned char *)message, strlen(message), &sig_signed, ctx);
+        if (point_to_bytes(group, key, pub_bytes, ctx) || point_from_bytes(group, pub_decoded, pub_bytes, ctx) ||
+            schnorr_sig_to_bytes(group, &sig_signed, sig_bytes, ctx) || schnorr_sig_from_bytes(group, &sig[i], sig_bytes, ctx)) {
+            handleErrors("Failed to encode the signature");
+        }
+        pub[i] = pub_decoded;
+        msg[i] = (const unsigned char *)message;
+        msg_len[i] = strlen(message);
+        schnorr_sig_free(&sig_signed);
+        point_free(key);
+        bn_free(priv);
+    }
+
+    int ver = 0;
+
+    platform_time_type start = platform_utils_get_wall_time();
+    for(int i = 0; i < num_reps; i++) {
+        if (batch) {
+            ver |= schnorr_verify_batch(group, batch_size, pub, msg, msg_len, sig, NULL, ctx);
+        } else {
+            for (int j = 0; j < batch_size; j++) {
+                ver |= schnorr_verify(group, pub[j], msg[j], msg_len[j], &sig[j], ctx);
+            }
+        }
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double sig_speed = platform_utils_get_wall_time_diff(start, end) / ((double)num_reps * batch_size);
+
+    if (ver != 0) {
+        printf("Schnorr signatures FAILED to verify!\n");
+    }
+
+    for (int i = 0; i < batch_size; i++) {
+        schnorr_sig_free(&sig[i]);
+        point_free((EC_POINT*)pub[i]);
+    }
+    free(pub);
+    free(msg);
+    free(msg_len);
+    free(sig);
+    BN_CTX_free(ctx);
+
+    return sig_speed;
+}
+
+// VRF verification against a key from the public key registry
+double praos_vrf_registry_speed(int num_reps) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    key_pair kp;
+    key_pair_generate(group, &kp, ctx);
+    pubkey_registry *reg = pubkey_registry_new(group);
+    int key_index = pubkey_registry_add(reg, kp.pub, ctx);
+
+    BIGNUM *seed = bn_random(get0_order(group), ctx);
+    BIGNUM *rand_val;
+    EC_POINT *u = point_new(group);
+    nizk_dl_eq_proof pi;
+    prove_vrf(group, seed, &rand_val, u, &pi, &kp, NULL, ctx);
+
+    int ver = 0;
+
+    platform_time_type start = platform_utils_get_wall_time();
+    for(int i = 0; i < num_reps; i++) {
+        ver |= verify_vrf_registered(group, seed, rand_val, u, &pi, reg, key_index, &vrf_uncached_params, ctx);
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double vrf_speed = platform_utils_get_wall_time_diff(start, end);
+
+    if (ver != 0) {
+        printf("VRF (registered key) FAILED to verify!\n");
+    }
+
+    nizk_dl_eq_proof_free(&pi);
+    point_free(u);
+    bn_free(rand_val);
+    bn_free(seed);
+    pubkey_registry_free(reg);
+    key_pair_free(&kp);
+    BN_CTX_free(ctx);
+
+    return vrf_speed;
+}
+
+// returns the time per term of point_weighted_sum, or of a point_mul/point_add loop
+double point_weighted_sum_speed(int num_terms, int use_loop) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    BIGNUM **w = malloc(num_terms * sizeof(BIGNUM*));
+    EC_POINT **p = malloc(num_terms * sizeof(EC_POINT*));
+    if (!w || !p) {
+        handleErrors("Failed to allocate weighted sum terms");
+    }
+    for (int i = 0; i < num_terms; i++) {
+        w[i] = bn_random(get0_order(group), ctx);
+        p[i] = point_random(group, ctx);
+    }
+    EC_POINT *r = point_new(group);
+    EC_POINT *t = point_new(group);
+
+    platform_time_type start = platform_utils_get_wall_time();
+    if (use_loop) {
+        point_mul(group, r, w[0], p[0], ctx);
+        for (int i = 1; i < num_terms; i++) {
+            point_mul(group, t, w[i], p[i], ctx);
+            point_add(group, r, r, t, ctx);
+        }
+    } else {
+        point_weighted_sum(group, r, num_terms, (const BIGNUM**)w, (const EC_POINT**)p, ctx);
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double sum_speed = platform_utils_get_wall_time_diff(start, end) / num_terms;
+
+    for (int i = 0; i < num_terms; i++) {
+        bn_free(w[i]);
+        point_free(p[i]);
+    }
+    free(w);
+    free(p);
+    point_free(r);
+    point_free(t);
+    BN_CTX_free(ctx);
+
+    return sum_speed;
+}
+
+// VRF verification with scratch values from an arena (no allocation in the loop)
+double praos_vrf_arena_speed(int num_reps) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    p256_arena *arena = p256_arena_new(group, PRAOS_VRF_ARENA_BNS, PRAOS_VRF_ARENA_POINTS);
+    key_pair kp;
+    key_pair_generate(group, &kp, ctx);
+    BIGNUM *seed = bn_random(get0_order(group), ctx);
+    BIGNUM *rand_val = bn_new();
+    EC_POINT *u = point_new(group);
+    nizk_dl_eq_proof pi;
+    nizk_dl_eq_proof_init(group, &pi);
+    prove_vrf_arena(group, seed, rand_val, u, &pi, &kp, NULL, arena);
+
+    int ver = 0;
+
+    platform_time_type start = platform_utils_get_wall_time();
+    for(int i = 0; i < num_reps; i++) {
+        ver |= verify_vrf_arena(group, seed, rand_val, u, &pi, kp.pub, &vrf_uncached_params, arena);
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double vrf_speed = platform_utils_get_wall_time_diff(start, end);
+
+    if (ver != 0) {
+        printf("VRF (arena) FAILED to verify!\n");
+    }
+
+    nizk_dl_eq_proof_free(&pi);
+    point_free(u);
+    bn_free(rand_val);
+    bn_free(seed);
+    key_pair_free(&kp);
+    p256_arena_free(arena);
+    BN_CTX_free(ctx);
+
+    return vrf_speed;
+}
+
+// seed to point mapping alone under the given praos_vrf_suite
+double vrf_hash_seed_speed(int num_reps, int suite) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    BIGNUM *seed = bn_random(get0_order(group), ctx);
+    EC_POINT *hash_seed_point = point_new(group);
+
+    platform_time_type start = platform_utils_get_wall_time();
+    for(int i = 0; i < num_reps; i++) {
+        vrf_hash_seed_r(group, hash_seed_point, seed, (praos_vrf_suite)suite, ctx);
+        BN_add_word(seed, 1);
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double hash_speed = platform_utils_get_wall_time_diff(start, end);
+
+    point_free(hash_seed_point);
+    bn_free(seed);
+    BN_CTX_free(ctx);
+
+    return hash_speed;
+}
+
+// VRF verification under the given praos_vrf_suite (seed points derived on every call)
+double praos_vrf_suite_speed(int num_reps, int suite) {
+
+    praos_vrf_params params = { (praos_vrf_suite)suite, NULL, NULL };
+    double vrf_speed = vrf_verify_speed(num_reps, &params);
+
+    return vrf_speed;
+}
+
+// VRF verification straight from the fixed-size encoding
+double praos_vrf_bytes_speed(int num_reps) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    key_pair kp;
+    key_pair_generate(group, &kp, ctx);
+    BIGNUM *seed = bn_random(get0_order(group), ctx);
+    BIGNUM *rand_val;
+    EC_POINT *u = point_new(group);
+    nizk_dl_eq_proof pi;
+    prove_vrf(group, seed, &rand_val, u, &pi, &kp, NULL, ctx);
+    unsigned char buf[VRF_OUTPUT_BYTES];
+    if (vrf_output_to_bytes(group, u, &pi, rand_val, PRAOS_VRF_SUITE_LEGACY, buf, ctx)) {
+        handleErrors("Failed to encode VRF output");
+    }
+
+    int ver = 0;
+
+    platform_time_type start = platform_utils_get_wall_time();
+    for(int i = 0; i < num_reps; i++) {
+        ver |= verify_vrf_bytes(group, seed, buf, kp.pub, &vrf_uncached_params, ctx);
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double vrf_speed = platform_utils_get_wall_time_diff(start, end);
+
+    if (ver != 0) {
+        printf("Encoded VRF FAILED to verify!\n");
+    }
+
+    nizk_dl_eq_proof_free(&pi);
+    point_free(u);
+    bn_free(rand_val);
+    bn_free(seed);
+    key_pair_free(&kp);
+    BN_CTX_free(ctx);
+
+    return vrf_speed;
+}
+
+// seconds per encoded VRF output received copies times each (gossip from several peers), verified with or without
+// the verify cache
+double praos_vrf_verify_cache_speed(int num_outputs, int copies, int use_cache) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    key_pair kp;
+    key_pair_generate(group, &kp, ctx);
+    BIGNUM *seed = bn_random(get0_order(group), ctx);
+    EC_POINT *u = point_new(group);
+    unsigned char *outputs = malloc(num_outputs * VRF_OUTPUT_BYTES);
+    if (!outputs) {
+        handleErrors("Failed to allocate VRF outputs");
+    }
+    for (int i = 0; i < num_outputs; i++) {
+        BIGNUM *randval;
+        nizk_dl_eq_proof pi;
+        BN_add_word(seed, 1);
+        prove_vrf(group, seed, &randval, u, &pi, &kp, NULL, ctx);
+        vrf_output_to_bytes(group, u, &pi, randval, PRAOS_VRF_SUITE_LEGACY, outputs + i * VRF_OUTPUT_BYTES, ctx);
+        nizk_dl_eq_proof_free(&pi);
+        bn_free(randval);
+    }
+    verify_cache *cache = verify_cache_new(VERIFY_CACHE_DEFAULT_CAPACITY, VERIFY_CACHE_LRU);
+    praos_vrf_params params = { PRAOS_VRF_SUITE_LEGACY, NULL, use_cache ? cache : NULL };
+
+    int failed = 0;
+    platform_time_type start = platform_utils_get_wall_time();
+    for (int c = 0; c < copies; c++) {
+        BN_sub_word(seed, num_outputs);
+        for (int i = 0; i < num_outputs; i++) {
+            BN_add_word(seed, 1);
+            failed |= verify_vrf_bytes(group, seed, outputs + i * VRF_OUTPUT_BYTES, kp.pub, &params, ctx);
+        }
+    }
+    platform_time_type end = platform_utils_get_wall_time();
+    double per_output = platform_utils_get_wall_time_diff(start, end) / ((double)num_outputs * copies);
+
+    if (failed) {
+        printf("VRF outputs FAILED to verify!\n");
+    }
+
+    verify_cache_free(cache);
+    free(outputs);
+    point_free(u);
+    bn_free(seed);
+    key_pair_free(&kp);
+    BN_CTX_free(ctx);
+
+    return per_output;
+}
+
+// VRF verification throughput (outputs per second) of the multi-threaded engine
+double vrf_engine_speed(int num_threads, int num_jobs, int pin_threads) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    key_pair *kp = malloc(num_jobs * sizeof(key_pair));
+    nizk_dl_eq_proof *pi = malloc(num_jobs * sizeof(nizk_dl_eq_proof));
+    vrf_verify_job *jobs = malloc(num_jobs * sizeof(vrf_verify_job));
+    if (!kp || !pi || !jobs) {
+        handleErrors("Failed to allocate VRF jobs");
+    }
+    for (int i = 0; i < num_jobs; i++) {
+        key_pair_generate(group, &kp[i], ctx);
+        jobs[i].seed = (i % 10) ? jobs[i - 1].seed : bn_random(get0_order(group), ctx);
+        jobs[i].u = point_new(group);
+        jobs[i].pi = &pi[i];
+        jobs[i].pub_key = kp[i].pub;
+        prove_vrf(group, jobs[i].seed, &jobs[i].randval, jobs[i].u, &pi[i], &kp[i], NULL, ctx);
+    }
+
+    vrf_engine *engine = vrf_engine_new(num_threads, pin_threads);
+
+    platform_time_type start = platform_utils_get_wall_time();
+    int ver = vrf_engine_verify(engine, num_jobs, jobs, 64, NULL);
+    platform_time_type end = platform_utils_get_wall_time();
+    double throughput = num_jobs / platform_utils_get_wall_time_diff(start, end);
+
+    if (ver != 0) {
+        printf("VRF engine FAILED to verify %d outputs!\n", ver);
+    }
+
+    vrf_engine_free(engine);
+    for (int i = 0; i < num_jobs; i++) {
+        if (i % 10 == 0) {
+            bn_free(jobs[i].seed);
+        }
+        nizk_dl_eq_proof_free(&pi[i]);
+        point_free(jobs[i].u);
+        bn_free(jobs[i].randval);
+        key_pair_free(&kp[i]);
+    }
+    free(kp);
+    free(pi);
+    free(jobs);
+    BN_CTX_free(ctx);
+
+    return throughput;
+}
+
+// seconds per slot of an epoch in which win_rate of the slots are won, with prove_vrf for every slot or
+// (lazy) vrf_evaluate for every slot and proofs only for the won ones
+double vrf_epoch_speed(int num_slots, double win_rate, int lazy) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    key_pair kp;
+    key_pair_generate(group, &kp, ctx);
+    unsigned char nonce[32];
+    if (RAND_bytes(nonce, sizeof(nonce)) != 1) {
+        handleErrors("Failed to generate epoch nonce");
+    }
+    unsigned char threshold_bytes[LEADER_SCHEDULE_THRESHOLD_BYTES];
+    leader_schedule_threshold(threshold_bytes, 1, win_rate);
+    BIGNUM *threshold = bn_from_binary_data(LEADER_SCHEDULE_THRESHOLD_BYTES, threshold_bytes);
+    BIGNUM *seed = bn_new();
+    EC_POINT *u = point_new(group);
+    int num_won = 0;
+
+    platform_time_type start = platform_utils_get_wall_time();
+    for (int slot = 0; slot < num_slots; slot++) {
+        leader_schedule_slot_seed(seed, nonce, sizeof(nonce), slot);
+        nizk_dl_eq_proof pi;
+        if (lazy) {
+            vrf_eval eval;
+            vrf_evaluate(group, seed, &kp, &eval, NULL, ctx);
+            if (vrf_prove_from_eval(group, &eval, &kp, vrf_randval_below, threshold, &pi, ctx)) {
+                num_won++;
+                nizk_dl_eq_proof_free(&pi);
+            }
+            vrf_eval_free(&eval);
+        } else {
+            BIGNUM *randval;
+            prove_vrf(group, seed, &randval, u, &pi, &kp, NULL, ctx);
+            num_won += vrf_randval_below(randval, threshold);
+            nizk_dl_eq_proof_free(&pi);
+            bn_free(randval);
+        }
+    }
+    platform_time_type end = platform_utils_get_wall_time();
+    double per_slot = platform_utils_get_wall_time_diff(start, end) / num_slots;
+
+    printf("VRF epoch: %d of %d slots won\n", num_won, num_slots);
+
+    point_free(u);
+    bn_free(seed);
+    bn_free(threshold);
+    key_pair_free(&kp);
+    BN_CTX_free(ctx);
+
+    return per_slot;
+}
+
+// leader schedule throughput (slots per second) for 5% stake and f = 0.05
+double leader_schedule_speed(int num_slots, int num_threads) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    key_pair kp;
+    key_pair_generate(group, &kp, ctx);
+    unsigned char nonce[32];
+    if (RAND_bytes(nonce, sizeof(nonce)) != 1) {
+        handleErrors("Failed to generate epoch nonce");
+    }
+    unsigned char threshold[LEADER_SCHEDULE_THRESHOLD_BYTES];
+    leader_schedule_threshold(threshold, 0.05, 0.05);
+
+    leader_schedule *schedule = leader_schedule_compute(group, &kp, nonce, sizeof(nonce), 0, num_slots, threshold, num_threads, NULL);
+    double throughput = schedule->slots_per_second;
+
+    leader_schedule_free(schedule);
+    key_pair_free(&kp);
+    BN_CTX_free(ctx);
+
+    return throughput;
+}
+
+// scalar multiplication by libcrypto or by the native backend (called directly, whether P256_NATIVE is set or not),
+// -1 where the native backend is not available
+double p256_backend_mul_speed(int num_reps, int use_generator, int native) {
+#ifndef P256_NATIVE_SUPPORTED
+    if (native) {
+        return -1;
+    }
+#endif
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    BIGNUM *bn = bn_random(get0_order(group), ctx);
+    EC_POINT *point = point_random(group, ctx);
+    EC_POINT *r = point_new(group);
+
+    platform_time_type start = platform_utils_get_wall_time();
+#ifdef P256_NATIVE_SUPPORTED
+    if (native) {
+        unsigned char scalar[32];
+        p256_point a, b;
+        bn_to_bytes(bn, scalar);
+        p256_native_from_ec_point(&a, group, point, ctx);
+        start = platform_utils_get_wall_time();
+        for (int i = 0; i < num_reps; i++) {
+            if (use_generator) {
+                p256_native_base_mul(&b, scalar);
+            } else {
+                p256_native_point_mul(&b, scalar, &a);
+            }
+        }
+        p256_native_to_ec_point(group, r, &b, ctx);
+    }
+#endif
+    for (int i = 0; i < num_reps && !native; i++) {
+        if (use_generator) {
+            EC_POINT_mul(group, r, bn, NULL, NULL, ctx);
+        } else {
+            EC_POINT_mul(group, r, NULL, point, bn, ctx);
+        }
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double mul_speed = platform_utils_get_wall_time_diff(start, end) / num_reps;
+
+    point_free(r);
+    point_free(point);
+    bn_free(bn);
+    BN_CTX_free(ctx);
+
+    return mul_speed;
+}
+
+// time per message hashing num_msgs messages of msg_len bytes with the kernel of the given number of lanes
+// (1 is libcrypto one message at a time), -1 if the CPU does not support it
+double sha256_mb_speed(int num_msgs, int msg_len, int num_reps, int lanes) {
+    if (sha256_mb_set_lanes(lanes)) {
+        return -1;
+    }
+    unsigned char *data = calloc(num_msgs, msg_len + 1);
+    unsigned char *md = malloc(num_msgs * 32);
+    const unsigned char **msg = malloc(num_msgs * sizeof(unsigned char*));
+    size_t *len = malloc(num_msgs * sizeof(size_t));
+    if (!data || !md || !msg || !len) {
+        handleErrors("Failed to allocate messages");
+    }
+    for (int i = 0; i < num_msgs; i++) {
+        msg[i] = data + i * (msg_len + 1);
+        len[i] = msg_len;
+    }
+
+    platform_time_type start = platform_utils_get_wall_time();
+    for (int r = 0; r < num_reps; r++) {
+        sha256_mb(num_msgs, msg, len, md);
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double hash_speed = platform_utils_get_wall_time_diff(start, end) / ((double)num_reps * num_msgs);
+
+    sha256_mb_set_lanes(0);
+    free(len);
+    free(msg);
+    free(md);
+    free(data);
+
+    return hash_speed;
+}
+
+// time per transcript of list_len points in Jacobian coordinates, hashed by openssl_hash_point_list2bn
+// (batch_affine = 1) or encoded one by one with EC_POINT_point2oct (batch_affine = 0)
+double hash_points_speed(int list_len, int num_reps, int batch_affine) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    EC_POINT **points = malloc(list_len * sizeof(EC_POINT*));
+    if (!points) {
+        handleErrors("Failed to allocate points");
+    }
+    for (int i = 0; i < list_len; i++) {
+        points[i] = point_random(group, ctx);
+        point_add(group, points[i], points[i], points[i], ctx);
+    }
+    BIGNUM *c = bn_new();
+
+    platform_time_type start = platform_utils_get_wall_time();
+    for (int r = 0; r < num_reps; r++) {
+        if (batch_affine) {
+            openssl_hash_point_list2bn_r(c, group, ctx, list_len, (const EC_POINT**)points);
+        } else {
+            SHA256_CTX sha_ctx;
+            unsigned char buf[P256_POINT_BYTES];
+            unsigned char md[SHA256_DIGEST_LENGTH];
+            SHA256_Init(&sha_ctx);
+            for (int i = 0; i < list_len; i++) {
+                size_t len = EC_POINT_point2oct(group, points[i], POINT_CONVERSION_COMPRESSED, buf, sizeof(buf), ctx);
+                SHA256_Update(&sha_ctx, buf, len);
+            }
+            SHA256_Final(md, &sha_ctx);
+            BN_bin2bn(md, SHA256_DIGEST_LENGTH, c);
+        }
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double hash_speed = platform_utils_get_wall_time_diff(start, end) / num_reps;
+
+    bn_free(c);
+    for (int i = 0; i < list_len; i++) {
+        point_free(points[i]);
+    }
+    free(points);
+    BN_CTX_free(ctx);
+
+    return hash_speed;
+}
+
+// SCRAPE low-degree test of n commitments to a polynomial of degree n / 2 - 1, returns the time per verification
+double scrape_ldt_speed(int n, int num_reps) {
+
+    const EC_GROUP *group = get0_group();
+    const BIGNUM *order = get0_order(group);
+    BN_CTX *ctx = BN_CTX_new();
+    int t = n / 2 - 1;
+    scrape_ldt *ldt = scrape_ldt_new(group, n, t, ctx);
+    EC_POINT **C = malloc(n * sizeof(EC_POINT*));
+    if (!C) {
+        handleErrors("Failed to allocate commitments");
+    }
+    // C_i = [(i + z)^t]G, the shape of the polynomial does not change the verification
+    BIGNUM *z = bn_random(order, ctx);
+    BIGNUM *e = bn_new();
+    BIGNUM *y = bn_new();
+    BN_set_word(e, t);
+    for (int i = 0; i < n; i++) {
+        BN_copy(y, z);
+        BN_add_word(y, i + 1);
+        BN_mod_exp(y, y, e, order, ctx);
+        C[i] = bn2point(group, y, ctx);
+    }
+
+    int ver = 0;
+
+    platform_time_type start = platform_utils_get_wall_time();
+    for (int r = 0; r < num_reps; r++) {
+        ver |= scrape_ldt_verify(ldt, (const EC_POINT**)C, 0, NULL, NULL, ctx);
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double ldt_speed = platform_utils_get_wall_time_diff(start, end) / num_reps;
+
+    if (ver != 0) {
+        printf("SCRAPE low-degree test FAILED!\n");
+    }
+
+    for (int i = 0; i < n; i++) {
+        point_free(C[i]);
+    }
+    free(C);
+    bn_free(y);
+    bn_free(e);
+    bn_free(z);
+    scrape_ldt_free(ldt);
+    BN_CTX_free(ctx);
+
+    return ldt_speed;
+}
+
+// combination of t shares in the exponent, returns the time per combination: mode 0 with a modular inversion per
+// coefficient and t scalar multiplications, 1 through threshold_combine, 2 with the coefficients cached
+double threshold_combine_speed(int t, int num_reps, int mode) {
+
+    const EC_GROUP *group = get0_group();
+    const BIGNUM *order = get0_order(group);
+    BN_CTX *ctx = BN_CTX_new();
+    threshold_cache *cache = threshold_cache_new(group, 1);
+    int *x = malloc(t * sizeof(int));
+    EC_POINT **shares = malloc(t * sizeof(EC_POINT*));
+    if (!x || !shares) {
+        handleErrors("Failed to allocate shares");
+    }
+    // every third of 3t participants
+    for (int k = 0; k < t; k++) {
+        x[k] = 3 * k + 1;
+        shares[k] = point_random(group, ctx);
+    }
+    EC_POINT *r = point_new(group);
+    EC_POINT *term = point_new(group);
+    BIGNUM *lambda = bn_new();
+    BIGNUM *den = bn_new();
+    BIGNUM *d = bn_new();
+    if (mode == 2) {
+        threshold_combine(group, cache, r, t, x, (const EC_POINT**)shares, ctx);
+    }
+
+    platform_time_type start = platform_utils_get_wall_time();
+    for (int rep = 0; rep < num_reps; rep++) {
+        if (mode) {
+            threshold_combine(group, mode == 2 ? cache : NULL, r, t, x, (const EC_POINT**)shares, ctx);
+            continue;
+        }
+        EC_POINT_set_to_infinity(group, r);
+        for (int k = 0; k < t; k++) {
+            BN_one(lambda);
+            BN_one(den);
+            for (int j = 0; j < t; j++) {
+                if (j != k) {
+                    BN_set_word(d, x[j]);
+                    BN_mod_mul(lambda, lambda, d, order, ctx);
+                    BN_set_word(d, x[j] - x[k] > 0 ? x[j] - x[k] : x[k] - x[j]);
+                    if (x[j] < x[k]) {
+                        BN_sub(d, order, d);
+                    }
+                    BN_mod_mul(den, den, d, order, ctx);
+                }
+            }
+            BN_mod_inverse(den, den, order, ctx);
+            BN_mod_mul(lambda, lambda, den, order, ctx);
+            point_mul(group, term, lambda, shares[k], ctx);
+            point_add(group, r, r, term, ctx);
+        }
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double combine_speed = platform_utils_get_wall_time_diff(start, end) / num_reps;
+
+    bn_free(d);
+    bn_free(den);
+    bn_free(lambda);
+    point_free(term);
+    point_free(r);
+    for (int k = 0; k < t; k++) {
+        point_free(shares[k]);
+    }
+    free(shares);
+    free(x);
+    threshold_cache_free(cache);
+    BN_CTX_free(ctx);
+
+    return combine_speed;
+}
+
+// hash of num_points points held as EC_POINTs (encoded with one field inversion) or as a point_vec, returns the
+// time per point
+double point_vec_hash_speed(int num_points, int num_reps, int use_vec) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    EC_POINT **points = malloc(num_points * sizeof(EC_POINT*));
+    if (!points) {
+        handleErrors("Failed to allocate points");
+    }
+    for (int i = 0; i < num_points; i++) {
+        points[i] = point_random(group, ctx);
+        point_add(group, points[i], points[i], points[i], ctx);
+    }
+    point_vec *v = point_vec_new(num_points);
+    point_vec_from_points(group, v, (const EC_POINT**)points, ctx);
+    BIGNUM *c = bn_new();
+
+    platform_time_type start = platform_utils_get_wall_time();
+    for (int r = 0; r < num_reps; r++) {
+        if (use_vec) {
+            openssl_hash_point_vec2bn_r(c, v);
+        } else {
+            openssl_hash_point_list2bn_r(c, group, ctx, num_points, (const EC_POINT**)points);
+        }
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double hash_speed = platform_utils_get_wall_time_diff(start, end) / ((double)num_reps * num_points);
+
+    bn_free(c);
+    point_vec_free(v);
+    for (int i = 0; i < num_points; i++) {
+        point_free(points[i]);
+    }
+    free(points);
+    BN_CTX_free(ctx);
+
+    return hash_speed;
+}
+
+// weighted sum of num_terms terms held as BIGNUMs and EC_POINTs or as a scalar_vec and a point_vec, returns the
+// time per term
+double point_weighted_sum_vec_speed(int num_terms, int use_vec) {
+
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    BIGNUM **w = malloc(num_terms * sizeof(BIGNUM*));
+    EC_POINT **p = malloc(num_terms * sizeof(EC_POINT*));
+    if (!w || !p) {
+        handleErrors("Failed to allocate weighted sum terms");
+    }
+    for (int i = 0; i < num_terms; i++) {
+        w[i] = bn_random(get0_order(group), ctx);
+        p[i] = point_random(group, ctx);
+    }
+    scalar_vec *wv = scalar_vec_new(num_terms);
+    point_vec *pv = point_vec_new(num_terms);
+    scalar_vec_from_bns(group, wv, (const BIGNUM**)w, ctx);
+    point_vec_from_points(group, pv, (const EC_POINT**)p, ctx);
+    EC_POINT *r = point_new(group);
+
+    platform_time_type start = platform_utils_get_wall_time();
+    if (use_vec) {
+        point_weighted_sum_vec(group, r, wv, pv, ctx);
+    } else {
+        point_weighted_sum(group, r, num_terms, (const BIGNUM**)w, (const EC_POINT**)p, ctx);
+    }
+
+    platform_time_type end = platform_utils_get_wall_time();
+    double sum_speed = platform_utils_get_wall_time_diff(start, end) / num_terms;
+
+    point_free(r);
+    point_vec_free(pv);
+    scalar_vec_free(wv);
+    for (int i = 0; i < num_terms; i++) {
+        bn_free(w[i]);
+        point_free(p[i]);
+    }
+    free(w);
+    free(p);
+    BN_CTX_free(ctx);
+
+    return sum_speed;
+}
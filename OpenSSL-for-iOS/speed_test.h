@@ -14,3 +14,27 @@
 
 double ecdsa_speed(int num_reps);
 double praos_vrf_speed(int num_reps);
+double nizk_dl_eq_speed(int num_reps);
+double nizk_dl_eq_batch_speed(int batch_size, int num_reps);
+double praos_vrf_batch_speed(int batch_size, int proofs_per_seed, int num_reps);
+double bn2point_speed(int num_reps, int use_generator_table);
+double ecdsa_registry_speed(int num_reps);
+double schnorr_speed(int batch_size, int num_reps, int batch);
+double praos_vrf_registry_speed(int num_reps);
+double point_weighted_sum_speed(int num_terms, int use_loop);
+double praos_vrf_bytes_speed(int num_reps);
+double praos_vrf_arena_speed(int num_reps);
+double praos_vrf_verify_cache_speed(int num_outputs, int copies, int use_cache);
+double vrf_engine_speed(int num_threads, int num_jobs, int pin_threads);
+double leader_schedule_speed(int num_slots, int num_threads);
+double vrf_epoch_speed(int num_slots, double win_rate, int lazy);
+double vrf_hash_seed_speed(int num_reps, int suite);
+double praos_vrf_suite_speed(int num_reps, int suite);
+double praos_vrf_seed_cache_speed(int num_proofs, int proofs_per_seed, int num_reps, int use_cache);
+double p256_backend_mul_speed(int num_reps, int use_generator, int native);
+double sha256_mb_speed(int num_msgs, int msg_len, int num_reps, int lanes);
+double hash_points_speed(int list_len, int num_reps, int batch_affine);
+double scrape_ldt_speed(int n, int num_reps);
+double threshold_combine_speed(int t, int num_reps, int mode);
+double point_vec_hash_speed(int num_points, int num_reps, int use_vec);
+double point_weighted_sum_vec_speed(int num_terms, int use_vec);
@@ -0,0 +1,538 @@
+//
+//  threshold.c
+//  OpenSSL-for-iOS
+//
+#include "threshold.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config_platform.h"
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/*
+ * lambda_k = N / (x_k d_k) with N = prod_j x_j and d_k = prod_{j != k} (x_j - x_k). The factors are indices and
+ * their differences, word sized: they are gathered in a BN_ULONG as long as the product fits and only then
+ * multiplied into the scalar, so the O(t^2) part costs about t^2 / 2 word multiplications (t^2 / 6 for indices
+ * below 1024). The t denominators x_k d_k are inverted together (bn_mod_inverse_batch).
+ */
+
+// running product of word sized factors, pending ones in acc
+typedef struct {
+    BIGNUM *bn;
+    BN_ULONG acc;
+} word_product;
+
+static int word_product_flush(word_product *p, const BIGNUM *order, BN_CTX *ctx) {
+    int ret = BN_mul_word(p->bn, p->acc);
+    ret &= BN_nnmod(p->bn, p->bn, order, ctx);
+    p->acc = 1;
+    return ret;
+}
+
+static int word_product_mul(word_product *p, BN_ULONG d, const BIGNUM *order, BN_CTX *ctx) {
+    int ret = 1;
+    if (p->acc > ~(BN_ULONG)0 / d) {
+        ret = word_product_flush(p, order, ctx);
+    }
+    p->acc *= d;
+    return ret;
+}
+
+int threshold_lagrange_coeffs(const EC_GROUP *group, int num, const int *x, BIGNUM **lambda, BN_CTX *ctx) {
+    const BIGNUM *order = get0_order(group);
+    for (int k=0; k<num; k++) {
+        if (x[k] <= 0) {
+            return 1;
+        }
+    }
+    BN_CTX_start(ctx);
+    BIGNUM **den = malloc(num * sizeof(BIGNUM*) + 1);
+    unsigned char *neg = malloc(num + 1);
+    assert(den && neg && "threshold_lagrange_coeffs: allocation error");
+    for (int k=0; k<num; k++) {
+        den[k] = BN_CTX_get(ctx);
+    }
+    word_product N = { BN_CTX_get(ctx), 1 };
+    assert(N.bn && "threshold_lagrange_coeffs: BN_CTX_get failed");
+
+    int ret = BN_one(N.bn);
+    for (int j=0; j<num; j++) {
+        ret &= word_product_mul(&N, (BN_ULONG)x[j], order, ctx);
+    }
+    ret &= word_product_flush(&N, order, ctx);
+    int distinct = 1;
+    for (int k=0; k<num && distinct; k++) {
+        word_product d = { den[k], (BN_ULONG)x[k] };
+        ret &= BN_one(d.bn);
+        neg[k] = 0;
+        for (int j=0; j<num; j++) {
+            if (j == k) {
+                continue;
+            }
+            if (x[j] == x[k]) {
+                distinct = 0;
+                break;
+            }
+            if (x[j] < x[k]) {
+                neg[k] ^= 1;
+            }
+            ret &= word_product_mul(&d, (BN_ULONG)(x[j] > x[k] ? x[j] - x[k] : x[k] - x[j]), order, ctx);
+        }
+        ret &= word_product_flush(&d, order, ctx);
+    }
+
+    if (distinct) {
+        bn_mod_inverse_batch(den, num, (const BIGNUM**)den, order, ctx);
+        for (int k=0; k<num; k++) {
+            ret &= BN_mod_mul(lambda[k], N.bn, den[k], order, ctx);
+            if (neg[k] && !BN_is_zero(lambda[k])) {
+                ret &= BN_sub(lambda[k], order, lambda[k]);
+            }
+        }
+    }
+    assert(ret == 1 && "threshold_lagrange_coeffs: computation failed");
+
+    // cleanup
+    free(neg);
+    free(den);
+    BN_CTX_end(ctx);
+
+    return !distinct;
+}
+
+/* cache of the coefficients per subset */
+
+typedef struct {
+    int num;
+    int *x;                 // key, the indices in their order
+    unsigned char *coeffs;  // num scalars of P256_SCALAR_BYTES
+    uint32_t hash;
+    int hash_next; // next entry in the same bucket, -1 at the end
+    int lru_prev; // towards the most recently used entry
+    int lru_next; // towards the least recently used entry
+} threshold_cache_entry;
+
+struct threshold_cache {
+    const EC_GROUP *group;
+    int capacity;
+    int num_entries;
+    threshold_cache_entry *entries;
+    int *buckets; // first entry per bucket, -1 if empty
+    int bucket_mask;
+    int lru_first; // most recently used
+    int lru_last; // least recently used, evicted first
+    long hits;
+    long misses;
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+    SRWLOCK lock;
+#else
+    pthread_mutex_t lock;
+#endif
+};
+
+static void threshold_cache_lock(threshold_cache *cache) {
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+    AcquireSRWLockExclusive(&cache->lock);
+#else
+    int ret = pthread_mutex_lock(&cache->lock);
+    assert(ret == 0 && "threshold_cache_lock: pthread_mutex_lock failed");
+#endif
+}
+
+static void threshold_cache_unlock(threshold_cache *cache) {
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+    ReleaseSRWLockExclusive(&cache->lock);
+#else
+    int ret = pthread_mutex_unlock(&cache->lock);
+    assert(ret == 0 && "threshold_cache_unlock: pthread_mutex_unlock failed");
+#endif
+}
+
+threshold_cache *threshold_cache_new(const EC_GROUP *group, int capacity) {
+    assert(capacity > 0 && "threshold_cache_new: usage error, capacity must be positive");
+    threshold_cache *cache = calloc(1, sizeof(threshold_cache));
+    assert(cache && "threshold_cache_new: allocation error (cache)");
+    int num_buckets = 1;
+    while (num_buckets < 2 * capacity) {
+        num_buckets *= 2;
+    }
+    cache->group = group;
+    cache->capacity = capacity;
+    cache->entries = calloc(capacity, sizeof(threshold_cache_entry));
+    cache->buckets = malloc(num_buckets * sizeof(int));
+    assert(cache->entries && cache->buckets && "threshold_cache_new: allocation error (table)");
+    cache->bucket_mask = num_buckets - 1;
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+    InitializeSRWLock(&cache->lock);
+#else
+    int ret = pthread_mutex_init(&cache->lock, NULL);
+    assert(ret == 0 && "threshold_cache_new: pthread_mutex_init failed");
+#endif
+    threshold_cache_clear(cache);
+    return cache;
+}
+
+void threshold_cache_free(threshold_cache *cache) {
+    for (int i=0; i<cache->capacity; i++) {
+        free(cache->entries[i].x);
+        free(cache->entries[i].coeffs);
+    }
+#if PLATFORM_TYPE != PLATFORM_TYPE_WINDOWS
+    pthread_mutex_destroy(&cache->lock);
+#endif
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache);
+}
+
+// FNV-1a over the indices
+static uint32_t threshold_cache_hash(int num, const int *x) {
+    uint32_t h = 2166136261u;
+    for (int i=0; i<num; i++) {
+        uint32_t v = (uint32_t)x[i];
+        for (int b=0; b<4; b++) {
+            h = (h ^ (v & 0xff)) * 16777619u;
+            v >>= 8;
+        }
+    }
+    return h;
+}
+
+static int threshold_cache_find(const threshold_cache *cache, int num, const int *x, uint32_t hash) {
+    for (int i=cache->buckets[hash & (uint32_t)cache->bucket_mask]; i>=0; i=cache->entries[i].hash_next) {
+        const threshold_cache_entry *e = &cache->entries[i];
+        if (e->hash == hash && e->num == num && memcmp(e->x, x, num * sizeof(int)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void threshold_cache_lru_unlink(threshold_cache *cache, int i) {
+    threshold_cache_entry *e = &cache->entries[i];
+    if (e->lru_prev >= 0) {
+        cache->entries[e->lru_prev].lru_next = e->lru_next;
+    } else {
+        cache->lru_first = e->lru_next;
+    }
+    if (e->lru_next >= 0) {
+        cache->entries[e->lru_next].lru_prev = e->lru_prev;
+    } else {
+        cache->lru_last = e->lru_prev;
+    }
+}
+
+static void threshold_cache_lru_push_first(threshold_cache *cache, int i) {
+    threshold_cache_entry *e = &cache->entries[i];
+    e->lru_prev = -1;
+    e->lru_next = cache->lru_first;
+    if (cache->lru_first >= 0) {
+        cache->entries[cache->lru_first].lru_prev = i;
+    } else {
+        cache->lru_last = i;
+    }
+    cache->lru_first = i;
+}
+
+static void threshold_cache_bucket_unlink(threshold_cache *cache, int i) {
+    int *link = &cache->buckets[cache->entries[i].hash & (uint32_t)cache->bucket_mask];
+    while (*link != i) {
+        link = &cache->entries[*link].hash_next;
+    }
+    *link = cache->entries[i].hash_next;
+}
+
+int threshold_cache_lookup(threshold_cache *cache, int num, const int *x, BIGNUM **lambda, BN_CTX *ctx) {
+    uint32_t hash = threshold_cache_hash(num, x);
+
+    threshold_cache_lock(cache);
+    int i = threshold_cache_find(cache, num, x, hash);
+    if (i >= 0) {
+        cache->hits++;
+        threshold_cache_lru_unlink(cache, i);
+        threshold_cache_lru_push_first(cache, i);
+        const unsigned char *coeffs = cache->entries[i].coeffs;
+        int ret = 1;
+        for (int k=0; k<num; k++) {
+            ret &= BN_bin2bn(coeffs + k * P256_SCALAR_BYTES, P256_SCALAR_BYTES, lambda[k]) != NULL;
+        }
+        threshold_cache_unlock(cache);
+        assert(ret == 1 && "threshold_cache_lookup: BN_bin2bn failed");
+        return 0;
+    }
+    cache->misses++;
+    threshold_cache_unlock(cache);
+
+    // compute and encode without holding the lock
+    if (threshold_lagrange_coeffs(cache->group, num, x, lambda, ctx)) {
+        return 1;
+    }
+    int *key = malloc(num * sizeof(int) + 1);
+    unsigned char *coeffs = malloc(num * P256_SCALAR_BYTES + 1);
+    assert(key && coeffs && "threshold_cache_lookup: allocation error");
+    memcpy(key, x, num * sizeof(int));
+    for (int k=0; k<num; k++) {
+        int ret = bn_to_bytes(lambda[k], coeffs + k * P256_SCALAR_BYTES);
+        assert(ret == 0 && "threshold_cache_lookup: coefficient does not fit");
+    }
+
+    // insert unless another thread did in the meantime, the buffers of the replaced subset are freed after
+    threshold_cache_lock(cache);
+    if (threshold_cache_find(cache, num, x, hash) < 0) {
+        if (cache->num_entries < cache->capacity) {
+            i = cache->num_entries++;
+        } else {
+            i = cache->lru_last;
+            threshold_cache_lru_unlink(cache, i);
+            threshold_cache_bucket_unlink(cache, i);
+        }
+        threshold_cache_entry *e = &cache->entries[i];
+        int *old_key = e->x;
+        unsigned char *old_coeffs = e->coeffs;
+        e->num = num;
+        e->x = key;
+        e->coeffs = coeffs;
+        e->hash = hash;
+        int bucket = hash & (uint32_t)cache->bucket_mask;
+        e->hash_next = cache->buckets[bucket];
+        cache->buckets[bucket] = i;
+        threshold_cache_lru_push_first(cache, i);
+        key = old_key;
+        coeffs = old_coeffs;
+    }
+    threshold_cache_unlock(cache);
+    free(key);
+    free(coeffs);
+
+    return 0;
+}
+
+void threshold_cache_get_stats(threshold_cache *cache, long *hits, long *misses) {
+    threshold_cache_lock(cache);
+    *hits = cache->hits;
+    *misses = cache->misses;
+    threshold_cache_unlock(cache);
+}
+
+void threshold_cache_clear(threshold_cache *cache) {
+    threshold_cache_lock(cache);
+    memset(cache->buckets, 0xff, (cache->bucket_mask + 1) * sizeof(int)); // all -1
+    cache->num_entries = 0;
+    cache->lru_first = -1;
+    cache->lru_last = -1;
+    cache->hits = 0;
+    cache->misses = 0;
+    threshold_cache_unlock(cache);
+}
+
+int threshold_combine(const EC_GROUP *group, threshold_cache *cache, EC_POINT *r, int num, const int *x, const EC_POINT **shares, BN_CTX *ctx) {
+    BIGNUM **lambda = bn_new_array(num);
+    int ret = cache ? threshold_cache_lookup(cache, num, x, lambda, ctx) : threshold_lagrange_coeffs(group, num, x, lambda, ctx);
+    if (ret == 0) {
+        point_weighted_sum(group, r, num, (const BIGNUM**)lambda, shares, ctx);
+    }
+
+    // cleanup
+    bn_free_array(num, lambda);
+
+    return ret;
+}
+
+/*
+ *
+ *  threshold tests
+ *
+ */
+
+// lambda_k = prod_{j != k} x_j / (x_j - x_k) with an inversion per factor
+static void threshold_test_lagrange_naive(const EC_GROUP *group, int num, const int *x, BIGNUM **lambda, BN_CTX *ctx) {
+    const BIGNUM *order = get0_order(group);
+    BIGNUM *f = bn_new();
+    for (int k=0; k<num; k++) {
+        BN_one(lambda[k]);
+        for (int j=0; j<num; j++) {
+            if (j != k) {
+                BN_set_word(f, x[j] > x[k] ? x[j] - x[k] : x[k] - x[j]);
+                if (x[j] < x[k]) {
+                    BN_sub(f, order, f);
+                }
+                BN_mod_inverse(f, f, order, ctx);
+                BN_mul_word(f, x[j]);
+                BN_mod_mul(lambda[k], lambda[k], f, order, ctx);
+            }
+        }
+    }
+    bn_free(f);
+}
+
+static int threshold_test_1(int print) {
+    const EC_GROUP *group = get0_group();
+    const BIGNUM *order = get0_order(group);
+    BN_CTX *ctx = BN_CTX_new();
+    const int num = 7;
+    const int x[] = { 3, 1, 1000, 65537, 2147483647, 12, 2 }; // word packing and the largest index
+    BIGNUM **lambda = bn_new_array(num);
+    BIGNUM **expected = bn_new_array(num);
+
+    // coefficients equal the ones with an inversion per factor and sum to 1 (interpolation of a constant)
+    int ret1 = threshold_lagrange_coeffs(group, num, x, lambda, ctx);
+    threshold_test_lagrange_naive(group, num, x, expected, ctx);
+    BIGNUM *sum = bn_new();
+    for (int k=0; k<num; k++) {
+        ret1 |= BN_cmp(lambda[k], expected[k]) != 0;
+        BN_mod_add(sum, sum, lambda[k], order, ctx);
+    }
+    ret1 |= !BN_is_one(sum);
+    // batch inversion in place
+    bn_mod_inverse_batch(lambda, num, (const BIGNUM**)lambda, order, ctx);
+    for (int k=0; k<num; k++) {
+        BN_mod_inverse(expected[k], expected[k], order, ctx);
+        ret1 |= BN_cmp(lambda[k], expected[k]) != 0;
+    }
+    if (print) {
+        printf("%6s Test 1 - 1: Lagrange coefficients %s the ones inverted one by one\n", ret1 ? "NOT OK" : "OK", ret1 ? "do NOT equal" : "equal");
+    }
+
+    // negative tests, a repeated and a zero index
+    const int repeated[] = { 4, 9, 4 };
+    const int zero[] = { 4, 0, 9 };
+    int ret2 = !threshold_lagrange_coeffs(group, 3, repeated, lambda, ctx);
+    ret2 |= !threshold_lagrange_coeffs(group, 3, zero, lambda, ctx);
+    if (print) {
+        if (!ret2) {
+            printf("    OK Test 1 - 2: Repeated or zero indices not accepted (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 1 - 2: Repeated or zero indices ARE accepted (which is an ERROR)\n");
+        }
+    }
+
+    // cleanup
+    bn_free(sum);
+    bn_free_array(num, expected);
+    bn_free_array(num, lambda);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0);
+}
+
+static int threshold_test_2(int print) {
+    const EC_GROUP *group = get0_group();
+    const BIGNUM *order = get0_order(group);
+    BN_CTX *ctx = BN_CTX_new();
+    const int t = 5;
+    const int n = 12;
+    threshold_cache *cache = threshold_cache_new(group, 2);
+
+    // shares [f(i)]P, i = 1..n, of f of degree t - 1
+    EC_POINT *P = point_random(group, ctx);
+    BIGNUM **coeff = bn_new_array(t);
+    for (int k=0; k<t; k++) {
+        bn_random_r(coeff[k], order, ctx);
+    }
+    EC_POINT *share[n];
+    BIGNUM *y = bn_new();
+    BIGNUM *xi = bn_new();
+    for (int i=1; i<=n; i++) {
+        BN_set_word(xi, i);
+        BN_copy(y, coeff[t-1]);
+        for (int k=t-2; k>=0; k--) {
+            BN_mod_mul(y, y, xi, order, ctx);
+            BN_mod_add(y, y, coeff[k], order, ctx);
+        }
+        share[i-1] = point_new(group);
+        point_mul(group, share[i-1], y, P, ctx);
+    }
+    EC_POINT *secret = point_new(group);
+    point_mul(group, secret, coeff[0], P, ctx);
+
+    // three quorums of t, each combined twice, the first again after the third evicted the second
+    const int quorum[3][5] = { { 2, 5, 7, 11, 12 }, { 1, 2, 3, 4, 5 }, { 12, 3, 9, 6, 10 } };
+    const int order_of_use[] = { 0, 0, 1, 1, 2, 2, 0, 1 };
+    const EC_POINT *shares[t];
+    EC_POINT *r = point_new(group);
+    int ret1 = 0;
+    for (int u=0; u<8; u++) {
+        const int *x = quorum[order_of_use[u]];
+        for (int k=0; k<t; k++) {
+            shares[k] = share[x[k] - 1];
+        }
+        ret1 |= threshold_combine(group, u % 2 ? cache : NULL, r, t, x, shares, ctx);
+        ret1 |= point_cmp(group, r, secret, ctx) != 0;
+        ret1 |= threshold_combine(group, cache, r, t, x, shares, ctx);
+        ret1 |= point_cmp(group, r, secret, ctx) != 0;
+    }
+    long hits, misses;
+    threshold_cache_get_stats(cache, &hits, &misses);
+    // quorum 0 miss, hits, quorum 1 miss, hits, quorum 2 miss (evicts 0), hits, quorum 0 miss (evicts 1),
+    // quorum 1 miss (evicts 2) and hit
+    ret1 |= hits != 7 || misses != 5;
+    if (print) {
+        printf("%6s Test 2 - 1: Quorums %s the secret in the exponent (cache: %ld hits, %ld misses)\n", ret1 ? "NOT OK" : "OK", ret1 ? "do NOT combine to" : "combine to", hits, misses);
+    }
+
+    // negative test, fewer than t shares
+    const int *x = quorum[0];
+    for (int k=0; k<t; k++) {
+        shares[k] = share[x[k] - 1];
+    }
+    threshold_combine(group, cache, r, t - 1, x, shares, ctx);
+    int ret2 = point_cmp(group, r, secret, ctx) == 0;
+    if (print) {
+        if (!ret2) {
+            printf("    OK Test 2 - 2: Fewer than t shares do not combine to the secret (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 2 - 2: Fewer than t shares DO combine to the secret (which is an ERROR)\n");
+        }
+    }
+
+    // cleanup
+    point_free(r);
+    point_free(secret);
+    for (int i=0; i<n; i++) {
+        point_free(share[i]);
+    }
+    bn_free(xi);
+    bn_free(y);
+    bn_free_array(t, coeff);
+    point_free(P);
+    threshold_cache_free(cache);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0);
+}
+
+typedef int (*test_function)(int);
+
+static test_function test_suite[] = {
+    &threshold_test_1,
+    &threshold_test_2
+};
+
+int threshold_test_suite(int print) {
+    if (print) {
+        printf("Threshold test suite BEGIN --------------------------\n");
+    }
+    int num_tests = sizeof(test_suite)/sizeof(test_function);
+    int ret = 0;
+    for (int i=0; i<num_tests; i++) {
+        if (test_suite[i](print)) {
+            ret = 1;
+        }
+    }
+    if (print) {
+        printf("Threshold test suite END ----------------------------\n");
+#ifdef DEBUG
+        print_allocation_status();
+#endif
+        fflush(stdout);
+    }
+    return ret;
+}
@@ -0,0 +1,44 @@
+//
+//  threshold.h
+//  OpenSSL-for-iOS
+//
+//  Threshold reconstruction in the exponent: partial results share_k = [f(x_k)]P of t participants with distinct
+//  indices x_k combine to [f(0)]P = sum_k [lambda_k]share_k, lambda_k = prod_{j != k} x_j / (x_j - x_k). The
+//  coefficients of a subset take one inversion for all of them and are kept in a cache, as the same quorum
+//  usually signs or decrypts again; the combination is one multi-scalar multiplication.
+//
+
+#ifndef THRESHOLD_H
+#define THRESHOLD_H
+#include "P256.h"
+
+typedef struct threshold_cache threshold_cache;
+
+#define THRESHOLD_CACHE_DEFAULT_CAPACITY 64
+
+// lambda[k] = Lagrange coefficient at 0 of x[k] among x[0..num-1] (lambda initialized), returns 0 on success, 1 if
+// the indices are not distinct and positive
+int threshold_lagrange_coeffs(const EC_GROUP *group, int num, const int *x, BIGNUM **lambda, BN_CTX *ctx);
+
+// new empty cache holding the coefficients of at most capacity subsets (keyed by the indices in their order)
+threshold_cache *threshold_cache_new(const EC_GROUP *group, int capacity);
+
+void threshold_cache_free(threshold_cache *cache);
+
+// threshold_lagrange_coeffs through the cache, computed and inserted in place of the least recently used subset
+// on a miss (thread-safe)
+int threshold_cache_lookup(threshold_cache *cache, int num, const int *x, BIGNUM **lambda, BN_CTX *ctx);
+
+// number of lookups answered from the cache and computed since creation or the last threshold_cache_clear
+void threshold_cache_get_stats(threshold_cache *cache, long *hits, long *misses);
+
+// drop all subsets and reset the counters
+void threshold_cache_clear(threshold_cache *cache);
+
+// r = sum_k [lambda_k]shares[k] for the participants x[0..num-1], coefficients from cache (NULL to compute them),
+// returns 0 on success, 1 if the indices are not distinct and positive
+int threshold_combine(const EC_GROUP *group, threshold_cache *cache, EC_POINT *r, int num, const int *x, const EC_POINT **shares, BN_CTX *ctx);
+
+int threshold_test_suite(int print);
+
+#endif /* THRESHOLD_H */
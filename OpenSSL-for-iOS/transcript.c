@@ -0,0 +1,326 @@
+//
+//  transcript.c
+//  OpenSSL-for-iOS
+//
+#include "transcript.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "openssl_hashing_tools.h"
+#include "sha256_mb.h"
+
+// label of the protocol name absorbed by transcript_init
+#define TRANSCRIPT_PROTOCOL_LABEL "protocol"
+
+// maximal frame header, label length, label and data length
+#define TRANSCRIPT_MAX_HEADER (1 + TRANSCRIPT_MAX_LABEL + 4)
+
+// write the header of a string of len bytes absorbed under label to buf, returns its length
+static size_t transcript_header(unsigned char *buf, const char *label, size_t len) {
+    size_t label_len = strlen(label);
+    assert(label_len <= TRANSCRIPT_MAX_LABEL && "transcript_header: usage error, label too long");
+    assert(len <= 0xffffffff && "transcript_header: usage error, string too long");
+    buf[0] = (unsigned char)label_len;
+    memcpy(buf + 1, label, label_len);
+    for (int i=0; i<4; i++) {
+        buf[1 + label_len + i] = (unsigned char)(len >> (8 * (3 - i)));
+    }
+    return 1 + label_len + 4;
+}
+
+void transcript_init(transcript *t, const char *protocol) {
+    openssl_hash_init(&t->sha);
+    transcript_absorb(t, TRANSCRIPT_PROTOCOL_LABEL, protocol, strlen(protocol));
+}
+
+void transcript_clone(transcript *dst, const transcript *src) {
+    *dst = *src;
+}
+
+void transcript_absorb(transcript *t, const char *label, const void *data, size_t len) {
+    unsigned char header[TRANSCRIPT_MAX_HEADER];
+    openssl_hash_update(&t->sha, header, transcript_header(header, label, len));
+    if (len > 0) {
+        openssl_hash_update(&t->sha, data, len);
+    }
+}
+
+void transcript_absorb_points(transcript *t, const EC_GROUP *group, int num, const char *const *labels, const EC_POINT **points, BN_CTX *ctx) {
+    unsigned char *buf = malloc(num * P256_POINT_BYTES + 1);
+    size_t *len = malloc(num * sizeof(size_t) + 1);
+    assert(buf && len && "transcript_absorb_points: allocation error");
+    points_encode(group, num, points, buf, len, ctx);
+    for (int i=0; i<num; i++) {
+        transcript_absorb(t, labels[i], buf + i * P256_POINT_BYTES, len[i]);
+    }
+    free(len);
+    free(buf);
+}
+
+void transcript_challenge(transcript *t, const char *label, BIGNUM *c, const BIGNUM *order, BN_CTX *ctx) {
+    transcript_absorb(t, label, NULL, 0);
+    SHA256_CTX sha = t->sha;
+    unsigned char md[SHA256_DIGEST_LENGTH];
+    openssl_hash_final(md, &sha);
+    BIGNUM *ret = BN_bin2bn(md, SHA256_DIGEST_LENGTH, c);
+    assert(ret && "transcript_challenge: BN_bin2bn failed");
+    int ok = BN_nnmod(c, c, order, ctx);
+    assert(ok == 1 && "transcript_challenge: BN_nnmod failed");
+}
+
+void transcript_challenge_columns(BIGNUM **r, const EC_GROUP *group, const char *protocol, int list_len, const char *const *labels, const EC_POINT **points[], const char *label, int num, BN_CTX *ctx) {
+    const BIGNUM *order = get0_order(group);
+    // the message of every transcript starts with the same protocol string and ends with the same challenge label
+    size_t protocol_len = strlen(protocol);
+    assert(protocol_len <= 0xffff && "transcript_challenge_columns: usage error, protocol name too long");
+    unsigned char *head = malloc(TRANSCRIPT_MAX_HEADER + protocol_len);
+    assert(head && "transcript_challenge_columns: allocation error (head)");
+    size_t head_len = transcript_header(head, TRANSCRIPT_PROTOCOL_LABEL, protocol_len);
+    memcpy(head + head_len, protocol, protocol_len);
+    head_len += protocol_len;
+    unsigned char tail[TRANSCRIPT_MAX_HEADER];
+    size_t tail_len = transcript_header(tail, label, 0);
+
+    // encode a chunk of transcripts together, then hash the chunk
+    enum { chunk = 4 * SHA256_MB_MAX_LANES };
+    size_t max_len = head_len + list_len * (TRANSCRIPT_MAX_HEADER + P256_POINT_BYTES) + tail_len;
+    unsigned char *msg_buf = malloc(chunk * max_len);
+    unsigned char *point_buf = malloc(chunk * list_len * P256_POINT_BYTES + 1);
+    size_t *point_len = malloc(chunk * list_len * sizeof(size_t) + 1);
+    const EC_POINT **chunk_points = malloc(chunk * list_len * sizeof(EC_POINT*) + 1);
+    unsigned char md[chunk * SHA256_DIGEST_LENGTH];
+    const unsigned char *msg[chunk];
+    size_t len[chunk];
+    assert(msg_buf && point_buf && point_len && chunk_points && "transcript_challenge_columns: allocation error");
+    for (int first=0; first<num; first+=chunk) {
+        int n = num - first < chunk ? num - first : chunk;
+        for (int i=0; i<n; i++) {
+            for (int k=0; k<list_len; k++) {
+                chunk_points[i * list_len + k] = points[k][first + i];
+            }
+        }
+        points_encode(group, n * list_len, chunk_points, point_buf, point_len, ctx);
+        for (int i=0; i<n; i++) {
+            unsigned char *m = msg_buf + i * max_len;
+            size_t off = head_len;
+            memcpy(m, head, head_len);
+            for (int k=0; k<list_len; k++) {
+                int j = i * list_len + k;
+                off += transcript_header(m + off, labels[k], point_len[j]);
+                memcpy(m + off, point_buf + j * P256_POINT_BYTES, point_len[j]);
+                off += point_len[j];
+            }
+            memcpy(m + off, tail, tail_len);
+            msg[i] = m;
+            len[i] = off + tail_len;
+        }
+        sha256_mb(n, msg, len, md);
+        for (int i=0; i<n; i++) {
+            BIGNUM *ret = BN_bin2bn(md + SHA256_DIGEST_LENGTH * i, SHA256_DIGEST_LENGTH, r[first + i]);
+            assert(ret && "transcript_challenge_columns: BN_bin2bn failed");
+            int ok = BN_nnmod(r[first + i], r[first + i], order, ctx);
+            assert(ok == 1 && "transcript_challenge_columns: BN_nnmod failed");
+        }
+    }
+    free(chunk_points);
+    free(point_len);
+    free(point_buf);
+    free(msg_buf);
+    free(head);
+}
+
+/*
+ *
+ *  transcript tests
+ *
+ */
+static int transcript_test_1(int print) {
+    const EC_GROUP *group = get0_group();
+    const BIGNUM *order = get0_order(group);
+    BN_CTX *ctx = BN_CTX_new();
+    BIGNUM *c1 = bn_new();
+    BIGNUM *c2 = bn_new();
+
+    // the same strings give the same challenge, also continuing from a clone of a common prefix
+    transcript prefix, t1, t2;
+    transcript_init(&prefix, "test");
+    transcript_absorb(&prefix, "key", "0123", 4);
+    transcript_clone(&t1, &prefix);
+    transcript_absorb(&t1, "msg", "abc", 3);
+    transcript_init(&t2, "test");
+    transcript_absorb(&t2, "key", "0123", 4);
+    transcript_absorb(&t2, "msg", "abc", 3);
+    transcript_challenge(&t1, "c", c1, order, ctx);
+    transcript_challenge(&t2, "c", c2, order, ctx);
+    int ret1 = BN_cmp(c1, c2) != 0 || BN_cmp(c1, order) >= 0 || BN_is_negative(c1);
+    // the prefix is unchanged by its clones
+    transcript_clone(&t1, &prefix);
+    transcript_absorb(&t1, "msg", "abc", 3);
+    transcript_challenge(&t1, "c", c1, order, ctx);
+    ret1 |= BN_cmp(c1, c2) != 0;
+    if (print) {
+        printf("%6s Test 1 - 1: Equal transcripts %s give equal challenges\n", ret1 ? "NOT OK" : "OK", ret1 ? "do NOT" : "indeed");
+    }
+
+    // moving bytes between label and data or between strings, another protocol or challenge label changes the challenge
+    int ret2 = 0;
+    const char *const split[][4] = {
+        { "msg", "abc", "msg", "abc" },
+        { "ms", "gabc", "msg", "abc" },
+        { "msg", "ab", "msgc", "" }
+    };
+    for (int i=0; i<3; i++) {
+        transcript_init(&t1, "test");
+        transcript_absorb(&t1, split[i][0], split[i][1], strlen(split[i][1]));
+        transcript_absorb(&t1, split[i][2], split[i][3], strlen(split[i][3]));
+        transcript_challenge(&t1, "c", c1, order, ctx);
+        transcript_init(&t2, "test");
+        transcript_absorb(&t2, "msg", "abcabc", 6);
+        transcript_challenge(&t2, "c", c2, order, ctx);
+        ret2 |= BN_cmp(c1, c2) == 0;
+    }
+    transcript_init(&t1, "test2");
+    transcript_absorb(&t1, "msg", "abcabc", 6);
+    transcript_challenge(&t1, "c", c1, order, ctx);
+    ret2 |= BN_cmp(c1, c2) == 0;
+    transcript_init(&t1, "test");
+    transcript_absorb(&t1, "msg", "abcabc", 6);
+    transcript_challenge(&t1, "d", c1, order, ctx);
+    ret2 |= BN_cmp(c1, c2) == 0;
+    if (print) {
+        printf("%6s Test 1 - 2: Different transcripts %s give different challenges\n", ret2 ? "NOT OK" : "OK", ret2 ? "do NOT" : "indeed");
+    }
+
+    // cleanup
+    bn_free(c1);
+    bn_free(c2);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0);
+}
+
+static int transcript_test_2(int print) {
+    const EC_GROUP *group = get0_group();
+    const BIGNUM *order = get0_order(group);
+    BN_CTX *ctx = BN_CTX_new();
+    BIGNUM *c1 = bn_new();
+    BIGNUM *c2 = bn_new();
+
+    // points absorbed as EC_POINTs (Jacobian from multiplications, affine decoded ones, the generator) and
+    // their encodings absorbed as bytes give the same challenge, also with the batched conversion to affine
+    enum { num = 6 };
+    const char *const labels[num] = { "p0", "p1", "p2", "p3", "p4", "p5" };
+    EC_POINT *p[num];
+    unsigned char buf[num * P256_POINT_BYTES];
+    for (int i=0; i<num; i++) {
+        p[i] = point_random(group, ctx);
+    }
+    point_to_bytes(group, p[1], buf, ctx);
+    point_from_bytes(group, p[1], buf, ctx); // affine
+    EC_POINT_copy(p[2], get0_generator(group));
+    int ret1 = points_to_bytes(group, num, (const EC_POINT**)p, buf, ctx);
+    for (int n=1; n<=num; n+=num-1) {
+        transcript t1, t2;
+        transcript_init(&t1, "test");
+        transcript_absorb_points(&t1, group, n, labels, (const EC_POINT**)p, ctx);
+        transcript_challenge(&t1, "c", c1, order, ctx);
+        transcript_init(&t2, "test");
+        for (int i=0; i<n; i++) {
+            transcript_absorb(&t2, labels[i], buf + i * P256_POINT_BYTES, P256_POINT_BYTES);
+        }
+        transcript_challenge(&t2, "c", c2, order, ctx);
+        ret1 |= BN_cmp(c1, c2) != 0;
+    }
+    if (print) {
+        printf("%6s Test 2 - 1: Points and their encodings %s give equal challenges\n", ret1 ? "NOT OK" : "OK", ret1 ? "do NOT" : "indeed");
+    }
+
+    // cleanup
+    for (int i=0; i<num; i++) {
+        point_free(p[i]);
+    }
+    bn_free(c1);
+    bn_free(c2);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return ret1;
+}
+
+static int transcript_test_3(int print) {
+    const EC_GROUP *group = get0_group();
+    const BIGNUM *order = get0_order(group);
+    BN_CTX *ctx = BN_CTX_new();
+
+    // challenges of many transcripts at once (more than a chunk) against transcript_challenge one by one,
+    // one point at infinity
+    enum { num = 150, list_len = 3 };
+    const char *const labels[list_len] = { "a", "A", "R" };
+    EC_POINT *p[list_len][num];
+    const EC_POINT **columns[list_len];
+    for (int k=0; k<list_len; k++) {
+        for (int i=0; i<num; i++) {
+            p[k][i] = point_random(group, ctx);
+        }
+        columns[k] = (const EC_POINT**)p[k];
+    }
+    EC_POINT_set_to_infinity(group, p[1][17]);
+    BIGNUM **r = bn_new_array(num);
+    transcript_challenge_columns(r, group, "test", list_len, labels, columns, "c", num, ctx);
+    BIGNUM *c = bn_new();
+    int ret1 = 0;
+    for (int i=0; i<num; i++) {
+        transcript t;
+        const EC_POINT *row[list_len] = { p[0][i], p[1][i], p[2][i] };
+        transcript_init(&t, "test");
+        transcript_absorb_points(&t, group, list_len, labels, row, ctx);
+        transcript_challenge(&t, "c", c, order, ctx);
+        ret1 |= BN_cmp(c, r[i]) != 0;
+    }
+    if (print) {
+        printf("%6s Test 3 - 1: Challenges of transcripts hashed together %s equal to those hashed one by one\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // cleanup
+    bn_free(c);
+    bn_free_array(num, r);
+    for (int k=0; k<list_len; k++) {
+        for (int i=0; i<num; i++) {
+            point_free(p[k][i]);
+        }
+    }
+    BN_CTX_free(ctx);
+
+    // return test results
+    return ret1;
+}
+
+typedef int (*test_function)(int);
+
+static test_function test_suite[] = {
+    &transcript_test_1,
+    &transcript_test_2,
+    &transcript_test_3
+};
+
+int transcript_test_suite(int print) {
+    if (print) {
+        printf("Transcript test suite BEGIN -------------------------\n");
+    }
+    int num_tests = sizeof(test_suite)/sizeof(test_function);
+    int ret = 0;
+    for (int i=0; i<num_tests; i++) {
+        if (test_suite[i](print)) {
+            ret = 1;
+        }
+    }
+    if (print) {
+        printf("Transcript test suite END ---------------------------\n");
+#ifdef DEBUG
+        print_allocation_status();
+#endif
+        fflush(stdout);
+    }
+    return ret;
+}
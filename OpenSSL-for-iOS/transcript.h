@@ -0,0 +1,48 @@
+//
+//  transcript.h
+//  OpenSSL-for-iOS
+//
+//  Fiat-Shamir transcript: a running SHA-256 over labeled byte strings, each absorbed as
+//  label_len (1 byte) || label || len (4 bytes, big endian) || data, so that no two sequences of
+//  absorbed strings hash the same. Encodings at hand (points as received) are absorbed as they are,
+//  points only held as EC_POINTs are encoded together with one field inversion. A transcript is a
+//  plain value: a prefix absorbed once (protocol, generator, public key) is cloned per proof.
+//
+
+#ifndef TRANSCRIPT_H
+#define TRANSCRIPT_H
+#include <stddef.h>
+#include <openssl/sha.h>
+#include "P256.h"
+
+typedef struct {
+    SHA256_CTX sha;
+} transcript;
+
+// maximal label length (labels are static strings naming the absorbed values)
+#define TRANSCRIPT_MAX_LABEL 64
+
+// start a transcript of protocol, the first absorbed string (domain separation)
+void transcript_init(transcript *t, const char *protocol);
+
+// dst continues from the state of src (prefix reuse)
+void transcript_clone(transcript *dst, const transcript *src);
+
+// absorb len bytes of data under label
+void transcript_absorb(transcript *t, const char *label, const void *data, size_t len);
+
+// absorb the compressed encodings of num points (points[i] under labels[i]), converted to affine together
+// (see points_encode)
+void transcript_absorb_points(transcript *t, const EC_GROUP *group, int num, const char *const *labels, const EC_POINT **points, BN_CTX *ctx);
+
+// c = hash of the transcript with label absorbed, reduced modulo order (t itself continues with label absorbed)
+void transcript_challenge(transcript *t, const char *label, BIGNUM *c, const BIGNUM *order, BN_CTX *ctx);
+
+// r[i] = challenge under label of a transcript of protocol that absorbed points[k][i] under labels[k] for
+// k < list_len (as transcript_init, transcript_absorb_points and transcript_challenge) for i < num, the points
+// of several transcripts encoded together and the transcripts hashed several at a time (sha256_mb.h)
+void transcript_challenge_columns(BIGNUM **r, const EC_GROUP *group, const char *protocol, int list_len, const char *const *labels, const EC_POINT **points[], const char *label, int num, BN_CTX *ctx);
+
+int transcript_test_suite(int print);
+
+#endif /* TRANSCRIPT_H */
@@ -0,0 +1,529 @@
+//
+//  verify_cache.c
+//  OpenSSL-for-iOS
+//
+#include "verify_cache.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config_platform.h"
+#include "openssl_hashing_tools.h"
+#include "praos_vrf.h"
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+#include <malloc.h>
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+// power of two, keys are uniform so their first byte picks the shard
+#define VERIFY_CACHE_SHARDS 16
+
+typedef struct {
+    unsigned char key[VERIFY_CACHE_KEY_BYTES];
+    int hash_next; // next entry in the same bucket, -1 at the end
+    int prev; // towards the newest entry (LRU, FIFO)
+    int next; // towards the oldest entry, evicted first
+    int referenced; // looked up since the clock hand passed (CLOCK)
+} verify_cache_entry;
+
+typedef struct {
+    _Alignas(64) int num_entries;
+    verify_cache_entry *entries;
+    int *buckets; // first entry per bucket, -1 if empty
+    int first; // newest
+    int last; // oldest
+    int hand; // next entry the clock looks at
+    long hits;
+    long misses;
+    long insertions;
+    long evictions;
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+    SRWLOCK lock;
+#else
+    pthread_mutex_t lock;
+#endif
+} verify_cache_shard;
+
+struct verify_cache {
+    verify_cache_policy policy;
+    int shard_capacity;
+    int bucket_mask;
+    verify_cache_shard *shards;
+};
+
+static void shard_lock(verify_cache_shard *shard) {
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+    AcquireSRWLockExclusive(&shard->lock);
+#else
+    int ret = pthread_mutex_lock(&shard->lock);
+    assert(ret == 0 && "verify_cache: pthread_mutex_lock failed");
+#endif
+}
+
+static void shard_unlock(verify_cache_shard *shard) {
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+    ReleaseSRWLockExclusive(&shard->lock);
+#else
+    int ret = pthread_mutex_unlock(&shard->lock);
+    assert(ret == 0 && "verify_cache: pthread_mutex_unlock failed");
+#endif
+}
+
+static void shard_clear(const verify_cache *cache, verify_cache_shard *shard) {
+    memset(shard->buckets, 0xff, (cache->bucket_mask + 1) * sizeof(int)); // all -1
+    shard->num_entries = 0;
+    shard->first = -1;
+    shard->last = -1;
+    shard->hand = 0;
+    shard->hits = 0;
+    shard->misses = 0;
+    shard->insertions = 0;
+    shard->evictions = 0;
+}
+
+verify_cache *verify_cache_new(int capacity, verify_cache_policy policy) {
+    assert(capacity > 0 && "verify_cache_new: usage error, capacity must be positive");
+    verify_cache *cache = malloc(sizeof(verify_cache));
+    assert(cache && "verify_cache_new: allocation error (cache)");
+    cache->policy = policy;
+    cache->shard_capacity = (capacity + VERIFY_CACHE_SHARDS - 1) / VERIFY_CACHE_SHARDS;
+    int num_buckets = 1;
+    while (num_buckets < 2 * cache->shard_capacity) {
+        num_buckets *= 2;
+    }
+    cache->bucket_mask = num_buckets - 1;
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+    cache->shards = _aligned_malloc(VERIFY_CACHE_SHARDS * sizeof(verify_cache_shard), 64);
+#else
+    if (posix_memalign((void **)&cache->shards, 64, VERIFY_CACHE_SHARDS * sizeof(verify_cache_shard))) {
+        cache->shards = NULL;
+    }
+#endif
+    assert(cache->shards && "verify_cache_new: allocation error (shards)");
+    for (int s=0; s<VERIFY_CACHE_SHARDS; s++) {
+        verify_cache_shard *shard = &cache->shards[s];
+        shard->entries = malloc(cache->shard_capacity * sizeof(verify_cache_entry));
+        shard->buckets = malloc(num_buckets * sizeof(int));
+        assert(shard->entries && shard->buckets && "verify_cache_new: allocation error (table)");
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+        InitializeSRWLock(&shard->lock);
+#else
+        int ret = pthread_mutex_init(&shard->lock, NULL);
+        assert(ret == 0 && "verify_cache_new: pthread_mutex_init failed");
+#endif
+        shard_clear(cache, shard);
+    }
+    return cache;
+}
+
+void verify_cache_free(verify_cache *cache) {
+    for (int s=0; s<VERIFY_CACHE_SHARDS; s++) {
+#if PLATFORM_TYPE != PLATFORM_TYPE_WINDOWS
+        pthread_mutex_destroy(&cache->shards[s].lock);
+#endif
+        free(cache->shards[s].entries);
+        free(cache->shards[s].buckets);
+    }
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+    _aligned_free(cache->shards);
+#else
+    free(cache->shards);
+#endif
+    free(cache);
+}
+
+static verify_cache *default_cache = NULL;
+
+static void default_cache_init(void) {
+    default_cache = verify_cache_new(VERIFY_CACHE_DEFAULT_CAPACITY, VERIFY_CACHE_LRU);
+}
+
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+static INIT_ONCE default_cache_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK default_cache_init_once(PINIT_ONCE once, PVOID param, PVOID *context) {
+    default_cache_init();
+    return TRUE;
+}
+
+verify_cache *get0_verify_cache(void) {
+    InitOnceExecuteOnce(&default_cache_once, default_cache_init_once, NULL, NULL);
+    return default_cache;
+}
+#else
+static pthread_once_t default_cache_once = PTHREAD_ONCE_INIT;
+
+verify_cache *get0_verify_cache(void) {
+    int ret = pthread_once(&default_cache_once, default_cache_init);
+    assert(ret == 0 && "get0_verify_cache: pthread_once failed");
+    return default_cache;
+}
+#endif
+
+int verify_cache_key(const BIGNUM *seed, const unsigned char *output, const unsigned char *pub_key, unsigned char *key) {
+    unsigned char seed_bytes[P256_SCALAR_BYTES];
+    // the encoding drops the sign, negative seeds are not cached
+    if (BN_is_negative(seed) || bn_to_bytes(seed, seed_bytes)) {
+        return 1;
+    }
+    SHA256_CTX sha_ctx;
+    openssl_hash_init(&sha_ctx);
+    openssl_hash_update(&sha_ctx, pub_key, P256_POINT_BYTES);
+    openssl_hash_update(&sha_ctx, seed_bytes, P256_SCALAR_BYTES);
+    openssl_hash_update(&sha_ctx, output, VRF_OUTPUT_BYTES);
+    openssl_hash_final(key, &sha_ctx);
+    return 0;
+}
+
+static verify_cache_shard *get0_shard(verify_cache *cache, const unsigned char *key) {
+    return &cache->shards[key[0] & (VERIFY_CACHE_SHARDS - 1)];
+}
+
+static int get_bucket(const verify_cache *cache, const unsigned char *key) {
+    uint32_t h = (uint32_t)key[1] | (uint32_t)key[2] << 8 | (uint32_t)key[3] << 16 | (uint32_t)key[4] << 24;
+    return (int)(h & (uint32_t)cache->bucket_mask);
+}
+
+static int shard_find(const verify_cache_shard *shard, const unsigned char *key, int bucket) {
+    for (int i=shard->buckets[bucket]; i>=0; i=shard->entries[i].hash_next) {
+        if (memcmp(shard->entries[i].key, key, VERIFY_CACHE_KEY_BYTES) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void shard_list_unlink(verify_cache_shard *shard, int i) {
+    verify_cache_entry *e = &shard->entries[i];
+    if (e->prev >= 0) {
+        shard->entries[e->prev].next = e->next;
+    } else {
+        shard->first = e->next;
+    }
+    if (e->next >= 0) {
+        shard->entries[e->next].prev = e->prev;
+    } else {
+        shard->last = e->prev;
+    }
+}
+
+static void shard_list_push_first(verify_cache_shard *shard, int i) {
+    verify_cache_entry *e = &shard->entries[i];
+    e->prev = -1;
+    e->next = shard->first;
+    if (shard->first >= 0) {
+        shard->entries[shard->first].prev = i;
+    } else {
+        shard->last = i;
+    }
+    shard->first = i;
+}
+
+static void shard_bucket_unlink(const verify_cache *cache, verify_cache_shard *shard, int i) {
+    int *link = &shard->buckets[get_bucket(cache, shard->entries[i].key)];
+    while (*link != i) {
+        link = &shard->entries[*link].hash_next;
+    }
+    *link = shard->entries[i].hash_next;
+}
+
+// entry to overwrite in a full shard
+static int shard_victim(const verify_cache *cache, verify_cache_shard *shard) {
+    if (cache->policy != VERIFY_CACHE_CLOCK) {
+        int i = shard->last;
+        shard_list_unlink(shard, i);
+        return i;
+    }
+    for (;;) {
+        int i = shard->hand;
+        shard->hand = (shard->hand + 1) % cache->shard_capacity;
+        if (!shard->entries[i].referenced) {
+            return i;
+        }
+        shard->entries[i].referenced = 0;
+    }
+}
+
+int verify_cache_lookup(verify_cache *cache, const unsigned char *key) {
+    verify_cache_shard *shard = get0_shard(cache, key);
+    int bucket = get_bucket(cache, key);
+    shard_lock(shard);
+    int i = shard_find(shard, key, bucket);
+    if (i >= 0) {
+        shard->hits++;
+        if (cache->policy == VERIFY_CACHE_LRU) {
+            shard_list_unlink(shard, i);
+            shard_list_push_first(shard, i);
+        } else if (cache->policy == VERIFY_CACHE_CLOCK) {
+            shard->entries[i].referenced = 1;
+        }
+    } else {
+        shard->misses++;
+    }
+    shard_unlock(shard);
+    return i >= 0;
+}
+
+void verify_cache_insert(verify_cache *cache, const unsigned char *key) {
+    verify_cache_shard *shard = get0_shard(cache, key);
+    int bucket = get_bucket(cache, key);
+    shard_lock(shard);
+    // another thread may have verified the same output in the meantime
+    if (shard_find(shard, key, bucket) < 0) {
+        int i;
+        if (shard->num_entries < cache->shard_capacity) {
+            i = shard->num_entries++;
+        } else {
+            i = shard_victim(cache, shard);
+            shard_bucket_unlink(cache, shard, i);
+            shard->evictions++;
+        }
+        verify_cache_entry *e = &shard->entries[i];
+        memcpy(e->key, key, VERIFY_CACHE_KEY_BYTES);
+        e->referenced = 0;
+        e->hash_next = shard->buckets[bucket];
+        shard->buckets[bucket] = i;
+        if (cache->policy != VERIFY_CACHE_CLOCK) {
+            shard_list_push_first(shard, i);
+        }
+        shard->insertions++;
+    }
+    shard_unlock(shard);
+}
+
+void verify_cache_get_stats(verify_cache *cache, verify_cache_stats *stats) {
+    memset(stats, 0, sizeof(verify_cache_stats));
+    for (int s=0; s<VERIFY_CACHE_SHARDS; s++) {
+        verify_cache_shard *shard = &cache->shards[s];
+        shard_lock(shard);
+        stats->hits += shard->hits;
+        stats->misses += shard->misses;
+        stats->insertions += shard->insertions;
+        stats->evictions += shard->evictions;
+        stats->num_entries += shard->num_entries;
+        shard_unlock(shard);
+    }
+    stats->capacity = VERIFY_CACHE_SHARDS * cache->shard_capacity;
+    stats->memory_bytes = sizeof(verify_cache) + VERIFY_CACHE_SHARDS * (sizeof(verify_cache_shard) +
+                          cache->shard_capacity * sizeof(verify_cache_entry) + (cache->bucket_mask + 1) * sizeof(int));
+}
+
+void verify_cache_clear(verify_cache *cache) {
+    for (int s=0; s<VERIFY_CACHE_SHARDS; s++) {
+        shard_lock(&cache->shards[s]);
+        shard_clear(cache, &cache->shards[s]);
+        shard_unlock(&cache->shards[s]);
+    }
+}
+
+/*
+ *
+ *  verify_cache tests
+ *
+ */
+
+// key of shard 0 (first byte) numbered by n
+static void test_key(unsigned char *key, int n) {
+    memset(key, 0, VERIFY_CACHE_KEY_BYTES);
+    key[0] = VERIFY_CACHE_SHARDS * (n % 8);
+    key[1] = (unsigned char)n;
+    key[31] = (unsigned char)(n >> 8);
+}
+
+// outputs kept per policy, all keys in one shard of capacity 2 (a cache of 2 * VERIFY_CACHE_SHARDS)
+static int verify_cache_test_1(int print) {
+    const char *policy_names[] = { "LRU", "FIFO", "CLOCK" };
+    // insert 0, 1, look up 0, insert 2: LRU keeps 0 and 2, FIFO 1 and 2, CLOCK (0 referenced) 0 and 2
+    const int kept[3][3] = { { 1, 0, 1 }, { 0, 1, 1 }, { 1, 0, 1 } };
+    int ret1 = 0;
+    for (int p=0; p<3; p++) {
+        verify_cache *cache = verify_cache_new(2 * VERIFY_CACHE_SHARDS, (verify_cache_policy)p);
+        unsigned char key[VERIFY_CACHE_KEY_BYTES];
+        test_key(key, 0);
+        verify_cache_insert(cache, key);
+        test_key(key, 1);
+        verify_cache_insert(cache, key);
+        test_key(key, 0);
+        int ret = verify_cache_lookup(cache, key) != 1;
+        test_key(key, 2);
+        verify_cache_insert(cache, key);
+        for (int n=0; n<3; n++) {
+            test_key(key, n);
+            ret |= verify_cache_lookup(cache, key) != kept[p][n];
+        }
+        verify_cache_stats stats;
+        verify_cache_get_stats(cache, &stats);
+        ret |= stats.hits != 3 || stats.misses != 1 || stats.insertions != 3 || stats.evictions != 1 || stats.num_entries != 2;
+        verify_cache_clear(cache);
+        ret |= verify_cache_lookup(cache, key) != 0;
+        if (print) {
+            printf("%6s Test 1 - %d: %s eviction %s\n", ret ? "NOT OK" : "OK", p + 1, policy_names[p], ret ? "NOT correct" : "correct");
+        }
+        ret1 |= ret;
+        verify_cache_free(cache);
+    }
+    return ret1;
+}
+
+// keys differ in every field of the output
+static int verify_cache_test_2(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    BIGNUM *seed = bn_random(get0_order(group), ctx);
+    unsigned char output[VRF_OUTPUT_BYTES];
+    for (int i=0; i<VRF_OUTPUT_BYTES; i++) {
+        output[i] = (unsigned char)i;
+    }
+    unsigned char pub_key[P256_POINT_BYTES];
+    memset(pub_key, 0x5a, P256_POINT_BYTES);
+    unsigned char key[VERIFY_CACHE_KEY_BYTES];
+    unsigned char other[VERIFY_CACHE_KEY_BYTES];
+    int ret1 = verify_cache_key(seed, output, pub_key, key);
+    ret1 |= verify_cache_key(seed, output, pub_key, other) || memcmp(key, other, VERIFY_CACHE_KEY_BYTES) != 0;
+    for (int i=0; i<VRF_OUTPUT_BYTES; i+=11) {
+        output[i] ^= 1;
+        ret1 |= verify_cache_key(seed, output, pub_key, other) || memcmp(key, other, VERIFY_CACHE_KEY_BYTES) == 0;
+        output[i] ^= 1;
+    }
+    BN_add_word(seed, 1);
+    ret1 |= verify_cache_key(seed, output, pub_key, other) || memcmp(key, other, VERIFY_CACHE_KEY_BYTES) == 0;
+    BN_sub_word(seed, 1);
+    pub_key[P256_POINT_BYTES - 1] ^= 1;
+    ret1 |= verify_cache_key(seed, output, pub_key, other) || memcmp(key, other, VERIFY_CACHE_KEY_BYTES) == 0;
+    pub_key[P256_POINT_BYTES - 1] ^= 1;
+    // the suite is the last byte of the output
+    output[VRF_OUTPUT_SUITE_OFFSET] ^= 1;
+    ret1 |= verify_cache_key(seed, output, pub_key, other) || memcmp(key, other, VERIFY_CACHE_KEY_BYTES) == 0;
+    output[VRF_OUTPUT_SUITE_OFFSET] ^= 1;
+    BN_set_negative(seed, 1);
+    ret1 |= verify_cache_key(seed, output, pub_key, other) != 1;
+    if (print) {
+        printf("%6s Test 2 - 1: Keys %s suite, key, seed and output\n", ret1 ? "NOT OK" : "OK", ret1 ? "do NOT separate" : "separate");
+    }
+
+    // cleanup
+    bn_free(seed);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return ret1;
+}
+
+// passed to the verifiers: repeated outputs are hits, changed ones are verified (and rejected)
+static int verify_cache_test_3(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    verify_cache *cache = verify_cache_new(64, VERIFY_CACHE_LRU);
+    praos_vrf_params params = { PRAOS_VRF_SUITE_LEGACY, NULL, cache };
+    key_pair kp;
+    key_pair_generate(group, &kp, ctx);
+    BIGNUM *seed = bn_random(get0_order(group), ctx);
+    BIGNUM *randval;
+    EC_POINT *u = point_new(group);
+    nizk_dl_eq_proof pi;
+    prove_vrf(group, seed, &randval, u, &pi, &kp, NULL, ctx);
+    unsigned char output[VRF_OUTPUT_BYTES];
+    vrf_output_to_bytes(group, u, &pi, randval, PRAOS_VRF_SUITE_LEGACY, output, ctx);
+
+    int ret1 = verify_vrf(group, seed, randval, u, &pi, kp.pub, &params, ctx);
+    ret1 |= verify_vrf(group, seed, randval, u, &pi, kp.pub, &params, ctx);
+    ret1 |= verify_vrf_bytes(group, seed, output, kp.pub, &params, ctx);
+    ret1 |= verify_vrf_batch(group, 1, &seed, &randval, &u, &pi, &kp.pub, NULL, &params, ctx);
+    verify_cache_stats stats;
+    verify_cache_get_stats(cache, &stats);
+    ret1 |= stats.hits != 3 || stats.misses != 1 || stats.insertions != 1;
+    if (print) {
+        printf("%6s Test 3 - 1: Repeated VRF output %s from the cache on all paths\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT answered" : "answered");
+    }
+
+    BN_add_word(pi.z, 1);
+    int ret2 = verify_vrf(group, seed, randval, u, &pi, kp.pub, &params, ctx) && verify_vrf(group, seed, randval, u, &pi, kp.pub, &params, ctx);
+    output[P256_POINT_BYTES + NIZK_DL_EQ_PROOF_BYTES - 1] ^= 1;
+    ret2 = ret2 && verify_vrf_bytes(group, seed, output, kp.pub, &params, ctx);
+    verify_cache_get_stats(cache, &stats);
+    ret2 = ret2 && stats.hits == 3 && stats.insertions == 1;
+    if (print) {
+        if (ret2) {
+            printf("    OK Test 3 - 2: Changed VRF outputs not accepted (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 3 - 2: Changed VRF output IS accepted or cached (which is an ERROR)\n");
+        }
+    }
+
+    // batch of the cached output, a new one and a bad one: only the new ones are checked, the bad one is reported
+    BN_sub_word(pi.z, 1);
+    BIGNUM *seeds[3] = { seed, seed, seed };
+    BIGNUM *randvals[3];
+    EC_POINT *us[3];
+    nizk_dl_eq_proof pis[3];
+    EC_POINT *pub_keys[3] = { kp.pub, kp.pub, kp.pub };
+    randvals[0] = randval;
+    us[0] = u;
+    pis[0] = pi;
+    for (int i=1; i<3; i++) {
+        us[i] = point_new(group);
+        prove_vrf(group, seed, &randvals[i], us[i], &pis[i], &kp, NULL, ctx);
+    }
+    BN_add_word(randvals[2], 1);
+    int bad_index = -1;
+    int ret3 = verify_vrf_batch(group, 3, seeds, randvals, us, pis, pub_keys, &bad_index, &params, ctx) != 1 || bad_index != 2;
+    verify_cache_get_stats(cache, &stats);
+    ret3 |= stats.hits != 4 || stats.insertions != 1;
+    BN_sub_word(randvals[2], 1);
+    ret3 |= verify_vrf_batch(group, 3, seeds, randvals, us, pis, pub_keys, NULL, &params, ctx);
+    verify_cache_get_stats(cache, &stats);
+    ret3 |= stats.hits != 5 || stats.insertions != 3;
+    if (print) {
+        printf("%6s Test 3 - 3: Batches with cached outputs %s\n", ret3 ? "NOT OK" : "OK", ret3 ? "NOT verified correctly" : "verified correctly");
+    }
+    for (int i=1; i<3; i++) {
+        nizk_dl_eq_proof_free(&pis[i]);
+        point_free(us[i]);
+        bn_free(randvals[i]);
+    }
+
+    // cleanup
+    nizk_dl_eq_proof_free(&pi);
+    point_free(u);
+    bn_free(randval);
+    bn_free(seed);
+    key_pair_free(&kp);
+    verify_cache_free(cache);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 != 0 && ret3 == 0);
+}
+
+typedef int (*test_function)(int);
+
+static test_function test_suite[] = {
+    &verify_cache_test_1,
+    &verify_cache_test_2,
+    &verify_cache_test_3
+};
+
+int verify_cache_test_suite(int print) {
+    if (print) {
+        printf("Verify cache test suite BEGIN -----------------------\n");
+    }
+    int num_tests = sizeof(test_suite)/sizeof(test_function);
+    int ret = 0;
+    for (int i=0; i<num_tests; i++) {
+        if (test_suite[i](print)) {
+            ret = 1;
+        }
+    }
+    if (print) {
+        printf("Verify cache test suite END -------------------------\n");
+#ifdef DEBUG
+        print_allocation_status();
+        nizk_dl_eq_print_allocation_status();
+#endif
+        fflush(stdout);
+    }
+    return ret;
+}
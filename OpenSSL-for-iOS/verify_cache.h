@@ -0,0 +1,64 @@
+//
+//  verify_cache.h
+//  OpenSSL-for-iOS
+//
+//  Bounded cache of VRF outputs that verified, keyed by SHA-256 of (pub_key, seed, u, Ra, Rb, z, randval, suite).
+//  Headers arrive from many peers under gossip; with the cache passed in praos_vrf_params the VRF verifiers answer
+//  a repeated output with one hash and a table lookup. Only successes are stored. The table is split into shards
+//  by key, each with its own lock, so concurrent verifiers rarely wait for each other.
+//
+
+#ifndef VERIFY_CACHE_H
+#define VERIFY_CACHE_H
+#include <stddef.h>
+#include "P256.h"
+
+typedef struct verify_cache verify_cache;
+
+#define VERIFY_CACHE_KEY_BYTES 32
+#define VERIFY_CACHE_DEFAULT_CAPACITY 8192
+
+// which output a full shard drops for a new one
+typedef enum {
+    VERIFY_CACHE_LRU = 0,   // least recently looked up or inserted
+    VERIFY_CACHE_FIFO = 1,  // least recently inserted, hits do not reorder (no write on a hit)
+    VERIFY_CACHE_CLOCK = 2  // second chance: the oldest one not looked up since the clock hand last passed it
+} verify_cache_policy;
+
+typedef struct {
+    long hits;
+    long misses;
+    long insertions;
+    long evictions;
+    int num_entries;
+    int capacity;
+    size_t memory_bytes; // fixed at creation
+} verify_cache_stats;
+
+// new empty cache holding at most capacity outputs (rounded up to a multiple of the number of shards)
+verify_cache *verify_cache_new(int capacity, verify_cache_policy policy);
+
+void verify_cache_free(verify_cache *cache);
+
+// process wide LRU cache of VERIFY_CACHE_DEFAULT_CAPACITY outputs, for the verify_cache of praos_vrf_params
+verify_cache *get0_verify_cache(void);
+
+// key of the encoded VRF output (VRF_OUTPUT_BYTES, the suite included) for seed and the encoded public key
+// (P256_POINT_BYTES), returns 0 on success, 1 if the output cannot be cached (seed not a 32-byte scalar)
+int verify_cache_key(const BIGNUM *seed, const unsigned char *output, const unsigned char *pub_key, unsigned char *key);
+
+// 1 if key was inserted and not evicted since, 0 otherwise
+int verify_cache_lookup(verify_cache *cache, const unsigned char *key);
+
+// record key as verified, evicting by the policy if its shard is full
+void verify_cache_insert(verify_cache *cache, const unsigned char *key);
+
+// counters since creation or the last verify_cache_clear
+void verify_cache_get_stats(verify_cache *cache, verify_cache_stats *stats);
+
+// drop all outputs and reset the counters
+void verify_cache_clear(verify_cache *cache);
+
+int verify_cache_test_suite(int print);
+
+#endif /* VERIFY_CACHE_H */
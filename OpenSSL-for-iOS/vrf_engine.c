@@ -0,0 +1,410 @@
+//
+//  vrf_engine.c
+//  OpenSSL-for-iOS
+//
+#include "config_platform.h"
+#if PLATFORM_TYPE == PLATFORM_TYPE_UNIX
+#define _GNU_SOURCE // pthread_setaffinity_np
+#endif
+#include "vrf_engine.h"
+#include <assert.h>
+#include <stdlib.h>
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+#error "vrf_engine: unsupported platform type (not implemented for this platform)"
+#endif
+#include <pthread.h>
+#include <unistd.h>
+#if PLATFORM_TYPE == PLATFORM_TYPE_MAC
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#elif PLATFORM_TYPE == PLATFORM_TYPE_UNIX
+#include <sched.h>
+#endif
+
+// chunks [begin, end) queued at a worker, the owner takes from the front, thieves from the back
+typedef struct {
+    pthread_mutex_t lock;
+    int begin;
+    int end;
+} vrf_engine_queue;
+
+typedef struct {
+    vrf_engine *engine;
+    int index;
+    pthread_t thread;
+    BN_CTX *ctx;
+    vrf_engine_queue queue;
+
+    // batch arguments of one chunk, grown to the chunk size by the worker (not on its stack)
+    int capacity;
+    BIGNUM **seed;
+    BIGNUM **randval;
+    EC_POINT **u;
+    EC_POINT **pub_key;
+    nizk_dl_eq_proof *pi;
+} vrf_engine_worker;
+
+struct vrf_engine {
+    int num_threads;
+    int pin_threads;
+    vrf_engine_worker *workers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond; // new work or shutdown
+    pthread_cond_t done_cond; // all workers done with the current work
+    unsigned long generation; // incremented for every vrf_engine_verify call
+    int shutdown;
+    int num_busy;
+
+    // current work
+    vrf_verify_job *jobs;
+    int num_jobs;
+    int chunk_size;
+    const praos_vrf_params *params;
+    int num_failed;
+};
+
+// pin the calling worker thread, on MAC this is an affinity hint only
+static void vrf_engine_pin_thread(int index) {
+#if PLATFORM_TYPE == PLATFORM_TYPE_UNIX
+    long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET((int)(index % (num_cores > 0 ? num_cores : 1)), &cpu_set);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#elif PLATFORM_TYPE == PLATFORM_TYPE_MAC
+    thread_affinity_policy_data_t policy = { index + 1 }; // distinct tags ask for distinct cores
+    thread_policy_set(pthread_mach_thread_np(pthread_self()), THREAD_AFFINITY_POLICY, (thread_policy_t)&policy, THREAD_AFFINITY_POLICY_COUNT);
+#endif
+}
+
+// take the next chunk from the own queue, -1 if empty
+static int vrf_engine_take(vrf_engine_worker *worker) {
+    int chunk = -1;
+    pthread_mutex_lock(&worker->queue.lock);
+    if (worker->queue.begin < worker->queue.end) {
+        chunk = worker->queue.begin++;
+    }
+    pthread_mutex_unlock(&worker->queue.lock);
+    return chunk;
+}
+
+// steal half of the chunks of the first other worker that has any, -1 if all queues are empty
+static int vrf_engine_steal(vrf_engine_worker *worker) {
+    vrf_engine *engine = worker->engine;
+    for (int i=1; i<engine->num_threads; i++) {
+        vrf_engine_worker *victim = &engine->workers[(worker->index + i) % engine->num_threads];
+        pthread_mutex_lock(&victim->queue.lock);
+        int num = victim->queue.end - victim->queue.begin;
+        if (num <= 0) {
+            pthread_mutex_unlock(&victim->queue.lock);
+            continue;
+        }
+        int num_stolen = (num + 1) / 2;
+        victim->queue.end -= num_stolen;
+        int begin = victim->queue.end;
+        pthread_mutex_unlock(&victim->queue.lock);
+
+        // keep the first stolen chunk, queue the rest
+        pthread_mutex_lock(&worker->queue.lock);
+        worker->queue.begin = begin + 1;
+        worker->queue.end = begin + num_stolen;
+        pthread_mutex_unlock(&worker->queue.lock);
+        return begin;
+    }
+    return -1;
+}
+
+// make room for chunks of chunk_size jobs in the scratch of the worker
+static void vrf_engine_reserve(vrf_engine_worker *worker, int chunk_size) {
+    if (chunk_size <= worker->capacity) {
+        return;
+    }
+    worker->seed = realloc(worker->seed, chunk_size * sizeof(BIGNUM*));
+    worker->randval = realloc(worker->randval, chunk_size * sizeof(BIGNUM*));
+    worker->u = realloc(worker->u, chunk_size * sizeof(EC_POINT*));
+    worker->pub_key = realloc(worker->pub_key, chunk_size * sizeof(EC_POINT*));
+    worker->pi = realloc(worker->pi, chunk_size * sizeof(nizk_dl_eq_proof));
+    assert(worker->seed && worker->randval && worker->u && worker->pub_key && worker->pi && "vrf_engine_reserve: allocation error");
+    worker->capacity = chunk_size;
+}
+
+// batch verify jobs [first, first + num) of the scratch; on a failure the jobs before the first bad one verified,
+// the rest is verified in two halves, so that k bad jobs cost O(k log num) batches, returns the number of failed jobs
+static int vrf_engine_verify_range(vrf_engine_worker *worker, vrf_verify_job *jobs, int first, int num) {
+    if (num <= 0) {
+        return 0;
+    }
+    int bad_index = 0;
+    if (!verify_vrf_batch(get0_group(), num, worker->seed + first, worker->randval + first, worker->u + first, worker->pi + first, worker->pub_key + first, &bad_index, worker->engine->params, worker->ctx)) {
+        bad_index = num;
+    }
+    for (int i=0; i<bad_index; i++) {
+        jobs[first + i].result = 0;
+    }
+    if (bad_index == num) {
+        return 0;
+    }
+    jobs[first + bad_index].result = 1;
+    int rest = first + bad_index + 1;
+    int num_rest = num - bad_index - 1;
+    return 1 + vrf_engine_verify_range(worker, jobs, rest, num_rest / 2) +
+               vrf_engine_verify_range(worker, jobs, rest + num_rest / 2, num_rest - num_rest / 2);
+}
+
+// verify a chunk of jobs as one batch, returns the number of failed jobs
+static int vrf_engine_verify_chunk(vrf_engine_worker *worker, int chunk) {
+    vrf_engine *engine = worker->engine;
+    int first = chunk * engine->chunk_size;
+    int num = engine->num_jobs - first < engine->chunk_size ? engine->num_jobs - first : engine->chunk_size;
+    vrf_verify_job *jobs = engine->jobs + first;
+
+    for (int i=0; i<num; i++) {
+        worker->seed[i] = jobs[i].seed;
+        worker->randval[i] = jobs[i].randval;
+        worker->u[i] = jobs[i].u;
+        worker->pi[i] = *jobs[i].pi;
+        worker->pub_key[i] = jobs[i].pub_key;
+    }
+    return vrf_engine_verify_range(worker, jobs, 0, num);
+}
+
+static void *vrf_engine_worker_main(void *arg) {
+    vrf_engine_worker *worker = arg;
+    vrf_engine *engine = worker->engine;
+    if (engine->pin_threads) {
+        vrf_engine_pin_thread(worker->index);
+    }
+
+    unsigned long generation = 0; // not engine->generation, work may have been submitted before this thread runs
+    pthread_mutex_lock(&engine->lock);
+    for (;;) {
+        while (!engine->shutdown && engine->generation == generation) {
+            pthread_cond_wait(&engine->work_cond, &engine->lock);
+        }
+        if (engine->shutdown) {
+            break;
+        }
+        generation = engine->generation;
+        int chunk_size = engine->chunk_size;
+        pthread_mutex_unlock(&engine->lock);
+
+        vrf_engine_reserve(worker, chunk_size);
+        int num_failed = 0;
+        int chunk;
+        while ((chunk = vrf_engine_take(worker)) >= 0 || (chunk = vrf_engine_steal(worker)) >= 0) {
+            num_failed += vrf_engine_verify_chunk(worker, chunk);
+        }
+
+        pthread_mutex_lock(&engine->lock);
+        engine->num_failed += num_failed;
+        if (--engine->num_busy == 0) {
+            pthread_cond_signal(&engine->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&engine->lock);
+    return NULL;
+}
+
+vrf_engine *vrf_engine_new(int num_threads, int pin_threads) {
+    assert(num_threads > 0 && "vrf_engine_new: usage error, no threads");
+    get0_group(); // instantiate the group before the workers use it
+
+    vrf_engine *engine = calloc(1, sizeof(vrf_engine));
+    assert(engine && "vrf_engine_new: allocation error (engine)");
+    engine->num_threads = num_threads;
+    engine->pin_threads = pin_threads;
+    pthread_mutex_init(&engine->lock, NULL);
+    pthread_cond_init(&engine->work_cond, NULL);
+    pthread_cond_init(&engine->done_cond, NULL);
+
+    engine->workers = calloc(num_threads, sizeof(vrf_engine_worker));
+    assert(engine->workers && "vrf_engine_new: allocation error (workers)");
+    for (int i=0; i<num_threads; i++) {
+        vrf_engine_worker *worker = &engine->workers[i];
+        worker->engine = engine;
+        worker->index = i;
+        worker->ctx = BN_CTX_new();
+        assert(worker->ctx && "vrf_engine_new: allocation error (BN_CTX)");
+        pthread_mutex_init(&worker->queue.lock, NULL);
+    }
+    for (int i=0; i<num_threads; i++) {
+        int ret = pthread_create(&engine->workers[i].thread, NULL, vrf_engine_worker_main, &engine->workers[i]);
+        assert(ret == 0 && "vrf_engine_new: pthread_create failed");
+    }
+    return engine;
+}
+
+void vrf_engine_free(vrf_engine *engine) {
+    pthread_mutex_lock(&engine->lock);
+    engine->shutdown = 1;
+    pthread_cond_broadcast(&engine->work_cond);
+    pthread_mutex_unlock(&engine->lock);
+
+    for (int i=0; i<engine->num_threads; i++) {
+        vrf_engine_worker *worker = &engine->workers[i];
+        pthread_join(worker->thread, NULL);
+        pthread_mutex_destroy(&worker->queue.lock);
+        BN_CTX_free(worker->ctx);
+        free(worker->seed);
+        free(worker->randval);
+        free(worker->u);
+        free(worker->pub_key);
+        free(worker->pi);
+    }
+    free(engine->workers);
+    pthread_cond_destroy(&engine->done_cond);
+    pthread_cond_destroy(&engine->work_cond);
+    pthread_mutex_destroy(&engine->lock);
+    free(engine);
+}
+
+int vrf_engine_verify(vrf_engine *engine, int num_jobs, vrf_verify_job *jobs, int chunk_size, const praos_vrf_params *params) {
+    assert(chunk_size > 0 && "vrf_engine_verify: usage error, unexpected chunk size");
+    if (num_jobs <= 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&engine->lock);
+    engine->jobs = jobs;
+    engine->num_jobs = num_jobs;
+    engine->chunk_size = chunk_size;
+    engine->params = params;
+    engine->num_failed = 0;
+
+    // spread the chunks evenly, workers that finish early steal from the others
+    int num_chunks = (num_jobs + chunk_size - 1) / chunk_size;
+    for (int i=0; i<engine->num_threads; i++) {
+        vrf_engine_queue *queue = &engine->workers[i].queue;
+        pthread_mutex_lock(&queue->lock);
+        queue->begin = (int)((long)num_chunks * i / engine->num_threads);
+        queue->end = (int)((long)num_chunks * (i + 1) / engine->num_threads);
+        pthread_mutex_unlock(&queue->lock);
+    }
+
+    engine->num_busy = engine->num_threads;
+    engine->generation++;
+    pthread_cond_broadcast(&engine->work_cond);
+    while (engine->num_busy > 0) {
+        pthread_cond_wait(&engine->done_cond, &engine->lock);
+    }
+    int num_failed = engine->num_failed;
+    pthread_mutex_unlock(&engine->lock);
+
+    return num_failed;
+}
+
+/*
+ *
+ *  vrf_engine tests
+ *
+ */
+static int vrf_engine_test_1(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    const int num_jobs = 30;
+    const int num_seeds = 4;
+
+    BIGNUM *seeds[num_seeds];
+    for (int i=0; i<num_seeds; i++) {
+        seeds[i] = bn_random(get0_order(group), ctx);
+    }
+    key_pair kp[num_jobs];
+    nizk_dl_eq_proof pi[num_jobs];
+    vrf_verify_job jobs[num_jobs];
+    for (int i=0; i<num_jobs; i++) {
+        key_pair_generate(group, &kp[i], ctx);
+        jobs[i].seed = seeds[i % num_seeds];
+        jobs[i].u = point_new(group);
+        jobs[i].pi = &pi[i];
+        jobs[i].pub_key = kp[i].pub;
+        prove_vrf(group, jobs[i].seed, &jobs[i].randval, jobs[i].u, &pi[i], &kp[i], NULL, ctx);
+    }
+
+    // all VRF outputs correct
+    vrf_engine *engine = vrf_engine_new(3, 0);
+    int ret1 = vrf_engine_verify(engine, num_jobs, jobs, 4, NULL);
+    for (int i=0; i<num_jobs; i++) {
+        ret1 |= jobs[i].result;
+    }
+    if (print) {
+        printf("%6s Test 1 - 1: Correct VRF outputs %s accepted by the engine\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // negative test, bad randval and bad proofs, two of them in the same chunk
+    BN_add_word(jobs[5].randval, 1);
+    BN_add_word(pi[6].z, 1);
+    BN_add_word(pi[21].z, 1);
+    int num_failed = vrf_engine_verify(engine, num_jobs, jobs, 4, NULL);
+    int ret2 = num_failed != 3;
+    for (int i=0; i<num_jobs; i++) {
+        ret2 |= jobs[i].result != (i == 5 || i == 6 || i == 21);
+    }
+    if (print) {
+        if (!ret2) {
+            printf("    OK Test 1 - 2: Incorrect VRF outputs found by the engine (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 1 - 2: Incorrect VRF outputs NOT found by the engine (which is an ERROR)\n");
+        }
+    }
+
+    // negative test, one chunk with bad outputs at both ends and in a row
+    BN_add_word(pi[0].z, 1);
+    BN_add_word(jobs[num_jobs - 1].randval, 1);
+    num_failed = vrf_engine_verify(engine, num_jobs, jobs, num_jobs, NULL);
+    int ret3 = num_failed != 5;
+    for (int i=0; i<num_jobs; i++) {
+        ret3 |= jobs[i].result != (i == 0 || i == 5 || i == 6 || i == 21 || i == num_jobs - 1);
+    }
+    if (print) {
+        if (!ret3) {
+            printf("    OK Test 1 - 3: Incorrect VRF outputs in one chunk found by the engine (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 1 - 3: Incorrect VRF outputs in one chunk NOT found by the engine (which is an ERROR)\n");
+        }
+    }
+
+    // cleanup
+    vrf_engine_free(engine);
+    for (int i=0; i<num_jobs; i++) {
+        nizk_dl_eq_proof_free(&pi[i]);
+        point_free(jobs[i].u);
+        bn_free(jobs[i].randval);
+        key_pair_free(&kp[i]);
+    }
+    for (int i=0; i<num_seeds; i++) {
+        bn_free(seeds[i]);
+    }
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0 && ret3 == 0);
+}
+
+typedef int (*test_function)(int);
+
+static test_function test_suite[] = {
+    &vrf_engine_test_1
+};
+
+int vrf_engine_test_suite(int print) {
+    if (print) {
+        printf("VRF engine test suite BEGIN -------------------------\n");
+    }
+    int num_tests = sizeof(test_suite)/sizeof(test_function);
+    int ret = 0;
+    for (int i=0; i<num_tests; i++) {
+        if (test_suite[i](print)) {
+            ret = 1;
+        }
+    }
+    if (print) {
+        printf("VRF engine test suite END ---------------------------\n");
+#ifdef DEBUG
+        print_allocation_status();
+        nizk_dl_eq_print_allocation_status();
+#endif
+        fflush(stdout);
+    }
+    return ret;
+}
@@ -0,0 +1,36 @@
+//
+//  vrf_engine.h
+//  OpenSSL-for-iOS
+//
+//  Multi-threaded VRF verification: a pool of worker threads, each with its own BN_CTX,
+//  verifying chunks of jobs and stealing chunks from each other when running out of work.
+//
+
+#ifndef VRF_ENGINE_H
+#define VRF_ENGINE_H
+#include "praos_vrf.h"
+
+typedef struct {
+    BIGNUM *seed;
+    BIGNUM *randval;
+    EC_POINT *u;
+    nizk_dl_eq_proof *pi;
+    EC_POINT *pub_key;
+    int result; // set by the engine, 0 if the VRF output verifies (as verify_vrf)
+} vrf_verify_job;
+
+typedef struct vrf_engine vrf_engine;
+
+// start num_threads workers, pin_threads != 0 pins worker i to core i (modulo the number of cores)
+vrf_engine *vrf_engine_new(int num_threads, int pin_threads);
+
+// stop the workers
+void vrf_engine_free(vrf_engine *engine);
+
+// verify jobs in chunks of chunk_size (each chunk is batch verified) under params (NULL: defaults), blocks until
+// all jobs are done, returns the number of jobs that failed to verify
+int vrf_engine_verify(vrf_engine *engine, int num_jobs, vrf_verify_job *jobs, int chunk_size, const praos_vrf_params *params);
+
+int vrf_engine_test_suite(int print);
+
+#endif /* VRF_ENGINE_H */
@@ -0,0 +1,495 @@
+//
+//  vrf_metrics.c
+//  OpenSSL-for-iOS
+//
+#include "vrf_metrics.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config_platform.h"
+#include "platform_measurement_utils.h"
+#include "praos_vrf.h"
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+#include <malloc.h>
+#define METRICS_THREAD_LOCAL __declspec(thread)
+#else
+#include <pthread.h>
+#define METRICS_THREAD_LOCAL _Thread_local
+#endif
+
+// nesting depth of instrumented operations per thread, deeper ones are not recorded
+#define METRICS_MAX_DEPTH 8
+
+// log-linear buckets: values below 32 exact, above 16 buckets per power of two
+#define HIST_SUB_BITS 4
+#define HIST_SUB (1 << HIST_SUB_BITS)
+
+atomic_int vrf_metrics_on = 0;
+
+typedef struct {
+    vrf_metrics_op op;
+    int counted; // 0 if the same op is already in progress further up (its work is counted there)
+    platform_time_type start;
+} metrics_frame;
+
+// written by its thread only (relaxed load and store, no read-modify-write), read by snapshots; aligned so that
+// no two threads write to the same cache line
+typedef struct metrics_slot {
+    _Alignas(64) _Atomic uint64_t counts[VRF_METRICS_NUM_OPS + 1][VRF_METRICS_NUM_COUNTERS];
+    _Atomic uint64_t calls[VRF_METRICS_NUM_OPS];
+    _Atomic uint64_t latency_sum[VRF_METRICS_NUM_OPS];
+    _Atomic uint64_t latency_min[VRF_METRICS_NUM_OPS];
+    _Atomic uint64_t latency_max[VRF_METRICS_NUM_OPS];
+    _Atomic uint64_t latency[VRF_METRICS_NUM_OPS][VRF_METRICS_HIST_BUCKETS];
+    // owner thread only
+    int depth;
+    int active[VRF_METRICS_NUM_OPS];
+    metrics_frame stack[METRICS_MAX_DEPTH];
+    // list of all slots, a slot is reused once its thread exits
+    atomic_int in_use;
+    struct metrics_slot *next;
+} metrics_slot;
+
+static _Atomic(metrics_slot *) slot_list = NULL;
+static METRICS_THREAD_LOCAL metrics_slot *thread_slot = NULL;
+
+static const char *counter_names[VRF_METRICS_NUM_COUNTERS] = {
+    "scalar_mul", "base_mul", "msm", "msm_terms", "point_add", "point_encode", "sha256_blocks", "bn_alloc", "point_alloc"
+};
+
+static const char *op_names[VRF_METRICS_NUM_OPS] = {
+    "prove_vrf", "vrf_evaluate", "verify_vrf", "verify_vrf_batch", "nizk_prove", "nizk_verify", "nizk_verify_batch"
+};
+
+const char *vrf_metrics_counter_name(vrf_metrics_counter counter) {
+    assert(counter >= 0 && counter < VRF_METRICS_NUM_COUNTERS && "vrf_metrics_counter_name: usage error, unknown counter");
+    return counter_names[counter];
+}
+
+const char *vrf_metrics_op_name(vrf_metrics_op op) {
+    assert(op >= 0 && op < VRF_METRICS_NUM_OPS && "vrf_metrics_op_name: usage error, unknown operation");
+    return op_names[op];
+}
+
+static inline void slot_add(_Atomic uint64_t *x, uint64_t n) {
+    atomic_store_explicit(x, atomic_load_explicit(x, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+static void slot_reset(metrics_slot *slot) {
+    for (int i=0; i<=VRF_METRICS_NUM_OPS; i++) {
+        for (int c=0; c<VRF_METRICS_NUM_COUNTERS; c++) {
+            atomic_store_explicit(&slot->counts[i][c], 0, memory_order_relaxed);
+        }
+    }
+    for (int op=0; op<VRF_METRICS_NUM_OPS; op++) {
+        atomic_store_explicit(&slot->calls[op], 0, memory_order_relaxed);
+        atomic_store_explicit(&slot->latency_sum[op], 0, memory_order_relaxed);
+        atomic_store_explicit(&slot->latency_min[op], UINT64_MAX, memory_order_relaxed);
+        atomic_store_explicit(&slot->latency_max[op], 0, memory_order_relaxed);
+        for (int b=0; b<VRF_METRICS_HIST_BUCKETS; b++) {
+            atomic_store_explicit(&slot->latency[op][b], 0, memory_order_relaxed);
+        }
+    }
+}
+
+#if PLATFORM_TYPE != PLATFORM_TYPE_WINDOWS
+// hands the slot of an exiting thread back (on Windows slots are not reused)
+static pthread_key_t slot_key;
+static pthread_once_t slot_key_once = PTHREAD_ONCE_INIT;
+
+static void slot_release(void *slot) {
+    atomic_store(&((metrics_slot *)slot)->in_use, 0);
+}
+
+static void slot_key_init(void) {
+    int ret = pthread_key_create(&slot_key, slot_release);
+    assert(ret == 0 && "vrf_metrics: pthread_key_create failed");
+}
+#endif
+
+// the slot of this thread, a released one or a new one (kept for the lifetime of the process)
+static metrics_slot *get_slot(void) {
+    metrics_slot *slot = thread_slot;
+    if (slot) {
+        return slot;
+    }
+    for (metrics_slot *s = atomic_load(&slot_list); s; s = s->next) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&s->in_use, &expected, 1)) {
+            slot = s;
+            break;
+        }
+    }
+    if (!slot) {
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+        slot = _aligned_malloc(sizeof(metrics_slot), 64);
+#else
+        if (posix_memalign((void **)&slot, 64, sizeof(metrics_slot))) {
+            slot = NULL;
+        }
+#endif
+        assert(slot && "vrf_metrics: allocation error");
+        memset(slot, 0, sizeof(metrics_slot));
+        slot_reset(slot);
+        atomic_init(&slot->in_use, 1);
+        metrics_slot *head = atomic_load(&slot_list);
+        do {
+            slot->next = head;
+        } while (!atomic_compare_exchange_weak(&slot_list, &head, slot));
+    }
+    slot->depth = 0;
+    memset(slot->active, 0, sizeof(slot->active));
+#if PLATFORM_TYPE != PLATFORM_TYPE_WINDOWS
+    pthread_once(&slot_key_once, slot_key_init);
+    pthread_setspecific(slot_key, slot);
+#endif
+    thread_slot = slot;
+    return slot;
+}
+
+void vrf_metrics_enable(int enable) {
+    atomic_store(&vrf_metrics_on, enable != 0);
+}
+
+void vrf_metrics_add(vrf_metrics_counter counter, uint64_t n) {
+    metrics_slot *slot = get_slot();
+    slot_add(&slot->counts[VRF_METRICS_NUM_OPS][counter], n);
+    for (int i=0; i<slot->depth; i++) {
+        if (slot->stack[i].counted) {
+            slot_add(&slot->counts[slot->stack[i].op][counter], n);
+        }
+    }
+}
+
+static int hist_bucket(uint64_t v) {
+    if (v < 2 * HIST_SUB) {
+        return (int)v;
+    }
+    int msb = 63;
+    while (!(v >> msb)) {
+        msb--;
+    }
+    int shift = msb - HIST_SUB_BITS;
+    int b = HIST_SUB * (shift + 1) + (int)((v >> shift) - HIST_SUB);
+    return b < VRF_METRICS_HIST_BUCKETS ? b : VRF_METRICS_HIST_BUCKETS - 1;
+}
+
+// largest value in bucket b
+static uint64_t hist_bucket_max(int b) {
+    if (b < 2 * HIST_SUB) {
+        return (uint64_t)b;
+    }
+    int shift = b / HIST_SUB - 1;
+    uint64_t mantissa = HIST_SUB + b % HIST_SUB;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+int vrf_metrics_op_begin(vrf_metrics_op op) {
+    if (!vrf_metrics_enabled()) {
+        return 0;
+    }
+    metrics_slot *slot = get_slot();
+    if (slot->depth == METRICS_MAX_DEPTH) {
+        return 0;
+    }
+    metrics_frame *frame = &slot->stack[slot->depth++];
+    frame->op = op;
+    frame->counted = slot->active[op]++ == 0;
+    frame->start = platform_utils_get_wall_time();
+    return slot->depth;
+}
+
+void vrf_metrics_op_end(int token) {
+    if (!token) {
+        return;
+    }
+    platform_time_type end = platform_utils_get_wall_time();
+    metrics_slot *slot = thread_slot;
+    assert(slot && token == slot->depth && "vrf_metrics_op_end: usage error, begin and end not nested");
+    metrics_frame *frame = &slot->stack[--slot->depth];
+    vrf_metrics_op op = frame->op;
+    slot->active[op]--;
+    double t = platform_utils_get_wall_time_diff(frame->start, end) * 1e9;
+    uint64_t ns = t > 0 ? (uint64_t)t : 0;
+    slot_add(&slot->calls[op], 1);
+    slot_add(&slot->latency_sum[op], ns);
+    slot_add(&slot->latency[op][hist_bucket(ns)], 1);
+    if (ns < atomic_load_explicit(&slot->latency_min[op], memory_order_relaxed)) {
+        atomic_store_explicit(&slot->latency_min[op], ns, memory_order_relaxed);
+    }
+    if (ns > atomic_load_explicit(&slot->latency_max[op], memory_order_relaxed)) {
+        atomic_store_explicit(&slot->latency_max[op], ns, memory_order_relaxed);
+    }
+}
+
+void vrf_metrics_get_snapshot(vrf_metrics_snapshot *snapshot) {
+    memset(snapshot, 0, sizeof(vrf_metrics_snapshot));
+    for (int op=0; op<VRF_METRICS_NUM_OPS; op++) {
+        snapshot->latency_min[op] = UINT64_MAX;
+    }
+    for (metrics_slot *slot = atomic_load(&slot_list); slot; slot = slot->next) {
+        for (int i=0; i<=VRF_METRICS_NUM_OPS; i++) {
+            for (int c=0; c<VRF_METRICS_NUM_COUNTERS; c++) {
+                snapshot->counts[i][c] += atomic_load_explicit(&slot->counts[i][c], memory_order_relaxed);
+            }
+        }
+        for (int op=0; op<VRF_METRICS_NUM_OPS; op++) {
+            snapshot->calls[op] += atomic_load_explicit(&slot->calls[op], memory_order_relaxed);
+            snapshot->latency_sum[op] += atomic_load_explicit(&slot->latency_sum[op], memory_order_relaxed);
+            uint64_t min = atomic_load_explicit(&slot->latency_min[op], memory_order_relaxed);
+            uint64_t max = atomic_load_explicit(&slot->latency_max[op], memory_order_relaxed);
+            snapshot->latency_min[op] = min < snapshot->latency_min[op] ? min : snapshot->latency_min[op];
+            snapshot->latency_max[op] = max > snapshot->latency_max[op] ? max : snapshot->latency_max[op];
+            for (int b=0; b<VRF_METRICS_HIST_BUCKETS; b++) {
+                snapshot->latency[op][b] += atomic_load_explicit(&slot->latency[op][b], memory_order_relaxed);
+            }
+        }
+    }
+    for (int op=0; op<VRF_METRICS_NUM_OPS; op++) {
+        if (snapshot->calls[op] == 0) {
+            snapshot->latency_min[op] = 0;
+        }
+    }
+}
+
+void vrf_metrics_reset(void) {
+    for (metrics_slot *slot = atomic_load(&slot_list); slot; slot = slot->next) {
+        slot_reset(slot);
+    }
+}
+
+uint64_t vrf_metrics_percentile(const vrf_metrics_snapshot *snapshot, vrf_metrics_op op, double pct) {
+    uint64_t num = 0;
+    for (int b=0; b<VRF_METRICS_HIST_BUCKETS; b++) {
+        num += snapshot->latency[op][b];
+    }
+    if (num == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(pct / 100.0 * (double)num + 0.999999);
+    rank = rank < 1 ? 1 : rank > num ? num : rank;
+    uint64_t seen = 0;
+    for (int b=0; b<VRF_METRICS_HIST_BUCKETS; b++) {
+        seen += snapshot->latency[op][b];
+        if (seen >= rank) {
+            uint64_t max = hist_bucket_max(b);
+            return max < snapshot->latency_max[op] ? max : snapshot->latency_max[op];
+        }
+    }
+    return snapshot->latency_max[op];
+}
+
+static void write_json_counters(FILE *out, const uint64_t *counts) {
+    fprintf(out, "{");
+    for (int c=0; c<VRF_METRICS_NUM_COUNTERS; c++) {
+        fprintf(out, "%s\"%s\": %llu", c ? ", " : "", counter_names[c], (unsigned long long)counts[c]);
+    }
+    fprintf(out, "}");
+}
+
+int vrf_metrics_write_json(FILE *out, const vrf_metrics_snapshot *snapshot) {
+    static const double percentiles[] = { 50, 90, 99, 99.9 };
+    static const char *percentile_names[] = { "p50", "p90", "p99", "p999" };
+    fprintf(out, "{\n  \"enabled\": %s,\n  \"total\": ", vrf_metrics_enabled() ? "true" : "false");
+    write_json_counters(out, snapshot->counts[VRF_METRICS_NUM_OPS]);
+    fprintf(out, ",\n  \"operations\": [");
+    for (int op=0; op<VRF_METRICS_NUM_OPS; op++) {
+        uint64_t calls = snapshot->calls[op];
+        fprintf(out, "%s\n    {\"name\": \"%s\", \"calls\": %llu, \"counters\": ", op ? "," : "", op_names[op], (unsigned long long)calls);
+        write_json_counters(out, snapshot->counts[op]);
+        fprintf(out, ", \"latency_ns\": {\"mean\": %llu, \"min\": %llu",
+                (unsigned long long)(calls ? snapshot->latency_sum[op] / calls : 0), (unsigned long long)snapshot->latency_min[op]);
+        for (size_t i=0; i<sizeof(percentiles)/sizeof(double); i++) {
+            fprintf(out, ", \"%s\": %llu", percentile_names[i], (unsigned long long)vrf_metrics_percentile(snapshot, op, percentiles[i]));
+        }
+        fprintf(out, ", \"max\": %llu}}", (unsigned long long)snapshot->latency_max[op]);
+    }
+    fprintf(out, "\n  ]\n}\n");
+    return ferror(out) ? 1 : 0;
+}
+
+/*
+ *
+ * test functions
+ *
+ */
+
+// histogram buckets cover every value once, within 1/16 of it
+static int vrf_metrics_test_1(int print) {
+    int ret1 = 0;
+    uint64_t prev_max = 0;
+    for (int b=0; b<VRF_METRICS_HIST_BUCKETS - 1 && !ret1; b++) {
+        uint64_t max = hist_bucket_max(b);
+        uint64_t min = b ? prev_max + 1 : 0;
+        ret1 = hist_bucket(min) != b || hist_bucket(max) != b || (max - min) * HIST_SUB > min + HIST_SUB;
+        prev_max = max;
+    }
+    ret1 |= hist_bucket(UINT64_MAX) != VRF_METRICS_HIST_BUCKETS - 1;
+
+    // 1..1000 ns once each: the percentiles are within a bucket of the exact ones
+    vrf_metrics_snapshot *snapshot = calloc(1, sizeof(vrf_metrics_snapshot));
+    assert(snapshot && "vrf_metrics_test_1: allocation error");
+    for (uint64_t v=1; v<=1000; v++) {
+        snapshot->latency[0][hist_bucket(v)]++;
+    }
+    snapshot->latency_max[0] = 1000;
+    uint64_t p50 = vrf_metrics_percentile(snapshot, 0, 50);
+    uint64_t p99 = vrf_metrics_percentile(snapshot, 0, 99);
+    uint64_t p100 = vrf_metrics_percentile(snapshot, 0, 100);
+    int ret2 = !(p50 >= 500 && p50 < 500 + 500 / HIST_SUB && p99 >= 990 && p99 < 990 + 990 / HIST_SUB && p100 == 1000);
+    free(snapshot);
+
+    if (print) {
+        printf("%6s Test 1 - 1: Latency histogram buckets %s all values within 1/%d\n", ret1 ? "NOT OK" : "OK", ret1 ? "do NOT cover" : "cover", HIST_SUB);
+        printf("%6s Test 1 - 2: Histogram percentiles %s (p50 %llu, p99 %llu)\n", ret2 ? "NOT OK" : "OK", ret2 ? "NOT correct" : "correct",
+               (unsigned long long)p50, (unsigned long long)p99);
+    }
+    return ret1 || ret2;
+}
+
+// work of a VRF prove and verify attributed to them and their nested proof operations, nothing while off
+static int vrf_metrics_test_2(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    key_pair kp;
+    key_pair_generate(group, &kp, ctx);
+    BIGNUM *seed = bn_random(get0_order(group), ctx);
+    BIGNUM *randval;
+    EC_POINT *u = point_new(group);
+    nizk_dl_eq_proof pi;
+    vrf_metrics_snapshot *snapshot = malloc(2 * sizeof(vrf_metrics_snapshot));
+    assert(snapshot && "vrf_metrics_test_2: allocation error");
+
+    vrf_metrics_reset();
+    vrf_metrics_enable(1);
+    prove_vrf(group, seed, &randval, u, &pi, &kp, NULL, ctx);
+    int verified = verify_vrf(group, seed, randval, u, &pi, kp.pub, NULL, ctx);
+    vrf_metrics_enable(0);
+    vrf_metrics_get_snapshot(&snapshot[0]);
+
+    const uint64_t *prove = snapshot[0].counts[VRF_METRICS_OP_PROVE_VRF];
+    const uint64_t *nizk_prove = snapshot[0].counts[VRF_METRICS_OP_NIZK_PROVE];
+    const uint64_t *total = snapshot[0].counts[VRF_METRICS_NUM_OPS];
+    int ret1 = verified != 0 || snapshot[0].calls[VRF_METRICS_OP_PROVE_VRF] != 1 || snapshot[0].calls[VRF_METRICS_OP_VERIFY_VRF] != 1 ||
+               snapshot[0].calls[VRF_METRICS_OP_NIZK_PROVE] != 1 || snapshot[0].calls[VRF_METRICS_OP_NIZK_VERIFY] != 1;
+    for (int c=0; c<VRF_METRICS_NUM_COUNTERS; c++) {
+        ret1 |= prove[c] < nizk_prove[c] || total[c] < prove[c] + snapshot[0].counts[VRF_METRICS_OP_VERIFY_VRF][c];
+    }
+    ret1 |= prove[VRF_METRICS_SCALAR_MUL] < 2 || nizk_prove[VRF_METRICS_SCALAR_MUL] < 1 || prove[VRF_METRICS_SHA256_BLOCKS] == 0 ||
+            prove[VRF_METRICS_POINT_ENCODE] == 0 || prove[VRF_METRICS_BN_ALLOC] == 0 || prove[VRF_METRICS_POINT_ALLOC] == 0 ||
+            snapshot[0].counts[VRF_METRICS_OP_NIZK_VERIFY][VRF_METRICS_MSM] != 2 ||
+            snapshot[0].latency_min[VRF_METRICS_OP_PROVE_VRF] < snapshot[0].latency_max[VRF_METRICS_OP_NIZK_PROVE];
+
+    // switched off: no change
+    BIGNUM *randval2;
+    nizk_dl_eq_proof pi2;
+    prove_vrf(group, seed, &randval2, u, &pi2, &kp, NULL, ctx);
+    vrf_metrics_get_snapshot(&snapshot[1]);
+    int ret2 = memcmp(&snapshot[0], &snapshot[1], sizeof(vrf_metrics_snapshot)) != 0;
+
+    // JSON snapshot
+    FILE *file = tmpfile();
+    int ret3 = !file || vrf_metrics_write_json(file, &snapshot[0]);
+    if (file) {
+        char buf[4096];
+        rewind(file);
+        size_t len = fread(buf, 1, sizeof(buf) - 1, file);
+        buf[len] = 0;
+        ret3 |= buf[0] != '{' || !strstr(buf, "\"name\": \"prove_vrf\", \"calls\": 1,") || !strstr(buf, "\"p99\": ");
+        fclose(file);
+    }
+    vrf_metrics_reset();
+
+    if (print) {
+        printf("%6s Test 2 - 1: Counters %s to the operations in progress\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT attributed" : "attributed");
+        printf("%6s Test 2 - 2: %s while switched off\n", ret2 ? "NOT OK" : "OK", ret2 ? "Operations STILL recorded" : "Nothing recorded");
+        printf("%6s Test 2 - 3: JSON snapshot %s\n", ret3 ? "NOT OK" : "OK", ret3 ? "NOT written" : "written");
+    }
+
+    // cleanup
+    free(snapshot);
+    nizk_dl_eq_proof_free(&pi2);
+    bn_free(randval2);
+    nizk_dl_eq_proof_free(&pi);
+    bn_free(randval);
+    point_free(u);
+    bn_free(seed);
+    key_pair_free(&kp);
+    BN_CTX_free(ctx);
+    return ret1 || ret2 || ret3;
+}
+
+#if PLATFORM_TYPE != PLATFORM_TYPE_WINDOWS
+#define TEST_NUM_THREADS 4
+#define TEST_NUM_ADDS 100000
+
+static void *vrf_metrics_test_thread(void *arg) {
+    (void)arg;
+    int token = vrf_metrics_op_begin(VRF_METRICS_OP_VERIFY_VRF_BATCH);
+    for (int i=0; i<TEST_NUM_ADDS; i++) {
+        vrf_metrics_add(VRF_METRICS_POINT_ADD, 1);
+    }
+    vrf_metrics_op_end(token);
+    return NULL;
+}
+
+// per-thread slots add up without lost updates
+static int vrf_metrics_test_3(int print) {
+    vrf_metrics_reset();
+    vrf_metrics_enable(1);
+    pthread_t threads[TEST_NUM_THREADS];
+    for (int i=0; i<TEST_NUM_THREADS; i++) {
+        int ret = pthread_create(&threads[i], NULL, vrf_metrics_test_thread, NULL);
+        assert(ret == 0 && "vrf_metrics_test_3: pthread_create failed");
+    }
+    for (int i=0; i<TEST_NUM_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    vrf_metrics_enable(0);
+    vrf_metrics_snapshot *snapshot = malloc(sizeof(vrf_metrics_snapshot));
+    assert(snapshot && "vrf_metrics_test_3: allocation error");
+    vrf_metrics_get_snapshot(snapshot);
+    int ret1 = snapshot->calls[VRF_METRICS_OP_VERIFY_VRF_BATCH] != TEST_NUM_THREADS ||
+               snapshot->counts[VRF_METRICS_OP_VERIFY_VRF_BATCH][VRF_METRICS_POINT_ADD] != (uint64_t)TEST_NUM_THREADS * TEST_NUM_ADDS ||
+               snapshot->counts[VRF_METRICS_NUM_OPS][VRF_METRICS_POINT_ADD] != (uint64_t)TEST_NUM_THREADS * TEST_NUM_ADDS;
+    free(snapshot);
+    vrf_metrics_reset();
+
+    if (print) {
+        printf("%6s Test 3 - 1: Counts of %d threads %s\n", ret1 ? "NOT OK" : "OK", TEST_NUM_THREADS, ret1 ? "do NOT add up" : "add up");
+    }
+    return ret1;
+}
+#endif
+
+typedef int (*test_function)(int);
+
+static test_function test_suite[] = {
+    &vrf_metrics_test_1,
+    &vrf_metrics_test_2,
+#if PLATFORM_TYPE != PLATFORM_TYPE_WINDOWS
+    &vrf_metrics_test_3
+#endif
+};
+
+int vrf_metrics_test_suite(int print) {
+    if (print) {
+        printf("VRF metrics test suite BEGIN ------------------------\n");
+    }
+    int num_tests = sizeof(test_suite)/sizeof(test_function);
+    int ret = 0;
+    for (int i=0; i<num_tests; i++) {
+        if (test_suite[i](print)) {
+            ret = 1;
+        }
+    }
+    if (print) {
+        printf("VRF metrics test suite END --------------------------\n");
+#ifdef DEBUG
+        print_allocation_status();
+        nizk_dl_eq_print_allocation_status();
+#endif
+        fflush(stdout);
+    }
+    return ret;
+}
@@ -0,0 +1,89 @@
+//
+//  vrf_metrics.h
+//  OpenSSL-for-iOS
+//
+//  Operation counters and latency histograms of the crypto core, compiled in and switched on at runtime.
+//  Work (scalar multiplications, encodings, SHA-256 compressions, allocations, ...) is counted for every
+//  instrumented operation in progress on the calling thread, so a prove_vrf includes the nizk_dl_eq_prove it
+//  calls, and for the process total. Each thread writes only its own cache-line aligned slot, snapshots sum the
+//  slots. Latencies go to log-linear histograms (HDR style, 16 sub-buckets per power of two, within 6.25%).
+//
+
+#ifndef VRF_METRICS_H
+#define VRF_METRICS_H
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef enum {
+    VRF_METRICS_SCALAR_MUL,     // variable-base scalar multiplications
+    VRF_METRICS_BASE_MUL,       // generator multiplications (fixed-base tables)
+    VRF_METRICS_MSM,            // multi-scalar multiplications (point_weighted_sum, double-scalar checks)
+    VRF_METRICS_MSM_TERMS,      // terms of those
+    VRF_METRICS_POINT_ADD,      // point additions and subtractions
+    VRF_METRICS_POINT_ENCODE,   // point encodings (hashing, serialization)
+    VRF_METRICS_SHA256_BLOCKS,  // SHA-256 compressions
+    VRF_METRICS_BN_ALLOC,       // bn_new
+    VRF_METRICS_POINT_ALLOC,    // point_new
+    VRF_METRICS_NUM_COUNTERS
+} vrf_metrics_counter;
+
+typedef enum {
+    VRF_METRICS_OP_PROVE_VRF,
+    VRF_METRICS_OP_VRF_EVALUATE,
+    VRF_METRICS_OP_VERIFY_VRF,
+    VRF_METRICS_OP_VERIFY_VRF_BATCH,
+    VRF_METRICS_OP_NIZK_PROVE,
+    VRF_METRICS_OP_NIZK_VERIFY,
+    VRF_METRICS_OP_NIZK_VERIFY_BATCH,
+    VRF_METRICS_NUM_OPS
+} vrf_metrics_op;
+
+// latencies from 0 to 2^48 ns (larger ones go to the last bucket)
+#define VRF_METRICS_HIST_BUCKETS 720
+
+extern atomic_int vrf_metrics_on;
+
+static inline int vrf_metrics_enabled(void) {
+    return atomic_load_explicit(&vrf_metrics_on, memory_order_relaxed);
+}
+
+// switch recording on or off (off by default), operations in progress when switching are not recorded
+void vrf_metrics_enable(int enable);
+
+// add n to counter for the operations in progress on this thread and the total (use VRF_METRICS_COUNT)
+void vrf_metrics_add(vrf_metrics_counter counter, uint64_t n);
+
+#define VRF_METRICS_COUNT(counter, n) do { if (vrf_metrics_enabled()) { vrf_metrics_add(counter, n); } } while (0)
+
+// bracket an operation, begin returns the token to pass to end (0 if not recorded, e.g. metrics off)
+int vrf_metrics_op_begin(vrf_metrics_op op);
+void vrf_metrics_op_end(int token);
+
+typedef struct {
+    uint64_t counts[VRF_METRICS_NUM_OPS + 1][VRF_METRICS_NUM_COUNTERS]; // row VRF_METRICS_NUM_OPS: total
+    uint64_t calls[VRF_METRICS_NUM_OPS];
+    uint64_t latency_sum[VRF_METRICS_NUM_OPS]; // ns
+    uint64_t latency_min[VRF_METRICS_NUM_OPS];
+    uint64_t latency_max[VRF_METRICS_NUM_OPS];
+    uint64_t latency[VRF_METRICS_NUM_OPS][VRF_METRICS_HIST_BUCKETS];
+} vrf_metrics_snapshot;
+
+// sum of all thread slots (updates racing with the snapshot may or may not be included)
+void vrf_metrics_get_snapshot(vrf_metrics_snapshot *snapshot);
+
+// zero all slots, updates racing with the reset may be lost
+void vrf_metrics_reset(void);
+
+// latency in ns below which pct percent of the calls of op fall (upper end of the histogram bucket), 0 without calls
+uint64_t vrf_metrics_percentile(const vrf_metrics_snapshot *snapshot, vrf_metrics_op op, double pct);
+
+const char *vrf_metrics_counter_name(vrf_metrics_counter counter);
+const char *vrf_metrics_op_name(vrf_metrics_op op);
+
+// write snapshot as JSON object to out, returns 0 on success
+int vrf_metrics_write_json(FILE *out, const vrf_metrics_snapshot *snapshot);
+
+int vrf_metrics_test_suite(int print);
+
+#endif /* VRF_METRICS_H */
@@ -0,0 +1,619 @@
+//
+//  vrf_stream.c
+//  OpenSSL-for-iOS
+//
+#include "vrf_stream.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "config_platform.h"
+#include "openssl_hashing_tools.h"
+#include "sha256_mb.h"
+#if PLATFORM_TYPE == PLATFORM_TYPE_WINDOWS
+#error "vrf_stream: unsupported platform type (not implemented for this platform)"
+#endif
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * File format (all integers little endian)
+ *   magic "P256VRF1" | uint32 num_records | uint32 record size | num_records records
+ *
+ * Chunks move through VRF_STREAM_NUM_SLOTS slots, the decode and hash stages run on their own threads
+ * and the DL EQ stage on the calling thread, so at most VRF_STREAM_NUM_SLOTS chunks are decoded at any
+ * time and mapped pages are released once their records are done.
+ */
+#define VRF_STREAM_MAGIC "P256VRF1"
+#define VRF_STREAM_MAGIC_SIZE 8
+#define VRF_STREAM_HEADER_SIZE 16
+#define VRF_STREAM_NUM_SLOTS 4
+
+// slot states, each stage moves a slot to the next state
+enum {
+    VRF_STREAM_SLOT_FREE,
+    VRF_STREAM_SLOT_DECODED,
+    VRF_STREAM_SLOT_HASHED
+};
+
+typedef struct {
+    BIGNUM *seed;
+    EC_POINT *pub_key;
+    EC_POINT *u;
+    EC_POINT *hash_seed_point;
+    nizk_dl_eq_proof pi;
+    int failed;
+    int cached; // found in the verify cache, the other stages skip the record
+    int cacheable;
+    unsigned char key[VERIFY_CACHE_KEY_BYTES];
+} vrf_stream_entry;
+
+typedef struct {
+    int state;
+    long first; // index of the first record of the chunk
+    int num;
+    vrf_stream_entry *entries;
+} vrf_stream_slot;
+
+typedef struct {
+    const EC_GROUP *group;
+    praos_vrf_suite suite;
+    verify_cache *verify_cache; // of params, NULL for none
+    const unsigned char *records;
+    long num_records;
+    long num_chunks;
+    int chunk_records;
+    vrf_stream_slot slots[VRF_STREAM_NUM_SLOTS];
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} vrf_stream;
+
+static void put_uint32_le(unsigned char *buf, uint32_t v) {
+    for (int i=0; i<4; i++) {
+        buf[i] = (unsigned char)(v >> (8 * i));
+    }
+}
+
+static uint32_t get_uint32_le(const unsigned char *buf) {
+    uint32_t v = 0;
+    for (int i=0; i<4; i++) {
+        v |= (uint32_t)buf[i] << (8 * i);
+    }
+    return v;
+}
+
+int vrf_stream_record_to_bytes(const EC_GROUP *group, const BIGNUM *seed, const EC_POINT *pub_key, const EC_POINT *u, const nizk_dl_eq_proof *pi, const BIGNUM *randval, praos_vrf_suite suite, unsigned char *buf, BN_CTX *ctx) {
+    if (bn_to_bytes(seed, buf) || point_to_bytes(group, pub_key, buf + P256_SCALAR_BYTES, ctx)) {
+        return 1;
+    }
+    return vrf_output_to_bytes(group, u, pi, randval, suite, buf + P256_SCALAR_BYTES + P256_POINT_BYTES, ctx);
+}
+
+int vrf_stream_save(const char *path, long num_records, const unsigned char *records) {
+    if (num_records < 0 || num_records > UINT32_MAX) {
+        return 1;
+    }
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return 1;
+    }
+    unsigned char header[VRF_STREAM_HEADER_SIZE];
+    memcpy(header, VRF_STREAM_MAGIC, VRF_STREAM_MAGIC_SIZE);
+    put_uint32_le(header + 8, (uint32_t)num_records);
+    put_uint32_le(header + 12, VRF_STREAM_RECORD_BYTES);
+    size_t records_len = (size_t)num_records * VRF_STREAM_RECORD_BYTES;
+    int ret = fwrite(header, 1, sizeof(header), f) != sizeof(header);
+    if (!ret && records_len > 0) {
+        ret = fwrite(records, 1, records_len, f) != records_len;
+    }
+    ret |= fclose(f) != 0;
+    return ret;
+}
+
+// wait until slot reaches state, returns the slot
+static vrf_stream_slot *vrf_stream_wait(vrf_stream *stream, long chunk, int state) {
+    vrf_stream_slot *slot = &stream->slots[chunk % VRF_STREAM_NUM_SLOTS];
+    pthread_mutex_lock(&stream->lock);
+    while (slot->state != state) {
+        pthread_cond_wait(&stream->cond, &stream->lock);
+    }
+    pthread_mutex_unlock(&stream->lock);
+    return slot;
+}
+
+static void vrf_stream_advance(vrf_stream *stream, vrf_stream_slot *slot, int state) {
+    pthread_mutex_lock(&stream->lock);
+    slot->state = state;
+    pthread_cond_broadcast(&stream->cond);
+    pthread_mutex_unlock(&stream->lock);
+}
+
+// stage 1: decode points and scalars, non-canonical encodings and outputs of another suite fail the record;
+// records in the verify cache (if params has one) are not decoded
+static void *vrf_stream_decode_stage(void *arg) {
+    vrf_stream *stream = arg;
+    const EC_GROUP *group = stream->group;
+    const BIGNUM *order = get0_order(group);
+    verify_cache *cache = stream->verify_cache;
+    BN_CTX *ctx = BN_CTX_new();
+    for (long chunk=0; chunk<stream->num_chunks; chunk++) {
+        vrf_stream_slot *slot = vrf_stream_wait(stream, chunk, VRF_STREAM_SLOT_FREE);
+        slot->first = chunk * stream->chunk_records;
+        slot->num = stream->num_records - slot->first < stream->chunk_records ? (int)(stream->num_records - slot->first) : stream->chunk_records;
+        for (int i=0; i<slot->num; i++) {
+            vrf_stream_entry *e = &slot->entries[i];
+            const unsigned char *rec = stream->records + (size_t)(slot->first + i) * VRF_STREAM_RECORD_BYTES;
+            const unsigned char *output = rec + P256_SCALAR_BYTES + P256_POINT_BYTES;
+            const unsigned char *proof = output + P256_POINT_BYTES;
+            BN_bin2bn(rec, P256_SCALAR_BYTES, e->seed);
+            if (output[VRF_OUTPUT_SUITE_OFFSET] != stream->suite) {
+                e->failed = 1;
+                e->cached = 0;
+                continue;
+            }
+            e->cacheable = cache && verify_cache_key(e->seed, output, rec + P256_SCALAR_BYTES, e->key) == 0;
+            e->cached = e->cacheable && verify_cache_lookup(cache, e->key);
+            if (e->cached) {
+                e->failed = 0;
+                continue;
+            }
+            BN_bin2bn(proof + 2 * P256_POINT_BYTES, P256_SCALAR_BYTES, e->pi.z);
+            e->failed = point_from_bytes(group, e->pub_key, rec + P256_SCALAR_BYTES, ctx) ||
+                        point_from_bytes(group, e->u, output, ctx) ||
+                        point_from_bytes(group, e->pi.Ra, proof, ctx) ||
+                        point_from_bytes(group, e->pi.Rb, proof + P256_POINT_BYTES, ctx) ||
+                        BN_cmp(e->pi.z, order) >= 0;
+        }
+        vrf_stream_advance(stream, slot, VRF_STREAM_SLOT_DECODED);
+    }
+    BN_CTX_free(ctx);
+    return NULL;
+}
+
+// stage 2: randval = H(seed_point, u) and H'(seed) as point, both once per run of equal seeds (the randvals of a
+// chunk hashed several at a time)
+static void *vrf_stream_hash_stage(void *arg) {
+    vrf_stream *stream = arg;
+    const EC_GROUP *group = stream->group;
+    BN_CTX *ctx = BN_CTX_new();
+    BIGNUM *seed = bn_new();
+    int have_seed = 0;
+    EC_POINT *hash_seed_point = point_new(group);
+    unsigned char seed_point_bytes[P256_POINT_BYTES];
+    size_t seed_point_len = 0;
+    int chunk_records = stream->chunk_records;
+    unsigned char *transcripts = malloc(chunk_records * 2 * P256_POINT_BYTES);
+    unsigned char *md = malloc(chunk_records * SHA256_DIGEST_LENGTH);
+    const unsigned char **msg = malloc(chunk_records * sizeof(unsigned char*));
+    size_t *len = malloc(chunk_records * sizeof(size_t));
+    int *index = malloc(chunk_records * sizeof(int));
+    assert(transcripts && md && msg && len && index && "vrf_stream_hash_stage: allocation error");
+    for (long chunk=0; chunk<stream->num_chunks; chunk++) {
+        vrf_stream_slot *slot = vrf_stream_wait(stream, chunk, VRF_STREAM_SLOT_DECODED);
+        int num = 0;
+        for (int i=0; i<slot->num; i++) {
+            vrf_stream_entry *e = &slot->entries[i];
+            if (e->failed || e->cached) {
+                continue;
+            }
+            if (!have_seed || BN_cmp(seed, e->seed) != 0) {
+                BN_copy(seed, e->seed);
+                have_seed = 1;
+                EC_POINT *seed_point = bn2point(group, seed, ctx);
+                if (point_to_bytes(group, seed_point, seed_point_bytes, ctx)) {
+                    // seed = 0 mod n, 1 byte for the point at infinity as in openssl_hash_update_point
+                    seed_point_bytes[0] = 0;
+                    seed_point_len = 1;
+                } else {
+                    seed_point_len = P256_POINT_BYTES;
+                }
+                point_free(seed_point);
+                vrf_hash_seed_r(group, hash_seed_point, seed, stream->suite, ctx);
+            }
+            int ret = EC_POINT_copy(e->hash_seed_point, hash_seed_point);
+            assert(ret == 1 && "vrf_stream_hash_stage: EC_POINT_copy failed");
+
+            const unsigned char *output = stream->records + (size_t)(slot->first + i) * VRF_STREAM_RECORD_BYTES + P256_SCALAR_BYTES + P256_POINT_BYTES;
+            unsigned char *t = transcripts + num * 2 * P256_POINT_BYTES;
+            memcpy(t, seed_point_bytes, seed_point_len);
+            memcpy(t + seed_point_len, output, P256_POINT_BYTES); // u as received
+            msg[num] = t;
+            len[num] = seed_point_len + P256_POINT_BYTES;
+            index[num++] = i;
+        }
+        sha256_mb(num, msg, len, md);
+        for (int j=0; j<num; j++) {
+            const unsigned char *output = stream->records + (size_t)(slot->first + index[j]) * VRF_STREAM_RECORD_BYTES + P256_SCALAR_BYTES + P256_POINT_BYTES;
+            slot->entries[index[j]].failed = memcmp(md + j * SHA256_DIGEST_LENGTH, output + P256_POINT_BYTES + NIZK_DL_EQ_PROOF_BYTES, SHA256_DIGEST_LENGTH) != 0;
+        }
+        vrf_stream_advance(stream, slot, VRF_STREAM_SLOT_HASHED);
+    }
+    free(index);
+    free(len);
+    free(msg);
+    free(md);
+    free(transcripts);
+    bn_free(seed);
+    point_free(hash_seed_point);
+    BN_CTX_free(ctx);
+    return NULL;
+}
+
+// stage 3: batch DL EQ check of the records that passed so far, resuming after each bad record
+static void vrf_stream_dl_eq_stage(vrf_stream *stream, const vrf_stream_slot *slot, const EC_POINT **a, const EC_POINT **A, const EC_POINT **b, const EC_POINT **B, nizk_dl_eq_proof *pi, int *index, BN_CTX *ctx) {
+    int num = 0;
+    for (int i=0; i<slot->num; i++) {
+        const vrf_stream_entry *e = &slot->entries[i];
+        if (e->failed || e->cached) {
+            continue;
+        }
+        a[num] = e->hash_seed_point;
+        A[num] = e->u;
+        b[num] = get0_generator(stream->group);
+        B[num] = e->pub_key;
+        pi[num] = e->pi;
+        index[num++] = i;
+    }
+    int done = 0;
+    while (done < num) {
+        int bad_index = 0;
+        if (!nizk_dl_eq_verify_batch(stream->group, num - done, a + done, A + done, b + done, B + done, pi + done, &bad_index, ctx)) {
+            break;
+        }
+        done += bad_index;
+        slot->entries[index[done++]].failed = 1;
+    }
+}
+
+long vrf_stream_verify_file(const char *path, int chunk_records, const praos_vrf_params *params, const vrf_stream_callbacks *cb) {
+    assert(chunk_records > 0 && "vrf_stream_verify_file: usage error, unexpected chunk size");
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < VRF_STREAM_HEADER_SIZE) {
+        close(fd);
+        return -1;
+    }
+    size_t len = (size_t)st.st_size;
+    void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    const unsigned char *data = map;
+    uint32_t num_records = get_uint32_le(data + 8);
+    if (memcmp(data, VRF_STREAM_MAGIC, VRF_STREAM_MAGIC_SIZE) != 0 ||
+        get_uint32_le(data + 12) != VRF_STREAM_RECORD_BYTES ||
+        len != VRF_STREAM_HEADER_SIZE + (size_t)num_records * VRF_STREAM_RECORD_BYTES) {
+        munmap(map, len);
+        return -1;
+    }
+    madvise(map, len, MADV_SEQUENTIAL);
+
+    const EC_GROUP *group = get0_group();
+    vrf_stream stream = {
+        .group = group,
+        .suite = params ? params->suite : PRAOS_VRF_SUITE_LEGACY,
+        .verify_cache = params ? params->verify_cache : NULL,
+        .records = data + VRF_STREAM_HEADER_SIZE,
+        .num_records = num_records,
+        .num_chunks = ((long)num_records + chunk_records - 1) / chunk_records,
+        .chunk_records = chunk_records
+    };
+    pthread_mutex_init(&stream.lock, NULL);
+    pthread_cond_init(&stream.cond, NULL);
+    for (int s=0; s<VRF_STREAM_NUM_SLOTS; s++) {
+        vrf_stream_slot *slot = &stream.slots[s];
+        slot->state = VRF_STREAM_SLOT_FREE;
+        slot->entries = malloc(chunk_records * sizeof(vrf_stream_entry));
+        assert(slot->entries && "vrf_stream_verify_file: allocation error (entries)");
+        for (int i=0; i<chunk_records; i++) {
+            vrf_stream_entry *e = &slot->entries[i];
+            e->seed = bn_new();
+            e->pub_key = point_new(group);
+            e->u = point_new(group);
+            e->hash_seed_point = point_new(group);
+            e->pi.Ra = point_new(group);
+            e->pi.Rb = point_new(group);
+            e->pi.z = bn_new();
+        }
+    }
+    const EC_POINT **a = malloc(chunk_records * sizeof(EC_POINT*));
+    const EC_POINT **A = malloc(chunk_records * sizeof(EC_POINT*));
+    const EC_POINT **b = malloc(chunk_records * sizeof(EC_POINT*));
+    const EC_POINT **B = malloc(chunk_records * sizeof(EC_POINT*));
+    nizk_dl_eq_proof *pi = malloc(chunk_records * sizeof(nizk_dl_eq_proof));
+    int *index = malloc(chunk_records * sizeof(int));
+    assert(a && A && b && B && pi && index && "vrf_stream_verify_file: allocation error");
+    BN_CTX *ctx = BN_CTX_new();
+
+    pthread_t decode_thread, hash_thread;
+    int ret = pthread_create(&decode_thread, NULL, vrf_stream_decode_stage, &stream);
+    assert(ret == 0 && "vrf_stream_verify_file: pthread_create failed");
+    ret = pthread_create(&hash_thread, NULL, vrf_stream_hash_stage, &stream);
+    assert(ret == 0 && "vrf_stream_verify_file: pthread_create failed");
+
+    long num_failed = 0;
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t released = 0;
+    for (long chunk=0; chunk<stream.num_chunks; chunk++) {
+        vrf_stream_slot *slot = vrf_stream_wait(&stream, chunk, VRF_STREAM_SLOT_HASHED);
+        vrf_stream_dl_eq_stage(&stream, slot, a, A, b, B, pi, index, ctx);
+        for (int i=0; i<slot->num; i++) {
+            const vrf_stream_entry *e = &slot->entries[i];
+            if (e->failed) {
+                num_failed++;
+                if (cb && cb->failure) {
+                    cb->failure(cb->arg, slot->first + i);
+                }
+            } else if (e->cacheable && !e->cached) {
+                verify_cache_insert(stream.verify_cache, e->key);
+            }
+        }
+        long num_done = slot->first + slot->num;
+        vrf_stream_advance(&stream, slot, VRF_STREAM_SLOT_FREE);
+
+        // drop the pages of finished records from the resident set
+        size_t done_end = (VRF_STREAM_HEADER_SIZE + (size_t)num_done * VRF_STREAM_RECORD_BYTES) / page_size * page_size;
+        if (done_end > released) {
+            madvise((unsigned char*)map + released, done_end - released, MADV_DONTNEED);
+            released = done_end;
+        }
+        if (cb && cb->progress) {
+            cb->progress(cb->arg, num_done, stream.num_records);
+        }
+    }
+    pthread_join(decode_thread, NULL);
+    pthread_join(hash_thread, NULL);
+
+    // cleanup
+    BN_CTX_free(ctx);
+    free(a);
+    free(A);
+    free(b);
+    free(B);
+    free(pi);
+    free(index);
+    for (int s=0; s<VRF_STREAM_NUM_SLOTS; s++) {
+        for (int i=0; i<chunk_records; i++) {
+            vrf_stream_entry *e = &stream.slots[s].entries[i];
+            bn_free(e->seed);
+            point_free(e->pub_key);
+            point_free(e->u);
+            point_free(e->hash_seed_point);
+            point_free(e->pi.Ra);
+            point_free(e->pi.Rb);
+            bn_free(e->pi.z);
+        }
+        free(stream.slots[s].entries);
+    }
+    pthread_cond_destroy(&stream.cond);
+    pthread_mutex_destroy(&stream.lock);
+    munmap(map, len);
+
+    return num_failed;
+}
+
+/*
+ *
+ *  vrf_stream tests
+ *
+ */
+typedef struct {
+    long failed[8];
+    int num_failed;
+    long num_done;
+} vrf_stream_test_report;
+
+static void vrf_stream_test_progress(void *arg, long num_done, long num_records) {
+    ((vrf_stream_test_report*)arg)->num_done = num_done;
+}
+
+static void vrf_stream_test_failure(void *arg, long record_index) {
+    vrf_stream_test_report *report = arg;
+    if (report->num_failed < 8) {
+        report->failed[report->num_failed] = record_index;
+    }
+    report->num_failed++;
+}
+
+static int vrf_stream_test_1(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    const int num_records = 22;
+    unsigned char *records = malloc(num_records * VRF_STREAM_RECORD_BYTES);
+    assert(records && "vrf_stream_test_1: allocation error");
+
+    // a few consecutive records per seed, as in a chain
+    BIGNUM *seed = NULL;
+    int ret1 = 0;
+    for (int i=0; i<num_records; i++) {
+        if (i % 5 == 0) {
+            if (seed) {
+                bn_free(seed);
+            }
+            seed = bn_random(get0_order(group), ctx);
+        }
+        key_pair kp;
+        key_pair_generate(group, &kp, ctx);
+        BIGNUM *randval;
+        EC_POINT *u = point_new(group);
+        nizk_dl_eq_proof pi;
+        prove_vrf(group, seed, &randval, u, &pi, &kp, NULL, ctx);
+        ret1 |= vrf_stream_record_to_bytes(group, seed, kp.pub, u, &pi, randval, PRAOS_VRF_SUITE_LEGACY, records + i * VRF_STREAM_RECORD_BYTES, ctx);
+        nizk_dl_eq_proof_free(&pi);
+        point_free(u);
+        bn_free(randval);
+        key_pair_free(&kp);
+    }
+    bn_free(seed);
+
+    const char *tmpdir = getenv("TMPDIR");
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/vrf_stream_test.bin", tmpdir ? tmpdir : "/tmp");
+
+    // all records correct
+    vrf_stream_test_report report = { .num_failed = 0 };
+    vrf_stream_callbacks cb = { vrf_stream_test_progress, vrf_stream_test_failure, &report };
+    ret1 |= vrf_stream_save(path, num_records, records);
+    ret1 |= vrf_stream_verify_file(path, 4, NULL, &cb) != 0 || report.num_failed != 0 || report.num_done != num_records;
+    if (print) {
+        printf("%6s Test 1 - 1: Correct VRF proof file %s accepted\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // negative test, bad randval, bad z, wrong pub_key and bad Rb, two of them in the same chunk
+    const long bad[] = { 3, 9, 10, 21 };
+    const int offsets[] = { VRF_STREAM_RECORD_BYTES - 2, VRF_STREAM_RECORD_BYTES - SHA256_DIGEST_LENGTH - 2, P256_SCALAR_BYTES, VRF_STREAM_RECORD_BYTES - SHA256_DIGEST_LENGTH - P256_SCALAR_BYTES - 3 };
+    for (int i=0; i<4; i++) {
+        records[bad[i] * VRF_STREAM_RECORD_BYTES + offsets[i]] ^= 0x01;
+    }
+    report.num_failed = 0;
+    int ret2 = vrf_stream_save(path, num_records, records);
+    ret2 |= vrf_stream_verify_file(path, 4, NULL, &cb) != 4 || report.num_failed != 4 || report.num_done != num_records;
+    for (int i=0; !ret2 && i<4; i++) {
+        ret2 |= report.failed[i] != bad[i];
+    }
+    if (print) {
+        if (!ret2) {
+            printf("    OK Test 1 - 2: Incorrect records in VRF proof file found (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 1 - 2: Incorrect records in VRF proof file NOT found (which is an ERROR)\n");
+        }
+    }
+
+    // with a verify cache (large enough for no shard to overflow) the second pass answers the correct records from
+    // it and still finds the bad ones
+    verify_cache *cache = verify_cache_new(1024, VERIFY_CACHE_LRU);
+    praos_vrf_params cached = { PRAOS_VRF_SUITE_LEGACY, NULL, cache };
+    int ret3 = 0;
+    for (int pass=0; pass<2; pass++) {
+        report.num_failed = 0;
+        ret3 |= vrf_stream_verify_file(path, 4, &cached, &cb) != 4 || report.num_failed != 4 || report.num_done != num_records;
+    }
+    verify_cache_stats stats;
+    verify_cache_get_stats(cache, &stats);
+    ret3 |= stats.hits != num_records - 4 || stats.insertions != num_records - 4;
+    verify_cache_free(cache);
+    if (print) {
+        printf("%6s Test 1 - 3: Repeated records %s from the verify cache\n", ret3 ? "NOT OK" : "OK", ret3 ? "NOT answered correctly" : "answered");
+    }
+
+    // negative test, the legacy outputs do not verify under another suite
+    praos_vrf_params sswu = { PRAOS_VRF_SUITE_P256_SSWU, NULL, NULL };
+    report.num_failed = 0;
+    int ret4 = vrf_stream_verify_file(path, 4, &sswu, &cb) != num_records || report.num_failed != num_records;
+    if (print) {
+        if (!ret4) {
+            printf("    OK Test 1 - 4: Records of another suite rejected (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 1 - 4: Records of another suite NOT rejected (which is an ERROR)\n");
+        }
+    }
+
+    // cleanup
+    remove(path);
+    free(records);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0 && ret3 == 0 && ret4 == 0);
+}
+
+static int vrf_stream_test_2(int print) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    const int num_records = 4;
+    unsigned char *records = malloc(num_records * VRF_STREAM_RECORD_BYTES);
+    assert(records && "vrf_stream_test_2: allocation error");
+
+    // seeds 0 and n, both with the point at infinity as seed point, two records each
+    BIGNUM *seeds[2] = { bn_new(), BN_dup(get0_order(group)) };
+    BN_zero(seeds[0]);
+    int ret1 = 0;
+    for (int i=0; i<num_records; i++) {
+        BIGNUM *seed = seeds[i / 2];
+        key_pair kp;
+        key_pair_generate(group, &kp, ctx);
+        BIGNUM *randval;
+        EC_POINT *u = point_new(group);
+        nizk_dl_eq_proof pi;
+        prove_vrf(group, seed, &randval, u, &pi, &kp, NULL, ctx);
+        ret1 |= verify_vrf(group, seed, randval, u, &pi, kp.pub, NULL, ctx);
+        ret1 |= vrf_stream_record_to_bytes(group, seed, kp.pub, u, &pi, randval, PRAOS_VRF_SUITE_LEGACY, records + i * VRF_STREAM_RECORD_BYTES, ctx);
+        nizk_dl_eq_proof_free(&pi);
+        point_free(u);
+        bn_free(randval);
+        key_pair_free(&kp);
+    }
+    bn_free(seeds[0]);
+    BN_free(seeds[1]);
+
+    const char *tmpdir = getenv("TMPDIR");
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/vrf_stream_test.bin", tmpdir ? tmpdir : "/tmp");
+
+    // the stream verifier agrees with verify_vrf
+    vrf_stream_test_report report = { .num_failed = 0 };
+    vrf_stream_callbacks cb = { vrf_stream_test_progress, vrf_stream_test_failure, &report };
+    ret1 |= vrf_stream_save(path, num_records, records);
+    ret1 |= vrf_stream_verify_file(path, 3, NULL, &cb) != 0 || report.num_failed != 0 || report.num_done != num_records;
+    if (print) {
+        printf("%6s Test 2 - 1: VRF proof file with seeds 0 and n %s accepted\n", ret1 ? "NOT OK" : "OK", ret1 ? "NOT" : "indeed");
+    }
+
+    // negative test, bad randval of a seed 0 record
+    records[VRF_STREAM_RECORD_BYTES - 2] ^= 0x01;
+    report.num_failed = 0;
+    int ret2 = vrf_stream_save(path, num_records, records);
+    ret2 |= vrf_stream_verify_file(path, 3, NULL, &cb) != 1 || report.num_failed != 1 || report.failed[0] != 0;
+    if (print) {
+        if (!ret2) {
+            printf("    OK Test 2 - 2: Incorrect record with seed 0 found (which is CORRECT)\n");
+        } else {
+            printf("NOT OK Test 2 - 2: Incorrect record with seed 0 NOT found (which is an ERROR)\n");
+        }
+    }
+
+    // cleanup
+    remove(path);
+    free(records);
+    BN_CTX_free(ctx);
+
+    // return test results
+    return !(ret1 == 0 && ret2 == 0);
+}
+
+typedef int (*test_function)(int);
+
+static test_function test_suite[] = {
+    &vrf_stream_test_1,
+    &vrf_stream_test_2
+};
+
+int vrf_stream_test_suite(int print) {
+    if (print) {
+        printf("VRF stream test suite BEGIN -------------------------\n");
+    }
+    int num_tests = sizeof(test_suite)/sizeof(test_function);
+    int ret = 0;
+    for (int i=0; i<num_tests; i++) {
+        if (test_suite[i](print)) {
+            ret = 1;
+        }
+    }
+    if (print) {
+        printf("VRF stream test suite END ---------------------------\n");
+#ifdef DEBUG
+        print_allocation_status();
+        nizk_dl_eq_print_allocation_status();
+#endif
+        fflush(stdout);
+    }
+    return ret;
+}
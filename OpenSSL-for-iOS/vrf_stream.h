@@ -0,0 +1,35 @@
+//
+//  vrf_stream.h
+//  OpenSSL-for-iOS
+//
+//  Streaming verification of files of stored VRF outputs (chain replay, audits). The file is memory
+//  mapped and verified chunk by chunk, decoding, hash checks and DL EQ checks run as pipeline stages.
+//
+
+#ifndef VRF_STREAM_H
+#define VRF_STREAM_H
+#include "praos_vrf.h"
+
+// record: seed (32 bytes, big endian) || pub_key (compressed) || VRF output (see vrf_output_to_bytes)
+#define VRF_STREAM_RECORD_BYTES (P256_SCALAR_BYTES + P256_POINT_BYTES + VRF_OUTPUT_BYTES)
+
+// write one record of an output made under suite to buf (VRF_STREAM_RECORD_BYTES), returns 0 on success
+int vrf_stream_record_to_bytes(const EC_GROUP *group, const BIGNUM *seed, const EC_POINT *pub_key, const EC_POINT *u, const nizk_dl_eq_proof *pi, const BIGNUM *randval, praos_vrf_suite suite, unsigned char *buf, BN_CTX *ctx);
+
+// write num_records consecutive records to a proof file, returns 0 on success
+int vrf_stream_save(const char *path, long num_records, const unsigned char *records);
+
+typedef struct {
+    void (*progress)(void *arg, long num_done, long num_records); // after every chunk, may be NULL
+    void (*failure)(void *arg, long record_index); // for every failing record in file order, may be NULL
+    void *arg;
+} vrf_stream_callbacks;
+
+// verify all records of a proof file in chunks of chunk_records records under the suite of params (NULL: legacy,
+// records of another suite fail), cb may be NULL, returns the number of failing records or -1 if the file cannot
+// be read
+long vrf_stream_verify_file(const char *path, int chunk_records, const praos_vrf_params *params, const vrf_stream_callbacks *cb);
+
+int vrf_stream_test_suite(int print);
+
+#endif /* VRF_STREAM_H */
@@ -0,0 +1,789 @@
+//
+//  vrf_bench.c
+//  OpenSSL-for-iOS tools
+//
+//  Benchmark of the single primitives: warmup, iteration count calibrated per benchmark so that a sample
+//  takes at least the sample time, then min / median / p99 / mean per operation over all samples, plus time stamp
+//  counter cycles and (-p) hardware event counts per operation and the peak RSS.
+//
+//  Benchmarks (-l lists their names): ECDSA; Schnorr signatures (schnorr.h) with single and batch verification;
+//  VRF prove/verify, evaluation without proof and verify cache hits; NIZK DL EQ; hashing, including the rest of a
+//  Fiat-Shamir transcript (transcript.h) after a precomputed key prefix; point multiplication, weighted sums and
+//  point hashing from BIGNUM/EC_POINT arrays and from scalar_vec/point_vec (P256.h); one slot of a leader schedule
+//  (leader_schedule.h); the SCRAPE low-degree test (scrape_ldt.h) at 64, 512 and 4096 parties; Lagrange
+//  coefficients and the combination of 100 shares in the exponent (threshold.h).
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/obj_mac.h>
+#include "leader_schedule.h"
+#include "platform_measurement_utils.h"
+#include "praos_vrf.h"
+#include "schnorr.h"
+#include "scrape_ldt.h"
+#include "threshold.h"
+#include "openssl_hashing_tools.h"
+#include "vrf_metrics.h"
+
+#define WEIGHTED_SUM_MAX_TERMS 256
+// signatures (under as many keys) verified together by schnorr_verify_batch
+#define SCHNORR_BATCH_SIGS 256
+// parties of the SCRAPE low-degree tests, commitments to a polynomial of degree n / 2 - 1
+static const int scrape_ldt_parties[] = { 64, 512, 4096 };
+#define SCRAPE_LDT_SIZES (int)(sizeof(scrape_ldt_parties) / sizeof(int))
+// shares combined by threshold_combine
+#define THRESHOLD_SHARES 100
+
+// inputs shared by all benchmarks, set up once before the first one runs
+static struct {
+    const EC_GROUP *group;
+    BN_CTX *ctx;
+    EC_KEY *ec_key;
+    unsigned char digest[32];
+    ECDSA_SIG *signature;
+    key_pair kp;
+    BIGNUM *seed;
+    BIGNUM *randval;
+    EC_POINT *u;
+    nizk_dl_eq_proof pi;
+    unsigned char output[VRF_OUTPUT_BYTES];
+    EC_POINT *pub; // decoded, as received
+    BIGNUM *slot_seed;
+    uint64_t slot;
+    BIGNUM *threshold;
+    BIGNUM *exp;
+    EC_POINT *a, *A, *b, *B;
+    nizk_dl_eq_proof nizk_pi;
+    transcript vrf_prefix; // proof transcript with the generator and kp.pub absorbed
+    BIGNUM *scalar;
+    EC_POINT *point;
+    EC_POINT *r;
+    BIGNUM *w[WEIGHTED_SUM_MAX_TERMS];
+    EC_POINT *p[WEIGHTED_SUM_MAX_TERMS];
+    scalar_vec *w_vec; // w and p as contiguous vectors
+    point_vec *p_vec;
+    BIGNUM *schnorr_priv;
+    const EC_POINT *schnorr_pub[SCHNORR_BATCH_SIGS]; // decoded, as received
+    const unsigned char *schnorr_msg[SCHNORR_BATCH_SIGS];
+    size_t schnorr_msg_len[SCHNORR_BATCH_SIGS];
+    schnorr_sig schnorr_sigs[SCHNORR_BATCH_SIGS]; // decoded, as received
+    scrape_ldt *ldt[SCRAPE_LDT_SIZES];
+    EC_POINT **ldt_C[SCRAPE_LDT_SIZES];
+    int threshold_x[THRESHOLD_SHARES];
+    EC_POINT *threshold_shares[THRESHOLD_SHARES];
+    threshold_cache *threshold_cache;
+    int failed;
+} f;
+
+static void fixture_init(void) {
+    f.group = get0_group();
+    f.ctx = BN_CTX_new();
+    const BIGNUM *order = get0_order(f.group);
+    f.ec_key = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+    if (!f.ec_key || EC_KEY_generate_key(f.ec_key) != 1) {
+        fprintf(stderr, "cannot generate ECDSA key\n");
+        exit(2);
+    }
+    SHA256((const unsigned char *)"vrf_bench", 9, f.digest);
+    f.signature = ECDSA_do_sign(f.digest, sizeof(f.digest), f.ec_key);
+    key_pair_generate(f.group, &f.kp, f.ctx);
+    f.seed = bn_random(order, f.ctx);
+    f.u = point_new(f.group);
+    prove_vrf(f.group, f.seed, &f.randval, f.u, &f.pi, &f.kp, NULL, f.ctx);
+    unsigned char pub_bytes[P256_POINT_BYTES];
+    f.pub = point_new(f.group);
+    if (vrf_output_to_bytes(f.group, f.u, &f.pi, f.randval, PRAOS_VRF_SUITE_LEGACY, f.output, f.ctx) || point_to_bytes(f.group, f.kp.pub, pub_bytes, f.ctx) ||
+        point_from_bytes(f.group, f.pub, pub_bytes, f.ctx)) {
+        fprintf(stderr, "cannot encode VRF output\n");
+        exit(2);
+    }
+    f.slot_seed = bn_new();
+    f.threshold = bn_new();
+    BN_set_bit(f.threshold, 256);
+    BN_div_word(f.threshold, 20); // 5% of the slots won
+    f.exp = bn_random(order, f.ctx);
+    f.a = point_random(f.group, f.ctx);
+    f.b = point_random(f.group, f.ctx);
+    f.A = point_new(f.group);
+    f.B = point_new(f.group);
+    point_mul(f.group, f.A, f.exp, f.a, f.ctx);
+    point_mul(f.group, f.B, f.exp, f.b, f.ctx);
+    nizk_dl_eq_prove(f.group, f.exp, f.a, f.A, f.b, f.B, &f.nizk_pi, f.ctx);
+    nizk_dl_eq_transcript_prefix(f.group, &f.vrf_prefix, get0_generator(f.group), f.kp.pub, NULL, f.ctx);
+    f.scalar = bn_random(order, f.ctx);
+    f.point = point_random(f.group, f.ctx);
+    f.r = point_new(f.group);
+    for (int i=0; i<WEIGHTED_SUM_MAX_TERMS; i++) {
+        f.w[i] = bn_random(order, f.ctx);
+        f.p[i] = point_random(f.group, f.ctx);
+    }
+    f.w_vec = scalar_vec_new(WEIGHTED_SUM_MAX_TERMS);
+    f.p_vec = point_vec_new(WEIGHTED_SUM_MAX_TERMS);
+    scalar_vec_from_bns(f.group, f.w_vec, (const BIGNUM**)f.w, f.ctx);
+    point_vec_from_points(f.group, f.p_vec, (const EC_POINT**)f.p, f.ctx);
+    for (int i=0; i<SCHNORR_BATCH_SIGS; i++) {
+        BIGNUM *priv = bn_random(order, f.ctx);
+        EC_POINT *pub = bn2point(f.group, priv, f.ctx);
+        EC_POINT *pub_decoded = point_new(f.group);
+        schnorr_sig sig;
+        unsigned char buf[SCHNORR_SIG_BYTES];
+        schnorr_sign(f.group, priv, pub, f.digest, sizeof(f.digest), &sig, f.ctx);
+        if (point_to_bytes(f.group, pub, pub_bytes, f.ctx) || point_from_bytes(f.group, pub_decoded, pub_bytes, f.ctx) ||
+            schnorr_sig_to_bytes(f.group, &sig, buf, f.ctx) || schnorr_sig_from_bytes(f.group, &f.schnorr_sigs[i], buf, f.ctx)) {
+            fprintf(stderr, "cannot encode Schnorr signature\n");
+            exit(2);
+        }
+        f.schnorr_pub[i] = pub_decoded;
+        f.schnorr_msg[i] = f.digest;
+        f.schnorr_msg_len[i] = sizeof(f.digest);
+        schnorr_sig_free(&sig);
+        point_free(pub);
+        if (i == 0) {
+            f.schnorr_priv = priv; // signs in schnorr_sign
+        } else {
+            bn_free(priv);
+        }
+    }
+    for (int k=0; k<SCRAPE_LDT_SIZES; k++) {
+        int n = scrape_ldt_parties[k];
+        f.ldt[k] = scrape_ldt_new(f.group, n, n / 2 - 1, f.ctx);
+        f.ldt_C[k] = malloc(n * sizeof(EC_POINT*));
+        if (!f.ldt_C[k]) {
+            fprintf(stderr, "cannot allocate commitments\n");
+            exit(2);
+        }
+        // C_i = [(i + exp)^(n/2-1)]G
+        BIGNUM *e = bn_new();
+        BIGNUM *y = bn_new();
+        BN_set_word(e, n / 2 - 1);
+        for (int i=0; i<n; i++) {
+            BN_copy(y, f.exp);
+            BN_add_word(y, i + 1);
+            BN_mod_exp(y, y, e, order, f.ctx);
+            f.ldt_C[k][i] = bn2point(f.group, y, f.ctx);
+        }
+        bn_free(y);
+        bn_free(e);
+    }
+    for (int i=0; i<THRESHOLD_SHARES; i++) {
+        f.threshold_x[i] = 3 * i + 1;
+        f.threshold_shares[i] = point_random(f.group, f.ctx);
+    }
+    f.threshold_cache = threshold_cache_new(f.group, 1);
+}
+
+static void fixture_free(void) {
+    threshold_cache_free(f.threshold_cache);
+    for (int i=0; i<THRESHOLD_SHARES; i++) {
+        point_free(f.threshold_shares[i]);
+    }
+    for (int k=0; k<SCRAPE_LDT_SIZES; k++) {
+        for (int i=0; i<scrape_ldt_parties[k]; i++) {
+            point_free(f.ldt_C[k][i]);
+        }
+        free(f.ldt_C[k]);
+        scrape_ldt_free(f.ldt[k]);
+    }
+    for (int i=0; i<SCHNORR_BATCH_SIGS; i++) {
+        schnorr_sig_free(&f.schnorr_sigs[i]);
+        point_free((EC_POINT*)f.schnorr_pub[i]);
+    }
+    bn_free(f.schnorr_priv);
+    point_vec_free(f.p_vec);
+    scalar_vec_free(f.w_vec);
+    for (int i=0; i<WEIGHTED_SUM_MAX_TERMS; i++) {
+        bn_free(f.w[i]);
+        point_free(f.p[i]);
+    }
+    point_free(f.r);
+    point_free(f.point);
+    bn_free(f.scalar);
+    nizk_dl_eq_proof_free(&f.nizk_pi);
+    point_free(f.a);
+    point_free(f.A);
+    point_free(f.b);
+    point_free(f.B);
+    bn_free(f.exp);
+    bn_free(f.threshold);
+    bn_free(f.slot_seed);
+    point_free(f.pub);
+    nizk_dl_eq_proof_free(&f.pi);
+    point_free(f.u);
+    bn_free(f.randval);
+    bn_free(f.seed);
+    key_pair_free(&f.kp);
+    ECDSA_SIG_free(f.signature);
+    EC_KEY_free(f.ec_key);
+    BN_CTX_free(f.ctx);
+}
+
+/* benchmarked operations, each runs its operation iters times */
+
+static void bench_ecdsa_keygen(long iters) {
+    for (long i=0; i<iters; i++) {
+        f.failed |= EC_KEY_generate_key(f.ec_key) != 1;
+    }
+    // keep the signature valid for ecdsa_verify
+    ECDSA_SIG_free(f.signature);
+    f.signature = ECDSA_do_sign(f.digest, sizeof(f.digest), f.ec_key);
+}
+
+static void bench_ecdsa_sign(long iters) {
+    for (long i=0; i<iters; i++) {
+        ECDSA_SIG *sig = ECDSA_do_sign(f.digest, sizeof(f.digest), f.ec_key);
+        f.failed |= sig == NULL;
+        ECDSA_SIG_free(sig);
+    }
+}
+
+static void bench_ecdsa_verify(long iters) {
+    for (long i=0; i<iters; i++) {
+        f.failed |= ECDSA_do_verify(f.digest, sizeof(f.digest), f.signature, f.ec_key) != 1;
+    }
+}
+
+static void bench_schnorr_sign(long iters) {
+    for (long i=0; i<iters; i++) {
+        schnorr_sig sig;
+        schnorr_sign(f.group, f.schnorr_priv, f.schnorr_pub[0], f.digest, sizeof(f.digest), &sig, f.ctx);
+        schnorr_sig_free(&sig);
+    }
+}
+
+static void bench_schnorr_verify(long iters) {
+    for (long i=0; i<iters; i++) {
+        f.failed |= schnorr_verify(f.group, f.schnorr_pub[0], f.digest, sizeof(f.digest), &f.schnorr_sigs[0], f.ctx);
+    }
+}
+
+// one operation is one signature of a batch of SCHNORR_BATCH_SIGS under different keys
+static void bench_schnorr_verify_batch(long iters) {
+    for (long i=0; i<iters; i+=SCHNORR_BATCH_SIGS) {
+        int num = iters - i < SCHNORR_BATCH_SIGS ? (int)(iters - i) : SCHNORR_BATCH_SIGS;
+        f.failed |= schnorr_verify_batch(f.group, num, f.schnorr_pub, f.schnorr_msg, f.schnorr_msg_len, f.schnorr_sigs, NULL, f.ctx);
+    }
+}
+
+static void scrape_ldt_run(long iters, int k) {
+    for (long i=0; i<iters; i++) {
+        f.failed |= scrape_ldt_verify(f.ldt[k], (const EC_POINT**)f.ldt_C[k], 0, NULL, NULL, f.ctx);
+    }
+}
+
+static void bench_scrape_ldt_64(long iters) {
+    scrape_ldt_run(iters, 0);
+}
+
+static void bench_scrape_ldt_512(long iters) {
+    scrape_ldt_run(iters, 1);
+}
+
+static void bench_scrape_ldt_4096(long iters) {
+    scrape_ldt_run(iters, 2);
+}
+
+static void bench_threshold_lagrange(long iters) {
+    BIGNUM **lambda = bn_new_array(THRESHOLD_SHARES);
+    for (long i=0; i<iters; i++) {
+        f.failed |= threshold_lagrange_coeffs(f.group, THRESHOLD_SHARES, f.threshold_x, lambda, f.ctx);
+    }
+    bn_free_array(THRESHOLD_SHARES, lambda);
+}
+
+// coefficients from the cache after the first iteration
+static void bench_threshold_combine(long iters) {
+    for (long i=0; i<iters; i++) {
+        f.failed |= threshold_combine(f.group, f.threshold_cache, f.r, THRESHOLD_SHARES, f.threshold_x, (const EC_POINT**)f.threshold_shares, f.ctx);
+    }
+}
+
+static void bench_vrf_keygen(long iters) {
+    for (long i=0; i<iters; i++) {
+        key_pair kp;
+        key_pair_generate(f.group, &kp, f.ctx);
+        key_pair_free(&kp);
+    }
+}
+
+static void bench_vrf_prove(long iters) {
+    for (long i=0; i<iters; i++) {
+        BIGNUM *randval;
+        nizk_dl_eq_proof pi;
+        prove_vrf(f.group, f.seed, &randval, f.r, &pi, &f.kp, NULL, f.ctx);
+        nizk_dl_eq_proof_free(&pi);
+        bn_free(randval);
+    }
+}
+
+static void bench_vrf_evaluate(long iters) {
+    for (long i=0; i<iters; i++) {
+        vrf_eval eval;
+        vrf_evaluate(f.group, f.seed, &f.kp, &eval, NULL, f.ctx);
+        vrf_eval_free(&eval);
+    }
+}
+
+// one operation is one slot of an epoch with 5% of the slots won, proofs only for those
+static void bench_vrf_epoch_slot(long iters) {
+    for (long i=0; i<iters; i++) {
+        leader_schedule_slot_seed(f.slot_seed, f.digest, sizeof(f.digest), f.slot++);
+        vrf_eval eval;
+        nizk_dl_eq_proof pi;
+        vrf_evaluate(f.group, f.slot_seed, &f.kp, &eval, NULL, f.ctx);
+        if (vrf_prove_from_eval(f.group, &eval, &f.kp, vrf_randval_below, f.threshold, &pi, f.ctx)) {
+            nizk_dl_eq_proof_free(&pi);
+        }
+        vrf_eval_free(&eval);
+    }
+}
+
+static void bench_vrf_verify(long iters) {
+    praos_vrf_params params = { PRAOS_VRF_SUITE_LEGACY, NULL, NULL };
+    for (long i=0; i<iters; i++) {
+        f.failed |= verify_vrf(f.group, f.seed, f.randval, f.u, &f.pi, f.kp.pub, &params, f.ctx);
+    }
+}
+
+static void bench_vrf_verify_cached(long iters) {
+    praos_vrf_params params = { PRAOS_VRF_SUITE_LEGACY, get0_seed_cache(), NULL };
+    for (long i=0; i<iters; i++) {
+        f.failed |= verify_vrf(f.group, f.seed, f.randval, f.u, &f.pi, f.kp.pub, &params, f.ctx);
+    }
+}
+
+// repeated encoded output answered by the verify cache
+static void bench_vrf_verify_cache_hit(long iters) {
+    praos_vrf_params params = { PRAOS_VRF_SUITE_LEGACY, NULL, get0_verify_cache() };
+    for (long i=0; i<iters; i++) {
+        f.failed |= verify_vrf_bytes(f.group, f.seed, f.output, f.pub, &params, f.ctx);
+    }
+}
+
+static void bench_nizk_prove(long iters) {
+    for (long i=0; i<iters; i++) {
+        nizk_dl_eq_proof pi;
+        nizk_dl_eq_prove(f.group, f.exp, f.a, f.A, f.b, f.B, &pi, f.ctx);
+        nizk_dl_eq_proof_free(&pi);
+    }
+}
+
+static void bench_nizk_verify(long iters) {
+    for (long i=0; i<iters; i++) {
+        f.failed |= nizk_dl_eq_verify(f.group, f.a, f.A, f.b, f.B, &f.nizk_pi, f.ctx);
+    }
+}
+
+static void bench_hash_transcript(long iters) {
+    for (long i=0; i<iters; i++) {
+        BIGNUM *c = openssl_hash_points2bn(f.group, f.ctx, 6, f.a, f.A, f.b, f.B, f.nizk_pi.Ra, f.nizk_pi.Rb);
+        bn_free(c);
+    }
+}
+
+// the rest of a proof transcript after a precomputed prefix (VRF proofs under one key)
+static void bench_transcript_challenge(long iters) {
+    static const char *const labels[] = { "a", "A", "Ra", "Rb" };
+    const EC_POINT *points[] = { f.a, f.A, f.nizk_pi.Ra, f.nizk_pi.Rb };
+    BIGNUM *c = bn_new();
+    for (long i=0; i<iters; i++) {
+        transcript t;
+        transcript_clone(&t, &f.vrf_prefix);
+        transcript_absorb_points(&t, f.group, 4, labels, points, f.ctx);
+        transcript_challenge(&t, "c", c, get0_order(f.group), f.ctx);
+    }
+    bn_free(c);
+}
+
+static void bench_hash_randval(long iters) {
+    for (long i=0; i<iters; i++) {
+        BIGNUM *c = openssl_hash_points2bn(f.group, f.ctx, 2, f.a, f.u);
+        bn_free(c);
+    }
+}
+
+static void bench_sha256_64(long iters) {
+    unsigned char buf[64] = { 0 };
+    for (long i=0; i<iters; i++) {
+        SHA256_CTX sha_ctx;
+        openssl_hash_init(&sha_ctx);
+        openssl_hash_update(&sha_ctx, buf, sizeof(buf));
+        openssl_hash_final(buf, &sha_ctx);
+    }
+}
+
+static void bench_point_mul(long iters) {
+    for (long i=0; i<iters; i++) {
+        point_mul(f.group, f.r, f.scalar, f.point, f.ctx);
+    }
+}
+
+static void bench_point_mul_generator(long iters) {
+    for (long i=0; i<iters; i++) {
+        bn2point_r(f.group, f.r, f.scalar, f.ctx);
+    }
+}
+
+static void bench_point_add(long iters) {
+    for (long i=0; i<iters; i++) {
+        point_add(f.group, f.r, f.point, f.a, f.ctx);
+    }
+}
+
+static void weighted_sum(long iters, int num_terms) {
+    for (long i=0; i<iters; i++) {
+        point_weighted_sum(f.group, f.r, num_terms, (const BIGNUM**)f.w, (const EC_POINT**)f.p, f.ctx);
+    }
+}
+
+static void bench_weighted_sum_2(long iters) {
+    weighted_sum(iters, 2);
+}
+
+static void bench_weighted_sum_16(long iters) {
+    weighted_sum(iters, 16);
+}
+
+static void bench_weighted_sum_256(long iters) {
+    weighted_sum(iters, 256);
+}
+
+static void bench_weighted_sum_vec_256(long iters) {
+    for (long i=0; i<iters; i++) {
+        point_weighted_sum_vec(f.group, f.r, f.w_vec, f.p_vec, f.ctx);
+    }
+}
+
+static void bench_hash_point_list_256(long iters) {
+    BIGNUM *c = bn_new();
+    for (long i=0; i<iters; i++) {
+        openssl_hash_point_list2bn_r(c, f.group, f.ctx, WEIGHTED_SUM_MAX_TERMS, (const EC_POINT**)f.p);
+    }
+    bn_free(c);
+}
+
+static void bench_hash_point_vec_256(long iters) {
+    BIGNUM *c = bn_new();
+    for (long i=0; i<iters; i++) {
+        openssl_hash_point_vec2bn_r(c, f.p_vec);
+    }
+    bn_free(c);
+}
+
+// one operation is one slot of a single-threaded leader schedule (5% stake, f = 0.05)
+static void bench_leader_schedule_slot(long iters) {
+    unsigned char threshold[LEADER_SCHEDULE_THRESHOLD_BYTES];
+    leader_schedule_threshold(threshold, 0.05, 0.05);
+    leader_schedule *schedule = leader_schedule_compute(f.group, &f.kp, f.digest, sizeof(f.digest), 0, iters, threshold, 1, NULL);
+    leader_schedule_free(schedule);
+}
+
+typedef struct {
+    const char *name;
+    void (*run)(long iters);
+} benchmark;
+
+static const benchmark benchmarks[] = {
+    { "ecdsa_keygen", bench_ecdsa_keygen },
+    { "ecdsa_sign", bench_ecdsa_sign },
+    { "ecdsa_verify", bench_ecdsa_verify },
+    { "schnorr_sign", bench_schnorr_sign },
+    { "schnorr_verify", bench_schnorr_verify },
+    { "schnorr_verify_batch_256", bench_schnorr_verify_batch },
+    { "scrape_ldt_verify_64", bench_scrape_ldt_64 },
+    { "scrape_ldt_verify_512", bench_scrape_ldt_512 },
+    { "scrape_ldt_verify_4096", bench_scrape_ldt_4096 },
+    { "threshold_lagrange_100", bench_threshold_lagrange },
+    { "threshold_combine_100", bench_threshold_combine },
+    { "vrf_keygen", bench_vrf_keygen },
+    { "vrf_prove", bench_vrf_prove },
+    { "vrf_evaluate", bench_vrf_evaluate },
+    { "vrf_epoch_slot", bench_vrf_epoch_slot },
+    { "vrf_verify", bench_vrf_verify },
+    { "vrf_verify_cached", bench_vrf_verify_cached },
+    { "vrf_verify_cache_hit", bench_vrf_verify_cache_hit },
+    { "nizk_prove", bench_nizk_prove },
+    { "nizk_verify", bench_nizk_verify },
+    { "hash_transcript_6", bench_hash_transcript },
+    { "transcript_prefix_challenge_4", bench_transcript_challenge },
+    { "hash_randval_2", bench_hash_randval },
+    { "sha256_64", bench_sha256_64 },
+    { "point_mul", bench_point_mul },
+    { "point_mul_generator", bench_point_mul_generator },
+    { "point_add", bench_point_add },
+    { "weighted_sum_2", bench_weighted_sum_2 },
+    { "weighted_sum_16", bench_weighted_sum_16 },
+    { "weighted_sum_256", bench_weighted_sum_256 },
+    { "weighted_sum_vec_256", bench_weighted_sum_vec_256 },
+    { "hash_point_list_256", bench_hash_point_list_256 },
+    { "hash_point_vec_256", bench_hash_point_vec_256 },
+    { "leader_schedule_slot", bench_leader_schedule_slot }
+};
+
+/* measurement */
+
+typedef struct {
+    const char *name;
+    long iters;         // operations per sample
+    int num_samples;
+    double min, median, p99, mean; // seconds per operation
+    double cycles;      // median time stamp counter cycles per operation, 0 without a counter
+    platform_perf_values perf; // hardware events over all samples (with -p)
+    uint64_t max_rss;   // peak resident memory of the process after the benchmark, bytes
+} result;
+
+static double time_run(const benchmark *bench, long iters, double *cycles) {
+    platform_time_type start = platform_utils_get_wall_time();
+    uint64_t start_cycles = platform_utils_get_cycles();
+    bench->run(iters);
+    uint64_t end_cycles = platform_utils_get_cycles();
+    platform_time_type end = platform_utils_get_wall_time();
+    if (cycles) {
+        *cycles = (double)(end_cycles - start_cycles);
+    }
+    return platform_utils_get_wall_time_diff(start, end);
+}
+
+static int cmp_double(const void *x, const void *y) {
+    double a = *(const double*)x;
+    double b = *(const double*)y;
+    return (a > b) - (a < b);
+}
+
+// nearest rank percentile of sorted values
+static double percentile(const double *sorted, int num, double pct) {
+    int rank = (int)(pct / 100.0 * num + 0.999999);
+    rank = rank < 1 ? 1 : rank > num ? num : rank;
+    return sorted[rank - 1];
+}
+
+static void measure(const benchmark *bench, double warmup_time, double sample_time, int num_samples, int count_events, result *res) {
+    // warmup (caches, lazy tables, CPU frequency), then double the iterations until a sample takes sample_time
+    double spent = 0;
+    long iters = 1;
+    while (spent < warmup_time) {
+        spent += time_run(bench, iters, NULL);
+        iters *= 2;
+    }
+    iters = 1;
+    double t;
+    while ((t = time_run(bench, iters, NULL)) < sample_time && iters < (1L << 30)) {
+        iters = t > 0 && sample_time / t < 2 ? (long)(iters * sample_time / t) + 1 : iters * 2;
+    }
+
+    double *per_op = malloc(2 * num_samples * sizeof(double));
+    if (!per_op) {
+        fprintf(stderr, "cannot allocate samples\n");
+        exit(2);
+    }
+    double *cycles_per_op = per_op + num_samples;
+    double sum = 0;
+    platform_perf_counters pc;
+    if (count_events) {
+        platform_utils_perf_start(&pc);
+    }
+    for (int s=0; s<num_samples; s++) {
+        per_op[s] = time_run(bench, iters, &cycles_per_op[s]) / iters;
+        cycles_per_op[s] /= iters;
+        sum += per_op[s];
+    }
+    res->perf.valid = 0;
+    if (count_events) {
+        platform_utils_perf_stop(&pc, &res->perf);
+        for (int e=0; e<PLATFORM_PERF_NUM_EVENTS; e++) {
+            res->perf.count[e] /= (uint64_t)iters * num_samples;
+        }
+    }
+    qsort(per_op, num_samples, sizeof(double), cmp_double);
+    qsort(cycles_per_op, num_samples, sizeof(double), cmp_double);
+    res->name = bench->name;
+    res->iters = iters;
+    res->num_samples = num_samples;
+    res->min = per_op[0];
+    res->median = percentile(per_op, num_samples, 50);
+    res->p99 = percentile(per_op, num_samples, 99);
+    res->mean = sum / num_samples;
+    res->cycles = platform_utils_has_cycle_counter() ? percentile(cycles_per_op, num_samples, 50) : 0;
+    res->max_rss = platform_utils_get_max_memory_usage();
+    free(per_op);
+}
+
+enum {
+    FORMAT_TEXT,
+    FORMAT_JSON,
+    FORMAT_CSV
+};
+
+static const char *perf_event_names[PLATFORM_PERF_NUM_EVENTS] = {
+    "cycles", "instructions", "cache_misses", "branch_misses"
+};
+
+static void print_header(int format, int count_events) {
+    if (format == FORMAT_TEXT) {
+        printf("%-22s %10s %8s %12s %12s %12s %12s %12s %12s %10s", "benchmark", "iters", "samples", "min us", "median us",
+               "p99 us", "mean us", "ops/s", "tsc cycles", "max RSS kB");
+        for (int e=0; count_events && e<PLATFORM_PERF_NUM_EVENTS; e++) {
+            printf(" %14s", perf_event_names[e]);
+        }
+        printf("\n");
+    } else if (format == FORMAT_JSON) {
+        printf("[\n");
+    } else {
+        printf("name,iterations,samples,min_ns,median_ns,p99_ns,mean_ns,ops_per_sec,tsc_cycles,max_rss_bytes");
+        for (int e=0; count_events && e<PLATFORM_PERF_NUM_EVENTS; e++) {
+            printf(",%s", perf_event_names[e]);
+        }
+        printf("\n");
+    }
+}
+
+// counted events per operation, unavailable ones as "-" (text), null (JSON) or empty (CSV)
+static void print_perf(int format, const result *res) {
+    for (int e=0; e<PLATFORM_PERF_NUM_EVENTS; e++) {
+        int valid = (res->perf.valid >> e) & 1;
+        unsigned long long count = res->perf.count[e];
+        if (format == FORMAT_TEXT) {
+            valid ? printf(" %14llu", count) : printf(" %14s", "-");
+        } else if (format == FORMAT_JSON) {
+            valid ? printf(", \"%s\": %llu", perf_event_names[e], count) : printf(", \"%s\": null", perf_event_names[e]);
+        } else {
+            valid ? printf(",%llu", count) : printf(",");
+        }
+    }
+}
+
+static void print_result(int format, int count_events, const result *res, int first) {
+    double ops = res->median > 0 ? 1 / res->median : 0;
+    unsigned long long max_rss = res->max_rss;
+    if (format == FORMAT_TEXT) {
+        printf("%-22s %10ld %8d %12.3f %12.3f %12.3f %12.3f %12.1f %12.0f %10llu", res->name, res->iters, res->num_samples,
+               res->min * 1e6, res->median * 1e6, res->p99 * 1e6, res->mean * 1e6, ops, res->cycles, max_rss / 1024);
+    } else if (format == FORMAT_JSON) {
+        printf("%s  {\"name\": \"%s\", \"iterations\": %ld, \"samples\": %d, \"min_ns\": %.1f, \"median_ns\": %.1f, "
+               "\"p99_ns\": %.1f, \"mean_ns\": %.1f, \"ops_per_sec\": %.1f, \"tsc_cycles\": %.0f, \"max_rss_bytes\": %llu",
+               first ? "" : ",\n", res->name, res->iters, res->num_samples, res->min * 1e9, res->median * 1e9,
+               res->p99 * 1e9, res->mean * 1e9, ops, res->cycles, max_rss);
+    } else {
+        printf("%s,%ld,%d,%.1f,%.1f,%.1f,%.1f,%.1f,%.0f,%llu", res->name, res->iters, res->num_samples,
+               res->min * 1e9, res->median * 1e9, res->p99 * 1e9, res->mean * 1e9, ops, res->cycles, max_rss);
+    }
+    if (count_events) {
+        print_perf(format, res);
+    }
+    printf(format == FORMAT_JSON ? "}" : "\n");
+    fflush(stdout);
+}
+
+static void print_footer(int format) {
+    if (format == FORMAT_JSON) {
+        printf("\n]\n");
+    }
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: vrf_bench [-f text|json|csv] [-n samples] [-s sample_ms] [-w warmup_ms] [-p] [-m metrics.json] [-l] [NAME...]\n"
+            "  runs the benchmarks whose name contains one of the NAMEs (all without NAME), -l lists them\n"
+            "  -p adds hardware event counts per operation (Linux perf events)\n"
+            "  -m records operation metrics (vrf_metrics.h) during the run and writes the snapshot to the file\n");
+}
+
+int main(int argc, char *argv[]) {
+    int format = FORMAT_TEXT;
+    int num_samples = 50;
+    double sample_time = 0.005;
+    double warmup_time = 0.1;
+    int count_events = 0;
+    const char *metrics_file = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:n:s:w:pm:l")) != -1) {
+        switch (opt) {
+            case 'f':
+                if (!strcmp(optarg, "text")) {
+                    format = FORMAT_TEXT;
+                } else if (!strcmp(optarg, "json")) {
+                    format = FORMAT_JSON;
+                } else if (!strcmp(optarg, "csv")) {
+                    format = FORMAT_CSV;
+                } else {
+                    usage();
+                    return 2;
+                }
+                break;
+            case 'n':
+                num_samples = atoi(optarg);
+                break;
+            case 's':
+                sample_time = atof(optarg) / 1000;
+                break;
+            case 'w':
+                warmup_time = atof(optarg) / 1000;
+                break;
+            case 'p':
+                count_events = 1;
+                break;
+            case 'm':
+                metrics_file = optarg;
+                break;
+            case 'l':
+                for (size_t i=0; i<sizeof(benchmarks)/sizeof(benchmark); i++) {
+                    printf("%s\n", benchmarks[i].name);
+                }
+                return 0;
+            default:
+                usage();
+                return 2;
+        }
+    }
+    if (num_samples <= 0 || sample_time <= 0 || warmup_time < 0) {
+        usage();
+        return 2;
+    }
+
+    fixture_init();
+    if (metrics_file) {
+        vrf_metrics_reset();
+        vrf_metrics_enable(1);
+    }
+    print_header(format, count_events);
+    int first = 1;
+    for (size_t i=0; i<sizeof(benchmarks)/sizeof(benchmark); i++) {
+        int selected = optind == argc;
+        for (int j=optind; j<argc && !selected; j++) {
+            selected = strstr(benchmarks[i].name, argv[j]) != NULL;
+        }
+        if (!selected) {
+            continue;
+        }
+        result res;
+        measure(&benchmarks[i], warmup_time, sample_time, num_samples, count_events, &res);
+        print_result(format, count_events, &res, first);
+        first = 0;
+    }
+    print_footer(format);
+    int failed = f.failed;
+    if (metrics_file) {
+        vrf_metrics_enable(0);
+        vrf_metrics_snapshot *snapshot = malloc(sizeof(vrf_metrics_snapshot));
+        FILE *out = fopen(metrics_file, "w");
+        if (!snapshot || !out) {
+            fprintf(stderr, "cannot write %s\n", metrics_file);
+            failed = 1;
+        } else {
+            vrf_metrics_get_snapshot(snapshot);
+            failed |= vrf_metrics_write_json(out, snapshot);
+        }
+        if (out) {
+            fclose(out);
+        }
+        free(snapshot);
+    }
+    fixture_free();
+    if (failed) {
+        fprintf(stderr, "a benchmarked operation FAILED\n");
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,153 @@
+//
+//  vrf_verify_file.c
+//  OpenSSL-for-iOS tools
+//
+//  Verify a file of stored VRF outputs (see vrf_stream.h), or write one for testing.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "platform_measurement_utils.h"
+#include "vrf_stream.h"
+#include "vrf_engine.h"
+#include "pubkey_registry.h"
+#include "hash_to_curve.h"
+#include "seed_cache.h"
+#include "p256_native.h"
+#include "sha256_mb.h"
+#include "openssl_hashing_tools.h"
+#include "vrf_metrics.h"
+#include "leader_schedule.h"
+#include "verify_cache.h"
+#include "schnorr.h"
+#include "scrape_ldt.h"
+#include "threshold.h"
+#include "transcript.h"
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: vrf_verify_file [-c chunk_records] [-q] [-r] [-x] FILE   verify all records of FILE (-r: skip repeated ones)\n"
+            "       vrf_verify_file -g num_records [-s per_seed] [-x] FILE   write num_records valid records to FILE\n"
+            "       vrf_verify_file -t                                       run the test suites\n"
+            "       -x: hash to curve suite instead of the legacy one\n");
+}
+
+static void print_progress(void *arg, long num_done, long num_records) {
+    fprintf(stderr, "\rverified %ld / %ld records (%.1f%%)", num_done, num_records, 100.0 * num_done / num_records);
+}
+
+static void print_failure(void *arg, long record_index) {
+    printf("record %ld: FAILED\n", record_index);
+}
+
+static int generate(const char *path, long num_records, int per_seed, const praos_vrf_params *params) {
+    const EC_GROUP *group = get0_group();
+    BN_CTX *ctx = BN_CTX_new();
+    unsigned char *records = malloc((size_t)num_records * VRF_STREAM_RECORD_BYTES);
+    if (!records) {
+        fprintf(stderr, "cannot allocate %ld records\n", num_records);
+        return 2;
+    }
+    BIGNUM *seed = NULL;
+    int ret = 0;
+    for (long i=0; i<num_records && !ret; i++) {
+        if (i % per_seed == 0) {
+            if (seed) {
+                bn_free(seed);
+            }
+            seed = bn_random(get0_order(group), ctx);
+        }
+        key_pair kp;
+        key_pair_generate(group, &kp, ctx);
+        BIGNUM *randval;
+        EC_POINT *u = point_new(group);
+        nizk_dl_eq_proof pi;
+        prove_vrf(group, seed, &randval, u, &pi, &kp, params, ctx);
+        ret = vrf_stream_record_to_bytes(group, seed, kp.pub, u, &pi, randval, params->suite, records + (size_t)i * VRF_STREAM_RECORD_BYTES, ctx);
+        nizk_dl_eq_proof_free(&pi);
+        point_free(u);
+        bn_free(randval);
+        key_pair_free(&kp);
+    }
+    if (seed) {
+        bn_free(seed);
+    }
+    ret = ret || vrf_stream_save(path, num_records, records);
+    free(records);
+    BN_CTX_free(ctx);
+    if (ret) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return 2;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int chunk_records = 1024;
+    int quiet = 0;
+    int result_cache = 0;
+    long num_generate = 0;
+    int per_seed = 1;
+    praos_vrf_params params = { PRAOS_VRF_SUITE_LEGACY, NULL, NULL };
+    int opt;
+    while ((opt = getopt(argc, argv, "c:qrg:s:xt")) != -1) {
+        switch (opt) {
+            case 'c':
+                chunk_records = atoi(optarg);
+                break;
+            case 'q':
+                quiet = 1;
+                break;
+            case 'r':
+                result_cache = 1;
+                break;
+            case 'g':
+                num_generate = atol(optarg);
+                break;
+            case 's':
+                per_seed = atoi(optarg);
+                break;
+            case 'x':
+                params.suite = PRAOS_VRF_SUITE_P256_SSWU;
+                break;
+            case 't':
+                return p256_test_suite(1) | p256_native_test_suite(1) | nizk_dl_eq_test_suite(1) | openssl_hashing_tools_test_suite(1) | hash_to_curve_test_suite(1) | sha256_mb_test_suite(1) | praos_vrf_test_suite(1) | seed_cache_test_suite(1) |
+                       pubkey_registry_test_suite(1) | vrf_engine_test_suite(1) | vrf_stream_test_suite(1) | vrf_metrics_test_suite(1) |
+                       leader_schedule_test_suite(1) | verify_cache_test_suite(1) | schnorr_test_suite(1) |
+                       transcript_test_suite(1) | scrape_ldt_test_suite(1) | threshold_test_suite(1);
+            default:
+                usage();
+                return 2;
+        }
+    }
+    if (optind != argc - 1 || chunk_records <= 0 || per_seed <= 0 || num_generate < 0) {
+        usage();
+        return 2;
+    }
+    const char *path = argv[optind];
+    if (num_generate > 0) {
+        return generate(path, num_generate, per_seed, &params);
+    }
+
+    if (result_cache) {
+        params.verify_cache = get0_verify_cache();
+    }
+    vrf_stream_callbacks cb = { quiet ? NULL : print_progress, print_failure, NULL };
+    platform_time_type start = platform_utils_get_wall_time();
+    long num_failed = vrf_stream_verify_file(path, chunk_records, &params, &cb);
+    platform_time_type end = platform_utils_get_wall_time();
+    if (num_failed < 0) {
+        fprintf(stderr, "cannot read %s (missing file or not a VRF proof file)\n", path);
+        return 2;
+    }
+    if (!quiet) {
+        fprintf(stderr, "\n%ld records failed, %.3f s\n", num_failed, platform_utils_get_wall_time_diff(start, end));
+        if (result_cache) {
+            verify_cache_stats stats;
+            verify_cache_get_stats(get0_verify_cache(), &stats);
+            fprintf(stderr, "verify cache: %ld hits, %ld misses (%.1f%% hit rate), %ld evictions, %d of %d entries, %zu kB\n", stats.hits, stats.misses,
+                    stats.hits + stats.misses ? 100.0 * stats.hits / (stats.hits + stats.misses) : 0.0, stats.evictions, stats.num_entries, stats.capacity, stats.memory_bytes / 1024);
+        }
+    }
+    return num_failed ? 1 : 0;
+}